@@ -0,0 +1 @@
+#include "/root/repo/src/network/utils/broadcom-egress-queue.h"
@@ -0,0 +1 @@
+#include "/root/repo/src/network/utils/flow-id-tag.h"
@@ -0,0 +1,127 @@
+#ifdef NS3_MODULE_COMPILATION 
+    error "Do not include ns3 module aggregator headers from other modules these are meant only for end user scripts." 
+#endif 
+#ifndef NS3_MODULE_INTERNET
+    // Module headers: 
+    #include <ns3/internet-stack-helper.h>
+    #include <ns3/internet-trace-helper.h>
+    #include <ns3/ipv4-address-helper.h>
+    #include <ns3/ipv4-global-routing-helper.h>
+    #include <ns3/ipv4-interface-container.h>
+    #include <ns3/ipv4-list-routing-helper.h>
+    #include <ns3/ipv4-routing-helper.h>
+    #include <ns3/ipv4-static-routing-helper.h>
+    #include <ns3/ipv6-address-helper.h>
+    #include <ns3/ipv6-interface-container.h>
+    #include <ns3/ipv6-list-routing-helper.h>
+    #include <ns3/ipv6-routing-helper.h>
+    #include <ns3/ipv6-static-routing-helper.h>
+    #include <ns3/neighbor-cache-helper.h>
+    #include <ns3/rip-helper.h>
+    #include <ns3/ripng-helper.h>
+    #include <ns3/rdma.h>
+    #include <ns3/arp-cache.h>
+    #include <ns3/arp-header.h>
+    #include <ns3/arp-l3-protocol.h>
+    #include <ns3/arp-queue-disc-item.h>
+    #include <ns3/candidate-queue.h>
+    #include <ns3/global-route-manager-impl.h>
+    #include <ns3/global-route-manager.h>
+    #include <ns3/global-router-interface.h>
+    #include <ns3/icmpv4-l4-protocol.h>
+    #include <ns3/icmpv4.h>
+    #include <ns3/icmpv6-header.h>
+    #include <ns3/icmpv6-l4-protocol.h>
+    #include <ns3/ip-l4-protocol.h>
+    #include <ns3/ipv4-address-generator.h>
+    #include <ns3/ipv4-end-point-demux.h>
+    #include <ns3/ipv4-end-point.h>
+    #include <ns3/ipv4-global-routing.h>
+    #include <ns3/ipv4-header.h>
+    #include <ns3/ipv4-interface-address.h>
+    #include <ns3/ipv4-interface.h>
+    #include <ns3/ipv4-l3-protocol.h>
+    #include <ns3/ipv4-list-routing.h>
+    #include <ns3/ipv4-packet-filter.h>
+    #include <ns3/ipv4-packet-info-tag.h>
+    #include <ns3/ipv4-packet-probe.h>
+    #include <ns3/ipv4-queue-disc-item.h>
+    #include <ns3/ipv4-raw-socket-factory.h>
+    #include <ns3/ipv4-raw-socket-impl.h>
+    #include <ns3/ipv4-route.h>
+    #include <ns3/ipv4-routing-protocol.h>
+    #include <ns3/ipv4-routing-table-entry.h>
+    #include <ns3/ipv4-static-routing.h>
+    #include <ns3/ipv4.h>
+    #include <ns3/ipv6-address-generator.h>
+    #include <ns3/ipv6-end-point-demux.h>
+    #include <ns3/ipv6-end-point.h>
+    #include <ns3/ipv6-extension-demux.h>
+    #include <ns3/ipv6-extension-header.h>
+    #include <ns3/ipv6-extension.h>
+    #include <ns3/ipv6-header.h>
+    #include <ns3/ipv6-interface-address.h>
+    #include <ns3/ipv6-interface.h>
+    #include <ns3/ipv6-l3-protocol.h>
+    #include <ns3/ipv6-list-routing.h>
+    #include <ns3/ipv6-option-header.h>
+    #include <ns3/ipv6-option.h>
+    #include <ns3/ipv6-packet-filter.h>
+    #include <ns3/ipv6-packet-info-tag.h>
+    #include <ns3/ipv6-packet-probe.h>
+    #include <ns3/ipv6-pmtu-cache.h>
+    #include <ns3/ipv6-queue-disc-item.h>
+    #include <ns3/ipv6-raw-socket-factory.h>
+    #include <ns3/ipv6-route.h>
+    #include <ns3/ipv6-routing-protocol.h>
+    #include <ns3/ipv6-routing-table-entry.h>
+    #include <ns3/ipv6-static-routing.h>
+    #include <ns3/ipv6.h>
+    #include <ns3/loopback-net-device.h>
+    #include <ns3/ndisc-cache.h>
+    #include <ns3/rip-header.h>
+    #include <ns3/rip.h>
+    #include <ns3/ripng-header.h>
+    #include <ns3/ripng.h>
+    #include <ns3/rtt-estimator.h>
+    #include <ns3/tcp-bbr.h>
+    #include <ns3/tcp-bic.h>
+    #include <ns3/tcp-congestion-ops.h>
+    #include <ns3/tcp-cubic.h>
+    #include <ns3/tcp-dctcp.h>
+    #include <ns3/tcp-header.h>
+    #include <ns3/tcp-highspeed.h>
+    #include <ns3/tcp-htcp.h>
+    #include <ns3/tcp-hybla.h>
+    #include <ns3/tcp-illinois.h>
+    #include <ns3/tcp-l4-protocol.h>
+    #include <ns3/tcp-ledbat.h>
+    #include <ns3/tcp-linux-reno.h>
+    #include <ns3/tcp-lp.h>
+    #include <ns3/tcp-option-rfc793.h>
+    #include <ns3/tcp-option-sack-permitted.h>
+    #include <ns3/tcp-option-sack.h>
+    #include <ns3/tcp-option-ts.h>
+    #include <ns3/tcp-option-winscale.h>
+    #include <ns3/tcp-option.h>
+    #include <ns3/tcp-prr-recovery.h>
+    #include <ns3/tcp-rate-ops.h>
+    #include <ns3/tcp-recovery-ops.h>
+    #include <ns3/tcp-rx-buffer.h>
+    #include <ns3/tcp-scalable.h>
+    #include <ns3/tcp-socket-base.h>
+    #include <ns3/tcp-socket-factory.h>
+    #include <ns3/tcp-socket-state.h>
+    #include <ns3/tcp-socket.h>
+    #include <ns3/tcp-tx-buffer.h>
+    #include <ns3/tcp-tx-item.h>
+    #include <ns3/tcp-vegas.h>
+    #include <ns3/tcp-veno.h>
+    #include <ns3/tcp-westwood-plus.h>
+    #include <ns3/tcp-yeah.h>
+    #include <ns3/udp-header.h>
+    #include <ns3/udp-l4-protocol.h>
+    #include <ns3/udp-socket-factory.h>
+    #include <ns3/udp-socket.h>
+    #include <ns3/windowed-filter.h>
+#endif 
\ No newline at end of file
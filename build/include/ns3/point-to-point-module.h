@@ -0,0 +1,35 @@
+#ifdef NS3_MODULE_COMPILATION 
+    error "Do not include ns3 module aggregator headers from other modules these are meant only for end user scripts." 
+#endif 
+#ifndef NS3_MODULE_POINT_TO_POINT
+    // Module headers: 
+    #include <ns3/point-to-point-helper.h>
+    #include <ns3/qbb-helper.h>
+    #include <ns3/rdma-route-helper.h>
+    #include <ns3/sim-setting.h>
+    #include <ns3/cn-header.h>
+    #include <ns3/forwarding-table.h>
+    #include <ns3/monitor-writer.h>
+    #include <ns3/nvswitch-node.h>
+    #include <ns3/pause-header.h>
+    #include <ns3/pint.h>
+    #include <ns3/qbb-channel.h>
+    #include <ns3/qbb-header.h>
+    #include <ns3/qbb-net-device.h>
+    #include <ns3/qbb-remote-channel.h>
+    #include <ns3/rdma-driver.h>
+    #include <ns3/rdma-header-template.h>
+    #include <ns3/rdma-congestion-control.h>
+    #include <ns3/rdma-hw.h>
+    #include <ns3/rdma-queue-pair.h>
+    #include <ns3/rdma-timer-wheel.h>
+    #include <ns3/rdma-fluid-engine.h>
+    #include <ns3/switch-byte-counter.h>
+    #include <ns3/switch-footprint.h>
+    #include <ns3/switch-mmu.h>
+    #include <ns3/switch-node.h>
+    #include <ns3/trace-format.h>
+    #include <ns3/point-to-point-channel.h>
+    #include <ns3/point-to-point-net-device.h>
+    #include <ns3/ppp-header.h>
+#endif 
\ No newline at end of file
@@ -0,0 +1 @@
+#include "/root/repo/src/applications/helper/rdma-client-helper.h"
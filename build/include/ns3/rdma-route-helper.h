@@ -0,0 +1 @@
+#include "/root/repo/src/point-to-point/helper/rdma-route-helper.h"
@@ -0,0 +1 @@
+#include "/root/repo/src/network/utils/simple-drop-tail-queue.h"
@@ -0,0 +1 @@
+#include "/root/repo/src/applications/model/simple-seq-ts-header.h"
@@ -16,6 +16,10 @@
 #include <limits>
 #include <stdint.h>
 
+#ifdef NS3_MTP
+#include <atomic>
+#endif
+
 /**
  * \file
  * \ingroup ptr
@@ -114,8 +118,13 @@ class SimpleRefCount : public PARENT
      */
     inline void Unref() const
     {
+#ifdef NS3_MTP
+        // objects such as packets and events are shared by logical processes
+        if (m_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+#else
         m_count--;
         if (m_count == 0)
+#endif
         {
             DELETER::Delete(static_cast<T*>(const_cast<SimpleRefCount*>(this)));
         }
@@ -140,7 +149,11 @@ class SimpleRefCount : public PARENT
      * Note we make this mutable so that the const methods can still
      * change it.
      */
+#ifdef NS3_MTP
+    mutable std::atomic<uint32_t> m_count;
+#else
     mutable uint32_t m_count;
+#endif
 };
 
 } // namespace ns3
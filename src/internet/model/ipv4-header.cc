@@ -12,6 +12,7 @@
 #include "ns3/assert.h"
 #include "ns3/header.h"
 #include "ns3/log.h"
+#include "ns3/packet.h"
 
 namespace ns3
 {
@@ -93,6 +94,31 @@ Ipv4Header::SetEcn(EcnType ecn)
     m_tos |= ecn;
 }
 
+bool
+Ipv4Header::SetEcn(Ptr<Packet> packet, uint32_t offset, EcnType ecn)
+{
+    NS_LOG_FUNCTION(packet << offset << ecn);
+    uint8_t* data = packet->PeekMutableData(offset, 20);
+    if (data == nullptr || (data[0] >> 4) != 4)
+    {
+        return false;
+    }
+    uint16_t oldWord = (data[0] << 8) | data[1];
+    data[1] = (data[1] & 0xFC) | ecn;
+    uint16_t checksum = (data[10] << 8) | data[11];
+    if (checksum != 0)
+    {
+        // HC' = ~(~HC + ~m + m')
+        uint32_t sum = (uint16_t)~checksum + (uint16_t)~oldWord + ((data[0] << 8) | data[1]);
+        sum = (sum & 0xffff) + (sum >> 16);
+        sum = (sum & 0xffff) + (sum >> 16);
+        checksum = ~sum;
+        data[10] = checksum >> 8;
+        data[11] = checksum & 0xff;
+    }
+    return true;
+}
+
 Ipv4Header::DscpType
 Ipv4Header::GetDscp() const
 {
@@ -11,9 +11,13 @@
 
 #include "ns3/header.h"
 #include "ns3/ipv4-address.h"
+#include "ns3/ptr.h"
 
 namespace ns3
 {
+
+class Packet;
+
 /**
  * \ingroup ipv4
  *
@@ -113,6 +117,18 @@ class Ipv4Header : public Header
      * \param ecn ECN Type
      */
     void SetEcn(EcnType ecn);
+    /**
+     * \brief Set the ECN field of the IPv4 header of a packet, in place
+     * \param packet the packet
+     * \param offset offset of the IPv4 header from the start of the packet
+     * \param ecn ECN Type
+     * \return false if there is no IPv4 header at this offset
+     *
+     * Only the TOS byte is rewritten, and the checksum updated as in
+     * \RFC{1624} when it is set, instead of removing the header, changing it
+     * and adding it back.
+     */
+    static bool SetEcn(Ptr<Packet> packet, uint32_t offset, EcnType ecn);
     /**
      * This packet is not the last packet of a fragmented ipv4 packet.
      */
@@ -279,6 +279,55 @@ Ipv4HeaderTest::DoRun()
     Simulator::Destroy();
 }
 
+/**
+ * \ingroup internet-test
+ *
+ * \brief Test of the in-place ECN rewrite of Ipv4Header::SetEcn
+ */
+class Ipv4HeaderEcnInPlaceTest : public TestCase
+{
+  public:
+    Ipv4HeaderEcnInPlaceTest();
+
+  private:
+    void DoRun() override;
+};
+
+Ipv4HeaderEcnInPlaceTest::Ipv4HeaderEcnInPlaceTest()
+    : TestCase("IPv4 Header ECN rewritten in place")
+{
+}
+
+void
+Ipv4HeaderEcnInPlaceTest::DoRun()
+{
+    Ipv4Header h;
+    h.SetSource(Ipv4Address("11.0.0.1"));
+    h.SetDestination(Ipv4Address("11.0.1.1"));
+    h.SetDscp(Ipv4Header::DSCP_AF21);
+    h.SetEcn(Ipv4Header::ECN_ECT0);
+    h.SetProtocol(17);
+    h.SetPayloadSize(100);
+    h.EnableChecksum();
+    Ptr<Packet> p = Create<Packet>(100);
+    p->AddHeader(h);
+
+    Ptr<Packet> shared = p->Copy();
+    NS_TEST_EXPECT_MSG_EQ(Ipv4Header::SetEcn(p, 0, Ipv4Header::ECN_CE), true, "IPv4 header");
+    NS_TEST_EXPECT_MSG_EQ(Ipv4Header::SetEcn(p, 40, Ipv4Header::ECN_CE), false, "not IPv4");
+    NS_TEST_EXPECT_MSG_EQ(Ipv4Header::SetEcn(p, 100, Ipv4Header::ECN_CE), false, "too short");
+
+    Ipv4Header marked;
+    marked.EnableChecksum();
+    p->RemoveHeader(marked);
+    NS_TEST_EXPECT_MSG_EQ(marked.GetEcn(), Ipv4Header::ECN_CE, "ECN rewritten");
+    NS_TEST_EXPECT_MSG_EQ(marked.GetDscp(), Ipv4Header::DSCP_AF21, "DSCP kept");
+    NS_TEST_EXPECT_MSG_EQ(marked.IsChecksumOk(), true, "checksum updated");
+    Ipv4Header orig;
+    shared->RemoveHeader(orig);
+    NS_TEST_EXPECT_MSG_EQ(orig.GetEcn(), Ipv4Header::ECN_ECT0, "copy untouched");
+}
+
 /**
  * \ingroup internet-test
  *
@@ -291,6 +340,7 @@ class Ipv4HeaderTestSuite : public TestSuite
         : TestSuite("ipv4-header", Type::UNIT)
     {
         AddTestCase(new Ipv4HeaderTest, TestCase::Duration::QUICK);
+        AddTestCase(new Ipv4HeaderEcnInPlaceTest, TestCase::Duration::QUICK);
     }
 };
 
@@ -0,0 +1,254 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/**
+ * \file
+ * \ingroup mtp
+ * Implementation of class ns3::LogicalProcess.
+ */
+
+#include "logical-process.h"
+
+#include "ns3/assert.h"
+#include "ns3/event-impl.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <limits>
+#include <tuple>
+
+namespace ns3
+{
+
+// Note: as in DefaultSimulatorImpl, logging is avoided on the per-event paths
+NS_LOG_COMPONENT_DEFINE("LogicalProcess");
+
+LogicalProcess::LogicalProcess(uint32_t systemId, ObjectFactory schedulerFactory, uint32_t firstUid)
+    : m_systemId(systemId),
+      m_events(schedulerFactory.Create<Scheduler>()),
+      m_uid(firstUid),
+      m_currentUid(EventId::UID::INVALID),
+      m_currentTs(0),
+      m_currentContext(Simulator::NO_CONTEXT),
+      m_eventCount(0),
+      m_roundEventCount(0),
+      m_sendSeq(0),
+      m_inboxTs(std::numeric_limits<uint64_t>::max())
+{
+    NS_LOG_FUNCTION(this << systemId);
+}
+
+LogicalProcess::~LogicalProcess()
+{
+    NS_LOG_FUNCTION(this);
+    ReceiveMessages();
+    while (!m_events->IsEmpty())
+    {
+        Scheduler::Event next = m_events->RemoveNext();
+        next.impl->Unref();
+    }
+}
+
+void
+LogicalProcess::SetScheduler(ObjectFactory schedulerFactory)
+{
+    NS_LOG_FUNCTION(this << schedulerFactory);
+    Ptr<Scheduler> scheduler = schedulerFactory.Create<Scheduler>();
+    while (!m_events->IsEmpty())
+    {
+        scheduler->Insert(m_events->RemoveNext());
+    }
+    m_events = scheduler;
+}
+
+uint32_t
+LogicalProcess::GetSystemId() const
+{
+    return m_systemId;
+}
+
+EventId
+LogicalProcess::Schedule(uint32_t context, const Time& delay, EventImpl* event)
+{
+    NS_ASSERT_MSG(delay.IsPositive(), "LogicalProcess::Schedule(): Negative delay");
+    Scheduler::Event ev;
+    ev.impl = event;
+    ev.key.m_ts = m_currentTs + delay.GetTimeStep();
+    ev.key.m_context = context;
+    ev.key.m_uid = m_uid;
+    m_uid++;
+    m_events->Insert(ev);
+    return EventId(event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+}
+
+void
+LogicalProcess::PostMessage(uint64_t ts,
+                            uint32_t context,
+                            LogicalProcess* sender,
+                            EventImpl* event)
+{
+    // the sender is run by the calling thread, so its counter is safe to use
+    Message msg = {ts, context, sender->m_systemId, sender->m_sendSeq++, event};
+    std::unique_lock lock{m_inboxMutex};
+    m_inbox.push_back(msg);
+    m_inboxTs = std::min(m_inboxTs, ts);
+}
+
+void
+LogicalProcess::ReceiveMessages()
+{
+    std::vector<Message> inbox;
+    {
+        std::unique_lock lock{m_inboxMutex};
+        if (m_inbox.empty())
+        {
+            return;
+        }
+        inbox.swap(m_inbox);
+        m_inboxTs = std::numeric_limits<uint64_t>::max();
+    }
+    // the uids follow a fixed order, whatever the order the senders ran in
+    std::sort(inbox.begin(), inbox.end(), [](const Message& a, const Message& b) {
+        return std::tie(a.ts, a.sender, a.seq) < std::tie(b.ts, b.sender, b.seq);
+    });
+    for (const auto& msg : inbox)
+    {
+        NS_ASSERT_MSG(msg.ts >= m_currentTs, "Event posted to the past of LP " << m_systemId);
+        Scheduler::Event ev;
+        ev.impl = msg.event;
+        ev.key.m_ts = msg.ts;
+        ev.key.m_context = msg.context;
+        ev.key.m_uid = m_uid;
+        m_uid++;
+        m_events->Insert(ev);
+    }
+}
+
+void
+LogicalProcess::InsertEvent(const Scheduler::Event& ev)
+{
+    m_uid = std::max(m_uid, ev.key.m_uid + 1);
+    m_events->Insert(ev);
+}
+
+std::vector<Scheduler::Event>
+LogicalProcess::TakeEvents()
+{
+    ReceiveMessages();
+    std::vector<Scheduler::Event> events;
+    while (!m_events->IsEmpty())
+    {
+        events.push_back(m_events->RemoveNext());
+    }
+    return events;
+}
+
+void
+LogicalProcess::ProcessOneRound(uint64_t windowEnd)
+{
+    ReceiveMessages();
+    m_roundEventCount = 0;
+    while (!m_events->IsEmpty() && m_events->PeekNext().key.m_ts < windowEnd)
+    {
+        Scheduler::Event next = m_events->RemoveNext();
+        NS_ASSERT(next.key.m_ts >= m_currentTs);
+        m_currentTs = next.key.m_ts;
+        m_currentContext = next.key.m_context;
+        m_currentUid = next.key.m_uid;
+        next.impl->Invoke();
+        next.impl->Unref();
+        m_roundEventCount++;
+    }
+    m_eventCount += m_roundEventCount;
+}
+
+uint64_t
+LogicalProcess::GetNextTs() const
+{
+    uint64_t ts = m_inboxTs;
+    if (!m_events->IsEmpty())
+    {
+        ts = std::min(ts, m_events->PeekNext().key.m_ts);
+    }
+    return ts;
+}
+
+uint64_t
+LogicalProcess::GetRoundEventCount() const
+{
+    return m_roundEventCount;
+}
+
+void
+LogicalProcess::Remove(const EventId& id)
+{
+    if (IsExpired(id))
+    {
+        return;
+    }
+    Scheduler::Event event;
+    event.impl = id.PeekEventImpl();
+    event.key.m_ts = id.GetTs();
+    event.key.m_context = id.GetContext();
+    event.key.m_uid = id.GetUid();
+    m_events->Remove(event);
+    event.impl->Cancel();
+    // whenever we remove an event from the event list, we have to unref it.
+    event.impl->Unref();
+}
+
+void
+LogicalProcess::Cancel(const EventId& id)
+{
+    if (!IsExpired(id))
+    {
+        id.PeekEventImpl()->Cancel();
+    }
+}
+
+bool
+LogicalProcess::IsExpired(const EventId& id) const
+{
+    return id.PeekEventImpl() == nullptr || id.GetTs() < m_currentTs ||
+           (id.GetTs() == m_currentTs && id.GetUid() <= m_currentUid) ||
+           id.PeekEventImpl()->IsCancelled();
+}
+
+Time
+LogicalProcess::GetDelayLeft(const EventId& id) const
+{
+    if (IsExpired(id))
+    {
+        return TimeStep(0);
+    }
+    return TimeStep(id.GetTs() - m_currentTs);
+}
+
+Time
+LogicalProcess::Now() const
+{
+    return TimeStep(m_currentTs);
+}
+
+uint32_t
+LogicalProcess::GetContext() const
+{
+    return m_currentContext;
+}
+
+uint64_t
+LogicalProcess::GetEventCount() const
+{
+    return m_eventCount;
+}
+
+void
+LogicalProcess::SetNow(uint64_t ts)
+{
+    NS_ASSERT(ts >= m_currentTs);
+    m_currentTs = ts;
+}
+
+} // namespace ns3
@@ -0,0 +1,153 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/**
+ * \file
+ * \ingroup mtp
+ * Declaration of class ns3::LogicalProcess.
+ */
+
+#ifndef NS3_LOGICAL_PROCESS_H
+#define NS3_LOGICAL_PROCESS_H
+
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/object-factory.h"
+#include "ns3/ptr.h"
+#include "ns3/scheduler.h"
+
+#include <mutex>
+#include <vector>
+
+namespace ns3
+{
+
+class EventImpl;
+
+/**
+ * \ingroup mtp
+ *
+ * \brief The event list and clock of one partition of the nodes.
+ *
+ * An LP is run by one thread at a time. Events scheduled by another LP are
+ * posted to its inbox, which is the only part of an LP other threads touch,
+ * and are moved to the event list at the start of the next window. They are
+ * sorted by time, sender and send order first, so the result of a run does
+ * not depend on how the LPs are mapped to threads.
+ */
+class LogicalProcess
+{
+  public:
+    /**
+     * \param systemId the id of this LP, 0 for the public LP of global events
+     * \param schedulerFactory the factory of the event list
+     * \param firstUid the first event uid to use
+     */
+    LogicalProcess(uint32_t systemId, ObjectFactory schedulerFactory, uint32_t firstUid);
+    ~LogicalProcess();
+
+    /**
+     * \brief Move the events to an event list of another type.
+     * \param schedulerFactory the factory of the new event list
+     */
+    void SetScheduler(ObjectFactory schedulerFactory);
+    /**
+     * \return the id of this LP
+     */
+    uint32_t GetSystemId() const;
+
+    /**
+     * \brief Schedule an event of this LP.
+     * \param context the context of the event
+     * \param delay the delay from the current time of this LP
+     * \param event the event
+     * \return the id of the event
+     */
+    EventId Schedule(uint32_t context, const Time& delay, EventImpl* event);
+    /**
+     * \brief Post an event scheduled by another LP. Thread safe.
+     * \param ts the absolute time of the event
+     * \param context the context of the event
+     * \param sender the LP which scheduled the event
+     * \param event the event
+     */
+    void PostMessage(uint64_t ts, uint32_t context, LogicalProcess* sender, EventImpl* event);
+    /**
+     * \brief Insert an event with its key, when the nodes are partitioned.
+     * \param ev the event
+     */
+    void InsertEvent(const Scheduler::Event& ev);
+    /**
+     * \brief Take all the events out of the event list.
+     * \return the events, in time order
+     */
+    std::vector<Scheduler::Event> TakeEvents();
+
+    /**
+     * \brief Run the events before the end of a window.
+     * \param windowEnd the events at this time or later are not run
+     */
+    void ProcessOneRound(uint64_t windowEnd);
+    /**
+     * \return the time of the next event, including the inbox, or
+     * UINT64_MAX if there is none. Not thread safe.
+     */
+    uint64_t GetNextTs() const;
+    /**
+     * \return the number of events run by the last ProcessOneRound()
+     */
+    uint64_t GetRoundEventCount() const;
+
+    /// \copydoc SimulatorImpl::Remove
+    void Remove(const EventId& id);
+    /// \copydoc SimulatorImpl::Cancel
+    void Cancel(const EventId& id);
+    /// \copydoc SimulatorImpl::IsExpired
+    bool IsExpired(const EventId& id) const;
+    /// \copydoc SimulatorImpl::GetDelayLeft
+    Time GetDelayLeft(const EventId& id) const;
+    /// \copydoc SimulatorImpl::Now
+    Time Now() const;
+    /// \copydoc SimulatorImpl::GetContext
+    uint32_t GetContext() const;
+    /// \copydoc SimulatorImpl::GetEventCount
+    uint64_t GetEventCount() const;
+    /**
+     * \brief Move the clock of an LP without events, e.g. the public LP at
+     * the end of a run.
+     * \param ts the new time, not earlier than the current one
+     */
+    void SetNow(uint64_t ts);
+
+  private:
+    /// An event posted by another LP
+    struct Message
+    {
+        uint64_t ts;      //!< absolute time
+        uint32_t context; //!< context of the event
+        uint32_t sender;  //!< id of the sending LP
+        uint64_t seq;     //!< send order in the sending LP
+        EventImpl* event; //!< the event
+    };
+
+    /// Move the inbox to the event list
+    void ReceiveMessages();
+
+    uint32_t m_systemId;          //!< id of this LP
+    Ptr<Scheduler> m_events;      //!< the event list
+    uint32_t m_uid;               //!< next event uid
+    uint32_t m_currentUid;        //!< uid of the current event
+    uint64_t m_currentTs;         //!< time of the current event
+    uint32_t m_currentContext;    //!< context of the current event
+    uint64_t m_eventCount;        //!< events run so far
+    uint64_t m_roundEventCount;   //!< events run in the last round
+    uint64_t m_sendSeq;           //!< events posted to other LPs so far
+    std::mutex m_inboxMutex;      //!< lock of the inbox
+    std::vector<Message> m_inbox; //!< events posted by other LPs
+    uint64_t m_inboxTs;           //!< earliest time in the inbox
+};
+
+} // namespace ns3
+
+#endif /* NS3_LOGICAL_PROCESS_H */
@@ -0,0 +1,99 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/**
+ * \file
+ * \ingroup mtp
+ * Implementation of class ns3::MtpInterface.
+ */
+
+#include "mtp-interface.h"
+
+#include "ns3/config.h"
+#include "ns3/global-value.h"
+#include "ns3/log.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("MtpInterface");
+
+/// Whether Enable() was called
+static bool g_enabled = false;
+/// Whether the LPs currently run a window in parallel
+static std::atomic<bool> g_parallel = false;
+/// Lock of MtpInterface::CriticalSection
+static std::mutex g_criticalSection;
+/// The LP run by each thread
+static thread_local LogicalProcess* g_system = nullptr;
+
+MtpInterface::CriticalSection::CriticalSection()
+    : m_locked(g_parallel.load(std::memory_order_acquire))
+{
+    if (m_locked)
+    {
+        g_criticalSection.lock();
+    }
+}
+
+MtpInterface::CriticalSection::~CriticalSection()
+{
+    if (m_locked)
+    {
+        g_criticalSection.unlock();
+    }
+}
+
+void
+MtpInterface::Enable()
+{
+    Enable(0);
+}
+
+void
+MtpInterface::Enable(uint32_t threads)
+{
+    NS_LOG_FUNCTION(threads);
+    GlobalValue::Bind("SimulatorImplementationType",
+                      StringValue("ns3::MultithreadedSimulatorImpl"));
+    Config::SetDefault("ns3::MultithreadedSimulatorImpl::MaxThreads", UintegerValue(threads));
+    g_enabled = true;
+}
+
+bool
+MtpInterface::IsEnabled()
+{
+    return g_enabled;
+}
+
+bool
+MtpInterface::IsParallel()
+{
+    return g_parallel.load(std::memory_order_acquire);
+}
+
+void
+MtpInterface::SetParallel(bool parallel)
+{
+    g_parallel.store(parallel, std::memory_order_release);
+}
+
+LogicalProcess*
+MtpInterface::GetSystem()
+{
+    return g_system;
+}
+
+void
+MtpInterface::SetSystem(LogicalProcess* system)
+{
+    g_system = system;
+}
+
+} // namespace ns3
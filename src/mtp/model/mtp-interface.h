@@ -0,0 +1,91 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/**
+ * \file
+ * \ingroup mtp
+ * Declaration of class ns3::MtpInterface.
+ */
+
+#ifndef NS3_MTP_INTERFACE_H
+#define NS3_MTP_INTERFACE_H
+
+#include <cstdint>
+
+namespace ns3
+{
+/**
+ * \defgroup mtp Multithreaded Parallel Simulation
+ *
+ * Shared-memory parallel simulation. The nodes are partitioned into
+ * logical processes (LPs) by cutting the channels which have a link delay,
+ * and the smallest delay of a cut channel is used as lookahead. The LPs
+ * run the events of one time window in parallel on a pool of threads and
+ * exchange the events they schedule for each other between the windows.
+ */
+
+class LogicalProcess;
+
+/**
+ * \ingroup mtp
+ *
+ * \brief Entry point of the multithreaded simulator.
+ *
+ * Enable() must be called before any simulation object is created, as it
+ * selects ns3::MultithreadedSimulatorImpl as the simulator implementation.
+ * Model code that touches state shared between nodes guards it with a
+ * CriticalSection, which is a no-op outside of the parallel windows.
+ */
+class MtpInterface
+{
+  public:
+    /**
+     * \brief Lock held while a model touches state shared between LPs.
+     */
+    class CriticalSection
+    {
+      public:
+        CriticalSection();
+        ~CriticalSection();
+
+      private:
+        bool m_locked; //!< whether the global lock was taken
+    };
+
+    /**
+     * \brief Select the multithreaded simulator, using all hardware threads.
+     */
+    static void Enable();
+    /**
+     * \brief Select the multithreaded simulator.
+     * \param threads the maximum number of threads, 0 for all hardware threads
+     */
+    static void Enable(uint32_t threads);
+    /**
+     * \return true if Enable() was called
+     */
+    static bool IsEnabled();
+    /**
+     * \return true while the LPs run a window in parallel
+     */
+    static bool IsParallel();
+    /**
+     * \brief Mark the start or end of a parallel window.
+     * \param parallel true while the LPs run in parallel
+     */
+    static void SetParallel(bool parallel);
+    /**
+     * \return the LP run by the calling thread, or nullptr
+     */
+    static LogicalProcess* GetSystem();
+    /**
+     * \brief Bind the calling thread to an LP.
+     * \param system the LP, or nullptr
+     */
+    static void SetSystem(LogicalProcess* system);
+};
+
+} // namespace ns3
+
+#endif /* NS3_MTP_INTERFACE_H */
@@ -0,0 +1,503 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/**
+ * \file
+ * \ingroup mtp
+ * Implementation of class ns3::MultithreadedSimulatorImpl.
+ */
+
+#include "multithreaded-simulator-impl.h"
+
+#include "logical-process.h"
+#include "mtp-interface.h"
+
+#include "ns3/assert.h"
+#include "ns3/channel-list.h"
+#include "ns3/channel.h"
+#include "ns3/log.h"
+#include "ns3/net-device.h"
+#include "ns3/node-list.h"
+#include "ns3/node.h"
+#include "ns3/scheduler.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace ns3
+{
+
+// Note: as in DefaultSimulatorImpl, logging is avoided on the per-event paths
+NS_LOG_COMPONENT_DEFINE("MultithreadedSimulatorImpl");
+
+NS_OBJECT_ENSURE_REGISTERED(MultithreadedSimulatorImpl);
+
+TypeId
+MultithreadedSimulatorImpl::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::MultithreadedSimulatorImpl")
+            .SetParent<SimulatorImpl>()
+            .SetGroupName("Mtp")
+            .AddConstructor<MultithreadedSimulatorImpl>()
+            .AddAttribute("MaxThreads",
+                          "The maximum number of threads, 0 for all hardware threads.",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&MultithreadedSimulatorImpl::m_maxThreads),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("MinLookahead",
+                          "The channels with a delay not larger than this are not cut, "
+                          "their nodes are put in the same LP.",
+                          TimeValue(Time(0)),
+                          MakeTimeAccessor(&MultithreadedSimulatorImpl::m_minLookahead),
+                          MakeTimeChecker());
+    return tid;
+}
+
+MultithreadedSimulatorImpl::MultithreadedSimulatorImpl()
+    : m_partitioned(false),
+      m_lookahead(std::numeric_limits<uint64_t>::max()),
+      m_stop(false),
+      m_windowEnd(0),
+      m_round(0),
+      m_next(0),
+      m_done(0),
+      m_exit(false)
+{
+    NS_LOG_FUNCTION(this);
+    m_schedulerFactory.SetTypeId("ns3::MapScheduler");
+    m_systems.push_back(new LogicalProcess(0, m_schedulerFactory, EventId::UID::VALID));
+}
+
+MultithreadedSimulatorImpl::~MultithreadedSimulatorImpl()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+MultithreadedSimulatorImpl::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    m_exit.store(true, std::memory_order_release);
+    m_round.fetch_add(1, std::memory_order_release);
+    for (auto& thread : m_threads)
+    {
+        thread.join();
+    }
+    m_threads.clear();
+    for (auto system : m_systems)
+    {
+        delete system;
+    }
+    m_systems.clear();
+    SimulatorImpl::DoDispose();
+}
+
+void
+MultithreadedSimulatorImpl::Destroy()
+{
+    NS_LOG_FUNCTION(this);
+    while (!m_destroyEvents.empty())
+    {
+        Ptr<EventImpl> ev = m_destroyEvents.front().PeekEventImpl();
+        m_destroyEvents.pop_front();
+        NS_LOG_LOGIC("handle destroy " << ev);
+        if (!ev->IsCancelled())
+        {
+            ev->Invoke();
+        }
+    }
+}
+
+void
+MultithreadedSimulatorImpl::SetScheduler(ObjectFactory schedulerFactory)
+{
+    NS_LOG_FUNCTION(this << schedulerFactory);
+    m_schedulerFactory = schedulerFactory;
+    for (auto system : m_systems)
+    {
+        system->SetScheduler(schedulerFactory);
+    }
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetSystemId() const
+{
+    return GetCurrent()->GetSystemId();
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetSystemCount() const
+{
+    return m_systems.size();
+}
+
+Time
+MultithreadedSimulatorImpl::GetLookahead() const
+{
+    return TimeStep(m_lookahead);
+}
+
+LogicalProcess*
+MultithreadedSimulatorImpl::GetOwner(uint32_t context) const
+{
+    if (m_partitioned && context < m_lpOfNode.size())
+    {
+        return m_systems[m_lpOfNode[context]];
+    }
+    return m_systems[0];
+}
+
+LogicalProcess*
+MultithreadedSimulatorImpl::GetCurrent() const
+{
+    LogicalProcess* system = MtpInterface::GetSystem();
+    return system ? system : m_systems[0];
+}
+
+void
+MultithreadedSimulatorImpl::Partition()
+{
+    NS_LOG_FUNCTION(this);
+    uint32_t nNodes = NodeList::GetNNodes();
+
+    // union-find over the nodes, joined by the channels that are not cut
+    std::vector<uint32_t> parent(nNodes);
+    std::iota(parent.begin(), parent.end(), 0);
+    auto find = [&parent](uint32_t x) {
+        while (parent[x] != x)
+        {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    };
+    for (auto it = ChannelList::Begin(); it != ChannelList::End(); it++)
+    {
+        Ptr<Channel> channel = *it;
+        TimeValue delay;
+        if (channel->GetAttributeFailSafe("Delay", delay) && delay.Get() > m_minLookahead)
+        {
+            m_lookahead = std::min<uint64_t>(m_lookahead, delay.Get().GetTimeStep());
+            continue;
+        }
+        for (std::size_t i = 1; i < channel->GetNDevices(); i++)
+        {
+            uint32_t a = find(channel->GetDevice(0)->GetNode()->GetId());
+            uint32_t b = find(channel->GetDevice(i)->GetNode()->GetId());
+            parent[std::max(a, b)] = std::min(a, b);
+        }
+    }
+
+    // one LP per component, numbered in node order
+    std::vector<uint32_t> lpOfRoot(nNodes, 0);
+    m_lpOfNode.assign(nNodes, 0);
+    for (uint32_t i = 0; i < nNodes; i++)
+    {
+        uint32_t root = find(i);
+        if (lpOfRoot[root] == 0)
+        {
+            lpOfRoot[root] = m_systems.size();
+            m_systems.push_back(
+                new LogicalProcess(m_systems.size(), m_schedulerFactory, EventId::UID::VALID));
+        }
+        m_lpOfNode[i] = lpOfRoot[root];
+    }
+    m_partitioned = true;
+
+    // the events scheduled for the nodes so far move to their LP
+    LogicalProcess* pub = m_systems[0];
+    for (const auto& ev : pub->TakeEvents())
+    {
+        GetOwner(ev.key.m_context)->InsertEvent(ev);
+    }
+    for (std::size_t i = 1; i < m_systems.size(); i++)
+    {
+        m_systems[i]->SetNow(pub->Now().GetTimeStep());
+        m_order.push_back(i);
+    }
+    NS_LOG_INFO(nNodes << " nodes in " << m_systems.size() - 1 << " LPs, lookahead "
+                       << GetLookahead());
+}
+
+void
+MultithreadedSimulatorImpl::ProcessRound()
+{
+    uint32_t n = m_order.size();
+    uint32_t i;
+    while ((i = m_next.fetch_add(1, std::memory_order_acq_rel)) < n)
+    {
+        LogicalProcess* system = m_systems[m_order[i]];
+        MtpInterface::SetSystem(system);
+        system->ProcessOneRound(m_windowEnd);
+        MtpInterface::SetSystem(nullptr);
+        m_done.fetch_add(1, std::memory_order_acq_rel);
+    }
+}
+
+void
+MultithreadedSimulatorImpl::WorkerLoop()
+{
+    uint64_t seen = 0;
+    while (true)
+    {
+        uint64_t round;
+        while ((round = m_round.load(std::memory_order_acquire)) == seen)
+        {
+            std::this_thread::yield();
+        }
+        if (m_exit.load(std::memory_order_acquire))
+        {
+            return;
+        }
+        seen = round;
+        ProcessRound();
+    }
+}
+
+void
+MultithreadedSimulatorImpl::RunParallelRound(uint64_t windowEnd)
+{
+    if (m_threads.empty())
+    {
+        uint32_t threads = m_maxThreads ? m_maxThreads : std::thread::hardware_concurrency();
+        threads = std::min<uint32_t>(threads, m_order.size());
+        for (uint32_t i = 1; i < threads; i++)
+        {
+            m_threads.emplace_back(&MultithreadedSimulatorImpl::WorkerLoop, this);
+        }
+    }
+
+    // the busiest LPs first, so that the window is not held up by a late start
+    std::stable_sort(m_order.begin(), m_order.end(), [this](uint32_t a, uint32_t b) {
+        return m_systems[a]->GetRoundEventCount() > m_systems[b]->GetRoundEventCount();
+    });
+    m_windowEnd = windowEnd;
+    m_done.store(0, std::memory_order_relaxed);
+    m_next.store(0, std::memory_order_release);
+    MtpInterface::SetParallel(true);
+    m_round.fetch_add(1, std::memory_order_acq_rel);
+    ProcessRound();
+    while (m_done.load(std::memory_order_acquire) < m_order.size())
+    {
+        std::this_thread::yield();
+    }
+    MtpInterface::SetParallel(false);
+}
+
+void
+MultithreadedSimulatorImpl::Run()
+{
+    NS_LOG_FUNCTION(this);
+    if (!m_partitioned)
+    {
+        Partition();
+    }
+    m_stop = false;
+
+    LogicalProcess* pub = m_systems[0];
+    const uint64_t never = std::numeric_limits<uint64_t>::max();
+    while (!m_stop)
+    {
+        uint64_t pubTs = pub->GetNextTs();
+        uint64_t minTs = never;
+        for (std::size_t i = 1; i < m_systems.size(); i++)
+        {
+            minTs = std::min(minTs, m_systems[i]->GetNextTs());
+        }
+        if (pubTs == never && minTs == never)
+        {
+            break;
+        }
+        if (pubTs <= minTs)
+        {
+            // the global events run alone, at a point where all the LPs are
+            pub->ProcessOneRound(pubTs + 1);
+            continue;
+        }
+        uint64_t windowEnd = minTs > never - m_lookahead ? never : minTs + m_lookahead;
+        RunParallelRound(std::min(windowEnd, pubTs));
+    }
+
+    uint64_t now = pub->Now().GetTimeStep();
+    for (auto system : m_systems)
+    {
+        now = std::max<uint64_t>(now, system->Now().GetTimeStep());
+    }
+    pub->SetNow(now);
+}
+
+bool
+MultithreadedSimulatorImpl::IsFinished() const
+{
+    if (m_stop)
+    {
+        return true;
+    }
+    for (auto system : m_systems)
+    {
+        if (system->GetNextTs() != std::numeric_limits<uint64_t>::max())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void
+MultithreadedSimulatorImpl::Stop()
+{
+    NS_LOG_FUNCTION(this);
+    m_stop = true;
+}
+
+EventId
+MultithreadedSimulatorImpl::Stop(const Time& delay)
+{
+    NS_LOG_FUNCTION(this << delay.GetTimeStep());
+    return Simulator::Schedule(delay, &Simulator::Stop);
+}
+
+EventId
+MultithreadedSimulatorImpl::Schedule(const Time& delay, EventImpl* event)
+{
+    LogicalProcess* system = GetCurrent();
+    return system->Schedule(system->GetContext(), delay, event);
+}
+
+void
+MultithreadedSimulatorImpl::ScheduleWithContext(uint32_t context,
+                                                const Time& delay,
+                                                EventImpl* event)
+{
+    LogicalProcess* system = GetCurrent();
+    LogicalProcess* target = GetOwner(context);
+    if (target == system)
+    {
+        system->Schedule(context, delay, event);
+        return;
+    }
+    NS_ASSERT_MSG(delay.IsPositive(), "MultithreadedSimulatorImpl: Negative delay");
+    uint64_t ts = system->Now().GetTimeStep() + delay.GetTimeStep();
+    NS_ASSERT_MSG(!MtpInterface::IsParallel() || ts >= m_windowEnd,
+                  "Event for context " << context << " is closer than the lookahead "
+                                       << GetLookahead());
+    target->PostMessage(ts, context, system, event);
+}
+
+EventId
+MultithreadedSimulatorImpl::ScheduleNow(EventImpl* event)
+{
+    return Schedule(Time(0), event);
+}
+
+EventId
+MultithreadedSimulatorImpl::ScheduleDestroy(EventImpl* event)
+{
+    NS_ASSERT_MSG(!MtpInterface::IsParallel(),
+                  "Simulator::ScheduleDestroy Thread-unsafe invocation!");
+
+    EventId id(Ptr<EventImpl>(event, false), Now().GetTimeStep(), 0xffffffff, 2);
+    m_destroyEvents.push_back(id);
+    return id;
+}
+
+Time
+MultithreadedSimulatorImpl::Now() const
+{
+    // Do not add function logging here, to avoid stack overflow
+    return GetCurrent()->Now();
+}
+
+Time
+MultithreadedSimulatorImpl::GetDelayLeft(const EventId& id) const
+{
+    if (IsExpired(id))
+    {
+        return TimeStep(0);
+    }
+    if (id.GetUid() == EventId::UID::DESTROY)
+    {
+        return TimeStep(id.GetTs() - Now().GetTimeStep());
+    }
+    return GetOwner(id.GetContext())->GetDelayLeft(id);
+}
+
+void
+MultithreadedSimulatorImpl::Remove(const EventId& id)
+{
+    if (id.GetUid() == EventId::UID::DESTROY)
+    {
+        // destroy events.
+        for (auto i = m_destroyEvents.begin(); i != m_destroyEvents.end(); i++)
+        {
+            if (*i == id)
+            {
+                m_destroyEvents.erase(i);
+                break;
+            }
+        }
+        return;
+    }
+    GetOwner(id.GetContext())->Remove(id);
+}
+
+void
+MultithreadedSimulatorImpl::Cancel(const EventId& id)
+{
+    if (!IsExpired(id))
+    {
+        id.PeekEventImpl()->Cancel();
+    }
+}
+
+bool
+MultithreadedSimulatorImpl::IsExpired(const EventId& id) const
+{
+    if (id.GetUid() == EventId::UID::DESTROY)
+    {
+        if (id.PeekEventImpl() == nullptr || id.PeekEventImpl()->IsCancelled())
+        {
+            return true;
+        }
+        // destroy events.
+        for (auto i = m_destroyEvents.begin(); i != m_destroyEvents.end(); i++)
+        {
+            if (*i == id)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    return GetOwner(id.GetContext())->IsExpired(id);
+}
+
+Time
+MultithreadedSimulatorImpl::GetMaximumSimulationTime() const
+{
+    return TimeStep(0x7fffffffffffffffLL);
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetContext() const
+{
+    return GetCurrent()->GetContext();
+}
+
+uint64_t
+MultithreadedSimulatorImpl::GetEventCount() const
+{
+    uint64_t count = 0;
+    for (auto system : m_systems)
+    {
+        count += system->GetEventCount();
+    }
+    return count;
+}
+
+} // namespace ns3
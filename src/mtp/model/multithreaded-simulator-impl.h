@@ -0,0 +1,155 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/**
+ * \file
+ * \ingroup mtp
+ * Declaration of class ns3::MultithreadedSimulatorImpl.
+ */
+
+#ifndef NS3_MULTITHREADED_SIMULATOR_IMPL_H
+#define NS3_MULTITHREADED_SIMULATOR_IMPL_H
+
+#include "ns3/nstime.h"
+#include "ns3/simulator-impl.h"
+
+#include <atomic>
+#include <list>
+#include <thread>
+#include <vector>
+
+namespace ns3
+{
+
+class LogicalProcess;
+
+/**
+ * \ingroup mtp
+ *
+ * \brief Shared-memory parallel simulator.
+ *
+ * On the first Run() the nodes are partitioned into logical processes:
+ * the nodes joined by a channel whose "Delay" is not larger than
+ * MinLookahead (or which has no delay) end up in the same LP, and the
+ * smallest delay of the other channels is the lookahead. Events whose
+ * context is not a node, such as the ones scheduled before Run() without
+ * a context, are kept by the public LP 0, which runs on the main thread
+ * while the others wait.
+ *
+ * The run then alternates between windows: the node LPs run their events
+ * in [T, T + lookahead) in parallel, T being the earliest event of all the
+ * node LPs, and the events they schedule for each other are delivered at
+ * the end of the window. Events of the public LP end a window early and
+ * run alone. The order of the events of a run does not depend on the
+ * number of threads.
+ *
+ * The nodes created after the first Run() are handled by the public LP.
+ */
+class MultithreadedSimulatorImpl : public SimulatorImpl
+{
+  public:
+    /**
+     *  Register this type.
+     *  \return The object TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /** Constructor. */
+    MultithreadedSimulatorImpl();
+    /** Destructor. */
+    ~MultithreadedSimulatorImpl() override;
+
+    // Inherited
+    void Destroy() override;
+    bool IsFinished() const override;
+    void Stop() override;
+    EventId Stop(const Time& delay) override;
+    EventId Schedule(const Time& delay, EventImpl* event) override;
+    void ScheduleWithContext(uint32_t context, const Time& delay, EventImpl* event) override;
+    EventId ScheduleNow(EventImpl* event) override;
+    EventId ScheduleDestroy(EventImpl* event) override;
+    void Remove(const EventId& id) override;
+    void Cancel(const EventId& id) override;
+    bool IsExpired(const EventId& id) const override;
+    void Run() override;
+    Time Now() const override;
+    Time GetDelayLeft(const EventId& id) const override;
+    Time GetMaximumSimulationTime() const override;
+    void SetScheduler(ObjectFactory schedulerFactory) override;
+    uint32_t GetSystemId() const override;
+    uint32_t GetContext() const override;
+    uint64_t GetEventCount() const override;
+
+    /**
+     * \return the number of LPs, including the public one; 1 before Run()
+     */
+    uint32_t GetSystemCount() const;
+    /**
+     * \return the lookahead between the LPs
+     */
+    Time GetLookahead() const;
+
+  private:
+    void DoDispose() override;
+
+    /** Split the nodes into LPs and move their events out of the public LP. */
+    void Partition();
+    /**
+     * \param context the context of an event
+     * \return the LP which runs the events of this context
+     */
+    LogicalProcess* GetOwner(uint32_t context) const;
+    /** \return the LP run by the calling thread */
+    LogicalProcess* GetCurrent() const;
+    /**
+     * \brief Run one window of all the node LPs.
+     * \param windowEnd the end of the window
+     */
+    void RunParallelRound(uint64_t windowEnd);
+    /** Take LPs of the current window until there is none left. */
+    void ProcessRound();
+    /** Main loop of the worker threads. */
+    void WorkerLoop();
+
+    /** The LPs, LP 0 being the public one. */
+    std::vector<LogicalProcess*> m_systems;
+    /** The LP of each node, indexed by node id. */
+    std::vector<uint32_t> m_lpOfNode;
+    /** Whether Partition() has run. */
+    bool m_partitioned;
+    /** The lookahead, in time steps. */
+    uint64_t m_lookahead;
+    /** Channels with a smaller delay are not cut. */
+    Time m_minLookahead;
+    /** Maximum number of threads, 0 for all hardware threads. */
+    uint32_t m_maxThreads;
+    /** The event list type. */
+    ObjectFactory m_schedulerFactory;
+
+    /** Container type for the events to run at Simulator::Destroy() */
+    typedef std::list<EventId> DestroyEvents;
+    /** The container of events to run at Destroy. */
+    DestroyEvents m_destroyEvents;
+    /** Flag calling for the end of the simulation. */
+    std::atomic<bool> m_stop;
+
+    /** The worker threads, started on the first parallel window. */
+    std::vector<std::thread> m_threads;
+    /** Node LPs in the order they are taken, busiest of the last window first. */
+    std::vector<uint32_t> m_order;
+    /** End of the current window. */
+    uint64_t m_windowEnd;
+    /** Window counter, the workers start a window when it changes. */
+    std::atomic<uint64_t> m_round;
+    /** Next index of m_order to take. */
+    std::atomic<uint32_t> m_next;
+    /** Number of LPs done in the current window. */
+    std::atomic<uint32_t> m_done;
+    /** Tells the workers to exit. */
+    std::atomic<bool> m_exit;
+};
+
+} // namespace ns3
+
+#endif /* NS3_MULTITHREADED_SIMULATOR_IMPL_H */
@@ -0,0 +1,193 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include "ns3/mac48-address.h"
+#include "ns3/multithreaded-simulator-impl.h"
+#include "ns3/node.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/simple-channel.h"
+#include "ns3/simple-net-device.h"
+#include "ns3/simulator.h"
+#include "ns3/test.h"
+#include "ns3/uinteger.h"
+
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * \file
+ * \ingroup mtp-tests
+ * Multithreaded simulator test suite
+ */
+
+/**
+ * \ingroup mtp
+ * \defgroup mtp-tests Multithreaded simulator tests
+ */
+
+/**
+ * \ingroup mtp-tests
+ *
+ * \brief Forward packets along a chain of nodes and check the receive times.
+ *
+ * Node 0 sends a few packets, each node forwards them to the next one after
+ * a fixed processing delay. Every node is an LP when the links are cut, and
+ * the whole chain is one LP when they are not, with the same receive times.
+ */
+class MtpChainTestCase : public TestCase
+{
+  public:
+    /**
+     * Constructor.
+     * \param threads the maximum number of threads
+     * \param cut whether the links are cut into LPs
+     */
+    MtpChainTestCase(uint32_t threads, bool cut);
+
+  private:
+    void DoRun() override;
+
+    /**
+     * Send a packet to the next node.
+     * \param node the sending node
+     */
+    void Forward(uint32_t node);
+    /**
+     * Receive callback of the devices.
+     * \param device the receiving device
+     * \param packet the packet
+     * \param protocol the protocol
+     * \param from the sender address
+     * \return true
+     */
+    bool Receive(Ptr<NetDevice> device,
+                 Ptr<const Packet> packet,
+                 uint16_t protocol,
+                 const Address& from);
+
+    static const uint32_t N_NODES = 6;   //!< length of the chain
+    static const uint32_t N_PACKETS = 4; //!< packets sent by node 0
+
+    uint32_t m_threads;                        //!< maximum number of threads
+    bool m_cut;                                //!< whether the links are cut
+    std::vector<Ptr<SimpleNetDevice>> m_right; //!< device of each node to the next one
+    std::vector<std::vector<Time>> m_rx;       //!< receive times of each node
+};
+
+MtpChainTestCase::MtpChainTestCase(uint32_t threads, bool cut)
+    : TestCase("Check a chain of nodes with " + std::to_string(threads) + " threads" +
+               (cut ? "" : ", links not cut")),
+      m_threads(threads),
+      m_cut(cut)
+{
+}
+
+void
+MtpChainTestCase::Forward(uint32_t node)
+{
+    m_right[node]->Send(Create<Packet>(100), Mac48Address::GetBroadcast(), 0x800);
+}
+
+bool
+MtpChainTestCase::Receive(Ptr<NetDevice> device,
+                          Ptr<const Packet> packet,
+                          uint16_t protocol,
+                          const Address& from)
+{
+    uint32_t node = device->GetNode()->GetId();
+    // the nodes of the test are the only ones, numbered from 0
+    m_rx[node].push_back(Simulator::Now());
+    if (node + 1 < N_NODES)
+    {
+        Simulator::Schedule(NanoSeconds(100), &MtpChainTestCase::Forward, this, node);
+    }
+    return true;
+}
+
+void
+MtpChainTestCase::DoRun()
+{
+    Ptr<MultithreadedSimulatorImpl> impl = CreateObject<MultithreadedSimulatorImpl>();
+    impl->SetAttribute("MaxThreads", UintegerValue(m_threads));
+    impl->SetAttribute("MinLookahead", TimeValue(m_cut ? Time(0) : MicroSeconds(1)));
+    Simulator::SetImplementation(impl);
+
+    std::vector<Ptr<Node>> nodes;
+    for (uint32_t i = 0; i < N_NODES; i++)
+    {
+        nodes.push_back(CreateObject<Node>());
+    }
+    m_right.assign(N_NODES, nullptr);
+    m_rx.assign(N_NODES, {});
+    for (uint32_t i = 0; i + 1 < N_NODES; i++)
+    {
+        Ptr<SimpleChannel> channel = CreateObject<SimpleChannel>();
+        channel->SetAttribute("Delay", TimeValue(MicroSeconds(1)));
+        for (uint32_t j = i; j <= i + 1; j++)
+        {
+            Ptr<SimpleNetDevice> device = CreateObject<SimpleNetDevice>();
+            device->SetAddress(Mac48Address::Allocate());
+            device->SetChannel(channel);
+            nodes[j]->AddDevice(device);
+            // after AddDevice(), which sets the callback of the node
+            device->SetReceiveCallback(MakeCallback(&MtpChainTestCase::Receive, this));
+            if (j == i)
+            {
+                m_right[i] = device;
+            }
+        }
+    }
+    for (uint32_t k = 0; k < N_PACKETS; k++)
+    {
+        Simulator::ScheduleWithContext(0,
+                                       NanoSeconds(500 * k),
+                                       &MtpChainTestCase::Forward,
+                                       this,
+                                       0);
+    }
+    Simulator::Stop(MicroSeconds(100));
+    Simulator::Run();
+
+    uint32_t systems = m_cut ? N_NODES + 1 : 2;
+    NS_TEST_EXPECT_MSG_EQ(impl->GetSystemCount(), systems, "Bad partition");
+    if (m_cut)
+    {
+        NS_TEST_EXPECT_MSG_EQ(impl->GetLookahead(), MicroSeconds(1), "Bad lookahead");
+    }
+    for (uint32_t i = 1; i < N_NODES; i++)
+    {
+        NS_TEST_ASSERT_MSG_EQ(m_rx[i].size(), N_PACKETS, "Packets lost at node " << i);
+        for (uint32_t k = 0; k < N_PACKETS; k++)
+        {
+            Time expected = NanoSeconds(500 * k + 1000 * i + 100 * (i - 1));
+            NS_TEST_EXPECT_MSG_EQ(m_rx[i][k], expected, "Bad time at node " << i);
+        }
+    }
+    NS_TEST_EXPECT_MSG_EQ(Simulator::Now(), MicroSeconds(100), "Bad stop time");
+
+    Simulator::Destroy();
+}
+
+/**
+ * \ingroup mtp-tests
+ *
+ * \brief The multithreaded simulator test suite.
+ */
+class MtpTestSuite : public TestSuite
+{
+  public:
+    MtpTestSuite()
+        : TestSuite("mtp", Type::UNIT)
+    {
+        AddTestCase(new MtpChainTestCase(1, true), TestCase::Duration::QUICK);
+        AddTestCase(new MtpChainTestCase(2, true), TestCase::Duration::QUICK);
+        AddTestCase(new MtpChainTestCase(4, true), TestCase::Duration::QUICK);
+        AddTestCase(new MtpChainTestCase(2, false), TestCase::Duration::QUICK);
+    }
+};
+
+/// Static variable for test initialization.
+static MtpTestSuite g_mtpTestSuite;
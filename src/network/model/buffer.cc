@@ -43,7 +43,11 @@ namespace ns3
 
 NS_LOG_COMPONENT_DEFINE("Buffer");
 
+#ifdef NS3_MTP
+thread_local uint32_t Buffer::g_recommendedStart = 0;
+#else
 uint32_t Buffer::g_recommendedStart = 0;
+#endif
 #ifdef BUFFER_FREE_LIST
 /* The following macros are pretty evil but they are needed to allow us to
  * keep track of 3 possible states for the g_freeList variable:
@@ -698,6 +702,54 @@ Buffer::PeekData() const
     return m_data->m_data + m_start;
 }
 
+uint8_t*
+Buffer::PeekMutableData(uint32_t start, uint32_t size)
+{
+    NS_LOG_FUNCTION(this << start << size);
+    NS_ASSERT(CheckInternalState());
+    if (start > GetSize() || size > GetSize() - start)
+    {
+        return nullptr;
+    }
+    uint32_t begin = m_start + start;
+    if (begin < m_zeroAreaEnd && begin + size > m_zeroAreaStart)
+    {
+        // the region overlaps the zero area: make it real first
+        TransformIntoRealBuffer();
+        begin = m_start + start;
+    }
+    if (m_data->m_count > 1)
+    {
+        /* shared with other buffers: detach before writing.
+         * Before: |--***---------***--| (shared)
+         * After:  |***---------***|     (private)
+         */
+        uint32_t internalSize = GetInternalSize();
+        Buffer::Data* newData = Buffer::Create(internalSize);
+        memcpy(newData->m_data, m_data->m_data + m_start, internalSize);
+        m_data->m_count--;
+        m_data = newData;
+
+        m_zeroAreaStart -= m_start;
+        m_zeroAreaEnd -= m_start;
+        m_end -= m_start;
+        begin -= m_start;
+        m_start = 0;
+
+        m_data->m_dirtyStart = m_start;
+        m_data->m_dirtyEnd = m_end;
+        m_maxZeroAreaStart = std::max(m_maxZeroAreaStart, m_zeroAreaStart);
+        LOG_INTERNAL_STATE("unshare start=" << start << ", ");
+    }
+    NS_ASSERT(CheckInternalState());
+    if (begin >= m_zeroAreaEnd)
+    {
+        // bytes after the zero area are stored right after the ones before it
+        return m_data->m_data + m_zeroAreaStart + (begin - m_zeroAreaEnd);
+    }
+    return m_data->m_data + begin;
+}
+
 void
 Buffer::CopyData(std::ostream* os, uint32_t size) const
 {
@@ -14,7 +14,9 @@
 #include <stdint.h>
 #include <vector>
 
+#ifndef NS3_MTP // the free list is not shared between threads
 #define BUFFER_FREE_LIST 1
+#endif
 
 namespace ns3
 {
@@ -490,6 +492,22 @@ class Buffer
      */
     const uint8_t* PeekData() const;
 
+    /**
+     * \param start offset from the start of the buffer
+     * \param size number of bytes which will be modified
+     * \return a pointer to \p size contiguous writable bytes starting
+     *         at offset \p start, or nullptr if the region does not fit
+     *         within the buffer.
+     *
+     * Unlike PeekData, only the requested region is guaranteed to be
+     * valid through the returned pointer. If the underlying data is
+     * shared with other Buffer instances, it is first copied so that
+     * the modification is not visible to them. The zero area is only
+     * materialized if the region overlaps it. The pointer is
+     * invalidated by any call which changes the size of the buffer.
+     */
+    uint8_t* PeekMutableData(uint32_t start, uint32_t size);
+
     /**
      * \param start size to reserve
      *
@@ -758,7 +776,11 @@ class Buffer
      * writing data. i.e., m_start should be initialized to this
      * value.
      */
+#ifdef NS3_MTP
+    static thread_local uint32_t g_recommendedStart;
+#else
     static uint32_t g_recommendedStart;
+#endif
 
     /**
      * offset to the start of the virtual zero area from the start
@@ -13,7 +13,9 @@
 #include <limits>
 #include <vector>
 
+#ifndef NS3_MTP // the free list is not shared between threads
 #define USE_FREE_LIST 1
+#endif
 #define FREE_LIST_SIZE 1000
 #define OFFSET_MAX (std::numeric_limits<int32_t>::max())
 
@@ -75,7 +75,8 @@ Node::GetTypeId()
 }
 
 Node::Node()
-    : m_id(0),
+    : m_node_type(0),
+      m_id(0),
       m_sid(0)
 {
     NS_LOG_FUNCTION(this);
@@ -83,7 +84,8 @@ Node::Node()
 }
 
 Node::Node(uint32_t sid)
-    : m_id(0),
+    : m_node_type(0),
+      m_id(0),
       m_sid(sid)
 {
     NS_LOG_FUNCTION(this << sid);
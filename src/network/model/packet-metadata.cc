@@ -26,9 +26,17 @@ NS_LOG_COMPONENT_DEFINE("PacketMetadata");
 bool PacketMetadata::m_enable = false;
 bool PacketMetadata::m_enableChecking = false;
 bool PacketMetadata::m_metadataSkipped = false;
+#ifdef NS3_MTP
+thread_local uint32_t PacketMetadata::m_maxSize = 0;
+#else
 uint32_t PacketMetadata::m_maxSize = 0;
+#endif
 uint16_t PacketMetadata::m_chunkUid = 0;
+#ifdef NS3_MTP
+thread_local PacketMetadata::DataFreeList PacketMetadata::m_freeList;
+#else
 PacketMetadata::DataFreeList PacketMetadata::m_freeList;
+#endif
 
 PacketMetadata::DataFreeList::~DataFreeList()
 {
@@ -62,6 +70,12 @@ PacketMetadata::EnableChecking()
     m_enableChecking = true;
 }
 
+bool
+PacketMetadata::IsEnabled()
+{
+    return m_enable;
+}
+
 void
 PacketMetadata::ReserveCopy(uint32_t size)
 {
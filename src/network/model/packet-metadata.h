@@ -158,6 +158,11 @@ class PacketMetadata
      * \brief Enable the packet metadata checking
      */
     static void EnableChecking();
+    /**
+     * \brief Check if the packet metadata is enabled
+     * \return true if Enable() or EnableChecking() was called
+     */
+    static bool IsEnabled();
 
     /**
      * \brief Constructor
@@ -664,7 +669,11 @@ class PacketMetadata
      */
     static void Deallocate(PacketMetadata::Data* data);
 
+#ifdef NS3_MTP
+    static thread_local DataFreeList m_freeList; //!< the metadata data storage, per thread
+#else
     static DataFreeList m_freeList; //!< the metadata data storage
+#endif
     static bool m_enable;           //!< Enable the packet metadata
     static bool m_enableChecking;   //!< Enable the packet metadata checking
 
@@ -675,7 +684,11 @@ class PacketMetadata
      */
     static bool m_metadataSkipped;
 
+#ifdef NS3_MTP
+    static thread_local uint32_t m_maxSize; //!< maximum metadata size, per thread
+#else
     static uint32_t m_maxSize;  //!< maximum metadata size
+#endif
     static uint16_t m_chunkUid; //!< Chunk Uid
 
     Data* m_data; //!< Metadata storage
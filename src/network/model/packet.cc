@@ -19,7 +19,11 @@ namespace ns3
 
 NS_LOG_COMPONENT_DEFINE("Packet");
 
+#ifdef NS3_MTP
+std::atomic<uint32_t> Packet::m_globalUid = 0;
+#else
 uint32_t Packet::m_globalUid = 0;
+#endif
 
 TypeId
 ByteTagIterator::Item::GetTypeId() const
@@ -135,17 +139,17 @@ Packet::Packet()
        * zero.  The lower 32 bits are for the
        * global UID
        */
-      m_metadata(static_cast<uint64_t>(Simulator::GetSystemId()) << 32 | m_globalUid, 0),
+      m_metadata(static_cast<uint64_t>(Simulator::GetSystemId()) << 32 | m_globalUid++, 0),
       m_nixVector(nullptr)
 {
-    m_globalUid++;
 }
 
 Packet::Packet(const Packet& o)
     : m_buffer(o.m_buffer),
       m_byteTagList(o.m_byteTagList),
       m_packetTagList(o.m_packetTagList),
-      m_metadata(o.m_metadata)
+      m_metadata(o.m_metadata),
+      m_meta(o.m_meta)
 {
     o.m_nixVector ? m_nixVector = o.m_nixVector->Copy() : m_nixVector = nullptr;
 }
@@ -161,6 +165,7 @@ Packet::operator=(const Packet& o)
     m_byteTagList = o.m_byteTagList;
     m_packetTagList = o.m_packetTagList;
     m_metadata = o.m_metadata;
+    m_meta = o.m_meta;
     o.m_nixVector ? m_nixVector = o.m_nixVector->Copy() : m_nixVector = nullptr;
     return *this;
 }
@@ -175,10 +180,9 @@ Packet::Packet(uint32_t size)
        * zero.  The lower 32 bits are for the
        * global UID
        */
-      m_metadata(static_cast<uint64_t>(Simulator::GetSystemId()) << 32 | m_globalUid, size),
+      m_metadata(static_cast<uint64_t>(Simulator::GetSystemId()) << 32 | m_globalUid++, size),
       m_nixVector(nullptr)
 {
-    m_globalUid++;
 }
 
 Packet::Packet(const uint8_t* buffer, uint32_t size, bool magic)
@@ -202,10 +206,9 @@ Packet::Packet(const uint8_t* buffer, uint32_t size)
        * zero.  The lower 32 bits are for the
        * global UID
        */
-      m_metadata(static_cast<uint64_t>(Simulator::GetSystemId()) << 32 | m_globalUid, size),
+      m_metadata(static_cast<uint64_t>(Simulator::GetSystemId()) << 32 | m_globalUid++, size),
       m_nixVector(nullptr)
 {
-    m_globalUid++;
     m_buffer.AddAtStart(size);
     Buffer::Iterator i = m_buffer.Begin();
     i.Write(buffer, size);
@@ -237,6 +240,7 @@ Packet::CreateFragment(uint32_t start, uint32_t length) const
     // through Create because it is private.
     Ptr<Packet> ret =
         Ptr<Packet>(new Packet(buffer, byteTagList, m_packetTagList, metadata), false);
+    ret->m_meta = m_meta;
     ret->SetNixVector(GetNixVector());
     return ret;
 }
@@ -397,6 +401,13 @@ Packet::CopyData(std::ostream* os, uint32_t size) const
     return m_buffer.CopyData(os, size);
 }
 
+uint8_t*
+Packet::PeekMutableData(uint32_t offset, uint32_t size)
+{
+    NS_LOG_FUNCTION(this << offset << size);
+    return m_buffer.PeekMutableData(offset, size);
+}
+
 uint64_t
 Packet::GetUid() const
 {
@@ -24,6 +24,10 @@
 
 #include <stdint.h>
 
+#ifdef NS3_MTP
+#include <atomic>
+#endif
+
 namespace ns3
 {
 
@@ -427,6 +431,35 @@ class Packet : public SimpleRefCount<Packet>
      */
     uint32_t CopyData(uint8_t* buffer, uint32_t size) const;
 
+    /**
+     * \brief Get a writable view of a region of the packet contents.
+     *
+     * \param offset offset of the region from the start of the packet
+     * \param size size of the region
+     * \returns a pointer to the region, or nullptr if it does not fit
+     *          in the packet.
+     *
+     * The region is modified in place: no copy of the packet is made
+     * unless its bytes are shared with another packet, in which case
+     * only this packet sees the modification. The pointer is valid until
+     * the size of the packet changes.
+     */
+    uint8_t* PeekMutableData(uint32_t offset, uint32_t size);
+
+    /**
+     * \brief Get a header laid out in wire format at a fixed offset,
+     *        for in-place modification.
+     *
+     * \tparam T a type with a static GetStaticSize() and no internal
+     *           padding, whose in-memory layout matches its serialized
+     *           form (e.g., IntHeader).
+     * \param offset offset of the header from the start of the packet
+     * \returns a pointer to the header, or nullptr if it does not fit
+     *          in the packet.
+     */
+    template <typename T>
+    T* PeekMutableHeader(uint32_t offset);
+
     /**
      * \brief Copy the packet contents to an output stream.
      *
@@ -660,6 +693,48 @@ class Packet : public SimpleRefCount<Packet>
      */
     void RemoveAllPacketTags();
 
+    /// Value of a metadata field which is not set.
+    static constexpr uint32_t META_NONE = 0xffffffff;
+
+    /**
+     * \brief Set the ingress port metadata field.
+     *
+     * The metadata fields (ingress port, queue index, enqueue timestamp) are
+     * a fixed set of per-packet values for the forwarding path of a node,
+     * stored in the Packet itself: unlike packet tags, setting them does not
+     * allocate. They are copied with the packet, like the packet tags, but
+     * are not serialized.
+     *
+     * \param port the ifIndex of the device which received the packet
+     */
+    inline void SetIngressPort(uint32_t port);
+    /**
+     * \returns the ingress port, META_NONE if not set
+     */
+    inline uint32_t GetIngressPort() const;
+    /**
+     * \brief Set the queue index metadata field.
+     * \param qIndex the index of the egress queue holding the packet
+     */
+    inline void SetQueueIndex(uint32_t qIndex);
+    /**
+     * \returns the queue index, META_NONE if not set
+     */
+    inline uint32_t GetQueueIndex() const;
+    /**
+     * \brief Set the enqueue timestamp metadata field.
+     * \param ts the time step at which the packet was enqueued
+     */
+    inline void SetEnqueueTs(int64_t ts);
+    /**
+     * \returns the enqueue timestamp, -1 if not set
+     */
+    inline int64_t GetEnqueueTs() const;
+    /**
+     * \brief Clear all the metadata fields.
+     */
+    inline void ResetMeta();
+
     /**
      * \brief Print the list of packet tags.
      *
@@ -781,10 +856,24 @@ class Packet : public SimpleRefCount<Packet>
     PacketTagList m_packetTagList; //!< the packet's Tag list
     PacketMetadata m_metadata;     //!< the packet's metadata
 
+    /// The metadata fields, see SetIngressPort()
+    struct Meta
+    {
+        uint32_t ingressPort = META_NONE; //!< ingress port
+        uint32_t queueIndex = META_NONE;  //!< queue index
+        int64_t enqueueTs = -1;           //!< enqueue timestamp
+    };
+
+    Meta m_meta; //!< the packet's metadata fields
+
     /* Please see comments above about nix-vector */
     mutable Ptr<NixVector> m_nixVector; //!< the packet's Nix vector
 
+#ifdef NS3_MTP
+    static std::atomic<uint32_t> m_globalUid; //!< Global counter of packets Uid
+#else
     static uint32_t m_globalUid; //!< Global counter of packets Uid
+#endif
 };
 
 /**
@@ -852,6 +941,55 @@ Packet::GetSize() const
     return m_buffer.GetSize();
 }
 
+template <typename T>
+T*
+Packet::PeekMutableHeader(uint32_t offset)
+{
+    return reinterpret_cast<T*>(PeekMutableData(offset, T::GetStaticSize()));
+}
+
+void
+Packet::SetIngressPort(uint32_t port)
+{
+    m_meta.ingressPort = port;
+}
+
+uint32_t
+Packet::GetIngressPort() const
+{
+    return m_meta.ingressPort;
+}
+
+void
+Packet::SetQueueIndex(uint32_t qIndex)
+{
+    m_meta.queueIndex = qIndex;
+}
+
+uint32_t
+Packet::GetQueueIndex() const
+{
+    return m_meta.queueIndex;
+}
+
+void
+Packet::SetEnqueueTs(int64_t ts)
+{
+    m_meta.enqueueTs = ts;
+}
+
+int64_t
+Packet::GetEnqueueTs() const
+{
+    return m_meta.enqueueTs;
+}
+
+void
+Packet::ResetMeta()
+{
+    m_meta = Meta();
+}
+
 } // namespace ns3
 
 #endif /* PACKET_H */
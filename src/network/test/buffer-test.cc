@@ -382,6 +382,31 @@ BufferTest::DoRun()
     val2 <<= 8;
     val2 |= i.ReadU8();
     NS_TEST_ASSERT_MSG_EQ(val1, val2, "Bad ReadNtohU16()");
+
+    // in-place modification through PeekMutableData
+    buffer = Buffer(4);
+    buffer.AddAtStart(2);
+    i = buffer.Begin();
+    i.WriteU8(0x11);
+    i.WriteU8(0x22);
+    buffer.AddAtEnd(2);
+    i = buffer.End();
+    i.Prev(2);
+    i.WriteU8(0x33);
+    i.WriteU8(0x44);
+    ENSURE_WRITTEN_BYTES(buffer, 8, 0x11, 0x22, 0, 0, 0, 0, 0x33, 0x44);
+    NS_TEST_ASSERT_MSG_EQ(buffer.PeekMutableData(7, 2), nullptr, "Region out of bounds");
+    Buffer shared = buffer;
+    uint8_t* region = buffer.PeekMutableData(1, 1);
+    region[0] = 0xaa;
+    region = buffer.PeekMutableData(6, 2);
+    region[1] = 0xbb;
+    ENSURE_WRITTEN_BYTES(buffer, 8, 0x11, 0xaa, 0, 0, 0, 0, 0x33, 0xbb);
+    ENSURE_WRITTEN_BYTES(shared, 8, 0x11, 0x22, 0, 0, 0, 0, 0x33, 0x44);
+    region = buffer.PeekMutableData(1, 3);
+    region[2] = 0xcc;
+    ENSURE_WRITTEN_BYTES(buffer, 8, 0x11, 0xaa, 0, 0xcc, 0, 0, 0x33, 0xbb);
+    ENSURE_WRITTEN_BYTES(shared, 8, 0x11, 0x22, 0, 0, 0, 0, 0x33, 0x44);
 }
 
 /**
@@ -1257,6 +1257,52 @@ PacketTagListTest::DoRun()
     } // Timing
 }
 
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * Packet metadata fields unit tests.
+ */
+class PacketMetaTest : public TestCase
+{
+  public:
+    PacketMetaTest();
+
+  private:
+    void DoRun() override;
+};
+
+PacketMetaTest::PacketMetaTest()
+    : TestCase("Packet metadata fields")
+{
+}
+
+void
+PacketMetaTest::DoRun()
+{
+    Ptr<Packet> p = Create<Packet>(100);
+    NS_TEST_EXPECT_MSG_EQ(p->GetIngressPort(), Packet::META_NONE, "not set");
+    NS_TEST_EXPECT_MSG_EQ(p->GetQueueIndex(), Packet::META_NONE, "not set");
+    NS_TEST_EXPECT_MSG_EQ(p->GetEnqueueTs(), -1, "not set");
+    p->SetIngressPort(3);
+    p->SetQueueIndex(5);
+    p->SetEnqueueTs(1000);
+
+    Ptr<Packet> copy = p->Copy();
+    Ptr<Packet> fragment = p->CreateFragment(10, 50);
+    p->SetIngressPort(4);
+    NS_TEST_EXPECT_MSG_EQ(copy->GetIngressPort(), 3, "copied with the packet");
+    NS_TEST_EXPECT_MSG_EQ(copy->GetQueueIndex(), 5, "copied with the packet");
+    NS_TEST_EXPECT_MSG_EQ(copy->GetEnqueueTs(), 1000, "copied with the packet");
+    NS_TEST_EXPECT_MSG_EQ(fragment->GetIngressPort(), 3, "copied with a fragment");
+    NS_TEST_EXPECT_MSG_EQ(p->GetIngressPort(), 4, "set again");
+
+    p->ResetMeta();
+    NS_TEST_EXPECT_MSG_EQ(p->GetIngressPort(), Packet::META_NONE, "reset");
+    NS_TEST_EXPECT_MSG_EQ(p->GetEnqueueTs(), -1, "reset");
+    NS_TEST_EXPECT_MSG_EQ(copy->GetQueueIndex(), 5, "copy not reset");
+}
+
 /**
  * \ingroup network-test
  * \ingroup tests
@@ -1274,6 +1320,7 @@ PacketTestSuite::PacketTestSuite()
 {
     AddTestCase(new PacketTest, TestCase::Duration::QUICK);
     AddTestCase(new PacketTagListTest, TestCase::Duration::QUICK);
+    AddTestCase(new PacketMetaTest, TestCase::Duration::QUICK);
 }
 
 static PacketTestSuite g_packetTestSuite; //!< Static variable for test initialization
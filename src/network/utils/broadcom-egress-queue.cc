@@ -25,6 +25,7 @@
 #include "ns3/simulator.h"
 #include "ns3/uinteger.h"
 
+#include <bit>
 #include <iostream>
 #include <stdio.h>
 
@@ -47,6 +48,21 @@ BEgressQueue::GetTypeId(void)
                           DoubleValue(1000.0 * 1024 * 1024),
                           MakeDoubleAccessor(&BEgressQueue::m_maxBytes),
                           MakeDoubleChecker<double>())
+            .AddAttribute("NumPriorities",
+                          "The number of priority queues, queue 0 being the strict priority one.",
+                          UintegerValue(qCnt),
+                          MakeUintegerAccessor(&BEgressQueue::m_nPriorities),
+                          MakeUintegerChecker<uint32_t>(1, qCnt))
+            .AddAttribute("SchedulingMode",
+                          "How the queues other than queue 0 are scheduled.",
+                          EnumValue(RR),
+                          MakeEnumAccessor<SchedulingMode>(&BEgressQueue::m_mode),
+                          MakeEnumChecker(RR, "RR", DWRR, "DWRR", SP, "SP"))
+            .AddAttribute("Quantum",
+                          "The bytes a queue may send per DWRR turn.",
+                          UintegerValue(1500),
+                          MakeUintegerAccessor(&BEgressQueue::m_quantum),
+                          MakeUintegerChecker<uint32_t>(1))
             .AddTraceSource("BeqEnqueue",
                             "Enqueue a packet in the BEgressQueue. Multiple queue",
                             MakeTraceSourceAccessor(&BEgressQueue::m_traceBeqEnqueue),
@@ -64,14 +80,19 @@ BEgressQueue::BEgressQueue()
       NS_LOG_TEMPLATE_DEFINE("BEgressQueue")
 {
     NS_LOG_FUNCTION_NOARGS();
+    m_nPriorities = qCnt;
+    m_mode = RR;
+    m_quantum = 1500;
     m_bytesInQueueTotal = 0;
     m_rrlast = 0;
-    for (uint32_t i = 0; i < fCnt; i++)
-    {
-        m_bytesInQueue[i] = 0;
-        m_queues.push_back(CreateObject<SimpleDropTailQueue>());
-        // m_queues.push_back(CreateObject<PacketQueue>());
-    }
+    m_qlast = 0;
+    m_nonEmpty = 0;
+    m_nBytes = 0;
+    m_nTotalReceivedBytes = 0;
+    m_nPackets = 0;
+    m_nTotalReceivedPackets = 0;
+    m_nTotalDroppedBytes = 0;
+    m_nTotalDroppedPackets = 0;
 }
 
 BEgressQueue::~BEgressQueue()
@@ -79,16 +100,81 @@ BEgressQueue::~BEgressQueue()
     NS_LOG_FUNCTION_NOARGS();
 }
 
+void
+BEgressQueue::NotifyConstructionCompleted(void)
+{
+    PacketQueue::NotifyConstructionCompleted();
+    // the attributes are set by now
+    m_queues.resize(m_nPriorities);
+    m_quanta.assign(m_nPriorities, m_quantum);
+    m_deficit.assign(m_nPriorities, 0);
+}
+
+BEgressQueue::PacketRing::PacketRing()
+    : m_head(0),
+      m_size(0),
+      m_bytes(0)
+{
+}
+
+void
+BEgressQueue::PacketRing::Push(Ptr<Packet> p)
+{
+    if (m_size == m_buf.size())
+    {
+        // unroll the ring into a buffer twice as large
+        std::vector<Ptr<Packet>> buf(m_buf.empty() ? 16 : 2 * m_buf.size());
+        for (uint32_t i = 0; i < m_size; i++)
+        {
+            buf[i] = std::move(m_buf[(m_head + i) % m_buf.size()]);
+        }
+        m_buf.swap(buf);
+        m_head = 0;
+    }
+    m_bytes += p->GetSize();
+    m_buf[(m_head + m_size) % m_buf.size()] = std::move(p);
+    m_size++;
+}
+
+Ptr<Packet>
+BEgressQueue::PacketRing::Pop(void)
+{
+    Ptr<Packet> p = std::move(m_buf[m_head]);
+    m_head = (m_head + 1) % m_buf.size();
+    m_size--;
+    m_bytes -= p->GetSize();
+    return p;
+}
+
+Ptr<Packet>
+BEgressQueue::PacketRing::Front(void) const
+{
+    return m_buf[m_head];
+}
+
+bool
+BEgressQueue::PacketRing::IsEmpty(void) const
+{
+    return m_size == 0;
+}
+
+uint32_t
+BEgressQueue::PacketRing::GetNBytes(void) const
+{
+    return m_bytes;
+}
+
 bool
 BEgressQueue::DoEnqueue(Ptr<Packet> p, uint32_t qIndex)
 {
     NS_LOG_FUNCTION(this << p);
+    NS_ASSERT_MSG(qIndex < m_queues.size(), "BEgressQueue: no such priority " << qIndex);
 
     if (m_bytesInQueueTotal + p->GetSize() < m_maxBytes) // infinite queue
     {
-        m_queues[qIndex]->Enqueue(p);
         m_bytesInQueueTotal += p->GetSize();
-        m_bytesInQueue[qIndex] += p->GetSize();
+        m_queues[qIndex].Push(p);
+        m_nonEmpty |= 1u << qIndex;
     }
     else
     {
@@ -97,57 +183,80 @@ BEgressQueue::DoEnqueue(Ptr<Packet> p, uint32_t qIndex)
     return true;
 }
 
+uint32_t
+BEgressQueue::SelectRR(uint32_t ready)
+{
+    // the first ready queue after the last one, wrapping around
+    uint32_t after = ready & ~((2u << m_rrlast) - 1);
+    return std::countr_zero(after ? after : ready);
+}
+
+uint32_t
+BEgressQueue::SelectDWRR(uint32_t ready)
+{
+    while (true)
+    {
+        if ((ready >> m_rrlast & 1) &&
+            m_deficit[m_rrlast] >= m_queues[m_rrlast].Front()->GetSize())
+        {
+            return m_rrlast;
+        }
+        // the turn of the next ready queue, the current one keeps its deficit
+        m_rrlast = SelectRR(ready);
+        m_deficit[m_rrlast] += m_quanta[m_rrlast];
+    }
+}
+
 Ptr<Packet>
-BEgressQueue::DoDequeueRR(bool paused[]) // this is for switch only
+BEgressQueue::DoDequeueRR(uint32_t pausedMask) // this is for switch only
 {
     NS_LOG_FUNCTION(this);
 
-    if (m_bytesInQueueTotal == 0)
+    // queue 0 is the highest priority and ignores pause
+    uint32_t ready = m_nonEmpty & ~(pausedMask & ~1u);
+    if (ready == 0)
     {
-        NS_LOG_LOGIC("Queue empty");
+        NS_LOG_LOGIC("Nothing can be sent");
         return 0;
     }
-    bool found = false;
     uint32_t qIndex;
-
-    if (m_queues[0]->GetNPackets() > 0) // 0 is the highest priority
+    if (ready & 1)
     {
-        found = true;
         qIndex = 0;
     }
+    else if (m_mode == SP)
+    {
+        qIndex = std::countr_zero(ready);
+    }
+    else if (m_mode == DWRR)
+    {
+        qIndex = SelectDWRR(ready);
+    }
     else
     {
-        if (!found)
-        {
-            for (qIndex = 1; qIndex <= qCnt; qIndex++)
-            {
-                if (!paused[(qIndex + m_rrlast) % qCnt] &&
-                    m_queues[(qIndex + m_rrlast) % qCnt]->GetNPackets() > 0) // round robin
-                {
-                    found = true;
-                    break;
-                }
-            }
-            qIndex = (qIndex + m_rrlast) % qCnt;
-        }
+        qIndex = SelectRR(ready);
     }
-    if (found)
+
+    Ptr<Packet> p = m_queues[qIndex].Pop();
+    m_traceBeqDequeue(p, qIndex);
+    m_bytesInQueueTotal -= p->GetSize();
+    if (m_queues[qIndex].IsEmpty())
     {
-        Ptr<Packet> p = m_queues[qIndex]->Dequeue();
-        m_traceBeqDequeue(p, qIndex);
-        m_bytesInQueueTotal -= p->GetSize();
-        m_bytesInQueue[qIndex] -= p->GetSize();
-        if (qIndex != 0)
-        {
-            m_rrlast = qIndex;
-        }
-        m_qlast = qIndex;
-        NS_LOG_LOGIC("Popped " << p);
-        NS_LOG_LOGIC("Number bytes " << m_bytesInQueueTotal);
-        return p;
+        m_nonEmpty &= ~(1u << qIndex);
+        m_deficit[qIndex] = 0;
     }
-    NS_LOG_LOGIC("Nothing can be sent");
-    return 0;
+    else if (m_mode == DWRR && qIndex != 0)
+    {
+        m_deficit[qIndex] -= p->GetSize();
+    }
+    if (qIndex != 0 && m_mode != DWRR)
+    {
+        m_rrlast = qIndex;
+    }
+    m_qlast = qIndex;
+    NS_LOG_LOGIC("Popped " << p);
+    NS_LOG_LOGIC("Number bytes " << m_bytesInQueueTotal);
+    return p;
 }
 
 bool
@@ -176,9 +285,20 @@ BEgressQueue::Enqueue(Ptr<Packet> p, uint32_t qIndex)
 
 Ptr<Packet>
 BEgressQueue::DequeueRR(bool paused[])
+{
+    uint32_t pausedMask = 0;
+    for (uint32_t i = 0; i < m_queues.size(); i++)
+    {
+        pausedMask |= (uint32_t)paused[i] << i;
+    }
+    return DequeueRR(pausedMask);
+}
+
+Ptr<Packet>
+BEgressQueue::DequeueRR(uint32_t pausedMask)
 {
     NS_LOG_FUNCTION(this);
-    Ptr<Packet> packet = DoDequeueRR(paused);
+    Ptr<Packet> packet = DoDequeueRR(pausedMask);
     if (packet != nullptr)
     {
         NS_ASSERT(m_nBytes >= packet->GetSize());
@@ -199,9 +319,9 @@ BEgressQueue::DoEnqueue(Ptr<Packet> p) // for compatiability
     NS_LOG_FUNCTION(this << p);
     if (m_bytesInQueueTotal + p->GetSize() < m_maxBytes)
     {
-        m_queues[qIndex]->Enqueue(p);
         m_bytesInQueueTotal += p->GetSize();
-        m_bytesInQueue[qIndex] += p->GetSize();
+        m_queues[qIndex].Push(p);
+        m_nonEmpty |= 1u << qIndex;
     }
     else
     {
@@ -227,14 +347,14 @@ BEgressQueue::DoPeek(void) const // DoPeek doesn't work for multiple queues!!
         NS_LOG_LOGIC("Queue empty");
         return 0;
     }
-    NS_LOG_LOGIC("Number bytes " << m_bytesInQueue);
-    return m_queues[0]->Peek();
+    NS_LOG_LOGIC("Number bytes " << m_bytesInQueueTotal);
+    return m_queues[0].Front();
 }
 
 uint32_t
 BEgressQueue::GetNBytes(uint32_t qIndex) const
 {
-    return m_bytesInQueue[qIndex];
+    return qIndex < m_queues.size() ? m_queues[qIndex].GetNBytes() : 0;
 }
 
 uint32_t
@@ -249,4 +369,23 @@ BEgressQueue::GetLastQueue()
     return m_qlast;
 }
 
+uint32_t
+BEgressQueue::GetNPriorities() const
+{
+    return m_queues.size();
+}
+
+void
+BEgressQueue::SetQuantum(uint32_t qIndex, uint32_t bytes)
+{
+    NS_ASSERT_MSG(qIndex < m_quanta.size() && bytes > 0, "BEgressQueue: bad quantum");
+    m_quanta[qIndex] = bytes;
+}
+
+uint32_t
+BEgressQueue::GetQuantum(uint32_t qIndex) const
+{
+    return m_quanta[qIndex];
+}
+
 } // namespace ns3
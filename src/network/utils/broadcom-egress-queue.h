@@ -29,31 +29,77 @@
 #include "ns3/point-to-point-net-device.h"
 #include "ns3/ptr.h"
 
-#include <queue>
+#include <vector>
 
 namespace ns3
 {
 
 class TraceContainer;
 
+/**
+ * Egress queues of a switch port, one per priority.
+ *
+ * Queue 0 always goes first and is never paused. The other queues are
+ * scheduled according to SchedulingMode:
+ *   RR:   round robin, one packet per turn
+ *   DWRR: deficit weighted round robin, Quantum bytes per turn (see SetQuantum)
+ *   SP:   strict priority, the lowest index first
+ * The queues holding packets are kept in a bitmask, so that the next one
+ * is found without a scan of all the queues.
+ */
 class BEgressQueue : public PacketQueue
 {
   public:
     static TypeId GetTypeId(void);
-    static const unsigned fCnt = 128; // max number of queues, 128 for NICs
-    static const unsigned qCnt = 8;   // max number of queues, 8 for switches
+    static const unsigned qCnt = 8; // max number of queues, 8 for switches
+
+    enum SchedulingMode
+    {
+        RR,
+        DWRR,
+        SP
+    };
+
     BEgressQueue();
     virtual ~BEgressQueue();
     bool Enqueue(Ptr<Packet> p, uint32_t qIndex);
     Ptr<Packet> DequeueRR(bool paused[]);
+    // bit i of pausedMask set if queue i is paused
+    Ptr<Packet> DequeueRR(uint32_t pausedMask);
+    // bytes per DWRR turn of a queue, Quantum unless set here
+    void SetQuantum(uint32_t qIndex, uint32_t bytes);
+    uint32_t GetQuantum(uint32_t qIndex) const;
     uint32_t GetNBytes(uint32_t qIndex) const;
     uint32_t GetNBytesTotal() const;
     uint32_t GetLastQueue();
+    uint32_t GetNPriorities() const;
 
     TracedCallback<Ptr<const Packet>, uint32_t> m_traceBeqEnqueue;
     TracedCallback<Ptr<const Packet>, uint32_t> m_traceBeqDequeue;
 
   private:
+    /**
+     * FIFO of one priority, a ring over a vector that doubles when full.
+     */
+    class PacketRing
+    {
+      public:
+        PacketRing();
+        void Push(Ptr<Packet> p);
+        Ptr<Packet> Pop(void);
+        Ptr<Packet> Front(void) const;
+        bool IsEmpty(void) const;
+        uint32_t GetNBytes(void) const;
+
+      private:
+        std::vector<Ptr<Packet>> m_buf;
+        uint32_t m_head;  // index of the first packet
+        uint32_t m_size;  // number of packets
+        uint32_t m_bytes; // bytes of the packets
+    };
+
+    void NotifyConstructionCompleted(void) override;
+
     /**
      * Place a packet into the rear of the Queue
      * \param p packet to enqueue
@@ -71,17 +117,25 @@ class BEgressQueue : public PacketQueue
      */
     Ptr<const Packet> Peek(void) const;
     bool DoEnqueue(Ptr<Packet> p, uint32_t qIndex);
-    Ptr<Packet> DoDequeueRR(bool paused[]);
+    Ptr<Packet> DoDequeueRR(uint32_t pausedMask);
+    // pick the queue to send from, ready being the queues allowed to send
+    uint32_t SelectRR(uint32_t ready);
+    uint32_t SelectDWRR(uint32_t ready);
     // for compatibility
     virtual bool DoEnqueue(Ptr<Packet> p);
     virtual Ptr<Packet> DoDequeue(void);
     virtual Ptr<const Packet> DoPeek(void) const;
     double m_maxBytes; // total bytes limit
-    uint32_t m_bytesInQueue[fCnt];
+    uint32_t m_nPriorities;
+    SchedulingMode m_mode;
+    uint32_t m_quantum; // default DWRR quantum
     uint32_t m_bytesInQueueTotal;
-    uint32_t m_rrlast;
+    uint32_t m_rrlast; // last queue of the round robin, current one for DWRR
     uint32_t m_qlast;
-    std::vector<Ptr<SimpleDropTailQueue>> m_queues; // uc queues
+    uint32_t m_nonEmpty; // bit i set if queue i holds packets
+    std::vector<PacketRing> m_queues; // one per priority
+    std::vector<uint32_t> m_quanta;   // DWRR quantum of each queue
+    std::vector<uint32_t> m_deficit;  // DWRR deficit of each queue
 
     TracedCallback<Ptr<const Packet>> m_traceEnqueue;
     TracedCallback<Ptr<const Packet>> m_traceDequeue;
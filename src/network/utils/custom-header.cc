@@ -23,6 +23,10 @@
 #include "ns3/abort.h"
 #include "ns3/assert.h"
 #include "ns3/log.h"
+#include "ns3/packet.h"
+
+#include <algorithm>
+#include <cstring>
 
 namespace ns3
 {
@@ -35,6 +39,7 @@ CustomHeader::CustomHeader()
     : brief(1),
       headerType(L3_Header | L4_Header),
       getInt(1),
+      intParsed(false),
       // ppp header
       pppProto(0),
       // IPv4 header
@@ -54,6 +59,7 @@ CustomHeader::CustomHeader(uint32_t _headerType)
     : brief(1),
       headerType(_headerType),
       getInt(1),
+      intParsed(false),
       // ppp header
       pppProto(0),
       // IPv4 header
@@ -96,7 +102,7 @@ CustomHeader::GetSerializedSize(void) const
 {
     uint32_t len = 0;
     if (headerType & L2_Header)
-        len += 14;
+        len += GetL2HeaderSize();
     if (headerType & L3_Header)
         len += 5 * 4;
     if (headerType & L4_Header)
@@ -124,9 +130,6 @@ CustomHeader::Serialize(Buffer::Iterator start) const
     if (headerType & L2_Header)
     {
         i.WriteHtonU16(pppProto);
-        // skip 12 Bytes, so total 14 bytes as Ethernet
-        i.WriteU64(0); // 8 bytes
-        i.WriteU32(0); // 4 byets
     }
 
     // IPv4
@@ -219,8 +222,7 @@ CustomHeader::Deserialize(Buffer::Iterator start)
     if (headerType & L2_Header)
     {
         pppProto = i.ReadNtohU16();
-        i.Next(12);
-        l2Size = 14;
+        l2Size = GetL2HeaderSize();
     }
 
     // L3
@@ -335,7 +337,10 @@ CustomHeader::Deserialize(Buffer::Iterator start)
             udp.seq = i.ReadNtohU64();
             udp.pg = i.ReadNtohU16();
             if (getInt)
+            {
                 udp.ih.Deserialize(i);
+                intParsed = true;
+            }
 
             l4Size = GetUdpHeaderSize();
         }
@@ -356,7 +361,10 @@ CustomHeader::Deserialize(Buffer::Iterator start)
             ack.pg = i.ReadU16();
             ack.seq = i.ReadU64();
             if (getInt)
+            {
                 ack.ih.Deserialize(i);
+                intParsed = true;
+            }
             l4Size = GetAckSerializedSize();
         }
         else if (l3Prot == 0xFE)
@@ -371,12 +379,216 @@ CustomHeader::Deserialize(Buffer::Iterator start)
     return l2Size + l3Size + l4Size;
 }
 
+namespace
+{
+
+/// Read a network order integer of n bytes
+inline uint64_t
+ReadNtoh(const uint8_t* p, uint32_t n)
+{
+    uint64_t v = 0;
+    for (uint32_t k = 0; k < n; k++)
+        v = (v << 8) | p[k];
+    return v;
+}
+
+/// Read an integer of n bytes as written by Buffer::Iterator::WriteU16/U32/U64
+inline uint64_t
+ReadLsb(const uint8_t* p, uint32_t n)
+{
+    uint64_t v = 0;
+    for (uint32_t k = n; k > 0; k--)
+        v = (v << 8) | p[k - 1];
+    return v;
+}
+
+/**
+ * Deserializes an IntHeader at a fixed offset from the start of a packet,
+ * so that Packet::PeekHeader reads it in place.
+ */
+class IntPeekHeader : public Header
+{
+  public:
+    IntPeekHeader(IntHeader& ih, uint32_t offset)
+        : m_ih(ih),
+          m_offset(offset)
+    {
+    }
+
+    static TypeId
+    GetTypeId(void)
+    {
+        static TypeId tid = TypeId("ns3::IntPeekHeader").SetParent<Header>();
+        return tid;
+    }
+
+    TypeId
+    GetInstanceTypeId(void) const override
+    {
+        return GetTypeId();
+    }
+
+    void
+    Print(std::ostream& os) const override
+    {
+    }
+
+    uint32_t
+    GetSerializedSize(void) const override
+    {
+        return m_offset + IntHeader::GetStaticSize();
+    }
+
+    void
+    Serialize(Buffer::Iterator start) const override
+    {
+        NS_ASSERT_MSG(false, "IntPeekHeader is only used to peek");
+    }
+
+    uint32_t
+    Deserialize(Buffer::Iterator start) override
+    {
+        start.Next(m_offset);
+        return m_offset + m_ih.Deserialize(start);
+    }
+
+  private:
+    IntHeader& m_ih;
+    uint32_t m_offset;
+};
+
+} // namespace
+
+uint32_t
+CustomHeader::FastParse(Ptr<const Packet> p)
+{
+    // ppp + ipv4 + the longest brief L4 fields (udp + SeqTs)
+    static const uint32_t maxSize = 2 + 20 + 8 + 10;
+    uint8_t buf[maxSize];
+    uint32_t size = std::min(p->GetSize(), maxSize);
+    p->CopyData(buf, size);
+    std::memset(buf + size, 0, maxSize - size);
+    intParsed = false;
+
+    // L2
+    uint32_t l2Size = 0;
+    if (headerType & L2_Header)
+    {
+        pppProto = ReadNtoh(buf, 2);
+        l2Size = GetL2HeaderSize();
+    }
+
+    // L3
+    uint32_t l3Size = 0;
+    if (headerType & L3_Header)
+    {
+        const uint8_t* ip = buf + l2Size;
+        if ((ip[0] >> 4) != 4)
+        {
+            NS_LOG_WARN("Trying to decode a non-IPv4 header, refusing to do it.");
+            return 0;
+        }
+        l3Size = (ip[0] & 0x0f) * 4;
+        if (l3Size != 20)
+        {
+            // ip options, the L4 fields are not at the fixed offsets
+            return p->PeekHeader(*this);
+        }
+        m_tos = ip[1];
+        ipid = ReadNtoh(ip + 4, 2);
+        l3Prot = ip[9];
+        sip = ReadNtoh(ip + 12, 4);
+        dip = ReadNtoh(ip + 16, 4);
+    }
+
+    // L4, the same fields as a brief Deserialize
+    uint32_t l4Size = 0;
+    if (headerType & L4_Header)
+    {
+        const uint8_t* l4 = buf + l2Size + l3Size;
+        if (l3Prot == 0x6)
+        { // TCP
+            tcp.sport = ReadNtoh(l4, 2);
+            tcp.dport = ReadNtoh(l4 + 2, 2);
+            tcp.seq = ReadNtoh(l4 + 4, 8);
+            tcp.ack = ReadNtoh(l4 + 12, 4);
+            tcp.tcpFlags = ReadNtoh(l4 + 16, 2) & 0x3f;
+            l4Size = tcp.length * 4;
+        }
+        else if (l3Prot == 0x11)
+        { // UDP + SeqTsHeader
+            udp.sport = ReadNtoh(l4, 2);
+            udp.dport = ReadNtoh(l4 + 2, 2);
+            udp.seq = ReadNtoh(l4 + 8, 8);
+            udp.pg = ReadNtoh(l4 + 16, 2);
+            l4Size = GetUdpHeaderSize();
+        }
+        else if (l3Prot == 0xFF)
+        { // CNP
+            cnp.qIndex = l4[0];
+            cnp.fid = ReadLsb(l4 + 1, 2);
+            cnp.ecnBits = l4[3];
+            cnp.qfb = ReadLsb(l4 + 4, 2);
+            cnp.total = ReadLsb(l4 + 6, 2);
+            l4Size = 8;
+        }
+        else if (l3Prot == 0xFC || l3Prot == 0xFD)
+        { // ACK or NACK
+            ack.sport = ReadLsb(l4, 2);
+            ack.dport = ReadLsb(l4 + 2, 2);
+            ack.flags = ReadLsb(l4 + 4, 2);
+            ack.pg = ReadLsb(l4 + 6, 2);
+            ack.seq = ReadLsb(l4 + 8, 8);
+            l4Size = GetAckSerializedSize();
+        }
+        else if (l3Prot == 0xFE)
+        { // PFC
+            pfc.time = ReadLsb(l4, 4);
+            pfc.qlen = ReadLsb(l4 + 4, 4);
+            pfc.qIndex = l4[8];
+            l4Size = 9;
+        }
+    }
+
+    return l2Size + l3Size + l4Size;
+}
+
+void
+CustomHeader::ParseInt(Ptr<const Packet> p)
+{
+    if (intParsed || !(headerType & L4_Header))
+        return;
+    uint32_t offset =
+        (headerType & L2_Header ? GetL2HeaderSize() : 0) + (headerType & L3_Header ? 20 : 0);
+    if (l3Prot == 0x11)
+    {
+        IntPeekHeader h(udp.ih, offset + 8 + sizeof(udp.seq) + sizeof(udp.pg));
+        p->PeekHeader(h);
+    }
+    else if (l3Prot == 0xFC || l3Prot == 0xFD)
+    {
+        IntPeekHeader h(ack.ih, offset + GetAckSerializedSize() - IntHeader::GetStaticSize());
+        p->PeekHeader(h);
+    }
+    else
+    {
+        return;
+    }
+    intParsed = true;
+}
+
 uint8_t
 CustomHeader::GetIpv4EcnBits(void) const
 {
     return m_tos & 0x3;
 }
 
+uint32_t
+CustomHeader::GetL2HeaderSize(void)
+{
+    return 2;
+}
+
 uint32_t
 CustomHeader::GetAckSerializedSize(void)
 {
@@ -393,7 +605,7 @@ CustomHeader::GetUdpHeaderSize(void)
 uint32_t
 CustomHeader::GetStaticWholeHeaderSize(void)
 {
-    return 14 + 20 + GetUdpHeaderSize();
+    return GetL2HeaderSize() + 20 + GetUdpHeaderSize();
 }
 
 } // namespace ns3
@@ -23,9 +23,13 @@
 
 #include "ns3/header.h"
 #include "ns3/int-header.h"
+#include "ns3/ptr.h"
 
 namespace ns3
 {
+
+class Packet;
+
 /**
  * \ingroup ipv4
  *
@@ -65,6 +69,24 @@ class CustomHeader : public Header
     virtual uint32_t Deserialize(Buffer::Iterator start);
 
     uint32_t brief, headerType, getInt;
+    bool intParsed; //!< udp.ih or ack.ih holds the INT of the packet
+
+    /**
+     * \brief Parse the fields a brief Deserialize() gives, without INT
+     *
+     * The first bytes of the packet are copied once and decoded at fixed
+     * offsets, which is enough for forwarding (sip, dip, ports, pg, l3Prot).
+     * The INT header is left for ParseInt().
+     *
+     * \param p the packet, starting with the headers in headerType
+     * \return the number of bytes parsed, 0 if not IPv4
+     */
+    uint32_t FastParse(Ptr<const Packet> p);
+    /**
+     * \brief Decode the INT header of a UDP data packet or an ACK/NACK on first use
+     * \param p the packet this header was parsed from
+     */
+    void ParseInt(Ptr<const Packet> p);
 
     enum HeaderType
     {
@@ -150,6 +172,7 @@ class CustomHeader : public Header
     };
 
     uint8_t GetIpv4EcnBits(void) const;
+    static uint32_t GetL2HeaderSize(void); // the ppp protocol, as PppHeader serializes it
     static uint32_t GetAckSerializedSize(void);
     static uint32_t GetUdpHeaderSize(void);         // include udp, seqTs, INT
     static uint32_t GetStaticWholeHeaderSize(void); // ppp + ip + udp + int
@@ -22,16 +22,18 @@
 #include "ns3/config.h"
 #include "ns3/log.h"
 #include "ns3/names.h"
+#include "ns3/nvswitch-node.h"
 #include "ns3/packet.h"
-#include "ns3/point-to-point-channel.h"
-#include "ns3/point-to-point-remote-channel.h"
 #include "ns3/qbb-channel.h"
 #include "ns3/qbb-net-device.h"
 #include "ns3/qbb-remote-channel.h"
 #include "ns3/queue.h"
 #include "ns3/simulator.h"
+#include "ns3/switch-mmu.h"
+#include "ns3/switch-node.h"
 
 #include <iostream>
+#include <set>
 #ifdef NS3_MPI
 #include "ns3/mpi-interface.h"
 #include "ns3/mpi-receiver.h"
@@ -339,6 +341,38 @@ QbbHelper::Install(std::string aName, std::string bName)
     return Install(a, b);
 }
 
+int64_t
+QbbHelper::AssignStreams(NetDeviceContainer c, int64_t stream)
+{
+    int64_t currentStream = stream;
+    std::set<uint32_t> switches;
+    for (auto i = c.Begin(); i != c.End(); ++i)
+    {
+        Ptr<QbbNetDevice> dev = DynamicCast<QbbNetDevice>(*i);
+        if (dev)
+        {
+            currentStream += dev->AssignStreams(currentStream);
+        }
+    }
+    for (auto i = c.Begin(); i != c.End(); ++i)
+    {
+        Ptr<Node> node = (*i)->GetNode();
+        if (!switches.insert(node->GetId()).second)
+        {
+            continue;
+        }
+        if (Ptr<SwitchNode> sw = DynamicCast<SwitchNode>(node))
+        {
+            currentStream += sw->m_mmu->AssignStreams(currentStream);
+        }
+        else if (Ptr<NVSwitchNode> nvsw = DynamicCast<NVSwitchNode>(node))
+        {
+            currentStream += nvsw->m_mmu->AssignStreams(currentStream);
+        }
+    }
+    return (currentStream - stream);
+}
+
 void
 QbbHelper::GetTraceFromPacket(TraceFormat& tr,
                               Ptr<QbbNetDevice> dev,
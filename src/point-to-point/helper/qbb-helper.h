@@ -156,6 +156,18 @@ class QbbHelper : public PcapHelperForDevice, public AsciiTraceHelperForDevice
      */
     NetDeviceContainer Install(std::string aNode, std::string bNode);
 
+    /**
+     * Assign a fixed random variable stream number to the random variables
+     * used by the QbbNetDevices of c (PFC ip ids) and by the SwitchMmu of
+     * their switches (ECN marking), each switch once. Return the number of
+     * streams that have been assigned.
+     *
+     * \param c the devices
+     * \param stream first stream index to use
+     * eturn the number of stream indices assigned
+     */
+    int64_t AssignStreams(NetDeviceContainer c, int64_t stream);
+
     static void GetTraceFromPacket(TraceFormat& tr,
                                    Ptr<QbbNetDevice>,
                                    Ptr<const Packet> p,
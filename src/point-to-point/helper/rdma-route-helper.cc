@@ -0,0 +1,387 @@
+#include "rdma-route-helper.h"
+
+#include "ns3/channel.h"
+#include "ns3/log.h"
+#include "ns3/nvswitch-node.h"
+#include "ns3/qbb-net-device.h"
+#include "ns3/rdma-driver.h"
+#include "ns3/switch-node.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("RdmaRouteHelper");
+
+namespace
+{
+
+const uint32_t NONE = 0xffffffff;
+const char MAGIC[8] = {'R', 'D', 'M', 'A', 'R', 'T', 0, 1}; // cache file format 1
+
+} // namespace
+
+RdmaRouteHelper::RdmaRouteHelper()
+    : m_threads(0)
+{
+}
+
+void
+RdmaRouteHelper::SetThreads(uint32_t threads)
+{
+    m_threads = threads;
+}
+
+Ipv4Address
+RdmaRouteHelper::GetNodeAddress(uint32_t nodeId)
+{
+    return Ipv4Address(0x0b000001 + ((nodeId / 256) * 0x00010000) + ((nodeId % 256) * 0x00000100));
+}
+
+void
+RdmaRouteHelper::BuildGraph(NodeContainer nodes)
+{
+    uint32_t n = nodes.GetN();
+    m_nodes = nodes;
+    m_indexOf.clear();
+    m_type.assign(n, 0);
+    m_adj.assign(n, {});
+    m_dsts.clear();
+    for (uint32_t i = 0; i < n; i++)
+    {
+        Ptr<Node> node = nodes.Get(i);
+        if (node->GetId() >= m_indexOf.size())
+        {
+            m_indexOf.resize(node->GetId() + 1, NONE);
+        }
+        m_indexOf[node->GetId()] = i;
+        m_type[i] = node->GetNodeType();
+        if (m_type[i] != 1)
+        {
+            m_dsts.push_back(i);
+        }
+    }
+    for (uint32_t i = 0; i < n; i++)
+    {
+        Ptr<Node> node = nodes.Get(i);
+        for (uint32_t j = 0; j < node->GetNDevices(); j++)
+        {
+            Ptr<QbbNetDevice> dev = DynamicCast<QbbNetDevice>(node->GetDevice(j));
+            if (!dev || !dev->IsLinkUp() || !dev->GetChannel())
+            {
+                continue;
+            }
+            Ptr<Channel> ch = dev->GetChannel();
+            for (std::size_t k = 0; k < ch->GetNDevices(); k++)
+            {
+                Ptr<NetDevice> other = ch->GetDevice(k);
+                uint32_t peerId = other->GetNode()->GetId();
+                if (other != dev && peerId < m_indexOf.size() && m_indexOf[peerId] != NONE)
+                {
+                    m_adj[i].push_back(Link{dev->GetIfIndex(), m_indexOf[peerId]});
+                }
+            }
+        }
+    }
+}
+
+uint64_t
+RdmaRouteHelper::GetGraphHash(void) const
+{
+    // FNV-1a over the nodes, their types and their links
+    uint64_t h = 0xcbf29ce484222325ull;
+    auto mix = [&h](uint32_t v) {
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            h ^= (v >> (8 * i)) & 0xff;
+            h *= 0x100000001b3ull;
+        }
+    };
+    mix(m_adj.size());
+    for (uint32_t i = 0; i < m_adj.size(); i++)
+    {
+        mix(m_nodes.Get(i)->GetId());
+        mix(m_type[i]);
+        mix(m_adj[i].size());
+        for (auto& l : m_adj[i])
+        {
+            mix(l.intf);
+            mix(m_nodes.Get(l.peer)->GetId());
+        }
+    }
+    return h;
+}
+
+void
+RdmaRouteHelper::ComputeDestination(uint32_t d,
+                                    std::vector<uint32_t>& dist,
+                                    std::vector<uint32_t>& queue)
+{
+    uint32_t dst = m_dsts[d];
+    dist.assign(m_adj.size(), NONE);
+    queue.clear();
+    dist[dst] = 0;
+    queue.push_back(dst);
+    for (std::size_t i = 0; i < queue.size(); i++)
+    {
+        uint32_t now = queue[i];
+        if (now != dst && m_type[now] == 0)
+        {
+            continue; // hosts do not relay
+        }
+        for (auto& l : m_adj[now])
+        {
+            if (dist[l.peer] == NONE)
+            {
+                dist[l.peer] = dist[now] + 1;
+                queue.push_back(l.peer);
+            }
+        }
+    }
+
+    std::vector<uint32_t>& routes = m_routes[d];
+    routes.clear();
+    for (std::size_t i = 1; i < queue.size(); i++)
+    {
+        uint32_t u = queue[i];
+        std::size_t head = routes.size();
+        routes.push_back(u);
+        routes.push_back(0);
+        for (auto& l : m_adj[u])
+        {
+            if (dist[l.peer] + 1 == dist[u] && (l.peer == dst || m_type[l.peer] != 0))
+            {
+                routes.push_back(l.intf);
+                routes[head + 1]++;
+            }
+        }
+    }
+}
+
+void
+RdmaRouteHelper::Compute(NodeContainer nodes)
+{
+    BuildGraph(nodes);
+    m_routes.assign(m_dsts.size(), {});
+
+    uint32_t threads = m_threads ? m_threads : std::thread::hardware_concurrency();
+    threads = std::max<uint32_t>(1, std::min<uint32_t>(threads, m_dsts.size()));
+    std::atomic<uint32_t> next(0);
+    auto worker = [this, &next]() {
+        std::vector<uint32_t> dist;
+        std::vector<uint32_t> queue;
+        for (uint32_t d = next++; d < m_dsts.size(); d = next++)
+        {
+            ComputeDestination(d, dist, queue);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (uint32_t i = 1; i < threads; i++)
+    {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : pool)
+    {
+        t.join();
+    }
+    NS_LOG_INFO("Routes to " << m_dsts.size() << " destinations on " << threads << " threads");
+}
+
+void
+RdmaRouteHelper::Install(void) const
+{
+    for (uint32_t i = 0; i < m_nodes.GetN(); i++)
+    {
+        Ptr<Node> node = m_nodes.Get(i);
+        if (m_type[i] == 1)
+        {
+            DynamicCast<SwitchNode>(node)->ClearTable();
+        }
+        else if (m_type[i] == 2)
+        {
+            DynamicCast<NVSwitchNode>(node)->ClearTable();
+        }
+        else if (Ptr<RdmaDriver> driver = node->GetObject<RdmaDriver>())
+        {
+            driver->m_rdma->ClearTable();
+        }
+    }
+    for (uint32_t d = 0; d < m_dsts.size(); d++)
+    {
+        Ipv4Address dstAddr = GetNodeAddress(m_nodes.Get(m_dsts[d])->GetId());
+        const std::vector<uint32_t>& routes = m_routes[d];
+        for (std::size_t r = 0; r < routes.size(); r += 2 + routes[r + 1])
+        {
+            uint32_t u = routes[r];
+            Ptr<Node> node = m_nodes.Get(u);
+            Ptr<SwitchNode> sw = m_type[u] == 1 ? DynamicCast<SwitchNode>(node) : nullptr;
+            Ptr<NVSwitchNode> nvsw = m_type[u] == 2 ? DynamicCast<NVSwitchNode>(node) : nullptr;
+            Ptr<RdmaDriver> driver = m_type[u] == 0 ? node->GetObject<RdmaDriver>() : nullptr;
+            for (uint32_t k = 0; k < routes[r + 1]; k++)
+            {
+                uint32_t intf = routes[r + 2 + k];
+                if (sw)
+                {
+                    sw->AddTableEntry(dstAddr, intf);
+                }
+                else if (nvsw)
+                {
+                    nvsw->AddTableEntry(dstAddr, intf);
+                }
+                else if (driver)
+                {
+                    // hosts have a few ports, find the peer of this one
+                    bool isNvswitch = false;
+                    for (auto& l : m_adj[u])
+                    {
+                        if (l.intf == intf)
+                        {
+                            isNvswitch = m_type[l.peer] == 2;
+                            break;
+                        }
+                    }
+                    driver->m_rdma->AddTableEntry(dstAddr, intf, isNvswitch);
+                }
+            }
+        }
+    }
+}
+
+bool
+RdmaRouteHelper::Save(std::string file) const
+{
+    FILE* f = fopen(file.c_str(), "wb");
+    if (f == nullptr)
+    {
+        NS_LOG_WARN("Cannot write the route cache " << file);
+        return false;
+    }
+    // native byte order, the cache is for the machine which wrote it
+    uint64_t hash = GetGraphHash();
+    uint32_t nDsts = m_dsts.size();
+    bool ok = fwrite(MAGIC, sizeof(MAGIC), 1, f) == 1 && fwrite(&hash, sizeof(hash), 1, f) == 1 &&
+              fwrite(&nDsts, sizeof(nDsts), 1, f) == 1;
+    for (uint32_t d = 0; ok && d < nDsts; d++)
+    {
+        uint32_t size = m_routes[d].size();
+        ok = fwrite(&size, sizeof(size), 1, f) == 1 &&
+             fwrite(m_routes[d].data(), sizeof(uint32_t), size, f) == size;
+    }
+    ok = fclose(f) == 0 && ok;
+    if (!ok)
+    {
+        NS_LOG_WARN("Cannot write the route cache " << file);
+    }
+    return ok;
+}
+
+bool
+RdmaRouteHelper::Load(NodeContainer nodes, std::string file)
+{
+    FILE* f = fopen(file.c_str(), "rb");
+    if (f == nullptr)
+    {
+        return false;
+    }
+    BuildGraph(nodes);
+    char magic[sizeof(MAGIC)];
+    uint64_t hash;
+    uint32_t nDsts;
+    bool ok = fread(magic, sizeof(magic), 1, f) == 1 &&
+              memcmp(magic, MAGIC, sizeof(MAGIC)) == 0 && fread(&hash, sizeof(hash), 1, f) == 1 &&
+              hash == GetGraphHash() && fread(&nDsts, sizeof(nDsts), 1, f) == 1 &&
+              nDsts == m_dsts.size();
+    if (!ok)
+    {
+        NS_LOG_INFO("Route cache " << file << " is for another topology");
+    }
+    m_routes.assign(ok ? nDsts : 0, {});
+    // a record per node at most, each with at most the links of its node
+    std::size_t maxSize = 0;
+    for (auto& links : m_adj)
+    {
+        maxSize += 2 + links.size();
+    }
+    for (uint32_t d = 0; ok && d < nDsts; d++)
+    {
+        uint32_t size;
+        ok = fread(&size, sizeof(size), 1, f) == 1 && size <= maxSize;
+        if (ok)
+        {
+            m_routes[d].resize(size);
+            ok = fread(m_routes[d].data(), sizeof(uint32_t), size, f) == size &&
+                 CheckRoutes(m_routes[d]);
+        }
+    }
+    fclose(f);
+    if (!ok)
+    {
+        NS_LOG_WARN("Route cache " << file << " is corrupted");
+        m_routes.clear();
+        return false;
+    }
+    return true;
+}
+
+bool
+RdmaRouteHelper::CheckRoutes(const std::vector<uint32_t>& routes) const
+{
+    std::size_t r = 0;
+    while (r < routes.size())
+    {
+        if (routes.size() - r < 2)
+        {
+            return false;
+        }
+        uint32_t u = routes[r];
+        uint32_t n = routes[r + 1];
+        if (u >= m_nodes.GetN() || n > routes.size() - r - 2)
+        {
+            return false;
+        }
+        for (uint32_t k = 0; k < n; k++)
+        {
+            uint32_t intf = routes[r + 2 + k];
+            if (std::none_of(m_adj[u].begin(), m_adj[u].end(), [intf](const Link& l) {
+                    return l.intf == intf;
+                }))
+            {
+                return false;
+            }
+        }
+        r += 2 + n;
+    }
+    return true;
+}
+
+std::vector<uint32_t>
+RdmaRouteHelper::GetNextHops(uint32_t nodeId, uint32_t dstId) const
+{
+    if (nodeId >= m_indexOf.size() || dstId >= m_indexOf.size() || m_indexOf[nodeId] == NONE)
+    {
+        return {};
+    }
+    auto dst = std::find(m_dsts.begin(), m_dsts.end(), m_indexOf[dstId]);
+    if (dst == m_dsts.end() || m_routes.empty())
+    {
+        return {};
+    }
+    const std::vector<uint32_t>& routes = m_routes[dst - m_dsts.begin()];
+    for (std::size_t r = 0; r < routes.size(); r += 2 + routes[r + 1])
+    {
+        if (routes[r] == m_indexOf[nodeId])
+        {
+            return std::vector<uint32_t>(routes.begin() + r + 2,
+                                         routes.begin() + r + 2 + routes[r + 1]);
+        }
+    }
+    return {};
+}
+
+} /* namespace ns3 */
@@ -0,0 +1,81 @@
+#ifndef RDMA_ROUTE_HELPER_H
+#define RDMA_ROUTE_HELPER_H
+
+#include "ns3/ipv4-address.h"
+#include "ns3/node-container.h"
+
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Routing tables of an RDMA topology: hosts (node type 0), switches (type 1)
+ * and NVSwitches (type 2) joined by QbbNetDevices.
+ *
+ * Compute() runs one BFS per destination, on as many threads as configured,
+ * over the links which are up. Every node gets all the shortest-path next
+ * hops (ECMP) toward each host and NVSwitch, over paths which only go
+ * through switches and NVSwitches. Install() then clears the
+ * tables of SwitchNode, NVSwitchNode and of the RdmaHw aggregated to the
+ * hosts (through RdmaDriver) and fills them, a host port toward an NVSwitch
+ * going to the NVSwitch table of RdmaHw.
+ *
+ * The result can be saved to a binary cache and loaded back as long as the
+ * topology is the same, so that runs on the same topology skip Compute():
+ *
+ *   RdmaRouteHelper routes;
+ *   if (!routes.Load(nodes, "routes.bin"))
+ *   {
+ *       routes.Compute(nodes);
+ *       routes.Save("routes.bin");
+ *   }
+ *   routes.Install();
+ *
+ * The ip of node i is GetNodeAddress(i), 11.x.y.1 with x.y = i.
+ */
+class RdmaRouteHelper
+{
+  public:
+    RdmaRouteHelper();
+
+    void SetThreads(uint32_t threads); // 0 for all hardware threads, the default
+
+    void Compute(NodeContainer nodes);
+    void Install(void) const;
+    bool Save(std::string file) const;
+    // false, with nothing loaded, if the file is missing or for another topology
+    bool Load(NodeContainer nodes, std::string file);
+
+    // interfaces of node toward dst, empty if none
+    std::vector<uint32_t> GetNextHops(uint32_t nodeId, uint32_t dstId) const;
+
+    static Ipv4Address GetNodeAddress(uint32_t nodeId);
+
+  private:
+    struct Link
+    {
+        uint32_t intf; // ifIndex on this side
+        uint32_t peer; // index of the node on the other side
+    };
+
+    void BuildGraph(NodeContainer nodes);
+    uint64_t GetGraphHash(void) const;
+    void ComputeDestination(uint32_t d, std::vector<uint32_t>& dist, std::vector<uint32_t>& queue);
+    // whether the records of routes fit in it, and name nodes and links of the graph
+    bool CheckRoutes(const std::vector<uint32_t>& routes) const;
+
+    uint32_t m_threads;
+    NodeContainer m_nodes;
+    std::vector<uint32_t> m_indexOf;      // index in m_nodes of each node id
+    std::vector<uint32_t> m_type;         // node type of each node
+    std::vector<std::vector<Link>> m_adj; // links up of each node
+    std::vector<uint32_t> m_dsts;         // the destinations, hosts and NVSwitches
+    // for each destination: records of [node, n, n interfaces] of the nodes with a route
+    std::vector<std::vector<uint32_t>> m_routes;
+};
+
+} /* namespace ns3 */
+
+#endif /* RDMA_ROUTE_HELPER_H */
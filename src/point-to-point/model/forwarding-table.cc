@@ -0,0 +1,153 @@
+#include "forwarding-table.h"
+
+#include "ns3/assert.h"
+
+namespace ns3
+{
+
+const uint32_t ForwardingTable::NONE; // bound to const references by resize()
+
+ForwardingTable::ForwardingTable()
+    : m_nEntries(0)
+{
+}
+
+void
+ForwardingTable::AddEntry(uint32_t dip, int intf)
+{
+    uint32_t* slot = GetGroupSlot(dip);
+    std::vector<int> nexthops;
+    if (slot)
+    {
+        nexthops = m_groups[*slot];
+        Release(*slot);
+    }
+    else
+    {
+        uint32_t idx = (dip >> 8) & 0xffff;
+        if (idx >= m_dip.size())
+        {
+            m_dip.resize(idx + 1, NONE);
+            m_groupOf.resize(idx + 1, NONE);
+        }
+        if (m_dip[idx] == NONE)
+        {
+            m_dip[idx] = dip;
+            slot = &m_groupOf[idx];
+        }
+        else
+        {
+            slot = &m_other[dip];
+        }
+        m_nEntries++;
+    }
+    nexthops.push_back(intf);
+    *slot = Intern(nexthops);
+}
+
+void
+ForwardingTable::Clear(void)
+{
+    m_dip.clear();
+    m_groupOf.clear();
+    m_other.clear();
+    m_nEntries = 0;
+    m_groups.clear();
+    m_refs.clear();
+    m_free.clear();
+    m_groupId.clear();
+}
+
+const std::vector<int>*
+ForwardingTable::LookupOther(uint32_t dip) const
+{
+    if (m_other.empty())
+    {
+        return nullptr;
+    }
+    auto it = m_other.find(dip);
+    return it == m_other.end() ? nullptr : &m_groups[it->second];
+}
+
+uint32_t*
+ForwardingTable::GetGroupSlot(uint32_t dip)
+{
+    uint32_t idx = (dip >> 8) & 0xffff;
+    if (idx < m_dip.size() && m_dip[idx] == dip)
+    {
+        return &m_groupOf[idx];
+    }
+    auto it = m_other.find(dip);
+    return it == m_other.end() ? nullptr : &it->second;
+}
+
+uint32_t
+ForwardingTable::Intern(const std::vector<int>& nexthops)
+{
+    auto it = m_groupId.find(nexthops);
+    if (it != m_groupId.end())
+    {
+        m_refs[it->second]++;
+        return it->second;
+    }
+    uint32_t group;
+    if (!m_free.empty())
+    {
+        group = m_free.back();
+        m_free.pop_back();
+        m_groups[group] = nexthops;
+        m_refs[group] = 1;
+    }
+    else
+    {
+        group = m_groups.size();
+        m_groups.push_back(nexthops);
+        m_refs.push_back(1);
+    }
+    m_groupId.emplace(nexthops, group);
+    return group;
+}
+
+void
+ForwardingTable::Release(uint32_t group)
+{
+    NS_ASSERT(m_refs[group] > 0);
+    if (--m_refs[group] == 0)
+    {
+        m_groupId.erase(m_groups[group]);
+        m_groups[group].clear();
+        m_groups[group].shrink_to_fit();
+        m_free.push_back(group);
+    }
+}
+
+uint32_t
+ForwardingTable::GetNEntries(void) const
+{
+    return m_nEntries;
+}
+
+uint32_t
+ForwardingTable::GetNGroups(void) const
+{
+    return m_groupId.size();
+}
+
+uint64_t
+ForwardingTable::GetMemoryFootprint(void) const
+{
+    uint64_t bytes = sizeof(*this);
+    bytes += m_dip.capacity() * sizeof(uint32_t) + m_groupOf.capacity() * sizeof(uint32_t);
+    bytes += m_other.bucket_count() * sizeof(void*) +
+             m_other.size() * (sizeof(void*) + sizeof(std::pair<const uint32_t, uint32_t>));
+    bytes += m_groups.capacity() * sizeof(std::vector<int>) + m_refs.capacity() * sizeof(uint32_t) +
+             m_free.capacity() * sizeof(uint32_t);
+    for (auto& it : m_groupId)
+    {
+        // the list is stored twice, in m_groups and as the key of its rb-tree node
+        bytes += 2 * it.first.capacity() * sizeof(int) + 4 * sizeof(void*) + sizeof(it);
+    }
+    return bytes;
+}
+
+} /* namespace ns3 */
@@ -0,0 +1,67 @@
+#ifndef FORWARDING_TABLE_H
+#define FORWARDING_TABLE_H
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Next hops of each destination ip, for switches and NICs.
+ *
+ * The destinations are indexed by node id, (dip >> 8) & 0xffff as everywhere
+ * else, in a dense array of next-hop group ids. A group is the list of ECMP
+ * ports of a destination, and destinations with the same list share one
+ * group. A lookup is then one indexed load, and a fat-tree switch keeps a
+ * handful of groups instead of one vector per destination. An ip which does
+ * not follow the node id scheme falls back to a map.
+ */
+class ForwardingTable
+{
+  public:
+    ForwardingTable();
+
+    void AddEntry(uint32_t dip, int intf); // append intf to the next hops of dip
+    void Clear(void);
+
+    // the next hops of dip, nullptr if none
+    const std::vector<int>*
+    Lookup(uint32_t dip) const
+    {
+        uint32_t idx = (dip >> 8) & 0xffff;
+        if (idx < m_dip.size() && m_dip[idx] == dip)
+        {
+            return &m_groups[m_groupOf[idx]];
+        }
+        return LookupOther(dip);
+    }
+
+    uint32_t GetNEntries(void) const;        // number of destinations
+    uint32_t GetNGroups(void) const;         // number of distinct next-hop groups
+    uint64_t GetMemoryFootprint(void) const; // approximate heap + object bytes
+
+  private:
+    static const uint32_t NONE = 0xffffffff;
+
+    const std::vector<int>* LookupOther(uint32_t dip) const;
+    uint32_t* GetGroupSlot(uint32_t dip); // nullptr if dip has no group yet
+    uint32_t Intern(const std::vector<int>& nexthops);
+    void Release(uint32_t group);
+
+    std::vector<uint32_t> m_dip;     // dip of each node id, NONE if unused
+    std::vector<uint32_t> m_groupOf; // group of each node id
+    std::unordered_map<uint32_t, uint32_t> m_other; // dip -> group, for other ips
+    uint32_t m_nEntries;
+
+    std::vector<std::vector<int>> m_groups;         // next hops of each group
+    std::vector<uint32_t> m_refs;                   // destinations using each group
+    std::vector<uint32_t> m_free;                   // unused group ids
+    std::map<std::vector<int>, uint32_t> m_groupId; // next hops -> group
+};
+
+} /* namespace ns3 */
+
+#endif /* FORWARDING_TABLE_H */
@@ -0,0 +1,267 @@
+#include "monitor-writer.h"
+
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace ns3
+{
+
+namespace
+{
+
+struct FileBuffer
+{
+    FILE* file;
+    std::vector<char> data;
+};
+
+// the buffers of one thread, known to Flush() through g_threads
+struct ThreadBuffers
+{
+    ThreadBuffers();
+    ~ThreadBuffers();
+    std::vector<char>& Get(FILE* file);
+
+    std::vector<FileBuffer> files;
+};
+
+std::atomic<int> g_format{MonitorWriter::TEXT};
+std::atomic<uint32_t> g_bufferSize{64 * 1024};
+std::atomic<bool> g_flushScheduled{false};
+std::mutex g_threadsMutex;
+std::vector<ThreadBuffers*> g_threads;
+
+ThreadBuffers::ThreadBuffers()
+{
+    std::lock_guard<std::mutex> lock(g_threadsMutex);
+    g_threads.push_back(this);
+}
+
+ThreadBuffers::~ThreadBuffers()
+{
+    // the files may be closed by now, so what was not flushed is dropped
+    std::lock_guard<std::mutex> lock(g_threadsMutex);
+    g_threads.erase(std::find(g_threads.begin(), g_threads.end(), this));
+}
+
+std::vector<char>&
+ThreadBuffers::Get(FILE* file)
+{
+    // a few monitor files at most, a linear search is enough
+    for (auto& f : files)
+    {
+        if (f.file == file)
+        {
+            return f.data;
+        }
+    }
+    files.push_back(FileBuffer{file, {}});
+    files.back().data.reserve(g_bufferSize.load(std::memory_order_relaxed));
+    return files.back().data;
+}
+
+thread_local ThreadBuffers t_buffers;
+
+template <typename T>
+void
+Put(std::vector<char>& data, T value)
+{
+    for (uint32_t i = 0; i < sizeof(T); i++)
+    {
+        data.push_back(static_cast<char>(value & 0xff));
+        value >>= 8;
+    }
+}
+
+void
+PutDouble(std::vector<char>& data, double value)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    Put(data, bits);
+}
+
+// the record has been appended to data
+void
+Commit(FILE* file, std::vector<char>& data)
+{
+    uint32_t bufferSize = g_bufferSize.load(std::memory_order_relaxed);
+    if (data.size() >= bufferSize)
+    {
+        fwrite(data.data(), 1, data.size(), file);
+        data.clear();
+        if (bufferSize == 0)
+        {
+            fflush(file);
+        }
+    }
+    else if (!g_flushScheduled.exchange(true))
+    {
+        Simulator::ScheduleDestroy(&MonitorWriter::Flush);
+    }
+}
+
+// the lines are far shorter than the buffer, snprintf() cannot truncate them
+void
+Append(std::vector<char>& data, const char* line, int n)
+{
+    data.insert(data.end(), line, line + n);
+}
+
+} // namespace
+
+void
+MonitorWriter::SetFormat(Format format)
+{
+    g_format = format;
+}
+
+MonitorWriter::Format
+MonitorWriter::GetFormat(void)
+{
+    return static_cast<Format>(g_format.load());
+}
+
+void
+MonitorWriter::SetBufferSize(uint32_t bytes)
+{
+    g_bufferSize = bytes;
+}
+
+uint32_t
+MonitorWriter::GetBufferSize(void)
+{
+    return g_bufferSize;
+}
+
+void
+MonitorWriter::WriteQlen(FILE* file,
+                         uint64_t time,
+                         uint32_t sw,
+                         uint32_t port,
+                         uint32_t queue,
+                         uint64_t qlen,
+                         uint64_t portLen)
+{
+    std::vector<char>& data = t_buffers.Get(file);
+    if (GetFormat() == BINARY)
+    {
+        Put<uint8_t>(data, QLEN);
+        Put(data, time);
+        Put(data, sw);
+        Put(data, port);
+        Put(data, queue);
+        Put(data, qlen);
+        Put(data, portLen);
+    }
+    else
+    {
+        char line[128];
+        int n = snprintf(line,
+                         sizeof(line),
+                         "%lu, %u, %u, %u, %lu, %lu\n",
+                         time,
+                         sw,
+                         port,
+                         queue,
+                         qlen,
+                         portLen);
+        Append(data, line, n);
+    }
+    Commit(file, data);
+}
+
+void
+MonitorWriter::WriteBw(FILE* file,
+                       RecordType type,
+                       uint64_t time,
+                       uint32_t node,
+                       uint32_t port,
+                       double bw)
+{
+    std::vector<char>& data = t_buffers.Get(file);
+    if (GetFormat() == BINARY)
+    {
+        Put<uint8_t>(data, type);
+        Put(data, time);
+        Put(data, node);
+        Put(data, port);
+        PutDouble(data, bw);
+    }
+    else
+    {
+        char line[128];
+        int n = snprintf(line, sizeof(line), "%lu, %u, %u, %f\n", time, node, port, bw);
+        Append(data, line, n);
+    }
+    Commit(file, data);
+}
+
+void
+MonitorWriter::WriteQp(FILE* file,
+                       RecordType type,
+                       uint64_t time,
+                       uint32_t src,
+                       uint32_t dst,
+                       uint16_t sport,
+                       uint16_t dport,
+                       uint64_t size,
+                       uint64_t value)
+{
+    std::vector<char>& data = t_buffers.Get(file);
+    if (GetFormat() == BINARY)
+    {
+        Put<uint8_t>(data, type);
+        Put(data, time);
+        Put(data, src);
+        Put(data, dst);
+        Put(data, sport);
+        Put(data, dport);
+        Put(data, size);
+        Put(data, value);
+    }
+    else
+    {
+        char line[128];
+        int n = snprintf(line,
+                         sizeof(line),
+                         "%lu, %u, %u, %u, %u, %lu, %lu\n",
+                         time,
+                         src,
+                         dst,
+                         sport,
+                         dport,
+                         size,
+                         value);
+        Append(data, line, n);
+    }
+    Commit(file, data);
+}
+
+void
+MonitorWriter::Flush(void)
+{
+    std::lock_guard<std::mutex> lock(g_threadsMutex);
+    for (auto buffers : g_threads)
+    {
+        for (auto& f : buffers->files)
+        {
+            if (!f.data.empty())
+            {
+                fwrite(f.data.data(), 1, f.data.size(), f.file);
+                f.data.clear();
+            }
+            fflush(f.file);
+        }
+        // the files may be closed after this, do not keep them around
+        buffers->files.clear();
+    }
+    g_flushScheduled = false;
+}
+
+} // namespace ns3
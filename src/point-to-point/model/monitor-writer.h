@@ -0,0 +1,80 @@
+#ifndef MONITOR_WRITER_H
+#define MONITOR_WRITER_H
+
+#include <cstdint>
+#include <cstdio>
+
+namespace ns3
+{
+
+/**
+ * Buffered output of the switch and host monitors.
+ *
+ * Every thread keeps one buffer per output file and hands it to fwrite() once
+ * it holds BufferSize bytes, instead of the fprintf() + fflush() per line the
+ * monitors used to do. The records are written either as the text lines the
+ * monitors always printed or, in BINARY mode, as packed little-endian records
+ * which utils/monitor-to-csv.py turns back into the same text:
+ *
+ *   u8 type, u64 time, then
+ *   QLEN:               u32 sw_id, u32 port_id, u32 q_id, u64 qlen, u64 port_len
+ *   SWITCH_BW, HOST_BW: u32 node_id, u32 port_id, f64 bandwidth
+ *   QP_RATE, QP_CNP:    u32 src, u32 dst, u16 sport, u16 dport, u64 size, u64 value
+ *
+ * Flush() must run before the files are closed. It is also scheduled to run
+ * at Simulator::Destroy() once something is buffered.
+ */
+class MonitorWriter
+{
+  public:
+    enum Format
+    {
+        TEXT = 0,
+        BINARY = 1
+    };
+
+    enum RecordType : uint8_t
+    {
+        QLEN = 1,
+        SWITCH_BW = 2,
+        HOST_BW = 3,
+        QP_RATE = 4,
+        QP_CNP = 5
+    };
+
+    static void SetFormat(Format format);
+    static Format GetFormat(void);
+    // 0 writes and flushes every record, as the monitors used to do
+    static void SetBufferSize(uint32_t bytes);
+    static uint32_t GetBufferSize(void);
+
+    static void WriteQlen(FILE* file,
+                          uint64_t time,
+                          uint32_t sw,
+                          uint32_t port,
+                          uint32_t queue,
+                          uint64_t qlen,
+                          uint64_t portLen);
+    static void WriteBw(FILE* file,
+                        RecordType type,
+                        uint64_t time,
+                        uint32_t node,
+                        uint32_t port,
+                        double bw);
+    static void WriteQp(FILE* file,
+                        RecordType type,
+                        uint64_t time,
+                        uint32_t src,
+                        uint32_t dst,
+                        uint16_t sport,
+                        uint16_t dport,
+                        uint64_t size,
+                        uint64_t value);
+
+    // write out the buffers of all threads; no other thread may be writing
+    static void Flush(void);
+};
+
+} /* namespace ns3 */
+
+#endif /* MONITOR_WRITER_H */
@@ -1,11 +1,12 @@
 #include "nvswitch-node.h"
 
+#include "monitor-writer.h"
 #include "ppp-header.h"
 #include "qbb-net-device.h"
+#include "switch-footprint.h"
 
 #include "ns3/boolean.h"
 #include "ns3/double.h"
-#include "ns3/flow-id-tag.h"
 #include "ns3/int-header.h"
 #include "ns3/ipv4-header.h"
 #include "ns3/ipv4.h"
@@ -38,15 +39,11 @@ NVSwitchNode::NVSwitchNode()
     m_ecmpSeed = GetId();
     m_node_type = 2;
     m_mmu = CreateObject<SwitchMmu>();
-    for (uint32_t i = 0; i < pCnt; i++)
-        for (uint32_t j = 0; j < pCnt; j++)
-            for (uint32_t k = 0; k < qCnt; k++)
-                m_bytes[i][j][k] = 0;
+    RegisterDeviceAdditionListener(MakeCallback(&SwitchMmu::AddPort, m_mmu));
     for (uint32_t i = 0; i < pCnt; i++)
     {
         m_txBytes[i] = 0;
         last_txBytes[i] = 0;
-        last_port_qlen[i] = 0;
     }
     for (uint32_t i = 0; i < pCnt; i++)
         m_lastPktSize[i] = m_lastPktTs[i] = 0;
@@ -58,14 +55,14 @@ int
 NVSwitchNode::GetOutDev(Ptr<const Packet> p, CustomHeader& ch)
 {
     // look up entries
-    auto entry = m_rtTable.find(ch.dip);
+    const std::vector<int>* entry = m_rtTable.Lookup(ch.dip);
 
     // no matching entry
-    if (entry == m_rtTable.end())
+    if (entry == nullptr)
         return -1;
 
     // entry found
-    auto& nexthops = entry->second;
+    auto& nexthops = *entry;
 
     // pick one next hop based on hash
     union {
@@ -108,9 +105,7 @@ NVSwitchNode::SendToDev(Ptr<Packet> p, CustomHeader& ch)
         }
 
         // admission control
-        FlowIdTag t;
-        p->PeekPacketTag(t);
-        uint32_t inDev = t.GetFlowId();
+        uint32_t inDev = p->GetIngressPort();
         if (qIndex != 0)
         { // not highest priority
             if (m_mmu->CheckIngressAdmission(inDev, qIndex, p->GetSize()) &&
@@ -118,13 +113,13 @@ NVSwitchNode::SendToDev(Ptr<Packet> p, CustomHeader& ch)
             { // Admission control
                 m_mmu->UpdateIngressAdmission(inDev, qIndex, p->GetSize());
                 m_mmu->UpdateEgressAdmission(idx, qIndex, p->GetSize());
+                m_bytes.Add(inDev, idx, qIndex, p->GetSize());
             }
             else
             {
                 return; // Drop
             }
         }
-        m_bytes[inDev][idx][qIndex] += p->GetSize();
         Ptr<QbbNetDevice> device = DynamicCast<QbbNetDevice>(GetDevice(idx));
         device->SwitchSend(qIndex, p, ch);
     }
@@ -188,13 +183,13 @@ void
 NVSwitchNode::AddTableEntry(Ipv4Address& dstAddr, uint32_t intf_idx)
 {
     uint32_t dip = dstAddr.Get();
-    m_rtTable[dip].push_back(intf_idx);
+    m_rtTable.AddEntry(dip, intf_idx);
 }
 
 void
 NVSwitchNode::ClearTable()
 {
-    m_rtTable.clear();
+    m_rtTable.Clear();
 }
 
 // This function can only be called in switch mode
@@ -208,14 +203,12 @@ NVSwitchNode::SwitchReceiveFromDevice(Ptr<NetDevice> device, Ptr<Packet> packet,
 void
 NVSwitchNode::SwitchNotifyDequeue(uint32_t ifIndex, uint32_t qIndex, Ptr<Packet> p)
 {
-    FlowIdTag t;
-    p->PeekPacketTag(t);
     if (qIndex != 0)
     {
-        uint32_t inDev = t.GetFlowId();
+        uint32_t inDev = p->GetIngressPort();
         m_mmu->RemoveFromIngressAdmission(inDev, qIndex, p->GetSize());
         m_mmu->RemoveFromEgressAdmission(ifIndex, qIndex, p->GetSize());
-        m_bytes[inDev][ifIndex][qIndex] -= p->GetSize();
+        m_bytes.Remove(inDev, ifIndex, qIndex, p->GetSize());
     }
     m_txBytes[ifIndex] += p->GetSize();
     m_lastPktSize[ifIndex] = p->GetSize();
@@ -224,42 +217,46 @@ NVSwitchNode::SwitchNotifyDequeue(uint32_t ifIndex, uint32_t qIndex, Ptr<Packet>
 
 // for monitor
 /**
- * outoput format:
+ * output format:
  * time, sw_id, port_id, q_id, qlen, port_len
  */
 void
 NVSwitchNode::PrintSwitchQlen(FILE* qlen_output)
 {
     uint32_t n_dev = this->GetNDevices();
+    if (last_qlen.size() < n_dev * qCnt)
+    {
+        last_qlen.resize(n_dev * qCnt, 0);
+    }
     for (uint32_t i = 1; i < n_dev; ++i)
     {
         uint64_t port_len = 0;
         for (uint32_t j = 0; j < qCnt; ++j)
         {
-            port_len += m_mmu->egress_bytes[i][j];
-        }
-        if (port_len == last_port_qlen[i])
-        {
-            continue;
+            port_len += m_mmu->GetEgressBytes(i, j);
         }
+        // only the queues that changed since the last sampling
         for (uint32_t j = 0; j < qCnt; ++j)
         {
-            fprintf(qlen_output,
-                    "%lu, %u, %u, %u, %lu, %lu\n",
-                    Simulator::Now().GetTimeStep(),
-                    GetId(),
-                    i,
-                    j,
-                    m_mmu->egress_bytes[i][j],
-                    port_len);
-            fflush(qlen_output);
+            uint64_t& last = last_qlen[i * qCnt + j];
+            if (m_mmu->GetEgressBytes(i, j) == last)
+            {
+                continue;
+            }
+            last = m_mmu->GetEgressBytes(i, j);
+            MonitorWriter::WriteQlen(qlen_output,
+                                     Simulator::Now().GetTimeStep(),
+                                     GetId(),
+                                     i,
+                                     j,
+                                     last,
+                                     port_len);
         }
-        last_port_qlen[i] = port_len;
     }
 }
 
 /**
- * outoput format:
+ * output format:
  * time, sw_id, port_id, txBytes
  */
 void
@@ -274,9 +271,31 @@ NVSwitchNode::PrintSwitchBw(FILE* bw_output, uint32_t bw_mon_interval)
         }
         double bw = (m_txBytes[i] - last_txBytes[i]) * 8 * 1e6 / bw_mon_interval; // bit/s
         bw = bw * 1.0 / 1e9;                                                      // Gbps
-        fprintf(bw_output, "%lu, %u, %u, %f\n", Simulator::Now().GetTimeStep(), GetId(), i, bw);
-        fflush(bw_output);
+        MonitorWriter::WriteBw(bw_output,
+                               MonitorWriter::SWITCH_BW,
+                               Simulator::Now().GetTimeStep(),
+                               GetId(),
+                               i,
+                               bw);
         last_txBytes[i] = m_txBytes[i];
     }
 }
+
+uint64_t
+NVSwitchNode::GetMemoryFootprint(void)
+{
+    return GetSwitchFootprint(sizeof(*this), m_mmu, m_rtTable, m_bytes);
+}
+
+void
+NVSwitchNode::PrintMemoryFootprint(FILE* mem_output)
+{
+    PrintSwitchFootprint(mem_output,
+                         GetId(),
+                         GetNodeType(),
+                         GetMemoryFootprint(),
+                         m_rtTable,
+                         m_bytes);
+}
+
 } /* namespace ns3 */
@@ -72,7 +72,7 @@ PppHeader::GetSerializedSize() const
 uint32_t
 PppHeader::GetStaticSize()
 {
-    return 14;
+    return 2;
 }
 
 void
@@ -28,7 +28,6 @@
 #include "ns3/data-rate.h"
 #include "ns3/double.h"
 #include "ns3/error-model.h"
-#include "ns3/flow-id-tag.h"
 #include "ns3/ipv4-header.h"
 #include "ns3/ipv4.h"
 #include "ns3/log.h"
@@ -39,7 +38,6 @@
 #include "ns3/ppp-header.h"
 #include "ns3/qbb-channel.h"
 #include "ns3/qbb-header.h"
-#include "ns3/random-variable.h"
 #include "ns3/red-queue.h"
 #include "ns3/seq-ts-header.h"
 #include "ns3/simple-drop-tail-queue.h"
@@ -83,6 +81,9 @@ RdmaEgressQueue::RdmaEgressQueue()
     // m_ackQ = CreateObject<RedQueue>();
     m_ackQ->SetAttribute("MaxBytes",
                          UintegerValue(0xffffffff)); // queue limit is on a higher level, not here
+    m_syncedGen = 0;
+    m_pendingIdx = -1;
+    m_nFinished = 0;
 }
 
 Ptr<Packet>
@@ -100,6 +101,8 @@ RdmaEgressQueue::DequeueQindex(int qIndex)
         Ptr<Packet> p = m_rdmaGetNxtPkt(m_qpGrp->Get(qIndex));
         m_rrlast = qIndex;
         m_qlast = qIndex;
+        // the caller updates m_nextAvail after this, classify the qp lazily
+        m_pendingIdx = qIndex;
         m_traceRdmaDequeue(p, m_qpGrp->Get(qIndex)->m_pg);
         return p;
     }
@@ -109,58 +112,328 @@ RdmaEgressQueue::DequeueQindex(int qIndex)
 int
 RdmaEgressQueue::GetNextQindex(bool paused[])
 {
-    // bool found = false;
-    uint32_t qIndex;
     if (!paused[ack_q_idx] && m_ackQ->GetNPackets() > 0)
         return -1;
+    if (m_qpGrp == nullptr)
+        return -1024;
 
     // no pkt in highest priority queue, do rr for each qp
-    int res = -1024;
-    uint32_t fcount = m_qpGrp->GetN();
-    uint32_t min_finish_id = 0xffffffff;
-    for (qIndex = 1; qIndex <= fcount; qIndex++)
+    SyncGroup();
+    ClassifyPending();
+    ReleaseRateBlocked();
+    if (m_nFinished > 0 && m_nFinished * 2 >= m_slots.size())
+        Compact();
+
+    uint32_t fcount = m_slots.size();
+    if (fcount == 0)
+        return -1024;
+    uint32_t rr = m_rrlast % fcount;
+    int64_t now = Simulator::Now().GetTimeStep();
+    while (true)
     {
-        // iterate start behind the m_rrlast qp
-        uint32_t idx = (qIndex + m_rrlast) % fcount;
-        Ptr<RdmaQueuePair> qp = m_qpGrp->Get(idx);
-        if (qp->GetBytesLeft() <= 0)
-        {
-            // int sender_node = qp->GetSrc();
-            // int receiver_node = qp->GetDest();
-            // int tag = qp->GetTag();
-            // int t_count = qp->GetInitialSize();
-            // qp transmission finished
-        }
-        if (!paused[qp->m_pg] && qp->GetBytesLeft() > 0 && !qp->IsWinBound())
+        // the first ready qp behind the m_rrlast qp, among the pgs not paused
+        uint32_t best = 0;
+        uint32_t bestDist = 0xffffffff;
+        for (uint32_t pg = 0; pg < qCnt; pg++)
         {
-            if (m_qpGrp->Get(idx)->m_nextAvail.GetTimeStep() >
-                Simulator::Now().GetTimeStep()) // not available now
+            if (paused[pg] || m_ready[pg].empty())
                 continue;
-            res = idx;
-            break;
+            auto it = m_ready[pg].upper_bound(rr);
+            uint32_t idx = it != m_ready[pg].end() ? *it : *m_ready[pg].begin();
+            uint32_t dist = idx > rr ? idx - rr : idx + fcount - rr;
+            if (dist < bestDist)
+            {
+                best = idx;
+                bestDist = dist;
+            }
         }
-        else if (qp->IsFinished())
+        if (bestDist == 0xffffffff)
+            return -1024;
+
+        // state may have changed without notice (e.g., the window shrank)
+        Ptr<RdmaQueuePair> qp = m_qpGrp->Get(best);
+        if (qp->GetBytesLeft() > 0 && !qp->IsWinBound() && qp->m_nextAvail.GetTimeStep() <= now)
+            return best;
+        Classify(best);
+    }
+}
+
+void
+RdmaEgressQueue::UpdateQp(Ptr<RdmaQueuePair> qp)
+{
+    if (!m_rdmaQpUpdated.IsNull())
+        m_rdmaQpUpdated(qp);
+    if (m_qpGrp == nullptr)
+        return;
+    SyncGroup();
+    ClassifyPending();
+    uint32_t idx = qp->m_eqIdx;
+    if (idx < m_slots.size() && m_qpGrp->m_qps[idx] == qp)
+        Classify(idx);
+}
+
+Time
+RdmaEgressQueue::GetNextAvail(void)
+{
+    if (m_qpGrp != nullptr)
+    {
+        SyncGroup();
+        ClassifyPending();
+        ReleaseRateBlocked();
+    }
+    if (m_rateBlocked.empty())
+        return Simulator::GetMaximumSimulationTime();
+    return TimeStep(m_slots[m_rateBlocked[0]].avail);
+}
+
+bool
+RdmaEgressQueue::IsAlone(uint32_t i)
+{
+    if (m_ackQ->GetNPackets() > 0)
+        return false;
+    for (uint32_t pg = 0; pg < qCnt; pg++)
+    {
+        if (m_ready[pg].size() > m_ready[pg].count(i))
+            return false;
+    }
+    return true;
+}
+
+bool
+RdmaEgressQueue::IsOnly(uint32_t i)
+{
+    if (m_qpGrp != nullptr)
+    {
+        SyncGroup();
+        ClassifyPending();
+    }
+    if (!IsAlone(i))
+        return false;
+    return m_rateBlocked.empty() || (m_rateBlocked.size() == 1 && m_rateBlocked[0] == i);
+}
+
+uint32_t
+RdmaEgressQueue::GetNActive(void) const
+{
+    uint32_t n = m_ackQ->GetNPackets() + m_rateBlocked.size();
+    for (uint32_t pg = 0; pg < qCnt; pg++)
+        n += m_ready[pg].size();
+    return n;
+}
+
+void
+RdmaEgressQueue::SyncGroup(void)
+{
+    if (m_qpGrp != m_syncedGrp || m_qpGrp->m_generation != m_syncedGen ||
+        m_qpGrp->GetN() < m_slots.size())
+    { // the group was replaced or cleared, start over
+        for (uint32_t pg = 0; pg < qCnt; pg++)
+            m_ready[pg].clear();
+        m_rateBlocked.clear();
+        m_slots.clear();
+        m_pendingIdx = -1;
+        m_nFinished = 0;
+        m_syncedGrp = m_qpGrp;
+        m_syncedGen = m_qpGrp->m_generation;
+    }
+    // qps are only appended to the group
+    for (uint32_t idx = m_slots.size(); idx < m_qpGrp->GetN(); idx++)
+    {
+        m_slots.push_back(QpSlot{QP_NEW, 0, 0, 0});
+        m_qpGrp->m_qps[idx]->m_eqIdx = idx;
+        Classify(idx);
+    }
+}
+
+void
+RdmaEgressQueue::ClassifyPending(void)
+{
+    if (m_pendingIdx >= 0 && (uint32_t)m_pendingIdx < m_slots.size())
+        Classify(m_pendingIdx);
+    m_pendingIdx = -1;
+}
+
+void
+RdmaEgressQueue::Classify(uint32_t idx)
+{
+    QpSlot& s = m_slots[idx];
+    Ptr<RdmaQueuePair> qp = m_qpGrp->m_qps[idx];
+    QpState state;
+    if (qp->IsFinished())
+        state = QP_FINISHED;
+    else if (qp->GetBytesLeft() == 0 || qp->IsWinBound())
+        state = QP_BLOCKED;
+    else if (qp->m_nextAvail > Simulator::Now())
+        state = QP_RATE_BLOCKED;
+    else
+        state = QP_READY;
+
+    if (s.state == QP_RATE_BLOCKED && state == QP_RATE_BLOCKED)
+    { // only the release time moved
+        s.avail = qp->m_nextAvail.GetTimeStep();
+        HeapUpdate(idx);
+        return;
+    }
+    // leave the old bucket
+    if (s.state == QP_READY)
+        m_ready[s.pg].erase(idx);
+    else if (s.state == QP_RATE_BLOCKED)
+        HeapRemove(idx);
+    else if (s.state == QP_FINISHED)
+        m_nFinished--;
+    // join the new one
+    s.state = state;
+    if (state == QP_READY)
+    {
+        NS_ASSERT_MSG(qp->m_pg < qCnt, "RdmaEgressQueue: pg out of range");
+        s.pg = qp->m_pg;
+        m_ready[s.pg].insert(idx);
+    }
+    else if (state == QP_RATE_BLOCKED)
+    {
+        s.avail = qp->m_nextAvail.GetTimeStep();
+        HeapPush(idx);
+    }
+    else if (state == QP_FINISHED)
+    {
+        m_nFinished++;
+    }
+}
+
+void
+RdmaEgressQueue::ReleaseRateBlocked(void)
+{
+    int64_t now = Simulator::Now().GetTimeStep();
+    while (!m_rateBlocked.empty() && m_slots[m_rateBlocked[0]].avail <= now)
+    {
+        Classify(m_rateBlocked[0]);
+    }
+}
+
+void
+RdmaEgressQueue::Compact(void)
+{
+    // clear the finished qps, keeping the order of the others
+    auto& qps = m_qpGrp->m_qps;
+    uint32_t fcount = m_slots.size();
+    uint32_t rr = fcount > 0 ? m_rrlast % fcount : 0;
+    uint32_t nxt = 0;
+    int newRr = -1;
+    int newPending = -1;
+    std::vector<Ptr<RdmaQueuePair>> dropped;
+    for (uint32_t i = 0; i < fcount; i++)
+    {
+        if (m_slots[i].state == QP_FINISHED)
         {
-            min_finish_id = idx < min_finish_id ? idx : min_finish_id;
+            dropped.push_back(qps[i]);
+            continue;
         }
+        if (i <= rr)
+            newRr = nxt;
+        if ((int)i == m_pendingIdx)
+            newPending = nxt;
+        qps[nxt] = qps[i];
+        qps[nxt]->m_eqIdx = nxt;
+        m_slots[nxt] = m_slots[i];
+        nxt++;
     }
+    qps.resize(nxt);
+    m_slots.resize(nxt);
+    m_nFinished = 0;
+    m_pendingIdx = newPending;
+    // continue the round-robin after the last surviving qp before m_rrlast
+    m_rrlast = newRr >= 0 ? newRr : (nxt > 0 ? nxt - 1 : 0);
 
-    // clear the finished qp
-    if (min_finish_id < 0xffffffff)
+    // indexes changed, rebuild the buckets
+    for (uint32_t pg = 0; pg < qCnt; pg++)
+        m_ready[pg].clear();
+    m_rateBlocked.clear();
+    for (uint32_t i = 0; i < nxt; i++)
     {
-        int nxt = min_finish_id;
-        auto& qps = m_qpGrp->m_qps;
-        for (uint32_t i = min_finish_id + 1; i < fcount; i++)
-            if (!qps[i]->IsFinished())
-            {
-                if (i == (uint32_t)res) // update res to the idx after removing finished qp
-                    res = nxt;
-                qps[nxt] = qps[i];
-                nxt++;
-            }
-        qps.resize(nxt);
+        if (m_slots[i].state == QP_READY)
+            m_ready[m_slots[i].pg].insert(i);
+        else if (m_slots[i].state == QP_RATE_BLOCKED)
+            HeapPush(i);
     }
-    return res;
+
+    if (m_rdmaQpDropped.IsNull())
+        return;
+    for (Ptr<RdmaQueuePair>& qp : dropped)
+    {
+        m_rdmaQpDropped(qp);
+    }
+}
+
+void
+RdmaEgressQueue::HeapSet(uint32_t pos, uint32_t idx)
+{
+    m_rateBlocked[pos] = idx;
+    m_slots[idx].heapPos = pos;
+}
+
+void
+RdmaEgressQueue::HeapSiftUp(uint32_t pos)
+{
+    uint32_t idx = m_rateBlocked[pos];
+    while (pos > 0)
+    {
+        uint32_t parent = (pos - 1) / 2;
+        if (m_slots[m_rateBlocked[parent]].avail <= m_slots[idx].avail)
+            break;
+        HeapSet(pos, m_rateBlocked[parent]);
+        pos = parent;
+    }
+    HeapSet(pos, idx);
+}
+
+void
+RdmaEgressQueue::HeapSiftDown(uint32_t pos)
+{
+    uint32_t n = m_rateBlocked.size();
+    uint32_t idx = m_rateBlocked[pos];
+    while (true)
+    {
+        uint32_t child = 2 * pos + 1;
+        if (child >= n)
+            break;
+        if (child + 1 < n &&
+            m_slots[m_rateBlocked[child + 1]].avail < m_slots[m_rateBlocked[child]].avail)
+            child++;
+        if (m_slots[idx].avail <= m_slots[m_rateBlocked[child]].avail)
+            break;
+        HeapSet(pos, m_rateBlocked[child]);
+        pos = child;
+    }
+    HeapSet(pos, idx);
+}
+
+void
+RdmaEgressQueue::HeapPush(uint32_t idx)
+{
+    m_rateBlocked.push_back(idx);
+    HeapSiftUp(m_rateBlocked.size() - 1);
+}
+
+void
+RdmaEgressQueue::HeapRemove(uint32_t idx)
+{
+    uint32_t pos = m_slots[idx].heapPos;
+    uint32_t last = m_rateBlocked.back();
+    m_rateBlocked.pop_back();
+    if (last == idx)
+        return;
+    HeapSet(pos, last);
+    HeapUpdate(last);
+}
+
+void
+RdmaEgressQueue::HeapUpdate(uint32_t idx)
+{
+    uint32_t pos = m_slots[idx].heapPos;
+    if (pos > 0 && m_slots[m_rateBlocked[(pos - 1) / 2]].avail > m_slots[idx].avail)
+        HeapSiftUp(pos);
+    else
+        HeapSiftDown(pos);
 }
 
 int
@@ -194,6 +467,7 @@ RdmaEgressQueue::RecoverQueue(uint32_t i)
 {
     NS_ASSERT_MSG(i < m_qpGrp->GetN(), "RdmaEgressQueue::RecoverQueue: qIndex >= m_qpGrp->GetN()");
     m_qpGrp->Get(i)->snd_nxt = m_qpGrp->Get(i)->snd_una;
+    UpdateQp(m_qpGrp->Get(i));
 }
 
 void
@@ -292,8 +566,14 @@ QbbNetDevice::QbbNetDevice()
     {
         m_paused[i] = false;
     }
+    m_pausedMask = 0;
+    m_lastCongested = Time::Min();
+    m_nFluid = 0;
+    m_fluidTxEnd = Time(0);
+    m_ipidRv = CreateObject<UniformRandomVariable>();
 
     m_rdmaEQ = CreateObject<RdmaEgressQueue>();
+    m_rdmaEQ->m_rdmaQpUpdated = MakeCallback(&QbbNetDevice::QpUpdated, this);
 }
 
 QbbNetDevice::~QbbNetDevice()
@@ -308,6 +588,7 @@ QbbNetDevice::DoDispose()
 
     // std::cout << "Do QbbNetDevice::DoDispose() function " << std::endl;
 
+    m_txQp = nullptr;
     PointToPointNetDevice::DoDispose();
 }
 
@@ -322,6 +603,7 @@ QbbNetDevice::TransmitComplete(void)
     NS_ASSERT_MSG(m_currentPkt != nullptr, "QbbNetDevice::TransmitComplete(): m_currentPkt zero");
     m_phyTxEndTrace(m_currentPkt);
     m_currentPkt = 0;
+    NotifySent();
     DequeueAndTransmit();
 }
 
@@ -334,9 +616,21 @@ QbbNetDevice::SwitchAsHostTransmitComplete(void)
     NS_ASSERT_MSG(m_currentPkt != nullptr, "QbbNetDevice::TransmitComplete(): m_currentPkt zero");
     m_phyTxEndTrace(m_currentPkt);
     m_currentPkt = 0;
+    NotifySent();
     SwitchAsHostSend();
 }
 
+void
+QbbNetDevice::NotifySent(void)
+{
+    if (m_txQp == nullptr)
+        return;
+    Ptr<RdmaQueuePair> qp = m_txQp;
+    m_txQp = nullptr;
+    if (!m_rdmaSentCb.IsNull())
+        m_rdmaSentCb(qp);
+}
+
 void
 QbbNetDevice::DequeueAndTransmit(void)
 {
@@ -351,6 +645,22 @@ QbbNetDevice::DequeueAndTransmit(void)
     if (m_node->GetNodeType() == 0 || (m_node->GetNodeType() == 2 && nvls_enable == 1))
     {
         int qIndex = m_rdmaEQ->GetNextQindex(m_paused);
+        if (qIndex != -1024 && m_nFluid > 0)
+        { // another packet stops the fluid flows of this nic
+            if (qIndex == -1)
+                m_fluidContendCb(this, m_rdmaEQ->m_ackQ->Peek(), nullptr);
+            else
+                m_fluidContendCb(this, nullptr, m_rdmaEQ->GetQp(qIndex));
+            qIndex = m_rdmaEQ->GetNextQindex(m_paused);
+        }
+        if (qIndex != -1024 && m_fluidTxEnd > Simulator::Now())
+        { // after the packet they have on the wire
+            Simulator::Cancel(m_nextSend);
+            m_nextSend = Simulator::Schedule(m_fluidTxEnd - Simulator::Now(),
+                                             &QbbNetDevice::DequeueAndTransmit,
+                                             this);
+            return;
+        }
         if (qIndex != -1024)
         {
             if (qIndex == -1)
@@ -370,6 +680,8 @@ QbbNetDevice::DequeueAndTransmit(void)
             m_rdmaUpdateTxBytes(m_ifIndex, p->GetSize());
             // transmit
             m_traceQpDequeue(p, lastQp);
+            if (m_node->GetNodeType() == 0)
+                m_txQp = lastQp;
             TransmitStart(p);
 
             // update for the next avail time
@@ -378,12 +690,7 @@ QbbNetDevice::DequeueAndTransmit(void)
         else
         { // no packet to send
             NS_LOG_INFO("PAUSE prohibits send at node " << m_node->GetId());
-            Time t = Simulator::GetMaximumSimulationTime();
-            for (uint32_t i = 0; i < m_rdmaEQ->GetFlowCount(); i++)
-            {
-                Ptr<RdmaQueuePair> qp = m_rdmaEQ->GetQp(i);
-                t = Min(qp->m_nextAvail, t);
-            }
+            Time t = m_rdmaEQ->GetNextAvail(); // earliest rate-blocked qp
             if (m_nextSend.IsExpired() && t < Simulator::GetMaximumSimulationTime() &&
                 t > Simulator::Now())
             {
@@ -395,53 +702,8 @@ QbbNetDevice::DequeueAndTransmit(void)
         return;
     }
     else
-    {                                     // switch, doesn't care about qcn, just send
-        p = m_queue->DequeueRR(m_paused); // this is round-robin
-        if (p != nullptr)
-        {
-            m_snifferTrace(p);
-            m_promiscSnifferTrace(p);
-            Ipv4Header h;
-            Ptr<Packet> packet = p->Copy();
-            uint16_t protocol = 0;
-            ProcessHeader(packet, protocol);
-            packet->RemoveHeader(h);
-            FlowIdTag t;
-            uint32_t qIndex = m_queue->GetLastQueue();
-            if (qIndex == 0)
-            { // this is a pause or cnp, send it immediately!
-                m_node->SwitchNotifyDequeue(m_ifIndex, qIndex, p);
-                p->RemovePacketTag(t);
-            }
-            else
-            {
-                m_node->SwitchNotifyDequeue(m_ifIndex, qIndex, p);
-                p->RemovePacketTag(t);
-            }
-            m_traceDequeue(p, qIndex);
-            TransmitStart(p);
-            return;
-        }
-        else
-        { // No queue can deliver any packet
-            NS_LOG_INFO("PAUSE prohibits send at node " << m_node->GetId());
-            if (m_node->GetNodeType() == 0 && m_qcnEnabled)
-            { // nothing to send, possibly due to qcn flow control, if so reschedule sending
-                Time t = Simulator::GetMaximumSimulationTime();
-                for (uint32_t i = 0; i < m_rdmaEQ->GetFlowCount(); i++)
-                {
-                    Ptr<RdmaQueuePair> qp = m_rdmaEQ->GetQp(i);
-                    t = Min(qp->m_nextAvail, t);
-                }
-                if (m_nextSend.IsExpired() && t < Simulator::GetMaximumSimulationTime() &&
-                    t > Simulator::Now())
-                {
-                    m_nextSend = Simulator::Schedule(t - Simulator::Now(),
-                                                     &QbbNetDevice::DequeueAndTransmit,
-                                                     this);
-                }
-            }
-        }
+    { // switch, doesn't care about qcn, just send
+        SwitchDequeueAndTransmit();
     }
     return;
 }
@@ -476,6 +738,7 @@ QbbNetDevice::SwitchAsHostSend(void)
         m_rdmaUpdateTxBytes(m_ifIndex, p->GetSize());
         // transmit
         m_traceQpDequeue(p, lastQp);
+        m_txQp = lastQp;
         SwitchAsHostTransmitStart(p);
 
         // update for the next avail time
@@ -484,12 +747,7 @@ QbbNetDevice::SwitchAsHostSend(void)
     else
     { // no packet to send
         NS_LOG_INFO("PAUSE prohibits send at node " << m_node->GetId());
-        Time t = Simulator::GetMaximumSimulationTime();
-        for (uint32_t i = 0; i < m_rdmaEQ->GetFlowCount(); i++)
-        {
-            Ptr<RdmaQueuePair> qp = m_rdmaEQ->GetQp(i);
-            t = Min(qp->m_nextAvail, t);
-        }
+        Time t = m_rdmaEQ->GetNextAvail(); // earliest rate-blocked qp
         if (m_nextSend.IsExpired() && t < Simulator::GetMaximumSimulationTime() &&
             t > Simulator::Now())
         {
@@ -511,28 +769,15 @@ QbbNetDevice::SwitchDequeueAndTransmit(void)
     if (m_txMachineState == BUSY)
         return; // Quit if channel busy
     Ptr<Packet> p;
-    p = m_queue->DequeueRR(m_paused); // this is round-robin
+    p = m_queue->DequeueRR(m_pausedMask); // this is round-robin
     if (p != nullptr)
     {
         m_snifferTrace(p);
         m_promiscSnifferTrace(p);
-        Ipv4Header h;
-        Ptr<Packet> packet = p->Copy();
-        uint16_t protocol = 0;
-        ProcessHeader(packet, protocol);
-        packet->RemoveHeader(h);
-        FlowIdTag t;
+        // the switch works from the metadata and the bytes of p, no need to parse a copy
         uint32_t qIndex = m_queue->GetLastQueue();
-        if (qIndex == 0)
-        { // this is a pause or cnp, send it immediately!
-            m_node->SwitchNotifyDequeue(m_ifIndex, qIndex, p);
-            p->RemovePacketTag(t);
-        }
-        else
-        {
-            m_node->SwitchNotifyDequeue(m_ifIndex, qIndex, p);
-            p->RemovePacketTag(t);
-        }
+        m_node->SwitchNotifyDequeue(m_ifIndex, qIndex, p);
+        p->ResetMeta();
         m_traceDequeue(p, qIndex);
         TransmitStart(p);
         return;
@@ -542,12 +787,7 @@ QbbNetDevice::SwitchDequeueAndTransmit(void)
         NS_LOG_INFO("PAUSE prohibits send at node " << m_node->GetId());
         if (m_node->GetNodeType() == 0 && m_qcnEnabled)
         { // nothing to send, possibly due to qcn flow control, if so reschedule sending
-            Time t = Simulator::GetMaximumSimulationTime();
-            for (uint32_t i = 0; i < m_rdmaEQ->GetFlowCount(); i++)
-            {
-                Ptr<RdmaQueuePair> qp = m_rdmaEQ->GetQp(i);
-                t = Min(qp->m_nextAvail, t);
-            }
+            Time t = m_rdmaEQ->GetNextAvail(); // earliest rate-blocked qp
             if (m_nextSend.IsExpired() && t < Simulator::GetMaximumSimulationTime() &&
                 t > Simulator::Now())
             {
@@ -565,6 +805,7 @@ QbbNetDevice::Resume(unsigned qIndex)
     NS_LOG_FUNCTION(this << qIndex);
     NS_ASSERT_MSG(m_paused[qIndex], "Must be PAUSEd");
     m_paused[qIndex] = false;
+    m_pausedMask &= ~(1u << qIndex);
     NS_LOG_INFO("Node " << m_node->GetId() << " dev " << m_ifIndex << " queue " << qIndex
                         << " resumed at " << Simulator::Now().GetSeconds());
     Ptr<RdmaQueuePair> lastQp = m_rdmaEQ->GetQp(qIndex);
@@ -596,8 +837,7 @@ QbbNetDevice::Receive(Ptr<Packet> packet)
 
     m_macRxTrace(packet);
     CustomHeader ch(CustomHeader::L2_Header | CustomHeader::L3_Header | CustomHeader::L4_Header);
-    ch.getInt = 1; // parse INT header
-    packet->PeekHeader(ch);
+    ch.FastParse(packet); // INT header is parsed by RdmaHw when it needs it
     if (ch.l3Prot == 0xFE)
     { // PFC
         if (!m_qbbEnabled)
@@ -607,6 +847,10 @@ QbbNetDevice::Receive(Ptr<Packet> packet)
         {
             m_tracePfc(1);
             m_paused[qIndex] = true;
+            m_pausedMask |= 1u << qIndex;
+            NotifyCongested();
+            if (m_nFluid > 0)
+                m_fluidContendCb(this, nullptr, nullptr);
         }
         else
         {
@@ -624,18 +868,15 @@ QbbNetDevice::Receive(Ptr<Packet> packet)
         { // switch
             // std::cout << "id: " << m_node->GetId() << " switch receive from " << sid <<
             // std::endl;
-            packet->AddPacketTag(FlowIdTag(m_ifIndex));
+            packet->SetIngressPort(m_ifIndex);
             m_node->SwitchReceiveFromDevice(this, packet, ch);
         }
         else
         { // NIC
             // send to RdmaHw
             // std::cout << "id: " << m_node->GetId() << " NIC receive from " << sid << std::endl;
-            if (ch.l3Prot == 0xFC)
-            {
-            }
-            // int ret = m_rdmaReceiveCb(packet, ch);
-            // TODO we may based on the ret do something
+            if (!m_rdmaReceiveCb.IsNull())
+                m_rdmaReceiveCb(packet, ch);
         }
     }
     return;
@@ -653,6 +894,10 @@ QbbNetDevice::SwitchSend(uint32_t qIndex, Ptr<Packet> packet, CustomHeader& ch)
 {
     m_macTxTrace(packet);
     m_traceEnqueue(packet, qIndex);
+    packet->SetQueueIndex(qIndex);
+    packet->SetEnqueueTs(Simulator::Now().GetTimeStep());
+    if (m_queue->GetNBytesTotal() > 0)
+        NotifyCongested();
     m_queue->Enqueue(packet, qIndex);
     // DequeueAndTransmit();
     SwitchDequeueAndTransmit();
@@ -671,11 +916,11 @@ QbbNetDevice::SendPfc(uint32_t qIndex, uint32_t type)
     ipv4h.SetDestination(Ipv4Address("255.255.255.255"));
     ipv4h.SetPayloadSize(p->GetSize());
     ipv4h.SetTtl(1);
-    ipv4h.SetIdentification(UniformVariable(0, 65536).GetValue());
+    ipv4h.SetIdentification(m_ipidRv->GetInteger(0, 65535));
     p->AddHeader(ipv4h);
     AddHeader(p, 0x800);
     CustomHeader ch(CustomHeader::L2_Header | CustomHeader::L3_Header | CustomHeader::L4_Header);
-    p->PeekHeader(ch);
+    ch.FastParse(p);
     SwitchSend(0, p, ch);
 }
 
@@ -693,7 +938,7 @@ QbbNetDevice::NICSendPfc(uint32_t qIndex, uint32_t type)
     ipv4h.SetDestination(Ipv4Address("255.255.255.255"));
     ipv4h.SetPayloadSize(p->GetSize());
     ipv4h.SetTtl(1);
-    ipv4h.SetIdentification(UniformVariable(0, 65536).GetValue());
+    ipv4h.SetIdentification(m_ipidRv->GetInteger(0, 65535));
     p->AddHeader(ipv4h);
     AddHeader(p, 0x800);
     return p;
@@ -709,14 +954,6 @@ QbbNetDevice::Attach(Ptr<QbbChannel> ch)
     return true;
 }
 
-void
-QbbNetDevice::SendCallback(Ptr<Packet> packet)
-{
-    CustomHeader ch(CustomHeader::L2_Header | CustomHeader::L3_Header | CustomHeader::L4_Header);
-    packet->PeekHeader(ch);
-    m_rdmaSentCb(packet, ch);
-}
-
 bool
 QbbNetDevice::TransmitStart(Ptr<Packet> p)
 {
@@ -736,30 +973,6 @@ QbbNetDevice::TransmitStart(Ptr<Packet> p)
     m_currentPkt = p;
     m_phyTxBeginTrace(m_currentPkt);
     Time txTime = m_bps.CalculateBytesTxTime(p->GetSize());
-    //添加当前qp所要发送的最后一个packet txtime后回调 根据mtu
-    //根据qpindex
-    // 添加一个回调
-    if (m_rdmaEQ != nullptr && m_rdmaEQ->m_qpGrp != nullptr && m_node->GetNodeType() == 0)
-    {
-        // int qIndex = m_rdmaEQ->GetNextQindex(m_paused);
-        // if(qIndex != -1024) {
-        // Ptr<RdmaQueuePair> lastQp = m_rdmaEQ->GetQp(qIndex);
-        // std::cout<<" net: "<<this<<" QPindex: "<<qIndex<<" GetBytesLeft
-        // "<<lastQp->GetBytesLeft()<<" p->GetSize() "<<p->GetSize()<<std::endl; std::cout<<" net:
-        // "<<this<<" p->GetSize() "<<p->GetSize()<<std::endl; if(9000>=lastQp->GetBytesLeft()){
-        if (p->GetSize() < 9000 && p->GetSize() > 60)
-        {   //增加判断当前packet是否是ack报文的逻辑。
-            // if(lastQp->IsFinished()){s
-            // Simulator::Schedule(txTime,&sendfinsh,this);
-            CustomHeader ch(CustomHeader::L2_Header | CustomHeader::L3_Header |
-                            CustomHeader::L4_Header);
-            // ch.getInt = 1; // parse INT header
-            p->PeekHeader(ch);
-            // std::cout<<" p->GetSize()>=lastQp->GetBytesLeft() "<<std::endl;
-            Simulator::Schedule(txTime, &QbbNetDevice::SendCallback, this, p);
-        }
-        // }
-    }
     Time txCompleteTime = txTime + m_tInterframeGap;
     NS_LOG_LOGIC("Schedule TransmitCompleteEvent in " << txCompleteTime.GetSeconds() << "sec");
     Simulator::Schedule(txCompleteTime, &QbbNetDevice::TransmitComplete, this);
@@ -770,6 +983,8 @@ QbbNetDevice::TransmitStart(Ptr<Packet> p)
     {
         m_phyTxDropTrace(p);
     }
+    if (m_nFluid > 0)
+        m_fluidContendCb(this, p, nullptr);
     return result;
 }
 
@@ -792,27 +1007,6 @@ QbbNetDevice::SwitchAsHostTransmitStart(Ptr<Packet> p)
     m_currentPkt = p;
     m_phyTxBeginTrace(m_currentPkt);
     Time txTime = m_bps.CalculateBytesTxTime(p->GetSize());
-    if (m_rdmaEQ != nullptr && m_rdmaEQ->m_qpGrp != nullptr && m_node->GetNodeType() == 2)
-    {
-        // int qIndex = m_rdmaEQ->GetNextQindex(m_paused);
-        // if(qIndex != -1024) {
-        // Ptr<RdmaQueuePair> lastQp = m_rdmaEQ->GetQp(qIndex);
-        // std::cout<<" net: "<<this<<" QPindex: "<<qIndex<<" GetBytesLeft
-        // "<<lastQp->GetBytesLeft()<<" p->GetSize() "<<p->GetSize()<<std::endl; std::cout<<" net:
-        // "<<this<<" p->GetSize() "<<p->GetSize()<<std::endl; if(9000>=lastQp->GetBytesLeft()){
-        if (p->GetSize() < 9000 && p->GetSize() > 60)
-        {   //增加判断当前packet是否是ack报文的逻辑。
-            // if(lastQp->IsFinished()){s
-            // Simulator::Schedule(txTime,&sendfinsh,this);
-            CustomHeader ch(CustomHeader::L2_Header | CustomHeader::L3_Header |
-                            CustomHeader::L4_Header);
-            // ch.getInt = 1; // parse INT header
-            p->PeekHeader(ch);
-            // std::cout<<" p->GetSize()>=lastQp->GetBytesLeft() "<<std::endl;
-            Simulator::Schedule(txTime, &QbbNetDevice::SendCallback, this, p);
-        }
-        // }
-    }
     Time txCompleteTime = txTime + m_tInterframeGap;
     // std::cout << "txCompleteTime: " << txCompleteTime << std::endl;
     NS_LOG_LOGIC("Schedule TransmitCompleteEvent in " << txCompleteTime.GetSeconds() << "sec");
@@ -827,6 +1021,13 @@ QbbNetDevice::SwitchAsHostTransmitStart(Ptr<Packet> p)
     return result;
 }
 
+void
+QbbNetDevice::QpUpdated(Ptr<RdmaQueuePair> qp)
+{
+    if (m_nFluid > 0)
+        m_fluidContendCb(this, nullptr, qp);
+}
+
 Ptr<Channel>
 QbbNetDevice::GetChannel(void) const
 {
@@ -903,9 +1104,10 @@ QbbNetDevice::TakeDown()
         // clean the queue
         for (uint32_t i = 0; i < qCnt; i++)
             m_paused[i] = false;
+        m_pausedMask = 0;
         while (1)
         {
-            Ptr<Packet> p = m_queue->DequeueRR(m_paused);
+            Ptr<Packet> p = m_queue->DequeueRR(m_pausedMask);
             if (p == nullptr)
                 break;
             m_traceDrop(p, m_queue->GetLastQueue());
@@ -913,6 +1115,8 @@ QbbNetDevice::TakeDown()
         // TODO: Notify switch that this link is down
     }
     m_linkUp = false;
+    if (m_nFluid > 0)
+        m_fluidContendCb(this, nullptr, nullptr);
 }
 
 void
@@ -925,4 +1129,23 @@ QbbNetDevice::UpdateNextAvail(Time t)
         m_nextSend = Simulator::Schedule(delta, &QbbNetDevice::DequeueAndTransmit, this);
     }
 }
+
+int64_t
+QbbNetDevice::AssignStreams(int64_t stream)
+{
+    m_ipidRv->SetStream(stream);
+    return 1;
+}
+
+void
+QbbNetDevice::NotifyCongested(void)
+{
+    m_lastCongested = Simulator::Now();
+}
+
+Time
+QbbNetDevice::GetLastCongested(void) const
+{
+    return m_lastCongested;
+}
 } // namespace ns3
@@ -22,6 +22,7 @@
 
 #include "ns3/point-to-point-net-device.h"
 #include "ns3/qbb-channel.h"
+#include "ns3/random-variable-stream.h"
 //#include "ns3/fivetuple.h"
 #include "ns3/broadcom-egress-queue.h"
 #include "ns3/event-id.h"
@@ -32,6 +33,7 @@
 #include <ns3/rdma.h>
 
 #include <map>
+#include <set>
 #include <vector>
 
 namespace ns3
@@ -51,6 +53,12 @@ class RdmaEgressQueue : public Object
     // callback for get next packet
     typedef Callback<Ptr<Packet>, Ptr<RdmaQueuePair>> RdmaGetNxtPkt;
     RdmaGetNxtPkt m_rdmaGetNxtPkt;
+    // callback told first by UpdateQp, before the qp is re-evaluated
+    typedef Callback<void, Ptr<RdmaQueuePair>> RdmaQpUpdated;
+    RdmaQpUpdated m_rdmaQpUpdated;
+    // callback told of each finished qp that Compact() drops from m_qpGrp
+    typedef Callback<void, Ptr<RdmaQueuePair>> RdmaQpDropped;
+    RdmaQpDropped m_rdmaQpDropped;
 
     static TypeId GetTypeId(void);
     RdmaEgressQueue();
@@ -63,9 +71,67 @@ class RdmaEgressQueue : public Object
     void RecoverQueue(uint32_t i);
     void EnqueueHighPrioQ(Ptr<Packet> p);
     void CleanHighPrio(TracedCallback<Ptr<const Packet>, uint32_t> dropCb);
+    // re-evaluate a qp whose window, rate or sequence state changed outside of the queue
+    void UpdateQp(Ptr<RdmaQueuePair> qp);
+    // earliest m_nextAvail of the rate-blocked qps, or the max simulation time if none
+    Time GetNextAvail(void);
+    // whether qp i is the only one which can send now, with no packet in the high prio queue
+    bool IsAlone(uint32_t i);
+    // whether qp i is the only one with bytes to send, with no packet in the high prio queue
+    bool IsOnly(uint32_t i);
+    // ready and rate-blocked qps, and high prio packets, as of the last classification
+    uint32_t GetNActive(void) const;
 
     TracedCallback<Ptr<const Packet>, uint32_t> m_traceRdmaEnqueue;
     TracedCallback<Ptr<const Packet>, uint32_t> m_traceRdmaDequeue;
+
+  private:
+    /**
+     * Each qp of m_qpGrp is kept in exactly one bucket, so that picking the
+     * next qp does not scan the whole group:
+     *  - READY: can send now, kept per pg in index order for round-robin
+     *  - RATE_BLOCKED: waiting for m_nextAvail, kept in an indexed min-heap
+     *  - BLOCKED: no bytes left or window-bound, woken up by UpdateQp
+     *  - FINISHED: all bytes acked, removed from m_qpGrp in batches
+     */
+    enum QpState : uint8_t
+    {
+        QP_NEW,
+        QP_READY,
+        QP_RATE_BLOCKED,
+        QP_BLOCKED,
+        QP_FINISHED
+    };
+
+    struct QpSlot
+    {
+        QpState state;
+        uint16_t pg;      // ready set holding the qp when READY
+        uint32_t heapPos; // position in m_rateBlocked when RATE_BLOCKED
+        int64_t avail;    // heap key when RATE_BLOCKED
+    };
+
+    void SyncGroup(void);
+    void ClassifyPending(void);
+    void Classify(uint32_t idx);
+    void ReleaseRateBlocked(void);
+    void Compact(void);
+
+    // indexed min-heap of qp indexes on QpSlot::avail
+    void HeapPush(uint32_t idx);
+    void HeapRemove(uint32_t idx);
+    void HeapUpdate(uint32_t idx);
+    void HeapSiftUp(uint32_t pos);
+    void HeapSiftDown(uint32_t pos);
+    void HeapSet(uint32_t pos, uint32_t idx);
+
+    std::vector<QpSlot> m_slots; // parallel to m_qpGrp->m_qps
+    std::set<uint32_t> m_ready[qCnt];
+    std::vector<uint32_t> m_rateBlocked;
+    Ptr<RdmaQueuePairGroup> m_syncedGrp;
+    uint32_t m_syncedGen;
+    int m_pendingIdx; // qp dequeued last, classified once its next avail is updated
+    uint32_t m_nFinished;
 };
 
 /**
@@ -150,6 +216,11 @@ class QbbNetDevice : public PointToPointNetDevice
     /// Reset the channel into READY state and try transmit again
     virtual void TransmitComplete(void);
 
+    /// Tell RdmaHw that the data packet of m_txQp left, from TransmitComplete()
+    void NotifySent(void);
+
+    void QpUpdated(Ptr<RdmaQueuePair> qp); // qp of m_rdmaEQ changed, for the fluid flows
+
     /// Look for an available packet and send it using TransmitStart(p)
     virtual void DequeueAndTransmit(void);
 
@@ -171,6 +242,7 @@ class QbbNetDevice : public PointToPointNetDevice
     bool m_dynamicth;
     uint32_t m_pausetime; //< Time for each Pause
     bool m_paused[qCnt];  //< Whether a queue paused
+    uint32_t m_pausedMask; //< m_paused as a bitmask, for the switch queue
 
     uint32_t nvls_enable;
 
@@ -178,6 +250,11 @@ class QbbNetDevice : public PointToPointNetDevice
 
     /* RP parameters */
     EventId m_nextSend; //< The next send event
+    Ptr<RdmaQueuePair> m_txQp; //< QP of the packet on the wire, told at TransmitComplete
+
+    Time m_lastCongested; //< Last queueing, ECN marking or PFC pause seen on this port
+
+    Ptr<UniformRandomVariable> m_ipidRv; //< IPv4 id of the PFC frames, per port for MTP
 
     /* State variable for rate-limited queues */
 
@@ -198,9 +275,8 @@ class QbbNetDevice : public PointToPointNetDevice
   public:
     Ptr<RdmaEgressQueue> m_rdmaEQ;
     void RdmaEnqueueHighPrioQ(Ptr<Packet> p);
-    void SendCallback(Ptr<Packet> Packet);
-    // callback for send packet finish in RDMA
-    typedef Callback<int, Ptr<Packet>, CustomHeader&> RdmaSentCb;
+    // callback for send packet finish in RDMA, with the QP of the data packet
+    typedef Callback<void, Ptr<RdmaQueuePair>> RdmaSentCb;
     RdmaSentCb m_rdmaSentCb;
     // callback for processing packet in RDMA
     typedef Callback<int, Ptr<Packet>, CustomHeader&> RdmaReceiveCb;
@@ -216,6 +292,18 @@ class QbbNetDevice : public PointToPointNetDevice
     Ptr<RdmaEgressQueue> GetRdmaQueue();
     void TakeDown(); // take down this device
     void UpdateNextAvail(Time t);
+    int64_t AssignStreams(int64_t stream); // of m_ipidRv, returns the number of streams used
+
+    // hybrid fluid mode, see RdmaFluidEngine
+    void NotifyCongested(void); // queueing, ECN marking or PFC pause on this port, now
+    Time GetLastCongested(void) const;
+    uint32_t m_nFluid; // fluid flows whose path has this port
+    Time m_fluidTxEnd; // end of the packet a stopped fluid flow of this NIC has on the wire
+    // callback told when a packet starts (with the packet), a qp is updated (with the qp), a
+    // pause arrives or the link goes down (with neither), with m_nFluid > 0
+    typedef Callback<void, Ptr<QbbNetDevice>, Ptr<const Packet>, Ptr<RdmaQueuePair>>
+        FluidContendCb;
+    FluidContendCb m_fluidContendCb;
 
     TracedCallback<Ptr<const Packet>, Ptr<RdmaQueuePair>>
         m_traceQpDequeue; // the trace for printing dequeue
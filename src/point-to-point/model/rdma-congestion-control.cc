@@ -0,0 +1,954 @@
+#include "rdma-congestion-control.h"
+
+#include "pint.h"
+#include "qbb-header.h"
+#include "rdma-hw.h"
+
+#include <ns3/simulator.h>
+
+#include <cstdlib>
+
+namespace ns3
+{
+
+/**************************
+ * RdmaCongestionControl
+ *************************/
+TypeId
+RdmaCongestionControl::GetTypeId(void)
+{
+    static TypeId tid = TypeId("ns3::RdmaCongestionControl")
+                            .SetParent<Object>()
+                            .AddConstructor<RdmaCongestionControl>();
+    return tid;
+}
+
+RdmaCongestionControl::RdmaCongestionControl()
+    : m_hw(nullptr)
+{
+}
+
+Ptr<RdmaCongestionControl>
+RdmaCongestionControl::CreateForMode(uint32_t ccMode)
+{
+    switch (ccMode)
+    {
+    case 1:
+        return CreateObject<RdmaDcqcn>();
+    case 3:
+        return CreateObject<RdmaHpcc>();
+    case 7:
+        return CreateObject<RdmaTimely>();
+    case 8:
+        return CreateObject<RdmaDctcp>();
+    case 10:
+        return CreateObject<RdmaHpccPint>();
+    }
+    return CreateObject<RdmaCongestionControl>();
+}
+
+void
+RdmaCongestionControl::SetHw(RdmaHw* hw)
+{
+    m_hw = hw;
+    m_timers.SetTick(hw->m_ccTimerTick);
+}
+
+uint32_t
+RdmaCongestionControl::GetCcMode(void) const
+{
+    return 0;
+}
+
+void
+RdmaCongestionControl::InitQp(Ptr<RdmaQueuePair> qp, DataRate lineRate)
+{
+    qp->SetCcMode(GetCcMode());
+    SetLineRate(qp, lineRate);
+}
+
+void
+RdmaCongestionControl::SetLineRate(Ptr<RdmaQueuePair> qp, DataRate lineRate)
+{
+}
+
+void
+RdmaCongestionControl::OnAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch)
+{
+}
+
+void
+RdmaCongestionControl::OnCnp(Ptr<RdmaQueuePair> qp)
+{
+}
+
+void
+RdmaCongestionControl::OnSend(Ptr<RdmaQueuePair> qp, Ptr<Packet> p)
+{
+}
+
+void
+RdmaCongestionControl::TeardownQp(Ptr<RdmaQueuePair> qp)
+{
+}
+
+#define PRINT_LOG 0
+
+/******************************
+ * Mellanox's version of DCQCN
+ *****************************/
+TypeId
+RdmaDcqcn::GetTypeId(void)
+{
+    static TypeId tid = TypeId("ns3::RdmaDcqcn")
+                            .SetParent<RdmaCongestionControl>()
+                            .AddConstructor<RdmaDcqcn>();
+    return tid;
+}
+
+uint32_t
+RdmaDcqcn::GetCcMode(void) const
+{
+    return 1;
+}
+
+void
+RdmaDcqcn::SetLineRate(Ptr<RdmaQueuePair> qp, DataRate lineRate)
+{
+    qp->Mlx().m_targetRate = lineRate;
+}
+
+void
+RdmaDcqcn::TeardownQp(Ptr<RdmaQueuePair> qp)
+{
+    m_timers.Cancel(qp->Mlx().m_eventUpdateAlpha);
+    m_timers.Cancel(qp->Mlx().m_eventDecreaseRate);
+    m_timers.Cancel(qp->Mlx().m_rpTimer);
+}
+
+void
+RdmaDcqcn::UpdateAlpha(Ptr<RdmaQueuePair> q)
+{
+#if PRINT_LOG
+// printf("%lu alpha update: %08x %08x %u %u %.6lf->", Simulator::Now().GetTimeStep(), q->sip.Get(),
+// q->dip.Get(), q->sport, q->dport, q->Mlx().m_alpha);
+#endif
+    if (q->Mlx().m_alpha_cnp_arrived)
+    {
+        q->Mlx().m_alpha = (1 - m_hw->m_g) * q->Mlx().m_alpha + m_hw->m_g; // binary feedback
+    }
+    else
+    {
+        q->Mlx().m_alpha = (1 - m_hw->m_g) * q->Mlx().m_alpha; // binary feedback
+    }
+#if PRINT_LOG
+// printf("%.6lf\n", q->Mlx().m_alpha);
+#endif
+    q->Mlx().m_alpha_cnp_arrived = false; // clear the CNP_arrived bit
+    ScheduleUpdateAlpha(q);
+}
+
+void
+RdmaDcqcn::ScheduleUpdateAlpha(Ptr<RdmaQueuePair> q)
+{
+    q->Mlx().m_eventUpdateAlpha =
+        m_timers.Schedule(MicroSeconds(m_hw->m_alpha_resume_interval),
+                          MakeCallback(&RdmaDcqcn::UpdateAlpha, this, q));
+}
+
+void
+RdmaDcqcn::OnCnp(Ptr<RdmaQueuePair> q)
+{
+    q->Mlx().m_alpha_cnp_arrived = true;    // set CNP_arrived bit for alpha update
+    q->Mlx().m_decrease_cnp_arrived = true; // set CNP_arrived bit for rate decrease
+    if (q->Mlx().m_first_cnp)
+    {
+        // init alpha
+        q->Mlx().m_alpha = 1;
+        q->Mlx().m_alpha_cnp_arrived = false;
+        // schedule alpha update
+        ScheduleUpdateAlpha(q);
+        // schedule rate decrease
+        ScheduleDecreaseRate(q, 1); // add 1 ns to make sure rate decrease is after alpha update
+        // set rate on first CNP
+        double bps = m_hw->m_rateOnFirstCNP * q->m_rate.GetBitRate();
+        q->Mlx().m_targetRate = q->m_rate = DataRate((uint64_t)bps);
+        q->Mlx().m_first_cnp = false;
+    }
+}
+
+void
+RdmaDcqcn::CheckRateDecrease(Ptr<RdmaQueuePair> q)
+{
+    ScheduleDecreaseRate(q, 0);
+    if (q->Mlx().m_decrease_cnp_arrived)
+    {
+#if PRINT_LOG
+        printf("%lu rate dec: %08x %08x %u %u (%0.3lf %.3lf)->",
+               Simulator::Now().GetTimeStep(),
+               q->sip.Get(),
+               q->dip.Get(),
+               q->sport,
+               q->dport,
+               q->Mlx().m_targetRate.GetBitRate() * 1e-9,
+               q->m_rate.GetBitRate() * 1e-9);
+#endif
+        bool clamp = true;
+        if (!m_hw->m_EcnClampTgtRate)
+        {
+            if (q->Mlx().m_rpTimeStage == 0)
+                clamp = false;
+        }
+        if (clamp)
+            q->Mlx().m_targetRate = q->m_rate;
+        q->m_rate = std::max(m_hw->m_minRate, q->m_rate * (1 - q->Mlx().m_alpha / 2));
+        // reset rate increase related things
+        q->Mlx().m_rpTimeStage = 0;
+        q->Mlx().m_decrease_cnp_arrived = false;
+        m_timers.Cancel(q->Mlx().m_rpTimer);
+        q->Mlx().m_rpTimer =
+            m_timers.Schedule(MicroSeconds(m_hw->m_rpgTimeReset),
+                              MakeCallback(&RdmaDcqcn::RateIncEventTimer, this, q));
+        // the egress queue, and a fluid flow of the qp, see the new rate
+        uint32_t nic_idx = m_hw->GetNicIdxOfQp(q);
+        m_hw->m_nic[nic_idx].dev->m_rdmaEQ->UpdateQp(q);
+#if PRINT_LOG
+        printf("(%.3lf %.3lf)\n",
+               q->Mlx().m_targetRate.GetBitRate() * 1e-9,
+               q->m_rate.GetBitRate() * 1e-9);
+#endif
+    }
+}
+
+void
+RdmaDcqcn::ScheduleDecreaseRate(Ptr<RdmaQueuePair> q, uint32_t delta)
+{
+    q->Mlx().m_eventDecreaseRate =
+        m_timers.Schedule(MicroSeconds(m_hw->m_rateDecreaseInterval) + NanoSeconds(delta),
+                          MakeCallback(&RdmaDcqcn::CheckRateDecrease, this, q));
+}
+
+void
+RdmaDcqcn::RateIncEventTimer(Ptr<RdmaQueuePair> q)
+{
+    q->Mlx().m_rpTimer = m_timers.Schedule(MicroSeconds(m_hw->m_rpgTimeReset),
+                                           MakeCallback(&RdmaDcqcn::RateIncEventTimer, this, q));
+    RateIncEvent(q);
+    q->Mlx().m_rpTimeStage++;
+    if (m_hw->m_var_win)
+    { // a larger rate may open the window
+        uint32_t nic_idx = m_hw->GetNicIdxOfQp(q);
+        m_hw->m_nic[nic_idx].dev->m_rdmaEQ->UpdateQp(q);
+    }
+}
+
+void
+RdmaDcqcn::RateIncEvent(Ptr<RdmaQueuePair> q)
+{
+    // check which increase phase: fast recovery, active increase, hyper increase
+    if (q->Mlx().m_rpTimeStage < m_hw->m_rpgThreshold)
+    { // fast recovery
+        FastRecovery(q);
+    }
+    else if (q->Mlx().m_rpTimeStage == m_hw->m_rpgThreshold)
+    { // active increase
+        ActiveIncrease(q);
+    }
+    else
+    { // hyper increase
+        HyperIncrease(q);
+    }
+}
+
+void
+RdmaDcqcn::FastRecovery(Ptr<RdmaQueuePair> q)
+{
+#if PRINT_LOG
+    printf("%lu fast recovery: %08x %08x %u %u (%0.3lf %.3lf)->",
+           Simulator::Now().GetTimeStep(),
+           q->sip.Get(),
+           q->dip.Get(),
+           q->sport,
+           q->dport,
+           q->Mlx().m_targetRate.GetBitRate() * 1e-9,
+           q->m_rate.GetBitRate() * 1e-9);
+#endif
+    double bps = (q->m_rate.GetBitRate() / 2) + (q->Mlx().m_targetRate.GetBitRate() / 2);
+    q->m_rate = DataRate((uint64_t)bps);
+#if PRINT_LOG
+    printf("(%.3lf %.3lf)\n",
+           q->Mlx().m_targetRate.GetBitRate() * 1e-9,
+           q->m_rate.GetBitRate() * 1e-9);
+#endif
+}
+
+void
+RdmaDcqcn::ActiveIncrease(Ptr<RdmaQueuePair> q)
+{
+#if PRINT_LOG
+    printf("%lu active inc: %08x %08x %u %u (%0.3lf %.3lf)->",
+           Simulator::Now().GetTimeStep(),
+           q->sip.Get(),
+           q->dip.Get(),
+           q->sport,
+           q->dport,
+           q->Mlx().m_targetRate.GetBitRate() * 1e-9,
+           q->m_rate.GetBitRate() * 1e-9);
+#endif
+    // get NIC
+    uint32_t nic_idx = m_hw->GetNicIdxOfQp(q);
+    Ptr<QbbNetDevice> dev = m_hw->m_nic[nic_idx].dev;
+    // increate rate
+    q->Mlx().m_targetRate += m_hw->m_rai;
+    if (q->Mlx().m_targetRate > dev->GetDataRate())
+        q->Mlx().m_targetRate = dev->GetDataRate();
+    double bps = (q->m_rate.GetBitRate() / 2) + (q->Mlx().m_targetRate.GetBitRate() / 2);
+    q->m_rate = DataRate((uint64_t)bps);
+#if PRINT_LOG
+    printf("(%.3lf %.3lf)\n",
+           q->Mlx().m_targetRate.GetBitRate() * 1e-9,
+           q->m_rate.GetBitRate() * 1e-9);
+#endif
+}
+
+void
+RdmaDcqcn::HyperIncrease(Ptr<RdmaQueuePair> q)
+{
+#if PRINT_LOG
+    printf("%lu hyper inc: %08x %08x %u %u (%0.3lf %.3lf)->",
+           Simulator::Now().GetTimeStep(),
+           q->sip.Get(),
+           q->dip.Get(),
+           q->sport,
+           q->dport,
+           q->Mlx().m_targetRate.GetBitRate() * 1e-9,
+           q->m_rate.GetBitRate() * 1e-9);
+#endif
+    // get NIC
+    uint32_t nic_idx = m_hw->GetNicIdxOfQp(q);
+    Ptr<QbbNetDevice> dev = m_hw->m_nic[nic_idx].dev;
+    // increate rate
+    q->Mlx().m_targetRate += m_hw->m_rhai;
+    if (q->Mlx().m_targetRate > dev->GetDataRate())
+        q->Mlx().m_targetRate = dev->GetDataRate();
+    double bps = (q->m_rate.GetBitRate() / 2) + (q->Mlx().m_targetRate.GetBitRate() / 2);
+    q->m_rate = DataRate((uint64_t)bps);
+#if PRINT_LOG
+    printf("(%.3lf %.3lf)\n",
+           q->Mlx().m_targetRate.GetBitRate() * 1e-9,
+           q->m_rate.GetBitRate() * 1e-9);
+#endif
+}
+
+/***********************
+ * High Precision CC
+ ***********************/
+TypeId
+RdmaHpcc::GetTypeId(void)
+{
+    static TypeId tid = TypeId("ns3::RdmaHpcc")
+                            .SetParent<RdmaCongestionControl>()
+                            .AddConstructor<RdmaHpcc>();
+    return tid;
+}
+
+uint32_t
+RdmaHpcc::GetCcMode(void) const
+{
+    return 3;
+}
+
+void
+RdmaHpcc::SetLineRate(Ptr<RdmaQueuePair> qp, DataRate lineRate)
+{
+    qp->Hp().m_curRate = lineRate;
+    if (m_hw->m_multipleRate)
+    {
+        for (uint32_t i = 0; i < IntHeader::maxHop; i++)
+            qp->Hp().hopState[i].Rc = lineRate;
+    }
+}
+
+void
+RdmaHpcc::OnAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch)
+{
+    uint64_t ack_seq = ch.ack.seq;
+    // update rate
+    if (ack_seq > qp->Hp().m_lastUpdateSeq)
+    { // if full RTT feedback is ready, do full update
+        UpdateRate(qp, p, ch, false);
+    }
+    else
+    { // do fast react
+        FastReact(qp, p, ch);
+    }
+}
+
+void
+RdmaHpcc::UpdateRate(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch, bool fast_react)
+{
+    uint64_t next_seq = qp->snd_nxt;
+#if PRINT_LOG
+    bool print = !fast_react || true;
+#endif
+    if (qp->Hp().m_lastUpdateSeq == 0)
+    { // first RTT
+        qp->Hp().m_lastUpdateSeq = next_seq;
+        // store INT
+        IntHeader& ih = ch.ack.ih;
+        NS_ASSERT(ih.IntHeader_t.nhop <= IntHeader::maxHop);
+        for (uint32_t i = 0; i < ih.IntHeader_t.nhop; i++)
+            qp->Hp().hop[i] = ih.IntHeader_t.hop[i];
+#if PRINT_LOG
+        if (print)
+        {
+            printf("%lu %s %08x %08x %u %u [%u,%u,%u]",
+                   Simulator::Now().GetTimeStep(),
+                   fast_react ? "fast" : "update",
+                   qp->sip.Get(),
+                   qp->dip.Get(),
+                   qp->sport,
+                   qp->dport,
+                   qp->Hp().m_lastUpdateSeq,
+                   ch.ack.seq,
+                   next_seq);
+            for (uint32_t i = 0; i < ih.nhop; i++)
+                printf(" %u %lu %lu",
+                       ih.hop[i].GetQlen(),
+                       ih.hop[i].GetBytes(),
+                       ih.hop[i].GetTime());
+            printf("\n");
+        }
+#endif
+    }
+    else
+    {
+        // check packet INT
+        IntHeader& ih = ch.ack.ih;
+        if (ih.IntHeader_t.nhop <= IntHeader::maxHop)
+        {
+            double max_c = 0;
+            // bool inStable = false;
+#if PRINT_LOG
+            if (print)
+                printf("%lu %s %08x %08x %u %u [%u,%u,%u]",
+                       Simulator::Now().GetTimeStep(),
+                       fast_react ? "fast" : "update",
+                       qp->sip.Get(),
+                       qp->dip.Get(),
+                       qp->sport,
+                       qp->dport,
+                       qp->Hp().m_lastUpdateSeq,
+                       ch.ack.seq,
+                       next_seq);
+#endif
+            // check each hop
+            double U = 0;
+            uint64_t dt = 0;
+            bool updated[IntHeader::maxHop] = {false}, updated_any = false;
+            NS_ASSERT(ih.IntHeader_t.nhop <= IntHeader::maxHop);
+            for (uint32_t i = 0; i < ih.IntHeader_t.nhop; i++)
+            {
+                if (m_hw->m_sampleFeedback)
+                {
+                    if (ih.IntHeader_t.hop[i].GetQlen() == 0 && fast_react)
+                        continue;
+                }
+                updated[i] = updated_any = true;
+#if PRINT_LOG
+                if (print)
+                    printf(" %u(%u) %lu(%lu) %lu(%lu)",
+                           ih.hop[i].GetQlen(),
+                           qp->Hp().hop[i].GetQlen(),
+                           ih.hop[i].GetBytes(),
+                           qp->Hp().hop[i].GetBytes(),
+                           ih.hop[i].GetTime(),
+                           qp->Hp().hop[i].GetTime());
+#endif
+                uint64_t tau = ih.IntHeader_t.hop[i].GetTimeDelta(qp->Hp().hop[i]);
+                ;
+                double duration = tau * 1e-9;
+                double txRate =
+                    (ih.IntHeader_t.hop[i].GetBytesDelta(qp->Hp().hop[i])) * 8 / duration;
+                double u =
+                    txRate / ih.IntHeader_t.hop[i].GetLineRate() +
+                    (double)std::min(ih.IntHeader_t.hop[i].GetQlen(), qp->Hp().hop[i].GetQlen()) *
+                        qp->m_max_rate.GetBitRate() / ih.IntHeader_t.hop[i].GetLineRate() /
+                        qp->m_win;
+#if PRINT_LOG
+                if (print)
+                    printf(" %.3lf %.3lf", txRate, u);
+#endif
+                if (!m_hw->m_multipleRate)
+                {
+                    // for aggregate (single R)
+                    if (u > U)
+                    {
+                        U = u;
+                        dt = tau;
+                    }
+                }
+                else
+                {
+                    // for per hop (per hop R)
+                    if (tau > qp->m_baseRtt)
+                        tau = qp->m_baseRtt;
+                    qp->Hp().hopState[i].u =
+                        (qp->Hp().hopState[i].u * (qp->m_baseRtt - tau) + u * tau) /
+                        double(qp->m_baseRtt);
+                }
+                qp->Hp().hop[i] = ih.IntHeader_t.hop[i];
+            }
+
+            DataRate new_rate;
+            int32_t new_incStage = 0;
+            DataRate new_rate_per_hop[IntHeader::maxHop];
+            int32_t new_incStage_per_hop[IntHeader::maxHop];
+            if (!m_hw->m_multipleRate)
+            {
+                // for aggregate (single R)
+                if (updated_any)
+                {
+                    if (dt > qp->m_baseRtt)
+                        dt = qp->m_baseRtt;
+                    qp->Hp().u =
+                        (qp->Hp().u * (qp->m_baseRtt - dt) + U * dt) / double(qp->m_baseRtt);
+                    max_c = qp->Hp().u / m_hw->m_targetUtil;
+
+                    if (max_c >= 1 || qp->Hp().m_incStage >= m_hw->m_miThresh)
+                    {
+                        double bps =
+                            qp->Hp().m_curRate.GetBitRate() / max_c + m_hw->m_rai.GetBitRate();
+                        new_rate = DataRate((uint64_t)bps);
+                        new_incStage = 0;
+                    }
+                    else
+                    {
+                        new_rate = qp->Hp().m_curRate + m_hw->m_rai;
+                        new_incStage = qp->Hp().m_incStage + 1;
+                    }
+                    if (new_rate < m_hw->m_minRate)
+                        new_rate = m_hw->m_minRate;
+                    if (new_rate > qp->m_max_rate)
+                        new_rate = qp->m_max_rate;
+#if PRINT_LOG
+                    if (print)
+                        printf(" u=%.6lf U=%.3lf dt=%u max_c=%.3lf", qp->Hp().u, U, dt, max_c);
+#endif
+#if PRINT_LOG
+                    if (print)
+                        printf(" rate:%.3lf->%.3lf\n",
+                               qp->Hp().m_curRate.GetBitRate() * 1e-9,
+                               new_rate.GetBitRate() * 1e-9);
+#endif
+                }
+            }
+            else
+            {
+                // for per hop (per hop R)
+                new_rate = qp->m_max_rate;
+                for (uint32_t i = 0; i < ih.IntHeader_t.nhop; i++)
+                {
+                    if (updated[i])
+                    {
+                        double c = qp->Hp().hopState[i].u / m_hw->m_targetUtil;
+                        if (c >= 1 || qp->Hp().hopState[i].incStage >= m_hw->m_miThresh)
+                        {
+                            double bps =
+                                qp->Hp().hopState[i].Rc.GetBitRate() / c + m_hw->m_rai.GetBitRate();
+                            new_rate_per_hop[i] = DataRate((uint64_t)bps);
+                            new_incStage_per_hop[i] = 0;
+                        }
+                        else
+                        {
+                            new_rate_per_hop[i] = qp->Hp().hopState[i].Rc + m_hw->m_rai;
+                            new_incStage_per_hop[i] = qp->Hp().hopState[i].incStage + 1;
+                        }
+                        // bound rate
+                        if (new_rate_per_hop[i] < m_hw->m_minRate)
+                            new_rate_per_hop[i] = m_hw->m_minRate;
+                        if (new_rate_per_hop[i] > qp->m_max_rate)
+                            new_rate_per_hop[i] = qp->m_max_rate;
+                        // find min new_rate
+                        if (new_rate_per_hop[i] < new_rate)
+                            new_rate = new_rate_per_hop[i];
+#if PRINT_LOG
+                        if (print)
+                            printf(" [%u]u=%.6lf c=%.3lf", i, qp->Hp().hopState[i].u, c);
+#endif
+#if PRINT_LOG
+                        if (print)
+                            printf(" %.3lf->%.3lf",
+                                   qp->Hp().hopState[i].Rc.GetBitRate() * 1e-9,
+                                   new_rate.GetBitRate() * 1e-9);
+#endif
+                    }
+                    else
+                    {
+                        if (qp->Hp().hopState[i].Rc < new_rate)
+                            new_rate = qp->Hp().hopState[i].Rc;
+                    }
+                }
+#if PRINT_LOG
+                printf("\n");
+#endif
+            }
+            if (updated_any)
+                m_hw->ChangeRate(qp, new_rate);
+            if (!fast_react)
+            {
+                if (updated_any)
+                {
+                    qp->Hp().m_curRate = new_rate;
+                    qp->Hp().m_incStage = new_incStage;
+                }
+                if (m_hw->m_multipleRate)
+                {
+                    // for per hop (per hop R)
+                    for (uint32_t i = 0; i < ih.IntHeader_t.nhop; i++)
+                    {
+                        if (updated[i])
+                        {
+                            qp->Hp().hopState[i].Rc = new_rate_per_hop[i];
+                            qp->Hp().hopState[i].incStage = new_incStage_per_hop[i];
+                        }
+                    }
+                }
+            }
+        }
+        if (!fast_react)
+        {
+            if (next_seq > qp->Hp().m_lastUpdateSeq)
+                qp->Hp().m_lastUpdateSeq = next_seq; //+ rand() % 2 * m_hw->m_mtu;
+        }
+    }
+}
+
+void
+RdmaHpcc::FastReact(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch)
+{
+    if (m_hw->m_fast_react)
+        UpdateRate(qp, p, ch, true);
+}
+
+/**********************
+ * TIMELY
+ *********************/
+TypeId
+RdmaTimely::GetTypeId(void)
+{
+    static TypeId tid = TypeId("ns3::RdmaTimely")
+                            .SetParent<RdmaCongestionControl>()
+                            .AddConstructor<RdmaTimely>();
+    return tid;
+}
+
+uint32_t
+RdmaTimely::GetCcMode(void) const
+{
+    return 7;
+}
+
+void
+RdmaTimely::SetLineRate(Ptr<RdmaQueuePair> qp, DataRate lineRate)
+{
+    qp->Tmly().m_curRate = lineRate;
+}
+
+void
+RdmaTimely::OnAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch)
+{
+    uint64_t ack_seq = ch.ack.seq;
+    // update rate
+    if (ack_seq > qp->Tmly().m_lastUpdateSeq)
+    { // if full RTT feedback is ready, do full update
+        UpdateRate(qp, p, ch, false);
+    }
+    else
+    { // do fast react
+        FastReact(qp, p, ch);
+    }
+}
+
+void
+RdmaTimely::UpdateRate(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch, bool us)
+{
+    uint64_t next_seq = qp->snd_nxt;
+    uint64_t rtt = Simulator::Now().GetTimeStep() - ch.ack.ih.ts;
+#if PRINT_LOG
+    bool print = !us;
+#endif
+    if (qp->Tmly().m_lastUpdateSeq != 0)
+    { // not first RTT
+        int64_t new_rtt_diff = (int64_t)rtt - (int64_t)qp->Tmly().lastRtt;
+        double rtt_diff =
+            (1 - m_hw->m_tmly_alpha) * qp->Tmly().rttDiff + m_hw->m_tmly_alpha * new_rtt_diff;
+        double gradient = rtt_diff / m_hw->m_tmly_minRtt;
+        bool inc = false;
+        double c = 0;
+#if PRINT_LOG
+        if (print)
+            printf("%lu node:%u rtt:%lu rttDiff:%.0lf gradient:%.3lf rate:%.3lf",
+                   Simulator::Now().GetTimeStep(),
+                   m_hw->m_node->GetId(),
+                   rtt,
+                   rtt_diff,
+                   gradient,
+                   qp->Tmly().m_curRate.GetBitRate() * 1e-9);
+#endif
+        if (rtt < m_hw->m_tmly_TLow)
+        {
+            inc = true;
+        }
+        else if (rtt > m_hw->m_tmly_THigh)
+        {
+            c = 1 - m_hw->m_tmly_beta * (1 - (double)m_hw->m_tmly_THigh / rtt);
+            inc = false;
+        }
+        else if (gradient <= 0)
+        {
+            inc = true;
+        }
+        else
+        {
+            c = 1 - m_hw->m_tmly_beta * gradient;
+            if (c < 0)
+                c = 0;
+            inc = false;
+        }
+        if (inc)
+        {
+            if (qp->Tmly().m_incStage < 5)
+            {
+                qp->m_rate = qp->Tmly().m_curRate + m_hw->m_rai;
+            }
+            else
+            {
+                qp->m_rate = qp->Tmly().m_curRate + m_hw->m_rhai;
+            }
+            if (qp->m_rate > qp->m_max_rate)
+                qp->m_rate = qp->m_max_rate;
+            if (!us)
+            {
+                qp->Tmly().m_curRate = qp->m_rate;
+                qp->Tmly().m_incStage++;
+                qp->Tmly().rttDiff = rtt_diff;
+            }
+        }
+        else
+        {
+            qp->m_rate = std::max(m_hw->m_minRate, qp->Tmly().m_curRate * c);
+            if (!us)
+            {
+                qp->Tmly().m_curRate = qp->m_rate;
+                qp->Tmly().m_incStage = 0;
+                qp->Tmly().rttDiff = rtt_diff;
+            }
+        }
+#if PRINT_LOG
+        if (print)
+        {
+            printf(" %c %.3lf\n", inc ? '^' : 'v', qp->m_rate.GetBitRate() * 1e-9);
+        }
+#endif
+    }
+    if (!us && next_seq > qp->Tmly().m_lastUpdateSeq)
+    {
+        qp->Tmly().m_lastUpdateSeq = next_seq;
+        // update
+        qp->Tmly().lastRtt = rtt;
+    }
+}
+
+void
+RdmaTimely::FastReact(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch)
+{
+}
+
+/**********************
+ * DCTCP
+ *********************/
+TypeId
+RdmaDctcp::GetTypeId(void)
+{
+    static TypeId tid = TypeId("ns3::RdmaDctcp")
+                            .SetParent<RdmaCongestionControl>()
+                            .AddConstructor<RdmaDctcp>();
+    return tid;
+}
+
+uint32_t
+RdmaDctcp::GetCcMode(void) const
+{
+    return 8;
+}
+
+void
+RdmaDctcp::OnAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch)
+{
+    uint64_t ack_seq = ch.ack.seq;
+    uint8_t cnp = (ch.ack.flags >> qbbHeader::FLAG_CNP) & 1;
+    bool new_batch = false;
+
+    // update alpha
+    qp->Dctcp().m_ecnCnt += (cnp > 0);
+    if (ack_seq > qp->Dctcp().m_lastUpdateSeq)
+    { // if full RTT feedback is ready, do alpha update
+#if PRINT_LOG
+        printf("%lu %s %08x %08x %u %u [%u,%u,%u] %.3lf->",
+               Simulator::Now().GetTimeStep(),
+               "alpha",
+               qp->sip.Get(),
+               qp->dip.Get(),
+               qp->sport,
+               qp->dport,
+               qp->Dctcp().m_lastUpdateSeq,
+               ch.ack.seq,
+               qp->snd_nxt,
+               qp->Dctcp().m_alpha);
+#endif
+        new_batch = true;
+        if (qp->Dctcp().m_lastUpdateSeq == 0)
+        { // first RTT
+            qp->Dctcp().m_lastUpdateSeq = qp->snd_nxt;
+            qp->Dctcp().m_batchSizeOfAlpha = qp->snd_nxt / m_hw->m_mtu + 1;
+        }
+        else
+        {
+            double frac =
+                std::min(1.0, double(qp->Dctcp().m_ecnCnt) / qp->Dctcp().m_batchSizeOfAlpha);
+            qp->Dctcp().m_alpha = (1 - m_hw->m_g) * qp->Dctcp().m_alpha + m_hw->m_g * frac;
+            qp->Dctcp().m_lastUpdateSeq = qp->snd_nxt;
+            qp->Dctcp().m_ecnCnt = 0;
+            qp->Dctcp().m_batchSizeOfAlpha = (qp->snd_nxt - ack_seq) / m_hw->m_mtu + 1;
+#if PRINT_LOG
+            printf("%.3lf F:%.3lf", qp->Dctcp().m_alpha, frac);
+#endif
+        }
+#if PRINT_LOG
+        printf("\n");
+#endif
+    }
+
+    // check cwr exit
+    if (qp->Dctcp().m_caState == 1)
+    {
+        if (ack_seq > qp->Dctcp().m_highSeq)
+            qp->Dctcp().m_caState = 0;
+    }
+
+    // check if need to reduce rate: ECN and not in CWR
+    if (cnp && qp->Dctcp().m_caState == 0)
+    {
+#if PRINT_LOG
+        printf("%lu %s %08x %08x %u %u %.3lf->",
+               Simulator::Now().GetTimeStep(),
+               "rate",
+               qp->sip.Get(),
+               qp->dip.Get(),
+               qp->sport,
+               qp->dport,
+               qp->m_rate.GetBitRate() * 1e-9);
+#endif
+        qp->m_rate = std::max(m_hw->m_minRate, qp->m_rate * (1 - qp->Dctcp().m_alpha / 2));
+#if PRINT_LOG
+        printf("%.3lf\n", qp->m_rate.GetBitRate() * 1e-9);
+#endif
+        qp->Dctcp().m_caState = 1;
+        qp->Dctcp().m_highSeq = qp->snd_nxt;
+    }
+
+    // additive inc
+    if (qp->Dctcp().m_caState == 0 && new_batch)
+        qp->m_rate = std::min(qp->m_max_rate, qp->m_rate + m_hw->m_dctcp_rai);
+}
+
+/*********************
+ * HPCC-PINT
+ ********************/
+TypeId
+RdmaHpccPint::GetTypeId(void)
+{
+    static TypeId tid = TypeId("ns3::RdmaHpccPint")
+                            .SetParent<RdmaCongestionControl>()
+                            .AddConstructor<RdmaHpccPint>();
+    return tid;
+}
+
+uint32_t
+RdmaHpccPint::GetCcMode(void) const
+{
+    return 10;
+}
+
+void
+RdmaHpccPint::SetLineRate(Ptr<RdmaQueuePair> qp, DataRate lineRate)
+{
+    qp->HpccPint().m_curRate = lineRate;
+}
+
+void
+RdmaHpccPint::OnAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch)
+{
+    uint64_t ack_seq = ch.ack.seq;
+    if ((uint32_t)rand() % 65536 >= m_hw->pint_smpl_thresh)
+        return;
+    // update rate
+    if (ack_seq > qp->HpccPint().m_lastUpdateSeq)
+    { // if full RTT feedback is ready, do full update
+        UpdateRate(qp, p, ch, false);
+    }
+    else
+    { // do fast react
+        UpdateRate(qp, p, ch, true);
+    }
+}
+
+void
+RdmaHpccPint::UpdateRate(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch, bool fast_react)
+{
+    uint64_t next_seq = qp->snd_nxt;
+    if (qp->HpccPint().m_lastUpdateSeq == 0)
+    { // first RTT
+        qp->HpccPint().m_lastUpdateSeq = next_seq;
+    }
+    else
+    {
+        // check packet INT
+        IntHeader& ih = ch.ack.ih;
+        double U = Pint::decode_u(ih.GetPower());
+
+        DataRate new_rate;
+        int32_t new_incStage = 0;
+        double max_c = U / m_hw->m_targetUtil;
+
+        if (max_c >= 1 || qp->HpccPint().m_incStage >= m_hw->m_miThresh)
+        {
+            double bps = qp->HpccPint().m_curRate.GetBitRate() / max_c + m_hw->m_rai.GetBitRate();
+            new_rate = DataRate((uint64_t)bps);
+            new_incStage = 0;
+        }
+        else
+        {
+            new_rate = qp->HpccPint().m_curRate + m_hw->m_rai;
+            new_incStage = qp->HpccPint().m_incStage + 1;
+        }
+        if (new_rate < m_hw->m_minRate)
+            new_rate = m_hw->m_minRate;
+        if (new_rate > qp->m_max_rate)
+            new_rate = qp->m_max_rate;
+        m_hw->ChangeRate(qp, new_rate);
+        if (!fast_react)
+        {
+            qp->HpccPint().m_curRate = new_rate;
+            qp->HpccPint().m_incStage = new_incStage;
+        }
+        if (!fast_react)
+        {
+            if (next_seq > qp->HpccPint().m_lastUpdateSeq)
+                qp->HpccPint().m_lastUpdateSeq = next_seq; //+ rand() % 2 * m_hw->m_mtu;
+        }
+    }
+}
+
+} // namespace ns3
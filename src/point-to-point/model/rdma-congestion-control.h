@@ -0,0 +1,150 @@
+#ifndef RDMA_CONGESTION_CONTROL_H
+#define RDMA_CONGESTION_CONTROL_H
+
+#include <ns3/custom-header.h>
+#include <ns3/data-rate.h>
+#include <ns3/object.h>
+#include <ns3/packet.h>
+#include <ns3/rdma-queue-pair.h>
+#include <ns3/rdma-timer-wheel.h>
+
+namespace ns3
+{
+
+class RdmaHw;
+
+/**
+ * Congestion control of the QPs of an RdmaHw, one object per RdmaHw.
+ *
+ * RdmaHw calls InitQp() on each new QP, OnAck() and OnCnp() on the ACKs,
+ * OnSend() after each data packet and TeardownQp() when the QP completes.
+ * An algorithm keeps its per-QP state in the QP state of GetCcMode() and
+ * schedules its own timers, in m_timers. Its parameters are the attributes
+ * of RdmaHw.
+ *
+ * This base class is no congestion control at all: the QPs send at line
+ * rate. CreateForMode() gives the algorithm of a CcMode, and another one
+ * can be installed with RdmaHw::SetCongestionControl().
+ */
+class RdmaCongestionControl : public Object
+{
+  public:
+    static TypeId GetTypeId(void);
+    RdmaCongestionControl();
+
+    // the algorithm of CcMode ccMode, this base class for the modes without one
+    static Ptr<RdmaCongestionControl> CreateForMode(uint32_t ccMode);
+
+    void SetHw(RdmaHw* hw); // the RdmaHw which owns this object
+
+    virtual uint32_t GetCcMode(void) const; // QP state used, 0 for none
+    virtual void InitQp(Ptr<RdmaQueuePair> qp, DataRate lineRate);
+    virtual void SetLineRate(Ptr<RdmaQueuePair> qp, DataRate lineRate); // (re)start rate
+    virtual void OnAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch);
+    virtual void OnCnp(Ptr<RdmaQueuePair> qp); // an ACK with the CNP flag
+    virtual void OnSend(Ptr<RdmaQueuePair> qp, Ptr<Packet> p);
+    virtual void TeardownQp(Ptr<RdmaQueuePair> qp);
+
+  protected:
+    RdmaHw* m_hw;
+    RdmaTimerWheel m_timers; // per-QP timers, with the CcTimerTick of m_hw
+};
+
+/**
+ * Mellanox's version of DCQCN, CcMode 1
+ */
+class RdmaDcqcn final : public RdmaCongestionControl
+{
+  public:
+    static TypeId GetTypeId(void);
+
+    uint32_t GetCcMode(void) const override;
+    void SetLineRate(Ptr<RdmaQueuePair> qp, DataRate lineRate) override;
+    void OnCnp(Ptr<RdmaQueuePair> q) override;
+    void TeardownQp(Ptr<RdmaQueuePair> qp) override;
+
+  private:
+    // the Mellanox's version of alpha update:
+    // every fixed time slot, update alpha.
+    void UpdateAlpha(Ptr<RdmaQueuePair> q);
+    void ScheduleUpdateAlpha(Ptr<RdmaQueuePair> q);
+
+    // Mellanox's version of rate decrease
+    // It checks every m_rateDecreaseInterval if CNP arrived (m_decrease_cnp_arrived).
+    // If so, decrease rate, and reset all rate increase related things
+    void CheckRateDecrease(Ptr<RdmaQueuePair> q);
+    void ScheduleDecreaseRate(Ptr<RdmaQueuePair> q, uint32_t delta);
+
+    // Mellanox's version of rate increase
+    void RateIncEventTimer(Ptr<RdmaQueuePair> q);
+    void RateIncEvent(Ptr<RdmaQueuePair> q);
+    void FastRecovery(Ptr<RdmaQueuePair> q);
+    void ActiveIncrease(Ptr<RdmaQueuePair> q);
+    void HyperIncrease(Ptr<RdmaQueuePair> q);
+};
+
+/**
+ * High Precision CC, CcMode 3
+ */
+class RdmaHpcc final : public RdmaCongestionControl
+{
+  public:
+    static TypeId GetTypeId(void);
+
+    uint32_t GetCcMode(void) const override;
+    void SetLineRate(Ptr<RdmaQueuePair> qp, DataRate lineRate) override;
+    void OnAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch) override;
+
+  private:
+    void UpdateRate(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch, bool fast_react);
+    void FastReact(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch);
+};
+
+/**
+ * TIMELY, CcMode 7
+ */
+class RdmaTimely final : public RdmaCongestionControl
+{
+  public:
+    static TypeId GetTypeId(void);
+
+    uint32_t GetCcMode(void) const override;
+    void SetLineRate(Ptr<RdmaQueuePair> qp, DataRate lineRate) override;
+    void OnAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch) override;
+
+  private:
+    void UpdateRate(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch, bool us);
+    void FastReact(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch);
+};
+
+/**
+ * DCTCP, CcMode 8
+ */
+class RdmaDctcp final : public RdmaCongestionControl
+{
+  public:
+    static TypeId GetTypeId(void);
+
+    uint32_t GetCcMode(void) const override;
+    void OnAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch) override;
+};
+
+/**
+ * HPCC-PINT, CcMode 10
+ */
+class RdmaHpccPint final : public RdmaCongestionControl
+{
+  public:
+    static TypeId GetTypeId(void);
+
+    uint32_t GetCcMode(void) const override;
+    void SetLineRate(Ptr<RdmaQueuePair> qp, DataRate lineRate) override;
+    void OnAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch) override;
+
+  private:
+    void UpdateRate(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch, bool fast_react);
+};
+
+} /* namespace ns3 */
+
+#endif /* RDMA_CONGESTION_CONTROL_H */
@@ -0,0 +1,451 @@
+#include "rdma-fluid-engine.h"
+
+#include "ppp-header.h"
+#include "qbb-header.h"
+#include "qbb-net-device.h"
+#include "qbb-remote-channel.h"
+#include "rdma-driver.h"
+#include "rdma-hw.h"
+#include "switch-node.h"
+
+#include <ns3/ipv4-header.h>
+#include <ns3/log.h>
+#include <ns3/simulator.h>
+#include <ns3/uinteger.h>
+
+#include <algorithm>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("RdmaFluidEngine");
+
+NS_OBJECT_ENSURE_REGISTERED(RdmaFluidEngine);
+
+namespace
+{
+
+const uint32_t MAX_HOPS = 64; // longer paths are a routing loop
+
+} // namespace
+
+TypeId
+RdmaFluidEngine::GetTypeId(void)
+{
+    static TypeId tid =
+        TypeId("ns3::RdmaFluidEngine")
+            .SetParent<Object>()
+            .AddConstructor<RdmaFluidEngine>()
+            .AddAttribute("IdleInterval",
+                          "Time without queueing, ECN marking or PFC pause on each port of the "
+                          "path of a QP before it can be fast forwarded.",
+                          TimeValue(MicroSeconds(10)),
+                          MakeTimeAccessor(&RdmaFluidEngine::m_idleInterval),
+                          MakeTimeChecker())
+            .AddAttribute("MinBytes",
+                          "Bytes a QP must have left to be fast forwarded.",
+                          UintegerValue(10000),
+                          MakeUintegerAccessor(&RdmaFluidEngine::m_minBytes),
+                          MakeUintegerChecker<uint64_t>(1));
+    return tid;
+}
+
+RdmaFluidEngine::RdmaFluidEngine()
+    : m_nStarted(0),
+      m_fluidPackets(0)
+{
+}
+
+bool
+RdmaFluidEngine::TryStart(RdmaHw* hw, Ptr<RdmaQueuePair> qp, Ptr<Packet> p, Time interframeGap)
+{
+    Ptr<QbbNetDevice> nic = hw->m_nic[hw->GetNicIdxOfQp(qp)].dev;
+    if (m_flows.count(PeekPointer(qp)) || !nic->m_rdmaEQ->IsOnly(qp->m_eqIdx))
+        return false; // asked again once the qp is alone, see RdmaHw::PktSentWith
+    DataRate rate = hw->m_rateBound ? qp->m_rate : qp->m_max_rate;
+    std::vector<Hop> path;
+    Ptr<RdmaHw> rxHw;
+    if (qp->GetBytesLeft() < m_minBytes || qp->nvls_enable == 1 || qp->m_win != 0 ||
+        rate != nic->GetDataRate() || !GetPath(hw, qp, path, rxHw))
+    {
+        qp->m_fluidRetry = Time::Max(); // until its rate changes, see RdmaHw::ChangeRate
+        return false;
+    }
+    // the egress ports of the path, and of the ACKs back if the receiver sends them
+    std::vector<Ptr<QbbNetDevice>> ports;
+    for (auto& h : path)
+    {
+        if (h.dev->GetDataRate() < rate)
+        { // it would queue there
+            qp->m_fluidRetry = Time::Max();
+            return false;
+        }
+        ports.push_back(h.dev);
+        if (rxHw->m_ack_interval != 0)
+            ports.push_back(h.peer);
+    }
+    Time idle = Simulator::Now();
+    for (auto& dev : ports)
+    {
+        idle = Max(idle, IdleAt(dev));
+    }
+    if (idle > Simulator::Now())
+    {
+        qp->m_fluidRetry = idle;
+        return false;
+    }
+
+    // p was a full packet, as the qp has bytes left
+    uint64_t left = qp->GetBytesLeft();
+    Flow f;
+    f.qp = qp;
+    f.hw = hw;
+    f.rxHw = rxHw;
+    f.path = path;
+    f.ports = ports;
+    f.rate = rate;
+    f.seq = qp->snd_nxt;
+    f.start = qp->m_nextAvail;
+    f.mtu = hw->m_mtu;
+    f.hdr = p->GetSize() - f.mtu;
+    f.pktTime = interframeGap + rate.CalculateBytesTxTime(f.hdr + f.mtu);
+    f.nPkts = (left + f.mtu - 1) / f.mtu;
+    uint32_t lastSize = f.hdr + (left - (uint64_t)(f.nPkts - 1) * f.mtu);
+    Time end = f.start + f.pktTime * (int64_t)(f.nPkts - 1) +
+               rate.CalculateBytesTxTime(lastSize) + interframeGap;
+    // the driver of the node only traces the send completions, skip them without a sink
+    Ptr<RdmaDriver> driver = hw->m_node->GetObject<RdmaDriver>();
+    f.notify = driver == nullptr || driver->m_rdma != hw || !driver->m_traceSendComplete.IsEmpty();
+    f.nSent = 0;
+    NS_LOG_FUNCTION(this << qp << left << f.nPkts << path.size());
+
+    // nothing left to send in packet mode
+    qp->snd_nxt = qp->m_size;
+    nic->m_rdmaEQ->UpdateQp(qp);
+    for (auto& dev : ports)
+    {
+        if (dev->m_nFluid++ == 0)
+            dev->m_fluidContendCb = MakeCallback(&RdmaFluidEngine::Contend, this);
+        m_ports[PeekPointer(dev)].push_back(PeekPointer(qp));
+    }
+    f.end = Simulator::Schedule(end - Simulator::Now(),
+                                &RdmaFluidEngine::Complete,
+                                this,
+                                PeekPointer(qp));
+    if (f.notify)
+        f.sent = Simulator::Schedule(SentAt(f, 0) - Simulator::Now(),
+                                     &RdmaFluidEngine::NotifySent,
+                                     this,
+                                     PeekPointer(qp));
+    m_flows.emplace(PeekPointer(qp), f);
+    m_nStarted++;
+    return true;
+}
+
+void
+RdmaFluidEngine::Stop(Ptr<RdmaQueuePair> qp)
+{
+    auto it = m_flows.find(PeekPointer(qp));
+    if (it == m_flows.end())
+        return;
+    Flow f = it->second;
+    Time now = Simulator::Now();
+    uint32_t n = 0; // packets which started
+    if (now >= f.start)
+    {
+        int64_t started = (now - f.start).GetTimeStep() / f.pktTime.GetTimeStep() + 1;
+        n = std::min<int64_t>(f.nPkts, started);
+    }
+    Ptr<QbbNetDevice> nic = f.path[0].dev;
+    if (n > 0) // the nic sends nothing else before the end of the packet on the wire
+        nic->m_fluidTxEnd = n == f.nPkts ? TimeStep(f.end.GetTs())
+                                             : f.start + f.pktTime * (int64_t)n;
+    if (n == f.nPkts)
+        return; // the last packet is on the wire, Complete() ends the flow
+    NS_LOG_FUNCTION(this << qp << n << f.nPkts);
+
+    // resume at packet n, when it would have started
+    Remove(PeekPointer(qp));
+    Simulator::Cancel(f.end);
+    NotifySentUntil(f, n);
+    qp->snd_nxt = f.seq + (uint64_t)n * f.mtu;
+    qp->m_ipid += n;
+    if (n > 0)
+        qp->lastPktSize = f.hdr + f.mtu;
+    qp->m_nextAvail = f.start + f.pktTime * (int64_t)n;
+    qp->m_fluidRetry = Time(0);
+    nic->m_rdmaEQ->UpdateQp(qp);
+    nic->TriggerTransmit();
+    nic->UpdateNextAvail(qp->m_nextAvail);
+    Account(f, n, (uint64_t)n * (f.hdr + f.mtu));
+    Deliver(f, n);
+}
+
+void
+RdmaFluidEngine::Contend(Ptr<QbbNetDevice> dev, Ptr<const Packet> p, Ptr<RdmaQueuePair> qp)
+{
+    auto it = m_ports.find(PeekPointer(dev));
+    if (it == m_ports.end())
+        return;
+    auto flow = qp != nullptr ? m_flows.find(PeekPointer(qp)) : m_flows.end();
+    if (flow != m_flows.end())
+    { // the flow goes on while the qp sends as it did
+        const Flow& f = flow->second;
+        DataRate rate = f.hw->m_rateBound ? qp->m_rate : qp->m_max_rate;
+        if (rate != f.rate || qp->snd_nxt != qp->m_size)
+            Stop(qp);
+        return;
+    }
+    if (qp != nullptr && (qp->GetBytesLeft() == 0 || qp->IsWinBound()))
+        return; // it cannot send
+    CustomHeader ch(CustomHeader::L2_Header | CustomHeader::L3_Header | CustomHeader::L4_Header);
+    if (p != nullptr)
+        ch.FastParse(p);
+    std::vector<RdmaQueuePair*> qps = it->second; // Stop() changes it
+    bool busy = false;
+    for (RdmaQueuePair* fluid : qps)
+    {
+        // its packets are ahead of the flow on each port, and so are their ACKs
+        if (p != nullptr && ch.l3Prot == 0x11 && ch.sip == fluid->sip.Get() &&
+            ch.dip == fluid->dip.Get() && ch.udp.sport == fluid->sport &&
+            ch.udp.dport == fluid->dport)
+            continue;
+        if (p != nullptr && (ch.l3Prot == 0xFC || ch.l3Prot == 0xFD) &&
+            ch.sip == fluid->dip.Get() && ch.dip == fluid->sip.Get() &&
+            ch.ack.sport == fluid->dport && ch.ack.dport == fluid->sport)
+            continue;
+        Stop(fluid);
+        busy = true;
+    }
+    if (busy)
+        dev->NotifyCongested(); // not idle for the flows which try again
+}
+
+bool
+RdmaFluidEngine::IsFluid(Ptr<RdmaQueuePair> qp) const
+{
+    return m_flows.count(PeekPointer(qp)) > 0;
+}
+
+uint32_t
+RdmaFluidEngine::GetNFluid(void) const
+{
+    return m_flows.size();
+}
+
+uint64_t
+RdmaFluidEngine::GetNStarted(void) const
+{
+    return m_nStarted;
+}
+
+uint64_t
+RdmaFluidEngine::GetFluidPackets(void) const
+{
+    return m_fluidPackets;
+}
+
+bool
+RdmaFluidEngine::GetPath(RdmaHw* hw,
+                         Ptr<RdmaQueuePair> qp,
+                         std::vector<Hop>& path,
+                         Ptr<RdmaHw>& rxHw) const
+{
+    Ptr<QbbNetDevice> dev = hw->m_nic[hw->GetNicIdxOfQp(qp)].dev;
+    path.push_back(Hop{dev, nullptr, nullptr, Time(0)});
+    // what the switches hash, see SwitchNode::GetOutDev
+    CustomHeader ch(CustomHeader::L2_Header | CustomHeader::L3_Header | CustomHeader::L4_Header);
+    ch.sip = qp->sip.Get();
+    ch.dip = qp->dip.Get();
+    ch.l3Prot = 0x11;
+    ch.udp.sport = qp->sport;
+    ch.udp.dport = qp->dport;
+    ch.udp.pg = qp->m_pg;
+    uint32_t dst = (ch.dip >> 8) & 0xffff; // node id, see RdmaRouteHelper::GetNodeAddress
+    for (uint32_t i = 0; i < MAX_HOPS; i++)
+    {
+        // the peer of a remote channel is simulated by another process
+        Ptr<QbbChannel> channel = DynamicCast<QbbChannel>(dev->GetChannel());
+        if (channel == nullptr || channel->GetNDevices() != 2 ||
+            DynamicCast<QbbRemoteChannel>(channel))
+            return false;
+        Ptr<QbbNetDevice> peer = channel->GetQbbDevice(0);
+        if (peer == dev)
+            peer = channel->GetQbbDevice(1);
+        path.back().peer = peer;
+        path.back().delay = channel->GetDelay();
+        Ptr<Node> node = peer->GetNode();
+        if (node->GetNodeType() == 0)
+        {
+            Ptr<RdmaDriver> driver = node->GetObject<RdmaDriver>();
+            if (node->GetId() != dst || driver == nullptr || driver->m_rdma == nullptr)
+                return false;
+            rxHw = driver->m_rdma;
+            return true;
+        }
+        if (node->GetNodeType() != 1)
+            return false; // NVSwitch
+        Ptr<SwitchNode> sw = DynamicCast<SwitchNode>(node);
+        int port = sw->GetOutPort(ch);
+        if (port < 0)
+            return false;
+        dev = DynamicCast<QbbNetDevice>(sw->GetDevice(port));
+        path.push_back(Hop{dev, sw, nullptr, Time(0)});
+    }
+    return false;
+}
+
+Time
+RdmaFluidEngine::IdleAt(Ptr<QbbNetDevice> dev) const
+{
+    if (dev->m_nFluid > 0 || !dev->IsLinkUp())
+        return Simulator::Now() + m_idleInterval; // try again then
+    return dev->GetLastCongested() + m_idleInterval;
+}
+
+void
+RdmaFluidEngine::Complete(RdmaQueuePair* qp)
+{
+    auto it = m_flows.find(qp);
+    NS_ASSERT(it != m_flows.end());
+    Flow f = it->second;
+    NS_LOG_FUNCTION(this << qp << f.nPkts);
+    Remove(qp);
+    NotifySentUntil(f, f.nPkts);
+    uint64_t left = qp->m_size - f.seq;
+    qp->m_ipid += f.nPkts;
+    qp->lastPktSize = f.hdr + (left - (uint64_t)(f.nPkts - 1) * f.mtu);
+    qp->m_nextAvail = Simulator::Now();
+    Account(f, f.nPkts, left + (uint64_t)f.nPkts * f.hdr);
+    Deliver(f, f.nPkts);
+}
+
+void
+RdmaFluidEngine::Account(Flow& f, uint32_t n, uint64_t bytes)
+{
+    if (n == 0)
+        return;
+    f.hw->UpdateTxBytes(f.path[0].dev->GetIfIndex(), bytes);
+    for (std::size_t i = 1; i < f.path.size(); i++)
+    {
+        f.path[i].sw->AddTxBytes(f.path[i].dev->GetIfIndex(), bytes);
+    }
+    m_fluidPackets += n;
+}
+
+Time
+RdmaFluidEngine::SentAt(const Flow& f, uint32_t i) const
+{
+    if (i + 1 == f.nPkts)
+        return TimeStep(f.end.GetTs());
+    return f.start + f.pktTime * (int64_t)(i + 1);
+}
+
+void
+RdmaFluidEngine::NotifySent(RdmaQueuePair* qp)
+{
+    Flow& f = m_flows.at(qp);
+    f.hw->SendComplete(f.qp);
+    if (++f.nSent < f.nPkts)
+        f.sent = Simulator::Schedule(SentAt(f, f.nSent) - Simulator::Now(),
+                                     &RdmaFluidEngine::NotifySent,
+                                     this,
+                                     qp);
+}
+
+void
+RdmaFluidEngine::NotifySentUntil(const Flow& f, uint32_t n)
+{
+    if (!f.notify)
+        return;
+    Simulator::Cancel(f.sent);
+    // the packet on the wire, and those which ended now
+    for (uint32_t i = f.nSent; i < n; i++)
+    {
+        Simulator::Schedule(Max(SentAt(f, i) - Simulator::Now(), Time(0)),
+                            &RdmaHw::SendComplete,
+                            f.hw,
+                            f.qp);
+    }
+}
+
+void
+RdmaFluidEngine::Deliver(const Flow& f, uint32_t n)
+{
+    if (n == 0)
+        return;
+    uint64_t to = std::min(f.seq + (uint64_t)n * f.mtu, f.qp->m_size);
+    uint32_t lastSize = f.hdr + (uint32_t)(to - (f.seq + (uint64_t)(n - 1) * f.mtu));
+    // the last packet, stored and forwarded by each idle port of the path
+    Time arrival = f.start + f.pktTime * (int64_t)(n - 1);
+    for (auto& h : f.path)
+    {
+        arrival += h.dev->GetDataRate().CalculateBytesTxTime(lastSize) + h.delay;
+    }
+    // its ACK, as RdmaHw::ReceiveUdp builds it, back over the same links
+    uint32_t seqSize = qbbHeader().GetSerializedSize();
+    uint32_t ackSize = std::max(60 - 14 - 20 - (int)seqSize, 0) + seqSize +
+                       Ipv4Header().GetSerializedSize() + PppHeader().GetSerializedSize();
+    Time ackDelay;
+    for (auto& h : f.path)
+    {
+        ackDelay += h.peer->GetDataRate().CalculateBytesTxTime(ackSize) + h.delay;
+    }
+    Simulator::Schedule(Max(arrival - Simulator::Now(), Time(0)),
+                        &RdmaFluidEngine::Receive,
+                        this,
+                        f,
+                        to,
+                        n,
+                        ackDelay);
+}
+
+void
+RdmaFluidEngine::Receive(const Flow& f, uint64_t to, uint32_t n, Time ackDelay)
+{
+    if (f.rxHw->m_ack_interval == 0)
+        return; // the receiver does not get packets either, see RdmaHw::Setup
+    Ptr<RdmaQueuePair> qp = f.qp;
+    Ptr<RdmaRxQueuePair> rxQp =
+        f.rxHw->GetRxQp(qp->dip.Get(), qp->sip.Get(), qp->dport, qp->sport, qp->m_pg, true);
+    rxQp->m_ecn_source.total += n;
+    rxQp->m_milestone_rx = f.rxHw->m_ack_interval;
+    if (rxQp->ReceiverNextExpectedSeq != f.seq)
+        return; // the packets before did not all arrive, packet mode recovers them
+    rxQp->ReceiverNextExpectedSeq = to;
+    Simulator::Schedule(ackDelay, &RdmaFluidEngine::Ack, this, f.hw, qp, to);
+}
+
+void
+RdmaFluidEngine::Ack(RdmaHw* hw, Ptr<RdmaQueuePair> qp, uint64_t seq)
+{
+    // as RdmaHw::ReceiveAckWith, but for the congestion control
+    if (hw->GetQp(qp->dip.Get(), qp->sport, qp->m_pg) != qp || hw->m_ack_interval == 0)
+        return; // completed meanwhile
+    Ptr<QbbNetDevice> nic = hw->m_nic[hw->GetNicIdxOfQp(qp)].dev;
+    if (hw->m_backto0)
+        seq = seq / hw->m_chunk * hw->m_chunk;
+    qp->Acknowledge(seq);
+    if (qp->IsFinished())
+        hw->QpComplete(qp);
+    nic->m_rdmaEQ->UpdateQp(qp);
+    nic->TriggerTransmit();
+}
+
+void
+RdmaFluidEngine::Remove(RdmaQueuePair* qp)
+{
+    auto it = m_flows.find(qp);
+    for (auto& dev : it->second.ports)
+    {
+        auto port = m_ports.find(PeekPointer(dev));
+        std::vector<RdmaQueuePair*>& qps = port->second;
+        qps.erase(std::find(qps.begin(), qps.end(), qp));
+        if (qps.empty())
+            m_ports.erase(port);
+        dev->m_nFluid--;
+    }
+    m_flows.erase(it);
+}
+
+} /* namespace ns3 */
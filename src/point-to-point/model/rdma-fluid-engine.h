@@ -0,0 +1,130 @@
+#ifndef RDMA_FLUID_ENGINE_H
+#define RDMA_FLUID_ENGINE_H
+
+#include <ns3/data-rate.h>
+#include <ns3/event-id.h>
+#include <ns3/nstime.h>
+#include <ns3/object.h>
+#include <ns3/packet.h>
+#include <ns3/rdma-queue-pair.h>
+
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+class QbbNetDevice;
+class RdmaHw;
+class SwitchNode;
+
+/**
+ * Hybrid flow-level mode of the QPs of uncongested paths, shared by the
+ * RdmaHw of the hosts which use it (RdmaHw::SetFluidEngine()).
+ *
+ * RdmaHw asks TryStart() whether a QP can be fast forwarded after its data
+ * packets, while it is the only active QP of its NIC and its retry time
+ * (RdmaQueuePair::m_fluidRetry) has passed. It can when it is the only QP of
+ * its NIC with bytes to send, it sends without a window at the line rate of
+ * its NIC (a QP whose congestion control lowered its rate is not fast
+ * forwarded until its rate is back), and every port of its path is at least
+ * that fast. Its ports (the NIC, then the port picked by each SwitchNode, and
+ * the ports which send its ACKs back if the receiver sends ACKs, see
+ * L2AckInterval) must also be idle: no other flow, and no queueing, ECN
+ * marking or PFC pause for IdleInterval. The rest of the QP is then a fluid
+ * flow at line rate: it sends no packet, and a single event completes it
+ * when its last packet would have left the NIC.
+ *
+ * A packet which starts on one of its ports (except the packets the QP sent
+ * before and their ACKs, still on their way), a PFC pause received by one of
+ * them, another QP of the NIC which can send, or a rate change of the QP
+ * drops the flow back to packet mode with Stop(), at the first packet which
+ * did not start. The packets the flow stood for are then accounted as sent:
+ * tx bytes of the NIC and of the switch ports. Their send completions are
+ * reported when each packet would have left the NIC, one event each, unless
+ * the SendComplete trace of the RdmaDriver of the host has no sink.
+ * When the last of them would have reached the receiver, its rx QP moves past
+ * them, and when its ACK would have come back, the QP is acknowledged, and
+ * completes if they were its last ones. The ACKs of the other packets are
+ * neither sent nor accounted, and the congestion control sees none of them.
+ *
+ * Known limitation: a NIC which also sends the ACKs of another flow is never
+ * idle, so the flows of a ring (e.g. a ring allreduce, where each host
+ * receives the chunk of its neighbour while sending its own) are not fast
+ * forwarded, and run no faster than in packet mode.
+ */
+class RdmaFluidEngine : public Object
+{
+  public:
+    static TypeId GetTypeId(void);
+    RdmaFluidEngine();
+
+    // fast forward qp of hw, which just sent the data packet p, if its path is idle
+    bool TryStart(RdmaHw* hw, Ptr<RdmaQueuePair> qp, Ptr<Packet> p, Time interframeGap);
+    void Stop(Ptr<RdmaQueuePair> qp); // back to packet mode, now
+    // a packet p starts on dev, or qp of dev was updated, or dev was paused or went down
+    // (both null): stop the flows of dev which this contends with
+    void Contend(Ptr<QbbNetDevice> dev, Ptr<const Packet> p, Ptr<RdmaQueuePair> qp);
+    bool IsFluid(Ptr<RdmaQueuePair> qp) const;
+
+    uint32_t GetNFluid(void) const;       // flows in fluid mode now
+    uint64_t GetNStarted(void) const;     // flows fast forwarded so far
+    uint64_t GetFluidPackets(void) const; // packets accounted without being sent
+
+  private:
+    struct Hop
+    {
+        Ptr<QbbNetDevice> dev;  // egress port
+        Ptr<SwitchNode> sw;     // its switch, null for the NIC
+        Ptr<QbbNetDevice> peer; // the other end of its link, which sends the ACKs back
+        Time delay;             // of its link
+    };
+
+    struct Flow
+    {
+        Ptr<RdmaQueuePair> qp;
+        RdmaHw* hw;
+        Ptr<RdmaHw> rxHw; // of the receiver
+        std::vector<Hop> path;
+        std::vector<Ptr<QbbNetDevice>> ports; // the flow contends on, see TryStart
+        DataRate rate;  // of the qp when the flow started
+        uint64_t seq;   // snd_nxt when the flow started
+        Time start;     // when its first packet starts
+        Time pktTime;   // between the starts of two full packets
+        uint32_t hdr;   // header bytes of a packet
+        uint32_t mtu;   // payload of a full packet
+        uint32_t nPkts; // packets of the flow
+        EventId end;
+        bool notify;    // whether anything sees its send completions, see NotifySent
+        uint32_t nSent; // send completions reported
+        EventId sent;   // the next one
+    };
+
+    // the path of qp to the RdmaHw of its receiver, false if it cannot be followed
+    bool GetPath(RdmaHw* hw, Ptr<RdmaQueuePair> qp, std::vector<Hop>& path, Ptr<RdmaHw>& rxHw)
+        const;
+    Time IdleAt(Ptr<QbbNetDevice> dev) const; // when dev is idle, if nothing else happens
+    Time SentAt(const Flow& f, uint32_t i) const; // end of packet i of f, as TransmitComplete
+    void NotifySent(RdmaQueuePair* qp);           // send completion of the next packet
+    // report the send completions of f left before packet n, on time
+    void NotifySentUntil(const Flow& f, uint32_t n);
+    void Complete(RdmaQueuePair* qp);
+    // account the first n packets of f as sent, of bytes in total
+    void Account(Flow& f, uint32_t n, uint64_t bytes);
+    // move the receiver and then the sender past the first n packets of f, on time
+    void Deliver(const Flow& f, uint32_t n);
+    void Receive(const Flow& f, uint64_t to, uint32_t n, Time ackDelay);
+    void Ack(RdmaHw* hw, Ptr<RdmaQueuePair> qp, uint64_t seq);
+    void Remove(RdmaQueuePair* qp);
+
+    Time m_idleInterval;
+    uint64_t m_minBytes;
+    std::unordered_map<RdmaQueuePair*, Flow> m_flows;
+    std::unordered_map<QbbNetDevice*, std::vector<RdmaQueuePair*>> m_ports; // flows per port
+    uint64_t m_nStarted;
+    uint64_t m_fluidPackets;
+};
+
+} /* namespace ns3 */
+
+#endif /* RDMA_FLUID_ENGINE_H */
@@ -0,0 +1,184 @@
+#include "rdma-header-template.h"
+
+#include "ppp-header.h"
+
+#include "ns3/assert.h"
+#include "ns3/int-header.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/node.h"
+#include "ns3/packet.h"
+#include "ns3/simple-seq-ts-header.h"
+#include "ns3/udp-header.h"
+
+namespace ns3
+{
+
+NS_OBJECT_ENSURE_REGISTERED(RdmaHeaderTemplate);
+
+RdmaHeaderTemplate::RdmaHeaderTemplate()
+    : m_seq(0),
+      m_ts(0),
+      m_ipid(0),
+      m_checksum(false)
+{
+}
+
+TypeId
+RdmaHeaderTemplate::GetTypeId(void)
+{
+    static TypeId tid = TypeId("ns3::RdmaHeaderTemplate")
+                            .SetParent<Header>()
+                            .SetGroupName("PointToPoint")
+                            .AddConstructor<RdmaHeaderTemplate>();
+    return tid;
+}
+
+TypeId
+RdmaHeaderTemplate::GetInstanceTypeId(void) const
+{
+    return GetTypeId();
+}
+
+void
+RdmaHeaderTemplate::Build(Ipv4Address sip,
+                          Ipv4Address dip,
+                          uint16_t sport,
+                          uint16_t dport,
+                          uint16_t pg,
+                          uint8_t tos)
+{
+    // same headers as the per-packet path of RdmaHw::GetNxtPacket
+    Ptr<Packet> p = Create<Packet>();
+    SimpleSeqTsHeader seqTs;
+    seqTs.SetSeq(0);
+    seqTs.SetPG(pg);
+    p->AddHeader(seqTs);
+    UdpHeader udpHeader;
+    udpHeader.SetDestinationPort(dport);
+    udpHeader.SetSourcePort(sport);
+    p->AddHeader(udpHeader);
+    Ipv4Header ipHeader;
+    ipHeader.SetSource(sip);
+    ipHeader.SetDestination(dip);
+    ipHeader.SetProtocol(0x11);
+    ipHeader.SetPayloadSize(p->GetSize());
+    ipHeader.SetTtl(64);
+    ipHeader.SetTos(tos);
+    p->AddHeader(ipHeader);
+    PppHeader ppp;
+    ppp.SetProtocol(0x0021); // EtherToPpp(0x800), see point-to-point-net-device.cc
+    p->AddHeader(ppp);
+
+    NS_ASSERT(p->GetSize() == intOffset + IntHeader::GetStaticSize());
+    m_bytes.resize(p->GetSize());
+    p->CopyData(m_bytes.data(), m_bytes.size());
+    m_checksum = Node::ChecksumEnabled(); // the one built above is zero
+}
+
+bool
+RdmaHeaderTemplate::IsBuilt(void) const
+{
+    return !m_bytes.empty();
+}
+
+void
+RdmaHeaderTemplate::SetSeq(uint64_t seq)
+{
+    m_seq = seq;
+}
+
+uint64_t
+RdmaHeaderTemplate::GetSeq(void) const
+{
+    return m_seq;
+}
+
+void
+RdmaHeaderTemplate::SetIpid(uint16_t ipid)
+{
+    m_ipid = ipid;
+}
+
+uint16_t
+RdmaHeaderTemplate::GetIpid(void) const
+{
+    return m_ipid;
+}
+
+void
+RdmaHeaderTemplate::SetTs(uint64_t ts)
+{
+    m_ts = ts;
+}
+
+void
+RdmaHeaderTemplate::Print(std::ostream& os) const
+{
+    os << "seq=" << m_seq << " ipid=" << m_ipid;
+}
+
+uint32_t
+RdmaHeaderTemplate::GetSerializedSize(void) const
+{
+    if (m_bytes.empty())
+    {
+        return intOffset + IntHeader::GetStaticSize();
+    }
+    return m_bytes.size();
+}
+
+void
+RdmaHeaderTemplate::Serialize(Buffer::Iterator start) const
+{
+    NS_ASSERT_MSG(!m_bytes.empty(), "Serializing a header template before Build()");
+    uint32_t size = start.GetSize(); // headers plus payload
+    Buffer::Iterator i = start;
+    i.Write(m_bytes.data(), m_bytes.size());
+
+    i = start;
+    i.Next(l3Offset + 2);
+    i.WriteHtonU16(size - l3Offset); // ip total length
+    i.WriteHtonU16(m_ipid);
+    if (m_checksum)
+    {
+        i = start;
+        i.Next(l3Offset);
+        uint16_t checksum = i.CalculateIpChecksum(l4Offset - l3Offset);
+        i = start;
+        i.Next(l3Offset + 10);
+        i.WriteU16(checksum);
+    }
+    i = start;
+    i.Next(l4Offset + 4);
+    i.WriteHtonU16(size - l4Offset); // udp length
+    i.Next(2);                       // udp checksum, not computed
+    i.WriteHtonU64(m_seq);
+    if (IntHeader::mode == IntHeader::TS)
+    {
+        i.Next(2); // pg
+        i.WriteU64(m_ts);
+    }
+}
+
+uint32_t
+RdmaHeaderTemplate::Deserialize(Buffer::Iterator start)
+{
+    m_bytes.resize(intOffset + IntHeader::GetStaticSize());
+    Buffer::Iterator i = start;
+    i.Read(m_bytes.data(), m_bytes.size());
+
+    i = start;
+    i.Next(l3Offset + 4);
+    m_ipid = i.ReadNtohU16();
+    i = start;
+    i.Next(seqOffset);
+    m_seq = i.ReadNtohU64();
+    if (IntHeader::mode == IntHeader::TS)
+    {
+        i.Next(2);
+        m_ts = i.ReadU64();
+    }
+    return m_bytes.size();
+}
+
+} // namespace ns3
@@ -0,0 +1,70 @@
+#ifndef RDMA_HEADER_TEMPLATE_H
+#define RDMA_HEADER_TEMPLATE_H
+
+#include <ns3/header.h>
+#include <ns3/ipv4-address.h>
+
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Pre-serialized ppp/ipv4/udp/SeqTs headers of the data packets of one qp.
+ *
+ * The bytes are built once from the real headers, so the wire format is the
+ * same as adding SimpleSeqTsHeader, UdpHeader, Ipv4Header and PppHeader one
+ * by one. Serialize() copies them in one go and patches the fields that change
+ * per packet: ip total length, ip identification, udp length, seq and, in
+ * IntHeader::TS mode, the timestamp. The lengths are taken from the size of
+ * the packet, so only seq, ipid and ts are kept here. The ip checksum is
+ * computed again after the patch if Node::ChecksumEnabled() when the template
+ * is built, and left zero otherwise, as Ipv4Header does.
+ *
+ * The packet metadata has a single entry for the four headers, so RdmaHw
+ * does not use templates while the metadata is enabled (Packet::Print(),
+ * ascii tracing).
+ */
+class RdmaHeaderTemplate : public Header
+{
+  public:
+    RdmaHeaderTemplate();
+
+    static TypeId GetTypeId(void);
+    TypeId GetInstanceTypeId(void) const override;
+
+    void Build(Ipv4Address sip,
+               Ipv4Address dip,
+               uint16_t sport,
+               uint16_t dport,
+               uint16_t pg,
+               uint8_t tos);
+    bool IsBuilt(void) const;
+
+    void SetSeq(uint64_t seq);
+    uint64_t GetSeq(void) const;
+    void SetIpid(uint16_t ipid);
+    uint16_t GetIpid(void) const;
+    void SetTs(uint64_t ts); // only written in IntHeader::TS mode
+
+    void Print(std::ostream& os) const override;
+    uint32_t GetSerializedSize(void) const override;
+    void Serialize(Buffer::Iterator start) const override;
+    uint32_t Deserialize(Buffer::Iterator start) override;
+
+  private:
+    static const uint32_t l3Offset = 2;               // ppp
+    static const uint32_t l4Offset = l3Offset + 20;   // ipv4
+    static const uint32_t seqOffset = l4Offset + 8;   // udp
+    static const uint32_t intOffset = seqOffset + 10; // seq, pg
+
+    std::vector<uint8_t> m_bytes; // headers as built, empty until Build()
+    uint64_t m_seq;
+    uint64_t m_ts;
+    uint16_t m_ipid;
+    bool m_checksum; // computed at each Serialize()
+};
+
+} // namespace ns3
+
+#endif /* RDMA_HEADER_TEMPLATE_H */
@@ -1,12 +1,18 @@
 #include "rdma-hw.h"
 
 #include "cn-header.h"
+#include "monitor-writer.h"
 #include "ppp-header.h"
 #include "qbb-header.h"
+#include "rdma-congestion-control.h"
 
+#include "ns3/abort.h"
 #include "ns3/boolean.h"
 #include "ns3/data-rate.h"
 #include "ns3/double.h"
+#include "ns3/node.h"
+#include "ns3/nstime.h"
+#include "ns3/packet-metadata.h"
 #include "ns3/pointer.h"
 #include "ns3/ppp-header.h"
 #include "ns3/uinteger.h"
@@ -54,7 +60,8 @@ RdmaHw::GetTypeId(void)
                           MakeUintegerAccessor(&RdmaHw::m_chunk),
                           MakeUintegerChecker<uint32_t>())
             .AddAttribute("L2AckInterval",
-                          "Layer 2 Ack intervals. Disable ack if equals to 0.",
+                          "Layer 2 Ack intervals. Disable ack, and the processing of the "
+                          "packets the host receives, if equals to 0.",
                           UintegerValue(0),
                           MakeUintegerAccessor(&RdmaHw::m_ack_interval),
                           MakeUintegerChecker<uint32_t>())
@@ -179,6 +186,12 @@ RdmaHw::GetTypeId(void)
                           DataRateValue(DataRate("1000Mb/s")),
                           MakeDataRateAccessor(&RdmaHw::m_dctcp_rai),
                           MakeDataRateChecker())
+            .AddAttribute("CcTimerTick",
+                          "Granularity of the congestion control timers, which expire at the "
+                          "end of their tick, 0 for exact times",
+                          TimeValue(Time(0)),
+                          MakeTimeAccessor(&RdmaHw::m_ccTimerTick),
+                          MakeTimeChecker(Time(0)))
             .AddAttribute("PintSmplThresh",
                           "PINT's sampling threshold in rand()%65536",
                           UintegerValue(65536),
@@ -198,13 +211,83 @@ RdmaHw::GetTypeId(void)
                           "NVLS enable info",
                           UintegerValue(0),
                           MakeUintegerAccessor(&RdmaHw::nvls_enable),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("HeaderTemplate",
+                          "Build data packet headers from a per-qp template, unless the "
+                          "packet metadata is enabled",
+                          BooleanValue(true),
+                          MakeBooleanAccessor(&RdmaHw::m_hdrTemplate),
+                          MakeBooleanChecker())
+            .AddAttribute("QpPoolSize",
+                          "The number of deleted qps, and of deleted rx qps, kept for reuse",
+                          UintegerValue(1024),
+                          MakeUintegerAccessor(&RdmaHw::m_qpPoolSize),
                           MakeUintegerChecker<uint32_t>());
     ;
     return tid;
 }
 
 RdmaHw::RdmaHw()
+    : m_receiveAck(nullptr),
+      m_pktSent(nullptr)
+{
+}
+
+void
+RdmaHw::SetCongestionControl(Ptr<RdmaCongestionControl> cc)
+{
+    m_cc = cc;
+    m_cc->SetHw(this);
+    // the ACK and send paths are instantiated for the built-in algorithms, whose calls
+    // are then direct; the others go through the virtual calls of the base class
+    if (DynamicCast<RdmaDcqcn>(cc))
+    {
+        SelectCc<RdmaDcqcn>();
+    }
+    else if (DynamicCast<RdmaHpcc>(cc))
+    {
+        SelectCc<RdmaHpcc>();
+    }
+    else if (DynamicCast<RdmaTimely>(cc))
+    {
+        SelectCc<RdmaTimely>();
+    }
+    else if (DynamicCast<RdmaDctcp>(cc))
+    {
+        SelectCc<RdmaDctcp>();
+    }
+    else if (DynamicCast<RdmaHpccPint>(cc))
+    {
+        SelectCc<RdmaHpccPint>();
+    }
+    else
+    {
+        SelectCc<RdmaCongestionControl>();
+    }
+}
+
+Ptr<RdmaCongestionControl>
+RdmaHw::GetCongestionControl(void) const
 {
+    return m_cc;
+}
+
+void
+RdmaHw::SetFluidEngine(Ptr<RdmaFluidEngine> fluid)
+{
+#ifdef NS3_MTP
+    // the engine follows and stops flows on every port of their path, across the LPs
+    NS_ABORT_MSG_IF(fluid && MtpInterface::IsEnabled(), "RdmaFluidEngine does not support MTP");
+#endif
+    m_fluid = fluid;
+}
+
+template <typename Cc>
+void
+RdmaHw::SelectCc(void)
+{
+    m_receiveAck = &RdmaHw::ReceiveAckWith<Cc>;
+    m_pktSent = &RdmaHw::PktSentWith<Cc>;
 }
 
 void
@@ -234,6 +317,10 @@ RdmaHw::SetNode(Ptr<Node> node)
 void
 RdmaHw::Setup(QpCompleteCallback cb, SendCompleteCallback send_cb)
 {
+    if (!m_cc)
+    {
+        SetCongestionControl(RdmaCongestionControl::CreateForMode(m_cc_mode));
+    }
     tx_bytes.resize(m_nic.size());
     last_tx_bytes.resize(m_nic.size());
     for (uint32_t i = 0; i < m_nic.size(); i++)
@@ -245,14 +332,17 @@ RdmaHw::Setup(QpCompleteCallback cb, SendCompleteCallback send_cb)
             continue;
         // share data with NIC
         dev->m_rdmaEQ->m_qpGrp = m_nic[i].qpGrp;
-        // setup callback
-        dev->m_rdmaReceiveCb = MakeCallback(&RdmaHw::Receive, this);
-        dev->m_rdmaSentCb = MakeCallback(&RdmaHw::SendPacketComplete, this);
+        // setup callback; without ACKs the host keeps nothing of what it receives, and
+        // nothing would free its rx qps
+        if (m_ack_interval != 0)
+            dev->m_rdmaReceiveCb = MakeCallback(&RdmaHw::Receive, this);
+        dev->m_rdmaSentCb = MakeCallback(&RdmaHw::SendComplete, this);
         dev->m_rdmaLinkDownCb = MakeCallback(&RdmaHw::SetLinkDown, this);
         dev->m_rdmaPktSent = MakeCallback(&RdmaHw::PktSent, this);
         dev->m_rdmaUpdateTxBytes = MakeCallback(&RdmaHw::UpdateTxBytes, this);
         // config NIC
         dev->m_rdmaEQ->m_rdmaGetNxtPkt = MakeCallback(&RdmaHw::GetNxtPacket, this);
+        dev->m_rdmaEQ->m_rdmaQpDropped = MakeCallback(&RdmaHw::QpDropped, this);
     }
     // setup qp complete callback
     m_qpCompleteCallback = cb;
@@ -267,16 +357,23 @@ ip_to_node_id(Ipv4Address ip)
 
 uint32_t
 RdmaHw::GetNicIdxOfQp(Ptr<RdmaQueuePair> qp)
+{
+    if (qp->m_nicIdx == (uint32_t)-1)
+        qp->m_nicIdx = LookupNicIdxOfQp(qp);
+    return qp->m_nicIdx;
+}
+
+uint32_t
+RdmaHw::LookupNicIdxOfQp(Ptr<RdmaQueuePair> qp)
 {
     uint32_t src = qp->m_src;
     uint32_t dst = qp->m_dest;
-    if (src / m_gpus_per_server == dst / m_gpus_per_server ||
-        m_rtTable_nxthop_nvswitch.count(qp->dip.Get()) != 0)
+    const std::vector<int>* nvswitch = m_rtTable_nxthop_nvswitch.Lookup(qp->dip.Get());
+    if (src / m_gpus_per_server == dst / m_gpus_per_server || nvswitch)
     { // src and dst are in the same server, communicate through nvswitch
-        auto& v = m_rtTable_nxthop_nvswitch[qp->dip.Get()];
-        if (v.size() > 0)
+        if (nvswitch)
         {
-            return v[qp->GetHash() % v.size()];
+            return (*nvswitch)[qp->GetHash() % nvswitch->size()];
         }
         else
         {
@@ -285,10 +382,10 @@ RdmaHw::GetNicIdxOfQp(Ptr<RdmaQueuePair> qp)
     }
     else
     { // src and dst don't in the same server, communicate through swicth
-        auto& v = m_rtTable[qp->dip.Get()];
-        if (v.size() > 0)
+        const std::vector<int>* v = m_rtTable.Lookup(qp->dip.Get());
+        if (v)
         {
-            return v[qp->GetHash() % v.size()];
+            return (*v)[qp->GetHash() % v->size()];
         }
         else
         {
@@ -329,7 +426,7 @@ RdmaHw::AddQueuePair(uint32_t src,
                      Callback<void> notifyAppSent)
 {
     // create qp
-    Ptr<RdmaQueuePair> qp = CreateObject<RdmaQueuePair>(pg, sip, dip, sport, dport);
+    Ptr<RdmaQueuePair> qp = AllocQp(pg, sip, dip, sport, dport);
     qp->SetSrc(src);
     qp->SetDest(dest);
     qp->SetTag(tag);
@@ -347,36 +444,18 @@ RdmaHw::AddQueuePair(uint32_t src,
     // the m_nic size is: " << m_nic.size() << std::endl; Assign the qp to specific qbbnetdevice
     m_nic[nic_idx].qpGrp->AddQp(qp);
     uint64_t key = GetQpKey(dip.Get(), sport, pg);
-    m_qpMap[key] = qp;
-    qp_cnp[key] = 0;
-    last_qp_cnp[key] = 0;
-    last_qp_rate[key] = 0;
+    Ptr<RdmaQueuePair>& slot = m_qpMap[key];
+    if (slot != nullptr)
+        RemoveFromQpList(slot); // replaced
+    slot = qp;
+    qp->m_hwIdx = m_qpList.size();
+    m_qpList.push_back(qp);
 
     // set init variables
     DataRate m_bps = m_nic[nic_idx].dev->GetDataRate();
     qp->m_rate = m_bps;
     qp->m_max_rate = m_bps;
-    if (m_cc_mode == 1)
-    {
-        qp->mlx.m_targetRate = m_bps;
-    }
-    else if (m_cc_mode == 3)
-    {
-        qp->hp.m_curRate = m_bps;
-        if (m_multipleRate)
-        {
-            for (uint32_t i = 0; i < IntHeader::maxHop; i++)
-                qp->hp.hopState[i].Rc = m_bps;
-        }
-    }
-    else if (m_cc_mode == 7)
-    {
-        qp->tmly.m_curRate = m_bps;
-    }
-    else if (m_cc_mode == 10)
-    {
-        qp->hpccPint.m_curRate = m_bps;
-    }
+    m_cc->InitQp(qp, m_bps);
     // NVLS settings
     if (nvls_enable == 1)
         qp->nvls_enable = 1;
@@ -391,10 +470,49 @@ RdmaHw::DeleteQueuePair(Ptr<RdmaQueuePair> qp)
 {
     // remove qp from the m_qpMap
     uint64_t key = GetQpKey(qp->dip.Get(), qp->sport, qp->m_pg);
-    m_qpMap.erase(key);
-    qp_cnp.erase(key);
-    last_qp_cnp.erase(key);
-    last_qp_rate.erase(key);
+    auto it = m_qpMap.find(key);
+    if (it == m_qpMap.end() || it->second != qp)
+        return; // already deleted
+    m_qpMap.erase(it);
+    RemoveFromQpList(qp);
+}
+
+void
+RdmaHw::QpDropped(Ptr<RdmaQueuePair> qp)
+{
+    if (qp->m_hwIdx != (uint32_t)-1 || m_qpPool.size() >= m_qpPoolSize)
+        return; // still in use, or enough kept
+    m_qpPool.push_back(qp);
+}
+
+void
+RdmaHw::RemoveFromQpList(Ptr<RdmaQueuePair> qp)
+{
+    // swap with the last one
+    Ptr<RdmaQueuePair> last = m_qpList.back();
+    m_qpList[qp->m_hwIdx] = last;
+    last->m_hwIdx = qp->m_hwIdx;
+    m_qpList.pop_back();
+    qp->m_hwIdx = -1;
+}
+
+Ptr<RdmaQueuePair>
+RdmaHw::AllocQp(uint16_t pg, Ipv4Address sip, Ipv4Address dip, uint16_t sport, uint16_t dport)
+{
+    // the device of the last packet, the apps or a pending timer may still
+    // hold a pooled qp, try a few of them and move the busy ones to the back
+    for (uint32_t i = 0; i < 4 && !m_qpPool.empty(); i++)
+    {
+        Ptr<RdmaQueuePair> qp = m_qpPool.front();
+        m_qpPool.pop_front();
+        if (qp->GetReferenceCount() == 1) // only qp
+        {
+            qp->Reset(pg, sip, dip, sport, dport);
+            return qp;
+        }
+        m_qpPool.push_back(qp);
+    }
+    return CreateObject<RdmaQueuePair>(pg, sip, dip, sport, dport);
 }
 
 Ptr<RdmaRxQueuePair>
@@ -417,8 +535,18 @@ RdmaHw::GetRxQp(uint32_t sip,
         }
         if (create)
         {
-            // create new rx qp
-            Ptr<RdmaRxQueuePair> q = CreateObject<RdmaRxQueuePair>();
+            // create new rx qp, or reuse a deleted one
+            Ptr<RdmaRxQueuePair> q;
+            if (m_rxQpPool.empty())
+            {
+                q = Create<RdmaRxQueuePair>();
+            }
+            else
+            {
+                q = m_rxQpPool.back();
+                m_rxQpPool.pop_back();
+                q->Reset();
+            }
             // init the qp
             q->sip = sip;
             q->dip = dip;
@@ -441,21 +569,13 @@ RdmaHw::GetNicIdxOfRxQp(Ptr<RdmaRxQueuePair> q)
     // BUG就出现在这里了，首先要判断m_rtTable[q->dip]是否存在，若不存在就去判断m_rtTable_nxthop_nvswitch是否存在，如果都不存在，那么就输出错误
     // auto &v = m_rtTable[q->dip];
 
-    if (m_rtTable.count(q->dip) != 0)
+    if (const std::vector<int>* v = m_rtTable.Lookup(q->dip))
     {
-        auto& v = m_rtTable[q->dip];
-        if (v.size() > 0)
-            return v[q->GetHash() % v.size()];
-        else
-            NS_ASSERT_MSG(false, "We assume at least one NIC is alive");
+        return (*v)[q->GetHash() % v->size()];
     }
-    else if (m_rtTable_nxthop_nvswitch.count(q->dip) != 0)
+    else if (const std::vector<int>* v = m_rtTable_nxthop_nvswitch.Lookup(q->dip))
     {
-        auto& v = m_rtTable_nxthop_nvswitch[q->dip];
-        if (v.size() > 0)
-            return v[q->GetHash() % v.size()];
-        else
-            NS_ASSERT_MSG(false, "We assume at least one NIC is alive");
+        return (*v)[q->GetHash() % v->size()];
     }
     else
     {
@@ -468,26 +588,14 @@ void
 RdmaHw::DeleteRxQp(uint32_t dip, uint16_t pg, uint16_t dport)
 {
     uint64_t key = ((uint64_t)dip << 32) | ((uint64_t)pg << 16) | (uint64_t)dport;
-    m_rxQpMap.erase(key);
-}
-
-int
-RdmaHw::SendPacketComplete(Ptr<Packet> p, CustomHeader& ch)
-{
-    uint16_t qIndex = ch.udp.pg;
-    uint16_t port = ch.udp.sport;
-    // uint32_t seq = ch.udp.seq;
-    // uint8_t cnp = (ch.flags >> qbbHeader::FLAG_CNP) & 1;
-    // int i;
-    Ptr<RdmaQueuePair> qp = GetQp(ch.dip, port, qIndex);
-    if (qp == nullptr)
-    {
-        return 0;
-    }
-    uint32_t nic_idx = GetNicIdxOfQp(qp);
-    Ptr<QbbNetDevice> dev = m_nic[nic_idx].dev;
-    SendComplete(qp);
-    return 0;
+    auto it = m_rxQpMap.find(key);
+    if (it == m_rxQpMap.end())
+        return;
+    Ptr<RdmaRxQueuePair> q = it->second;
+    m_rxQpMap.erase(it);
+    Simulator::Cancel(q->QcnTimerEvent);
+    if (q->GetReferenceCount() == 1 && m_rxQpPool.size() < m_qpPoolSize) // nothing else holds it
+        m_rxQpPool.push_back(q);
 }
 
 void
@@ -589,27 +697,7 @@ RdmaHw::ReceiveCnp(Ptr<Packet> p, CustomHeader& ch)
     if (qp->m_rate == 0) // lazy initialization
     {
         qp->m_rate = dev->GetDataRate();
-        if (m_cc_mode == 1)
-        {
-            qp->mlx.m_targetRate = dev->GetDataRate();
-        }
-        else if (m_cc_mode == 3)
-        {
-            qp->hp.m_curRate = dev->GetDataRate();
-            if (m_multipleRate)
-            {
-                for (uint32_t i = 0; i < IntHeader::maxHop; i++)
-                    qp->hp.hopState[i].Rc = dev->GetDataRate();
-            }
-        }
-        else if (m_cc_mode == 7)
-        {
-            qp->tmly.m_curRate = dev->GetDataRate();
-        }
-        else if (m_cc_mode == 10)
-        {
-            qp->hpccPint.m_curRate = dev->GetDataRate();
-        }
+        m_cc->SetLineRate(qp, dev->GetDataRate());
     }
     return 0;
 }
@@ -617,6 +705,14 @@ RdmaHw::ReceiveCnp(Ptr<Packet> p, CustomHeader& ch)
 int
 RdmaHw::ReceiveAck(Ptr<Packet> p, CustomHeader& ch)
 {
+    return (this->*m_receiveAck)(p, ch);
+}
+
+template <typename Cc>
+int
+RdmaHw::ReceiveAckWith(Ptr<Packet> p, CustomHeader& ch)
+{
+    Cc* cc = static_cast<Cc*>(PeekPointer(m_cc));
     uint16_t qIndex = ch.ack.pg;
     uint16_t port = ch.ack.dport;
     uint64_t seq = ch.ack.seq;
@@ -655,30 +751,12 @@ RdmaHw::ReceiveAck(Ptr<Packet> p, CustomHeader& ch)
     // handle cnp
     if (cnp)
     {
-        uint64_t key = GetQpKey(qp->dip.Get(), qp->sport, qp->m_pg);
-        qp_cnp[key]++; // update for the number of cnp this qp has received
-        if (m_cc_mode == 1)
-        { // mlx version
-            cnp_received_mlx(qp);
-        }
-    }
-
-    if (m_cc_mode == 3)
-    {
-        HandleAckHp(qp, p, ch);
-    }
-    else if (m_cc_mode == 7)
-    {
-        HandleAckTimely(qp, p, ch);
-    }
-    else if (m_cc_mode == 8)
-    {
-        HandleAckDctcp(qp, p, ch);
-    }
-    else if (m_cc_mode == 10)
-    {
-        HandleAckHpPint(qp, p, ch);
+        qp->m_cnpCount++; // update for the number of cnp this qp has received
+        cc->OnCnp(qp);
     }
+    cc->OnAck(qp, p, ch);
+    // snd_una, window and rate may all have changed
+    dev->m_rdmaEQ->UpdateQp(qp);
     // uint32_t sip = ch.sip;
     // uint32_t sid = (sip >> 8) & 0xffff;
     uint32_t dip = ch.dip;
@@ -695,6 +773,7 @@ RdmaHw::ReceiveAck(Ptr<Packet> p, CustomHeader& ch)
 int
 RdmaHw::Receive(Ptr<Packet> p, CustomHeader& ch)
 {
+    ch.ParseInt(p); // the device only parses the forwarding fields
     if (ch.l3Prot == 0x11)
     { // UDP
         ReceiveUdp(p, ch);
@@ -785,24 +864,22 @@ void
 RdmaHw::RecoverQueue(Ptr<RdmaQueuePair> qp)
 {
     qp->snd_nxt = qp->snd_una;
+    uint32_t nic_idx = GetNicIdxOfQp(qp);
+    m_nic[nic_idx].dev->m_rdmaEQ->UpdateQp(qp);
 }
 
 void
 RdmaHw::QpComplete(Ptr<RdmaQueuePair> qp)
 {
     NS_ASSERT(!m_qpCompleteCallback.IsNull());
-    if (m_cc_mode == 1)
-    {
-        Simulator::Cancel(qp->mlx.m_eventUpdateAlpha);
-        Simulator::Cancel(qp->mlx.m_eventDecreaseRate);
-        Simulator::Cancel(qp->mlx.m_rpTimer);
-    }
+    m_cc->TeardownQp(qp);
 
     // This callback will log info
     // It may also delete the rxQp on the receiver
     m_qpCompleteCallback(qp);
 
-    qp->m_notifyAppFinish();
+    if (!qp->m_notifyAppFinish.IsNull())
+        qp->m_notifyAppFinish();
 
     // delete the qp
     DeleteQueuePair(qp);
@@ -812,6 +889,14 @@ void
 RdmaHw::SetLinkDown(Ptr<QbbNetDevice> dev)
 {
     printf("RdmaHw: node:%u a link down\n", m_node->GetId());
+    InvalidateNicIdx();
+}
+
+void
+RdmaHw::InvalidateNicIdx()
+{
+    for (auto& it : m_qpMap)
+        it.second->m_nicIdx = -1;
 }
 
 void
@@ -819,28 +904,30 @@ RdmaHw::AddTableEntry(Ipv4Address& dstAddr, uint32_t intf_idx, bool is_nvswitch)
 {
     uint32_t dip = dstAddr.Get();
     if (is_nvswitch == false)
-        m_rtTable[dip].push_back(intf_idx);
+        m_rtTable.AddEntry(dip, intf_idx);
     else
     {
-        m_rtTable_nxthop_nvswitch[dip].push_back(intf_idx);
+        m_rtTable_nxthop_nvswitch.AddEntry(dip, intf_idx);
     }
 }
 
 void
 RdmaHw::ClearTable()
 {
-    m_rtTable.clear();
-    m_rtTable_nxthop_nvswitch.clear();
+    m_rtTable.Clear();
+    m_rtTable_nxthop_nvswitch.Clear();
 }
 
 void
 RdmaHw::RedistributeQp()
 {
-    // clear old qpGrp
+    // clear old qpGrp, the deleted qps go to the pool
     for (uint32_t i = 0; i < m_nic.size(); i++)
     {
         if (m_nic[i].dev == nullptr)
             continue;
+        for (Ptr<RdmaQueuePair>& qp : m_nic[i].qpGrp->m_qps)
+            QpDropped(qp);
         m_nic[i].qpGrp->Clear();
     }
 
@@ -848,7 +935,8 @@ RdmaHw::RedistributeQp()
     for (auto& it : m_qpMap)
     {
         Ptr<RdmaQueuePair> qp = it.second;
-        uint32_t nic_idx = GetNicIdxOfQp(qp);
+        qp->m_nicIdx = LookupNicIdxOfQp(qp); // the routing table may have changed
+        uint32_t nic_idx = qp->m_nicIdx;
         m_nic[nic_idx].qpGrp->AddQp(qp);
         // Notify Nic
         m_nic[nic_idx].dev->ReassignedQp(qp);
@@ -862,6 +950,39 @@ RdmaHw::GetNxtPacket(Ptr<RdmaQueuePair> qp)
     if ((uint64_t)m_mtu < payload_size)
         payload_size = m_mtu;
     Ptr<Packet> p = Create<Packet>((uint32_t)payload_size);
+    if (m_hdrTemplate && !PacketMetadata::IsEnabled())
+    {
+        RdmaHeaderTemplate& hdr = qp->m_hdrTemplate;
+        if (!hdr.IsBuilt())
+        {
+            // nvls <-> ToS, ToS = 1 -> NVLS enable
+            uint8_t tos = qp->nvls_enable == 1 ? 4 : 0;
+            hdr.Build(qp->sip, qp->dip, qp->sport, qp->dport, qp->m_pg, tos);
+        }
+        hdr.SetSeq(qp->snd_nxt);
+        hdr.SetIpid(qp->m_ipid);
+        if (IntHeader::mode == IntHeader::TS)
+            hdr.SetTs(Simulator::Now().GetTimeStep());
+        p->AddHeader(hdr);
+    }
+    else
+    {
+        AddDataHeaders(qp, p);
+    }
+
+    // update state
+    qp->snd_nxt += payload_size;
+    // std::cout << "current snd_nxt is: " << qp->snd_nxt << ", the window is: " << qp->m_win <<
+    // std::endl;
+    qp->m_ipid++;
+
+    // return
+    return p;
+}
+
+void
+RdmaHw::AddDataHeaders(Ptr<RdmaQueuePair> qp, Ptr<Packet> p)
+{
     // add SimpleSeqTsHeader
     SimpleSeqTsHeader seqTs;
     seqTs.SetSeq(qp->snd_nxt);
@@ -885,27 +1006,31 @@ RdmaHw::GetNxtPacket(Ptr<RdmaQueuePair> qp)
     else
         ipHeader.SetTos(0);
     ipHeader.SetIdentification(qp->m_ipid);
+    if (Node::ChecksumEnabled())
+        ipHeader.EnableChecksum();
     p->AddHeader(ipHeader);
     // add ppp header
     PppHeader ppp;
     ppp.SetProtocol(0x0021); // EtherToPpp(0x800), see point-to-point-net-device.cc
     p->AddHeader(ppp);
-
-    // update state
-    qp->snd_nxt += payload_size;
-    // std::cout << "current snd_nxt is: " << qp->snd_nxt << ", the window is: " << qp->m_win <<
-    // std::endl;
-    qp->m_ipid++;
-
-    // return
-    return p;
 }
 
 void
 RdmaHw::PktSent(Ptr<RdmaQueuePair> qp, Ptr<Packet> pkt, Time interframeGap)
+{
+    (this->*m_pktSent)(qp, pkt, interframeGap);
+}
+
+template <typename Cc>
+void
+RdmaHw::PktSentWith(Ptr<RdmaQueuePair> qp, Ptr<Packet> pkt, Time interframeGap)
 {
     qp->lastPktSize = pkt->GetSize();
+    static_cast<Cc*>(PeekPointer(m_cc))->OnSend(qp, pkt);
     UpdateNextAvail(qp, interframeGap, pkt->GetSize());
+    if (m_fluid && qp->m_fluidRetry <= Simulator::Now() &&
+        m_nic[GetNicIdxOfQp(qp)].dev->m_rdmaEQ->GetNActive() <= 1)
+        m_fluid->TryStart(this, qp, pkt, interframeGap);
 }
 
 void
@@ -933,6 +1058,9 @@ RdmaHw::ChangeRate(Ptr<RdmaQueuePair> qp, DataRate new_rate)
 
     // change to new rate
     qp->m_rate = new_rate;
+    qp->m_fluidRetry = Time(0); // it may be fast forwarded at its new rate
+    // m_nextAvail moved, and a variable window follows the rate
+    m_nic[nic_idx].dev->m_rdmaEQ->UpdateQp(qp);
 }
 
 /**
@@ -959,13 +1087,12 @@ RdmaHw::PrintHostBW(FILE* bw_output, uint32_t bw_mon_interval)
         }
         double bw = (tx_bytes[i] - last_tx_bytes[i]) * 8 * 1e6 / (bw_mon_interval); // bit/s
         bw = bw * 1.0 / 1e9;                                                        // Gbps
-        fprintf(bw_output,
-                "%lu, %u, %lu, %f\n",
-                Simulator::Now().GetTimeStep(),
-                m_node->GetId(),
-                i,
-                bw);
-        fflush(bw_output);
+        MonitorWriter::WriteBw(bw_output,
+                               MonitorWriter::HOST_BW,
+                               Simulator::Now().GetTimeStep(),
+                               m_node->GetId(),
+                               i,
+                               bw);
         last_tx_bytes[i] = tx_bytes[i];
     }
 }
@@ -977,26 +1104,22 @@ RdmaHw::PrintHostBW(FILE* bw_output, uint32_t bw_mon_interval)
 void
 RdmaHw::PrintQPRate(FILE* rate_output)
 {
-    std::unordered_map<uint64_t, Ptr<RdmaQueuePair>>::iterator it = m_qpMap.begin();
-    for (; it != m_qpMap.end(); it++)
+    for (const Ptr<RdmaQueuePair>& qp : m_qpList)
     {
-        Ptr<RdmaQueuePair> qp = it->second;
-        uint64_t key = it->first;
-        if (qp->m_rate.GetBitRate() == last_qp_rate[key])
+        if (qp->m_rate.GetBitRate() == qp->m_lastRate)
         {
             continue;
         }
-        fprintf(rate_output,
-                "%lu, %u, %u, %u, %u, %lu, %lu\n",
-                Simulator::Now().GetTimeStep(),
-                qp->m_src,
-                qp->m_dest,
-                qp->sport,
-                qp->dport,
-                qp->m_size,
-                qp->m_rate.GetBitRate());
-        fflush(rate_output);
-        last_qp_rate[key] = qp->m_rate.GetBitRate();
+        MonitorWriter::WriteQp(rate_output,
+                               MonitorWriter::QP_RATE,
+                               Simulator::Now().GetTimeStep(),
+                               qp->m_src,
+                               qp->m_dest,
+                               qp->sport,
+                               qp->dport,
+                               qp->m_size,
+                               qp->m_rate.GetBitRate());
+        qp->m_lastRate = qp->m_rate.GetBitRate();
     }
 }
 
@@ -1007,770 +1130,28 @@ RdmaHw::PrintQPRate(FILE* rate_output)
 void
 RdmaHw::PrintQPCnpNumber(FILE* cnp_output)
 {
-    std::unordered_map<uint64_t, Ptr<RdmaQueuePair>>::iterator it = m_qpMap.begin();
-    for (; it != m_qpMap.end(); it++)
+    for (const Ptr<RdmaQueuePair>& qp : m_qpList)
     {
-        Ptr<RdmaQueuePair> qp = it->second;
-        uint64_t key = it->first;
-        if (qp_cnp[key] != last_qp_cnp[key])
+        if (qp->m_cnpCount != qp->m_lastCnpCount)
         {
-            fprintf(cnp_output,
-                    "%lu, %u, %u, %u, %u, %lu, %u\n",
-                    Simulator::Now().GetTimeStep(),
-                    qp->m_src,
-                    qp->m_dest,
-                    qp->sport,
-                    qp->dport,
-                    qp->m_size,
-                    qp_cnp[key]);
-            fflush(cnp_output);
-            last_qp_cnp[key] = qp_cnp[key];
+            MonitorWriter::WriteQp(cnp_output,
+                                   MonitorWriter::QP_CNP,
+                                   Simulator::Now().GetTimeStep(),
+                                   qp->m_src,
+                                   qp->m_dest,
+                                   qp->sport,
+                                   qp->dport,
+                                   qp->m_size,
+                                   qp->m_cnpCount);
+            qp->m_lastCnpCount = qp->m_cnpCount;
         }
     }
 }
 
-#define PRINT_LOG 0
-
-/******************************
- * Mellanox's version of DCQCN
- *****************************/
-void
-RdmaHw::UpdateAlphaMlx(Ptr<RdmaQueuePair> q)
-{
-#if PRINT_LOG
-// printf("%lu alpha update: %08x %08x %u %u %.6lf->", Simulator::Now().GetTimeStep(), q->sip.Get(),
-// q->dip.Get(), q->sport, q->dport, q->mlx.m_alpha);
-#endif
-    if (q->mlx.m_alpha_cnp_arrived)
-    {
-        q->mlx.m_alpha = (1 - m_g) * q->mlx.m_alpha + m_g; // binary feedback
-    }
-    else
-    {
-        q->mlx.m_alpha = (1 - m_g) * q->mlx.m_alpha; // binary feedback
-    }
-#if PRINT_LOG
-// printf("%.6lf\n", q->mlx.m_alpha);
-#endif
-    q->mlx.m_alpha_cnp_arrived = false; // clear the CNP_arrived bit
-    ScheduleUpdateAlphaMlx(q);
-}
-
-void
-RdmaHw::ScheduleUpdateAlphaMlx(Ptr<RdmaQueuePair> q)
-{
-    q->mlx.m_eventUpdateAlpha = Simulator::Schedule(MicroSeconds(m_alpha_resume_interval),
-                                                    &RdmaHw::UpdateAlphaMlx,
-                                                    this,
-                                                    q);
-}
-
-void
-RdmaHw::cnp_received_mlx(Ptr<RdmaQueuePair> q)
-{
-    q->mlx.m_alpha_cnp_arrived = true;    // set CNP_arrived bit for alpha update
-    q->mlx.m_decrease_cnp_arrived = true; // set CNP_arrived bit for rate decrease
-    if (q->mlx.m_first_cnp)
-    {
-        // init alpha
-        q->mlx.m_alpha = 1;
-        q->mlx.m_alpha_cnp_arrived = false;
-        // schedule alpha update
-        ScheduleUpdateAlphaMlx(q);
-        // schedule rate decrease
-        ScheduleDecreaseRateMlx(q, 1); // add 1 ns to make sure rate decrease is after alpha update
-        // set rate on first CNP
-        double bps = m_rateOnFirstCNP * q->m_rate.GetBitRate();
-        q->mlx.m_targetRate = q->m_rate = DataRate((uint64_t)bps);
-        q->mlx.m_first_cnp = false;
-    }
-}
-
-void
-RdmaHw::CheckRateDecreaseMlx(Ptr<RdmaQueuePair> q)
-{
-    ScheduleDecreaseRateMlx(q, 0);
-    if (q->mlx.m_decrease_cnp_arrived)
-    {
-#if PRINT_LOG
-        printf("%lu rate dec: %08x %08x %u %u (%0.3lf %.3lf)->",
-               Simulator::Now().GetTimeStep(),
-               q->sip.Get(),
-               q->dip.Get(),
-               q->sport,
-               q->dport,
-               q->mlx.m_targetRate.GetBitRate() * 1e-9,
-               q->m_rate.GetBitRate() * 1e-9);
-#endif
-        bool clamp = true;
-        if (!m_EcnClampTgtRate)
-        {
-            if (q->mlx.m_rpTimeStage == 0)
-                clamp = false;
-        }
-        if (clamp)
-            q->mlx.m_targetRate = q->m_rate;
-        q->m_rate = std::max(m_minRate, q->m_rate * (1 - q->mlx.m_alpha / 2));
-        // reset rate increase related things
-        q->mlx.m_rpTimeStage = 0;
-        q->mlx.m_decrease_cnp_arrived = false;
-        Simulator::Cancel(q->mlx.m_rpTimer);
-        q->mlx.m_rpTimer = Simulator::Schedule(MicroSeconds(m_rpgTimeReset),
-                                               &RdmaHw::RateIncEventTimerMlx,
-                                               this,
-                                               q);
-#if PRINT_LOG
-        printf("(%.3lf %.3lf)\n",
-               q->mlx.m_targetRate.GetBitRate() * 1e-9,
-               q->m_rate.GetBitRate() * 1e-9);
-#endif
-    }
-}
-
-void
-RdmaHw::ScheduleDecreaseRateMlx(Ptr<RdmaQueuePair> q, uint32_t delta)
-{
-    q->mlx.m_eventDecreaseRate =
-        Simulator::Schedule(MicroSeconds(m_rateDecreaseInterval) + NanoSeconds(delta),
-                            &RdmaHw::CheckRateDecreaseMlx,
-                            this,
-                            q);
-}
-
-void
-RdmaHw::RateIncEventTimerMlx(Ptr<RdmaQueuePair> q)
-{
-    q->mlx.m_rpTimer =
-        Simulator::Schedule(MicroSeconds(m_rpgTimeReset), &RdmaHw::RateIncEventTimerMlx, this, q);
-    RateIncEventMlx(q);
-    q->mlx.m_rpTimeStage++;
-}
-
-void
-RdmaHw::RateIncEventMlx(Ptr<RdmaQueuePair> q)
-{
-    // check which increase phase: fast recovery, active increase, hyper increase
-    if (q->mlx.m_rpTimeStage < m_rpgThreshold)
-    { // fast recovery
-        FastRecoveryMlx(q);
-    }
-    else if (q->mlx.m_rpTimeStage == m_rpgThreshold)
-    { // active increase
-        ActiveIncreaseMlx(q);
-    }
-    else
-    { // hyper increase
-        HyperIncreaseMlx(q);
-    }
-}
-
-void
-RdmaHw::FastRecoveryMlx(Ptr<RdmaQueuePair> q)
-{
-#if PRINT_LOG
-    printf("%lu fast recovery: %08x %08x %u %u (%0.3lf %.3lf)->",
-           Simulator::Now().GetTimeStep(),
-           q->sip.Get(),
-           q->dip.Get(),
-           q->sport,
-           q->dport,
-           q->mlx.m_targetRate.GetBitRate() * 1e-9,
-           q->m_rate.GetBitRate() * 1e-9);
-#endif
-    double bps = (q->m_rate.GetBitRate() / 2) + (q->mlx.m_targetRate.GetBitRate() / 2);
-    q->m_rate = DataRate((uint64_t)bps);
-#if PRINT_LOG
-    printf("(%.3lf %.3lf)\n",
-           q->mlx.m_targetRate.GetBitRate() * 1e-9,
-           q->m_rate.GetBitRate() * 1e-9);
-#endif
-}
-
-void
-RdmaHw::ActiveIncreaseMlx(Ptr<RdmaQueuePair> q)
-{
-#if PRINT_LOG
-    printf("%lu active inc: %08x %08x %u %u (%0.3lf %.3lf)->",
-           Simulator::Now().GetTimeStep(),
-           q->sip.Get(),
-           q->dip.Get(),
-           q->sport,
-           q->dport,
-           q->mlx.m_targetRate.GetBitRate() * 1e-9,
-           q->m_rate.GetBitRate() * 1e-9);
-#endif
-    // get NIC
-    uint32_t nic_idx = GetNicIdxOfQp(q);
-    Ptr<QbbNetDevice> dev = m_nic[nic_idx].dev;
-    // increate rate
-    q->mlx.m_targetRate += m_rai;
-    if (q->mlx.m_targetRate > dev->GetDataRate())
-        q->mlx.m_targetRate = dev->GetDataRate();
-    double bps = (q->m_rate.GetBitRate() / 2) + (q->mlx.m_targetRate.GetBitRate() / 2);
-    q->m_rate = DataRate((uint64_t)bps);
-#if PRINT_LOG
-    printf("(%.3lf %.3lf)\n",
-           q->mlx.m_targetRate.GetBitRate() * 1e-9,
-           q->m_rate.GetBitRate() * 1e-9);
-#endif
-}
-
-void
-RdmaHw::HyperIncreaseMlx(Ptr<RdmaQueuePair> q)
-{
-#if PRINT_LOG
-    printf("%lu hyper inc: %08x %08x %u %u (%0.3lf %.3lf)->",
-           Simulator::Now().GetTimeStep(),
-           q->sip.Get(),
-           q->dip.Get(),
-           q->sport,
-           q->dport,
-           q->mlx.m_targetRate.GetBitRate() * 1e-9,
-           q->m_rate.GetBitRate() * 1e-9);
-#endif
-    // get NIC
-    uint32_t nic_idx = GetNicIdxOfQp(q);
-    Ptr<QbbNetDevice> dev = m_nic[nic_idx].dev;
-    // increate rate
-    q->mlx.m_targetRate += m_rhai;
-    if (q->mlx.m_targetRate > dev->GetDataRate())
-        q->mlx.m_targetRate = dev->GetDataRate();
-    double bps = (q->m_rate.GetBitRate() / 2) + (q->mlx.m_targetRate.GetBitRate() / 2);
-    q->m_rate = DataRate((uint64_t)bps);
-#if PRINT_LOG
-    printf("(%.3lf %.3lf)\n",
-           q->mlx.m_targetRate.GetBitRate() * 1e-9,
-           q->m_rate.GetBitRate() * 1e-9);
-#endif
-}
-
-/***********************
- * High Precision CC
- ***********************/
-void
-RdmaHw::HandleAckHp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch)
-{
-    uint64_t ack_seq = ch.ack.seq;
-    // update rate
-    if (ack_seq > qp->hp.m_lastUpdateSeq)
-    { // if full RTT feedback is ready, do full update
-        UpdateRateHp(qp, p, ch, false);
-    }
-    else
-    { // do fast react
-        FastReactHp(qp, p, ch);
-    }
-}
-
-void
-RdmaHw::UpdateRateHp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch, bool fast_react)
-{
-    uint64_t next_seq = qp->snd_nxt;
-#if PRINT_LOG
-    bool print = !fast_react || true;
-#endif
-    if (qp->hp.m_lastUpdateSeq == 0)
-    { // first RTT
-        qp->hp.m_lastUpdateSeq = next_seq;
-        // store INT
-        IntHeader& ih = ch.ack.ih;
-        NS_ASSERT(ih.IntHeader_t.nhop <= IntHeader::maxHop);
-        for (uint32_t i = 0; i < ih.IntHeader_t.nhop; i++)
-            qp->hp.hop[i] = ih.IntHeader_t.hop[i];
-#if PRINT_LOG
-        if (print)
-        {
-            printf("%lu %s %08x %08x %u %u [%u,%u,%u]",
-                   Simulator::Now().GetTimeStep(),
-                   fast_react ? "fast" : "update",
-                   qp->sip.Get(),
-                   qp->dip.Get(),
-                   qp->sport,
-                   qp->dport,
-                   qp->hp.m_lastUpdateSeq,
-                   ch.ack.seq,
-                   next_seq);
-            for (uint32_t i = 0; i < ih.nhop; i++)
-                printf(" %u %lu %lu",
-                       ih.hop[i].GetQlen(),
-                       ih.hop[i].GetBytes(),
-                       ih.hop[i].GetTime());
-            printf("\n");
-        }
-#endif
-    }
-    else
-    {
-        // check packet INT
-        IntHeader& ih = ch.ack.ih;
-        if (ih.IntHeader_t.nhop <= IntHeader::maxHop)
-        {
-            double max_c = 0;
-            // bool inStable = false;
-#if PRINT_LOG
-            if (print)
-                printf("%lu %s %08x %08x %u %u [%u,%u,%u]",
-                       Simulator::Now().GetTimeStep(),
-                       fast_react ? "fast" : "update",
-                       qp->sip.Get(),
-                       qp->dip.Get(),
-                       qp->sport,
-                       qp->dport,
-                       qp->hp.m_lastUpdateSeq,
-                       ch.ack.seq,
-                       next_seq);
-#endif
-            // check each hop
-            double U = 0;
-            uint64_t dt = 0;
-            bool updated[IntHeader::maxHop] = {false}, updated_any = false;
-            NS_ASSERT(ih.IntHeader_t.nhop <= IntHeader::maxHop);
-            for (uint32_t i = 0; i < ih.IntHeader_t.nhop; i++)
-            {
-                if (m_sampleFeedback)
-                {
-                    if (ih.IntHeader_t.hop[i].GetQlen() == 0 && fast_react)
-                        continue;
-                }
-                updated[i] = updated_any = true;
-#if PRINT_LOG
-                if (print)
-                    printf(" %u(%u) %lu(%lu) %lu(%lu)",
-                           ih.hop[i].GetQlen(),
-                           qp->hp.hop[i].GetQlen(),
-                           ih.hop[i].GetBytes(),
-                           qp->hp.hop[i].GetBytes(),
-                           ih.hop[i].GetTime(),
-                           qp->hp.hop[i].GetTime());
-#endif
-                uint64_t tau = ih.IntHeader_t.hop[i].GetTimeDelta(qp->hp.hop[i]);
-                ;
-                double duration = tau * 1e-9;
-                double txRate = (ih.IntHeader_t.hop[i].GetBytesDelta(qp->hp.hop[i])) * 8 / duration;
-                double u =
-                    txRate / ih.IntHeader_t.hop[i].GetLineRate() +
-                    (double)std::min(ih.IntHeader_t.hop[i].GetQlen(), qp->hp.hop[i].GetQlen()) *
-                        qp->m_max_rate.GetBitRate() / ih.IntHeader_t.hop[i].GetLineRate() /
-                        qp->m_win;
-#if PRINT_LOG
-                if (print)
-                    printf(" %.3lf %.3lf", txRate, u);
-#endif
-                if (!m_multipleRate)
-                {
-                    // for aggregate (single R)
-                    if (u > U)
-                    {
-                        U = u;
-                        dt = tau;
-                    }
-                }
-                else
-                {
-                    // for per hop (per hop R)
-                    if (tau > qp->m_baseRtt)
-                        tau = qp->m_baseRtt;
-                    qp->hp.hopState[i].u =
-                        (qp->hp.hopState[i].u * (qp->m_baseRtt - tau) + u * tau) /
-                        double(qp->m_baseRtt);
-                }
-                qp->hp.hop[i] = ih.IntHeader_t.hop[i];
-            }
-
-            DataRate new_rate;
-            int32_t new_incStage = 0;
-            DataRate new_rate_per_hop[IntHeader::maxHop];
-            int32_t new_incStage_per_hop[IntHeader::maxHop];
-            if (!m_multipleRate)
-            {
-                // for aggregate (single R)
-                if (updated_any)
-                {
-                    if (dt > qp->m_baseRtt)
-                        dt = qp->m_baseRtt;
-                    qp->hp.u = (qp->hp.u * (qp->m_baseRtt - dt) + U * dt) / double(qp->m_baseRtt);
-                    max_c = qp->hp.u / m_targetUtil;
-
-                    if (max_c >= 1 || qp->hp.m_incStage >= m_miThresh)
-                    {
-                        double bps = qp->hp.m_curRate.GetBitRate() / max_c + m_rai.GetBitRate();
-                        new_rate = DataRate((uint64_t)bps);
-                        new_incStage = 0;
-                    }
-                    else
-                    {
-                        new_rate = qp->hp.m_curRate + m_rai;
-                        new_incStage = qp->hp.m_incStage + 1;
-                    }
-                    if (new_rate < m_minRate)
-                        new_rate = m_minRate;
-                    if (new_rate > qp->m_max_rate)
-                        new_rate = qp->m_max_rate;
-#if PRINT_LOG
-                    if (print)
-                        printf(" u=%.6lf U=%.3lf dt=%u max_c=%.3lf", qp->hp.u, U, dt, max_c);
-#endif
-#if PRINT_LOG
-                    if (print)
-                        printf(" rate:%.3lf->%.3lf\n",
-                               qp->hp.m_curRate.GetBitRate() * 1e-9,
-                               new_rate.GetBitRate() * 1e-9);
-#endif
-                }
-            }
-            else
-            {
-                // for per hop (per hop R)
-                new_rate = qp->m_max_rate;
-                for (uint32_t i = 0; i < ih.IntHeader_t.nhop; i++)
-                {
-                    if (updated[i])
-                    {
-                        double c = qp->hp.hopState[i].u / m_targetUtil;
-                        if (c >= 1 || qp->hp.hopState[i].incStage >= m_miThresh)
-                        {
-                            double bps =
-                                qp->hp.hopState[i].Rc.GetBitRate() / c + m_rai.GetBitRate();
-                            new_rate_per_hop[i] = DataRate((uint64_t)bps);
-                            new_incStage_per_hop[i] = 0;
-                        }
-                        else
-                        {
-                            new_rate_per_hop[i] = qp->hp.hopState[i].Rc + m_rai;
-                            new_incStage_per_hop[i] = qp->hp.hopState[i].incStage + 1;
-                        }
-                        // bound rate
-                        if (new_rate_per_hop[i] < m_minRate)
-                            new_rate_per_hop[i] = m_minRate;
-                        if (new_rate_per_hop[i] > qp->m_max_rate)
-                            new_rate_per_hop[i] = qp->m_max_rate;
-                        // find min new_rate
-                        if (new_rate_per_hop[i] < new_rate)
-                            new_rate = new_rate_per_hop[i];
-#if PRINT_LOG
-                        if (print)
-                            printf(" [%u]u=%.6lf c=%.3lf", i, qp->hp.hopState[i].u, c);
-#endif
-#if PRINT_LOG
-                        if (print)
-                            printf(" %.3lf->%.3lf",
-                                   qp->hp.hopState[i].Rc.GetBitRate() * 1e-9,
-                                   new_rate.GetBitRate() * 1e-9);
-#endif
-                    }
-                    else
-                    {
-                        if (qp->hp.hopState[i].Rc < new_rate)
-                            new_rate = qp->hp.hopState[i].Rc;
-                    }
-                }
-#if PRINT_LOG
-                printf("\n");
-#endif
-            }
-            if (updated_any)
-                ChangeRate(qp, new_rate);
-            if (!fast_react)
-            {
-                if (updated_any)
-                {
-                    qp->hp.m_curRate = new_rate;
-                    qp->hp.m_incStage = new_incStage;
-                }
-                if (m_multipleRate)
-                {
-                    // for per hop (per hop R)
-                    for (uint32_t i = 0; i < ih.IntHeader_t.nhop; i++)
-                    {
-                        if (updated[i])
-                        {
-                            qp->hp.hopState[i].Rc = new_rate_per_hop[i];
-                            qp->hp.hopState[i].incStage = new_incStage_per_hop[i];
-                        }
-                    }
-                }
-            }
-        }
-        if (!fast_react)
-        {
-            if (next_seq > qp->hp.m_lastUpdateSeq)
-                qp->hp.m_lastUpdateSeq = next_seq; //+ rand() % 2 * m_mtu;
-        }
-    }
-}
-
-void
-RdmaHw::FastReactHp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch)
-{
-    if (m_fast_react)
-        UpdateRateHp(qp, p, ch, true);
-}
-
-/**********************
- * TIMELY
- *********************/
-void
-RdmaHw::HandleAckTimely(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch)
-{
-    uint64_t ack_seq = ch.ack.seq;
-    // update rate
-    if (ack_seq > qp->tmly.m_lastUpdateSeq)
-    { // if full RTT feedback is ready, do full update
-        UpdateRateTimely(qp, p, ch, false);
-    }
-    else
-    { // do fast react
-        FastReactTimely(qp, p, ch);
-    }
-}
-
-void
-RdmaHw::UpdateRateTimely(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch, bool us)
-{
-    uint64_t next_seq = qp->snd_nxt;
-    uint64_t rtt = Simulator::Now().GetTimeStep() - ch.ack.ih.ts;
-#if PRINT_LOG
-    bool print = !us;
-#endif
-    if (qp->tmly.m_lastUpdateSeq != 0)
-    { // not first RTT
-        int64_t new_rtt_diff = (int64_t)rtt - (int64_t)qp->tmly.lastRtt;
-        double rtt_diff = (1 - m_tmly_alpha) * qp->tmly.rttDiff + m_tmly_alpha * new_rtt_diff;
-        double gradient = rtt_diff / m_tmly_minRtt;
-        bool inc = false;
-        double c = 0;
-#if PRINT_LOG
-        if (print)
-            printf("%lu node:%u rtt:%lu rttDiff:%.0lf gradient:%.3lf rate:%.3lf",
-                   Simulator::Now().GetTimeStep(),
-                   m_node->GetId(),
-                   rtt,
-                   rtt_diff,
-                   gradient,
-                   qp->tmly.m_curRate.GetBitRate() * 1e-9);
-#endif
-        if (rtt < m_tmly_TLow)
-        {
-            inc = true;
-        }
-        else if (rtt > m_tmly_THigh)
-        {
-            c = 1 - m_tmly_beta * (1 - (double)m_tmly_THigh / rtt);
-            inc = false;
-        }
-        else if (gradient <= 0)
-        {
-            inc = true;
-        }
-        else
-        {
-            c = 1 - m_tmly_beta * gradient;
-            if (c < 0)
-                c = 0;
-            inc = false;
-        }
-        if (inc)
-        {
-            if (qp->tmly.m_incStage < 5)
-            {
-                qp->m_rate = qp->tmly.m_curRate + m_rai;
-            }
-            else
-            {
-                qp->m_rate = qp->tmly.m_curRate + m_rhai;
-            }
-            if (qp->m_rate > qp->m_max_rate)
-                qp->m_rate = qp->m_max_rate;
-            if (!us)
-            {
-                qp->tmly.m_curRate = qp->m_rate;
-                qp->tmly.m_incStage++;
-                qp->tmly.rttDiff = rtt_diff;
-            }
-        }
-        else
-        {
-            qp->m_rate = std::max(m_minRate, qp->tmly.m_curRate * c);
-            if (!us)
-            {
-                qp->tmly.m_curRate = qp->m_rate;
-                qp->tmly.m_incStage = 0;
-                qp->tmly.rttDiff = rtt_diff;
-            }
-        }
-#if PRINT_LOG
-        if (print)
-        {
-            printf(" %c %.3lf\n", inc ? '^' : 'v', qp->m_rate.GetBitRate() * 1e-9);
-        }
-#endif
-    }
-    if (!us && next_seq > qp->tmly.m_lastUpdateSeq)
-    {
-        qp->tmly.m_lastUpdateSeq = next_seq;
-        // update
-        qp->tmly.lastRtt = rtt;
-    }
-}
-
-void
-RdmaHw::FastReactTimely(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch)
-{
-}
-
-/**********************
- * DCTCP
- *********************/
-void
-RdmaHw::HandleAckDctcp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch)
-{
-    uint64_t ack_seq = ch.ack.seq;
-    uint8_t cnp = (ch.ack.flags >> qbbHeader::FLAG_CNP) & 1;
-    bool new_batch = false;
-
-    // update alpha
-    qp->dctcp.m_ecnCnt += (cnp > 0);
-    if (ack_seq > qp->dctcp.m_lastUpdateSeq)
-    { // if full RTT feedback is ready, do alpha update
-#if PRINT_LOG
-        printf("%lu %s %08x %08x %u %u [%u,%u,%u] %.3lf->",
-               Simulator::Now().GetTimeStep(),
-               "alpha",
-               qp->sip.Get(),
-               qp->dip.Get(),
-               qp->sport,
-               qp->dport,
-               qp->dctcp.m_lastUpdateSeq,
-               ch.ack.seq,
-               qp->snd_nxt,
-               qp->dctcp.m_alpha);
-#endif
-        new_batch = true;
-        if (qp->dctcp.m_lastUpdateSeq == 0)
-        { // first RTT
-            qp->dctcp.m_lastUpdateSeq = qp->snd_nxt;
-            qp->dctcp.m_batchSizeOfAlpha = qp->snd_nxt / m_mtu + 1;
-        }
-        else
-        {
-            double frac = std::min(1.0, double(qp->dctcp.m_ecnCnt) / qp->dctcp.m_batchSizeOfAlpha);
-            qp->dctcp.m_alpha = (1 - m_g) * qp->dctcp.m_alpha + m_g * frac;
-            qp->dctcp.m_lastUpdateSeq = qp->snd_nxt;
-            qp->dctcp.m_ecnCnt = 0;
-            qp->dctcp.m_batchSizeOfAlpha = (qp->snd_nxt - ack_seq) / m_mtu + 1;
-#if PRINT_LOG
-            printf("%.3lf F:%.3lf", qp->dctcp.m_alpha, frac);
-#endif
-        }
-#if PRINT_LOG
-        printf("\n");
-#endif
-    }
-
-    // check cwr exit
-    if (qp->dctcp.m_caState == 1)
-    {
-        if (ack_seq > qp->dctcp.m_highSeq)
-            qp->dctcp.m_caState = 0;
-    }
-
-    // check if need to reduce rate: ECN and not in CWR
-    if (cnp && qp->dctcp.m_caState == 0)
-    {
-#if PRINT_LOG
-        printf("%lu %s %08x %08x %u %u %.3lf->",
-               Simulator::Now().GetTimeStep(),
-               "rate",
-               qp->sip.Get(),
-               qp->dip.Get(),
-               qp->sport,
-               qp->dport,
-               qp->m_rate.GetBitRate() * 1e-9);
-#endif
-        qp->m_rate = std::max(m_minRate, qp->m_rate * (1 - qp->dctcp.m_alpha / 2));
-#if PRINT_LOG
-        printf("%.3lf\n", qp->m_rate.GetBitRate() * 1e-9);
-#endif
-        qp->dctcp.m_caState = 1;
-        qp->dctcp.m_highSeq = qp->snd_nxt;
-    }
-
-    // additive inc
-    if (qp->dctcp.m_caState == 0 && new_batch)
-        qp->m_rate = std::min(qp->m_max_rate, qp->m_rate + m_dctcp_rai);
-}
-
-/*********************
- * HPCC-PINT
- ********************/
 void
 RdmaHw::SetPintSmplThresh(double p)
 {
     pint_smpl_thresh = (uint32_t)(65536 * p);
 }
 
-void
-RdmaHw::HandleAckHpPint(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch)
-{
-    uint64_t ack_seq = ch.ack.seq;
-    if ((uint32_t)rand() % 65536 >= pint_smpl_thresh)
-        return;
-    // update rate
-    if (ack_seq > qp->hpccPint.m_lastUpdateSeq)
-    { // if full RTT feedback is ready, do full update
-        UpdateRateHpPint(qp, p, ch, false);
-    }
-    else
-    { // do fast react
-        UpdateRateHpPint(qp, p, ch, true);
-    }
-}
-
-void
-RdmaHw::UpdateRateHpPint(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch, bool fast_react)
-{
-    uint64_t next_seq = qp->snd_nxt;
-    if (qp->hpccPint.m_lastUpdateSeq == 0)
-    { // first RTT
-        qp->hpccPint.m_lastUpdateSeq = next_seq;
-    }
-    else
-    {
-        // check packet INT
-        IntHeader& ih = ch.ack.ih;
-        double U = Pint::decode_u(ih.GetPower());
-
-        DataRate new_rate;
-        int32_t new_incStage = 0;
-        double max_c = U / m_targetUtil;
-
-        if (max_c >= 1 || qp->hpccPint.m_incStage >= m_miThresh)
-        {
-            double bps = qp->hpccPint.m_curRate.GetBitRate() / max_c + m_rai.GetBitRate();
-            new_rate = DataRate((uint64_t)bps);
-            new_incStage = 0;
-        }
-        else
-        {
-            new_rate = qp->hpccPint.m_curRate + m_rai;
-            new_incStage = qp->hpccPint.m_incStage + 1;
-        }
-        if (new_rate < m_minRate)
-            new_rate = m_minRate;
-        if (new_rate > qp->m_max_rate)
-            new_rate = qp->m_max_rate;
-        ChangeRate(qp, new_rate);
-        if (!fast_react)
-        {
-            qp->hpccPint.m_curRate = new_rate;
-            qp->hpccPint.m_incStage = new_incStage;
-        }
-        if (!fast_react)
-        {
-            if (next_seq > qp->hpccPint.m_lastUpdateSeq)
-                qp->hpccPint.m_lastUpdateSeq = next_seq; //+ rand() % 2 * m_mtu;
-        }
-    }
-}
-
 } // namespace ns3
@@ -1,14 +1,18 @@
 #ifndef RDMA_HW_H
 #define RDMA_HW_H
 
+#include "forwarding-table.h"
 #include "pint.h"
 #include "qbb-net-device.h"
+#include "rdma-congestion-control.h"
+#include "rdma-fluid-engine.h"
 
 #include <ns3/custom-header.h>
 #include <ns3/node.h>
 #include <ns3/rdma-queue-pair.h>
 #include <ns3/rdma.h>
 
+#include <deque>
 #include <set>
 #include <unordered_map>
 
@@ -51,12 +55,13 @@ class RdmaHw : public Object
     bool m_rateBound;
     uint32_t m_total_pause_times;
     uint32_t m_paused_times;
+    bool m_hdrTemplate; // stamp data packets from the per-qp header template
     std::vector<RdmaInterfaceMgr> m_nic; // list of running nic controlled by this RdmaHw
     std::unordered_map<uint64_t, Ptr<RdmaQueuePair>> m_qpMap;     // mapping from uint64_t to qp
+    std::vector<Ptr<RdmaQueuePair>> m_qpList; // the qps of m_qpMap, in no particular order
     std::unordered_map<uint64_t, Ptr<RdmaRxQueuePair>> m_rxQpMap; // mapping from uint64_t to rx qp
-    std::unordered_map<uint32_t, std::vector<int>>
-        m_rtTable; // map from ip address (u32) to possible ECMP port (index of dev)
-    std::unordered_map<uint32_t, std::vector<int>>
+    ForwardingTable m_rtTable; // map from ip address (u32) to possible ECMP port (index of dev)
+    ForwardingTable
         m_rtTable_nxthop_nvswitch; // map from ip address (u32) to possible ECMP port (index of dev)
                                    // connected to nvswitch
     uint32_t m_gpus_per_server;    // uesed for routing; if src and dst in the same server, then
@@ -71,13 +76,9 @@ class RdmaHw : public Object
     SendCompleteCallback m_sendCompleteCallback;
 
     // for monitor
-    std::vector<uint64_t> tx_bytes;                // <port_id, tx_bytes>
-    std::unordered_map<uint64_t, uint32_t> qp_cnp; // key of qp ---> received cnp number
-    std::vector<uint64_t> last_tx_bytes;           // last sampling value <port_id, tx_bytes>
-    std::unordered_map<uint64_t, uint32_t>
-        last_qp_cnp; // last sampling value key of qp ---> received cnp number
-    std::unordered_map<uint64_t, uint64_t>
-        last_qp_rate; // last sampling value key of qp ---> sending rate
+    std::vector<uint64_t> tx_bytes;      // <port_id, tx_bytes>
+    std::vector<uint64_t> last_tx_bytes; // last sampling value <port_id, tx_bytes>
+    // the per-qp counters are kept in the qps, see RdmaQueuePair::m_cnpCount
     void UpdateTxBytes(uint32_t port_id, uint64_t bytes);
     void PrintHostBW(FILE* bw_output, uint32_t bw_mon_interval);
     void PrintQPRate(FILE* rate_output);
@@ -89,6 +90,11 @@ class RdmaHw : public Object
     void add_nvswitch(uint32_t nvswitch_id);
 
     void SetNode(Ptr<Node> node);
+    // replace the algorithm of CcMode, which Setup installs if none was set before
+    void SetCongestionControl(Ptr<RdmaCongestionControl> cc);
+    Ptr<RdmaCongestionControl> GetCongestionControl(void) const;
+    // fast forward the qps of uncongested paths with fluid, null (the default) for none
+    void SetFluidEngine(Ptr<RdmaFluidEngine> fluid);
     void Setup(
         QpCompleteCallback cb,
         SendCompleteCallback send_cb); // setup shared data and callbacks with the QbbNetDevice
@@ -96,7 +102,9 @@ class RdmaHw : public Object
                              uint16_t sport,
                              uint16_t pg); // get the lookup key for m_qpMap
     Ptr<RdmaQueuePair> GetQp(uint32_t dip, uint16_t sport, uint16_t pg); // get the qp
-    uint32_t GetNicIdxOfQp(Ptr<RdmaQueuePair> qp); // get the NIC index of the qp
+    uint32_t GetNicIdxOfQp(Ptr<RdmaQueuePair> qp); // get the NIC index of the qp, cached on the qp
+    uint32_t LookupNicIdxOfQp(Ptr<RdmaQueuePair> qp); // look up the NIC index in the routing table
+    void InvalidateNicIdx(); // drop the cached NIC index of all qps
     void AddQueuePair(uint32_t src,
                       uint32_t dest,
                       uint64_t tag,
@@ -111,6 +119,8 @@ class RdmaHw : public Object
                       Callback<void> notifyAppFinish,
                       Callback<void> notifyAppSent); // add a new qp (new send)
     void DeleteQueuePair(Ptr<RdmaQueuePair> qp);
+    // qp is out of the qpGrp of its nic, pool it if it was deleted
+    void QpDropped(Ptr<RdmaQueuePair> qp);
 
     Ptr<RdmaRxQueuePair> GetRxQp(uint32_t sip,
                                  uint32_t dip,
@@ -143,7 +153,6 @@ class RdmaHw : public Object
     void QpComplete(Ptr<RdmaQueuePair> qp);
     void SetLinkDown(Ptr<QbbNetDevice> dev);
 
-    int SendPacketComplete(Ptr<Packet> p, CustomHeader& ch);
     void SendComplete(Ptr<RdmaQueuePair> qp);
 
     // call this function after the NIC is setup
@@ -152,12 +161,15 @@ class RdmaHw : public Object
     void RedistributeQp();
 
     Ptr<Packet> GetNxtPacket(Ptr<RdmaQueuePair> qp); // get next packet to send, inc snd_nxt
+    void AddDataHeaders(Ptr<RdmaQueuePair> qp,
+                        Ptr<Packet> p); // per-packet headers, used without the template
     void PktSent(Ptr<RdmaQueuePair> qp, Ptr<Packet> pkt, Time interframeGap);
     void UpdateNextAvail(Ptr<RdmaQueuePair> qp, Time interframeGap, uint32_t pkt_size);
     void ChangeRate(Ptr<RdmaQueuePair> qp, DataRate new_rate);
     /******************************
-     * Mellanox's version of DCQCN
+     * Parameters of the congestion control algorithms, see RdmaCongestionControl
      *****************************/
+    // Mellanox's version of DCQCN
     double m_g;              // feedback weight
     double m_rateOnFirstCNP; // the fraction of line rate to set on first CNP
     bool m_EcnClampTgtRate;
@@ -168,62 +180,51 @@ class RdmaHw : public Object
     DataRate m_rai;  //< Rate of additive increase
     DataRate m_rhai; //< Rate of hyper-additive increase
 
-    // the Mellanox's version of alpha update:
-    // every fixed time slot, update alpha.
-    void UpdateAlphaMlx(Ptr<RdmaQueuePair> q);
-    void ScheduleUpdateAlphaMlx(Ptr<RdmaQueuePair> q);
-
-    // Mellanox's version of CNP receive
-    void cnp_received_mlx(Ptr<RdmaQueuePair> q);
-
-    // Mellanox's version of rate decrease
-    // It checks every m_rateDecreaseInterval if CNP arrived (m_decrease_cnp_arrived).
-    // If so, decrease rate, and reset all rate increase related things
-    void CheckRateDecreaseMlx(Ptr<RdmaQueuePair> q);
-    void ScheduleDecreaseRateMlx(Ptr<RdmaQueuePair> q, uint32_t delta);
-
-    // Mellanox's version of rate increase
-    void RateIncEventTimerMlx(Ptr<RdmaQueuePair> q);
-    void RateIncEventMlx(Ptr<RdmaQueuePair> q);
-    void FastRecoveryMlx(Ptr<RdmaQueuePair> q);
-    void ActiveIncreaseMlx(Ptr<RdmaQueuePair> q);
-    void HyperIncreaseMlx(Ptr<RdmaQueuePair> q);
-
-    /***********************
-     * High Precision CC
-     ***********************/
+    // High Precision CC
     double m_targetUtil;
     double m_utilHigh;
     uint32_t m_miThresh;
     bool m_multipleRate;
     bool m_sampleFeedback; // only react to feedback every RTT, or qlen > 0
-    void HandleAckHp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch);
-    void UpdateRateHp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch, bool fast_react);
-    void UpdateRateHpTest(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch, bool fast_react);
-    void FastReactHp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch);
-
-    /**********************
-     * TIMELY
-     *********************/
+
+    // TIMELY
     double m_tmly_alpha, m_tmly_beta;
     uint64_t m_tmly_TLow, m_tmly_THigh, m_tmly_minRtt;
-    void HandleAckTimely(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch);
-    void UpdateRateTimely(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch, bool us);
-    void FastReactTimely(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch);
 
-    /**********************
-     * DCTCP
-     *********************/
+    // DCTCP
     DataRate m_dctcp_rai;
-    void HandleAckDctcp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch);
 
-    /*********************
-     * HPCC-PINT
-     ********************/
+    // HPCC-PINT
     uint32_t pint_smpl_thresh;
+
+    Time m_ccTimerTick; // see RdmaTimerWheel
     void SetPintSmplThresh(double p);
-    void HandleAckHpPint(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch);
-    void UpdateRateHpPint(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader& ch, bool fast_react);
+
+  private:
+    template <typename Cc>
+    void SelectCc(void);
+    template <typename Cc>
+    int ReceiveAckWith(Ptr<Packet> p, CustomHeader& ch);
+    template <typename Cc>
+    void PktSentWith(Ptr<RdmaQueuePair> qp, Ptr<Packet> pkt, Time interframeGap);
+
+    // a qp of the pool if one is no longer referenced elsewhere, else a new one
+    Ptr<RdmaQueuePair> AllocQp(uint16_t pg,
+                               Ipv4Address sip,
+                               Ipv4Address dip,
+                               uint16_t sport,
+                               uint16_t dport);
+    void RemoveFromQpList(Ptr<RdmaQueuePair> qp);
+
+    Ptr<RdmaCongestionControl> m_cc;
+    Ptr<RdmaFluidEngine> m_fluid;
+    // deleted qps out of their qpGrp, reused by AllocQp once nothing else holds them
+    std::deque<Ptr<RdmaQueuePair>> m_qpPool;
+    uint32_t m_qpPoolSize; // bound of m_qpPool and of m_rxQpPool
+    std::vector<Ptr<RdmaRxQueuePair>> m_rxQpPool; // deleted rx qps, free to reuse
+    // ReceiveAck and PktSent, instantiated for the type of m_cc by SelectCc
+    int (RdmaHw::*m_receiveAck)(Ptr<Packet> p, CustomHeader& ch);
+    void (RdmaHw::*m_pktSent)(Ptr<RdmaQueuePair> qp, Ptr<Packet> pkt, Time interframeGap);
 };
 
 } /* namespace ns3 */
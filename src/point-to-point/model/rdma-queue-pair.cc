@@ -11,6 +11,63 @@
 namespace ns3
 {
 
+namespace
+{
+
+/**
+ * Free list of the cc states of one type. The states are allocated in chunks
+ * and never given back, a finished QP leaving its state to the next one.
+ */
+template <typename T>
+class CcStatePool
+{
+  public:
+    static T*
+    Alloc(void)
+    {
+        std::vector<T*>& freeList = Get().m_free;
+        if (freeList.empty())
+        {
+            T* chunk = new T[CHUNK];
+            for (uint32_t i = CHUNK; i > 0; i--)
+            {
+                freeList.push_back(&chunk[i - 1]);
+            }
+        }
+        T* state = freeList.back();
+        freeList.pop_back();
+        *state = T();
+        return state;
+    }
+
+    static void
+    Free(T* state)
+    {
+        Get().m_free.push_back(state);
+    }
+
+  private:
+    static const uint32_t CHUNK = 256;
+
+    static CcStatePool&
+    Get(void)
+    {
+        // not destroyed at exit, QPs held by globals may still give states back
+#ifdef NS3_MTP
+        // one per thread, a state freed by another thread than the one which
+        // allocated it joins the list of the freeing thread
+        static thread_local CcStatePool* pool = new CcStatePool;
+#else
+        static CcStatePool* pool = new CcStatePool;
+#endif
+        return *pool;
+    }
+
+    std::vector<T*> m_free;
+};
+
+} // namespace
+
 /**************************
  * RdmaQueuePair
  *************************/
@@ -26,6 +83,18 @@ RdmaQueuePair::RdmaQueuePair(uint16_t pg,
                              Ipv4Address _dip,
                              uint16_t _sport,
                              uint16_t _dport)
+{
+    m_ccMode = 0;
+    m_cc = nullptr;
+    Reset(pg, _sip, _dip, _sport, _dport);
+}
+
+void
+RdmaQueuePair::Reset(uint16_t pg,
+                     Ipv4Address _sip,
+                     Ipv4Address _dip,
+                     uint16_t _sport,
+                     uint16_t _dport)
 {
     startTime = Simulator::Now();
     sip = _sip;
@@ -46,37 +115,104 @@ RdmaQueuePair::RdmaQueuePair(uint16_t pg,
     m_var_win = false;
     m_rate = 0;
     m_nextAvail = Time(0);
-    mlx.m_alpha = 1;
-    mlx.m_alpha_cnp_arrived = false;
-    mlx.m_first_cnp = true;
-    mlx.m_decrease_cnp_arrived = false;
-    mlx.m_rpTimeStage = 0;
-    hp.m_lastUpdateSeq = 0;
-    for (uint32_t i = 0; i < sizeof(hp.keep) / sizeof(hp.keep[0]); i++)
-        hp.keep[i] = 0;
-    hp.m_incStage = 0;
-    hp.m_lastGap = 0;
-    hp.u = 1;
-    for (uint32_t i = 0; i < IntHeader::maxHop; i++)
+    m_eqIdx = 0;
+    m_nicIdx = -1;
+    m_hash = ComputeHash();
+    m_hwIdx = -1;
+    wp = 0;
+    lastPktSize = 0;
+    nvls_enable = 0;
+    m_notifyAppFinish = Callback<void>();
+    m_notifyAppSent = Callback<void>();
+    m_hdrTemplate = RdmaHeaderTemplate();
+    m_fluidRetry = Time(0);
+    m_cnpCount = 0;
+    m_lastCnpCount = 0;
+    m_lastRate = 0;
+    FreeCcState();
+}
+
+RdmaQueuePair::~RdmaQueuePair()
+{
+    FreeCcState();
+}
+
+void
+RdmaQueuePair::SetCcMode(uint32_t mode)
+{
+    FreeCcState();
+    switch (mode)
     {
-        hp.hopState[i].u = 1;
-        hp.hopState[i].incStage = 0;
+    case 1:
+        m_cc = CcStatePool<DcqcnState>::Alloc();
+        break;
+    case 3:
+        m_cc = CcStatePool<HpccState>::Alloc();
+        break;
+    case 7:
+        m_cc = CcStatePool<TimelyState>::Alloc();
+        break;
+    case 8:
+        m_cc = CcStatePool<DctcpState>::Alloc();
+        break;
+    case 10:
+        m_cc = CcStatePool<HpccPintState>::Alloc();
+        break;
+    default:
+        return;
     }
+    m_ccMode = mode;
+}
 
-    tmly.m_lastUpdateSeq = 0;
-    tmly.m_incStage = 0;
-    tmly.lastRtt = 0;
-    tmly.rttDiff = 0;
+uint32_t
+RdmaQueuePair::GetCcMode(void) const
+{
+    return m_ccMode;
+}
 
-    dctcp.m_lastUpdateSeq = 0;
-    dctcp.m_caState = 0;
-    dctcp.m_highSeq = 0;
-    dctcp.m_alpha = 1;
-    dctcp.m_ecnCnt = 0;
-    dctcp.m_batchSizeOfAlpha = 0;
+void
+RdmaQueuePair::FreeCcState(void)
+{
+    switch (m_ccMode)
+    {
+    case 1:
+        CcStatePool<DcqcnState>::Free(static_cast<DcqcnState*>(m_cc));
+        break;
+    case 3:
+        CcStatePool<HpccState>::Free(static_cast<HpccState*>(m_cc));
+        break;
+    case 7:
+        CcStatePool<TimelyState>::Free(static_cast<TimelyState*>(m_cc));
+        break;
+    case 8:
+        CcStatePool<DctcpState>::Free(static_cast<DctcpState*>(m_cc));
+        break;
+    case 10:
+        CcStatePool<HpccPintState>::Free(static_cast<HpccPintState*>(m_cc));
+        break;
+    }
+    m_ccMode = 0;
+    m_cc = nullptr;
+}
 
-    hpccPint.m_lastUpdateSeq = 0;
-    hpccPint.m_incStage = 0;
+uint64_t
+RdmaQueuePair::GetMemoryFootprint(void) const
+{
+    uint64_t bytes = sizeof(*this);
+    switch (m_ccMode)
+    {
+    case 1:
+        return bytes + sizeof(DcqcnState);
+    case 3:
+        return bytes + sizeof(HpccState);
+    case 7:
+        return bytes + sizeof(TimelyState);
+    case 8:
+        return bytes + sizeof(DctcpState);
+    case 10:
+        return bytes + sizeof(HpccPintState);
+    }
+    return bytes;
 }
 
 void
@@ -172,6 +308,12 @@ RdmaQueuePair::GetBytesLeft()
 
 uint32_t
 RdmaQueuePair::GetHash(void)
+{
+    return m_hash;
+}
+
+uint32_t
+RdmaQueuePair::ComputeHash(void)
 {
     union {
         struct
@@ -239,7 +381,7 @@ RdmaQueuePair::HpGetCurWin()
     uint64_t w;
     if (m_var_win)
     {
-        w = m_win * hp.m_curRate.GetBitRate() / m_max_rate.GetBitRate();
+        w = m_win * Hp().m_curRate.GetBitRate() / m_max_rate.GetBitRate();
         if (w == 0)
             w = 1; // must > 0
     }
@@ -259,21 +401,22 @@ RdmaQueuePair::IsFinished()
 /*********************
  * RdmaRxQueuePair
  ********************/
-TypeId
-RdmaRxQueuePair::GetTypeId(void)
+RdmaRxQueuePair::RdmaRxQueuePair()
 {
-    static TypeId tid = TypeId("ns3::RdmaRxQueuePair").SetParent<Object>();
-    return tid;
+    Reset();
 }
 
-RdmaRxQueuePair::RdmaRxQueuePair()
+void
+RdmaRxQueuePair::Reset(void)
 {
+    m_ecn_source = ECNAccount();
     sip = dip = sport = dport = 0;
     m_ipid = 0;
     ReceiverNextExpectedSeq = 0;
     m_nackTimer = Time(0);
     m_milestone_rx = 0;
     m_lastNACK = 0;
+    QcnTimerEvent = EventId();
 }
 
 uint32_t
@@ -307,6 +450,7 @@ RdmaQueuePairGroup::GetTypeId(void)
 }
 
 RdmaQueuePairGroup::RdmaQueuePairGroup(void)
+    : m_generation(0)
 {
 }
 
@@ -344,6 +488,7 @@ void
 RdmaQueuePairGroup::Clear(void)
 {
     m_qps.clear();
+    m_generation++;
 }
 
 } // namespace ns3
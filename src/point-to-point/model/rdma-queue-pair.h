@@ -1,6 +1,7 @@
 #ifndef RDMA_QUEUE_PAIR_H
 #define RDMA_QUEUE_PAIR_H
 
+#include <ns3/assert.h>
 #include <ns3/custom-header.h>
 #include <ns3/data-rate.h>
 #include <ns3/event-id.h>
@@ -8,6 +9,9 @@
 #include <ns3/ipv4-address.h>
 #include <ns3/object.h>
 #include <ns3/packet.h>
+#include <ns3/rdma-header-template.h>
+#include <ns3/rdma-timer-wheel.h>
+#include <ns3/simple-ref-count.h>
 
 #include <vector>
 
@@ -30,6 +34,10 @@ class RdmaQueuePair : public Object
     DataRate m_max_rate; // max rate
     bool m_var_win;      // variable window size
     Time m_nextAvail;    //< Soonest time of next send
+    uint32_t m_eqIdx;    //< index in its RdmaQueuePairGroup, kept by RdmaEgressQueue
+    uint32_t m_nicIdx;   //< index of its nic in RdmaHw, cached by RdmaHw::GetNicIdxOfQp
+    uint32_t m_hash;     //< flow hash of sip, dip, sport and dport
+    uint32_t m_hwIdx;    //< index in RdmaHw::m_qpList, kept by RdmaHw
     uint32_t wp;         // current window of packets
     uint32_t lastPktSize;
     Callback<void> m_notifyAppFinish;
@@ -38,64 +46,112 @@ class RdmaQueuePair : public Object
      * runtime states
      *****************************/
     uint32_t nvls_enable;
-    DataRate m_rate; //< Current rate
+    DataRate m_rate;                   //< Current rate
+    RdmaHeaderTemplate m_hdrTemplate; //< Headers of data packets, built on first send
+    Time m_fluidRetry;                //< Soonest time to try RdmaFluidEngine::TryStart again
+    /******************************
+     * monitor counters, see RdmaHw::PrintQPRate and RdmaHw::PrintQPCnpNumber
+     *****************************/
+    uint32_t m_cnpCount;     //< CNPs received
+    uint32_t m_lastCnpCount; //< m_cnpCount at the last sample
+    uint64_t m_lastRate;     //< m_rate in bit/s at the last sample
 
-    struct
+    /**
+     * Congestion control state, of the algorithm of the RdmaHw only (its
+     * CcMode), allocated from a free list per algorithm by SetCcMode().
+     */
+    struct DcqcnState // CcMode 1
     {
         DataRate m_targetRate; //< Target rate
-        EventId m_eventUpdateAlpha;
-        double m_alpha;
-        bool m_alpha_cnp_arrived; // indicate if CNP arrived in the last slot
-        bool m_first_cnp;         // indicate if the current CNP is the first CNP
-        EventId m_eventDecreaseRate;
-        bool m_decrease_cnp_arrived; // indicate if CNP arrived in the last slot
-        uint32_t m_rpTimeStage;
-        EventId m_rpTimer;
-    } mlx;
-
-    struct
+        RdmaTimerWheel::TimerId m_eventUpdateAlpha = 0;
+        double m_alpha = 1;
+        bool m_alpha_cnp_arrived = false; // indicate if CNP arrived in the last slot
+        bool m_first_cnp = true;          // indicate if the current CNP is the first CNP
+        RdmaTimerWheel::TimerId m_eventDecreaseRate = 0;
+        bool m_decrease_cnp_arrived = false; // indicate if CNP arrived in the last slot
+        uint32_t m_rpTimeStage = 0;
+        RdmaTimerWheel::TimerId m_rpTimer = 0;
+    };
+
+    struct HpccState // CcMode 3
     {
-        uint64_t m_lastUpdateSeq;
+        uint64_t m_lastUpdateSeq = 0;
         DataRate m_curRate;
         IntHop hop[IntHeader::maxHop];
-        uint32_t keep[IntHeader::maxHop];
-        uint32_t m_incStage;
-        double m_lastGap;
-        double u;
+        uint32_t keep[IntHeader::maxHop] = {};
+        uint32_t m_incStage = 0;
+        double m_lastGap = 0;
+        double u = 1;
 
         struct
         {
-            double u;
+            double u = 1;
             DataRate Rc;
-            uint32_t incStage;
+            uint32_t incStage = 0;
         } hopState[IntHeader::maxHop];
-    } hp;
+    };
 
-    struct
+    struct TimelyState // CcMode 7
     {
-        uint64_t m_lastUpdateSeq;
+        uint64_t m_lastUpdateSeq = 0;
         DataRate m_curRate;
-        uint32_t m_incStage;
-        uint64_t lastRtt;
-        double rttDiff;
-    } tmly;
+        uint32_t m_incStage = 0;
+        uint64_t lastRtt = 0;
+        double rttDiff = 0;
+    };
 
-    struct
+    struct DctcpState // CcMode 8
     {
-        uint64_t m_lastUpdateSeq;
-        uint32_t m_caState;
-        uint64_t m_highSeq; // when to exit cwr
-        double m_alpha;
-        uint32_t m_ecnCnt;
-        uint32_t m_batchSizeOfAlpha;
-    } dctcp;
-
-    struct
+        uint64_t m_lastUpdateSeq = 0;
+        uint32_t m_caState = 0;
+        uint64_t m_highSeq = 0; // when to exit cwr
+        double m_alpha = 1;
+        uint32_t m_ecnCnt = 0;
+        uint32_t m_batchSizeOfAlpha = 0;
+    };
+
+    struct HpccPintState // CcMode 10
     {
-        uint64_t m_lastUpdateSeq;
+        uint64_t m_lastUpdateSeq = 0;
         DataRate m_curRate;
-        uint32_t m_incStage;
-    } hpccPint;
+        uint32_t m_incStage = 0;
+    };
+
+    // the state of the current CcMode, which must be the one asked for
+    DcqcnState&
+    Mlx(void)
+    {
+        NS_ASSERT(m_ccMode == 1);
+        return *static_cast<DcqcnState*>(m_cc);
+    }
+
+    HpccState&
+    Hp(void)
+    {
+        NS_ASSERT(m_ccMode == 3);
+        return *static_cast<HpccState*>(m_cc);
+    }
+
+    TimelyState&
+    Tmly(void)
+    {
+        NS_ASSERT(m_ccMode == 7);
+        return *static_cast<TimelyState*>(m_cc);
+    }
+
+    DctcpState&
+    Dctcp(void)
+    {
+        NS_ASSERT(m_ccMode == 8);
+        return *static_cast<DctcpState*>(m_cc);
+    }
+
+    HpccPintState&
+    HpccPint(void)
+    {
+        NS_ASSERT(m_ccMode == 10);
+        return *static_cast<HpccPintState*>(m_cc);
+    }
 
     /***********
      * methods
@@ -106,6 +162,13 @@ class RdmaQueuePair : public Object
                   Ipv4Address _dip,
                   uint16_t _sport,
                   uint16_t _dport);
+    ~RdmaQueuePair() override;
+    // back to the state of a new qp, for RdmaHw to reuse this object for another flow
+    void Reset(uint16_t pg, Ipv4Address _sip, Ipv4Address _dip, uint16_t _sport, uint16_t _dport);
+    // bind to CcMode mode with a fresh state, the modes without state free it
+    void SetCcMode(uint32_t mode);
+    uint32_t GetCcMode(void) const;
+    uint64_t GetMemoryFootprint(void) const; // this object and its cc state, in bytes
     void SetSize(uint64_t size);
     void SetWin(uint32_t win);
     void SetBaseRtt(uint64_t baseRtt);
@@ -122,17 +185,29 @@ class RdmaQueuePair : public Object
     void SetSrc(uint32_t src);
     void SetDest(uint32_t dest);
     void SetInitialSize(uint64_t size);
-    uint32_t GetHash(void);
+    uint32_t GetHash(void);     // cached m_hash
+    uint32_t ComputeHash(void); // Hash32 of sip, dip, sport and dport
     void Acknowledge(uint64_t ack);
     uint64_t GetOnTheFly();
     bool IsWinBound();
     uint64_t GetWin(); // window size calculated from m_rate
     bool IsFinished();
-    uint64_t HpGetCurWin(); // window size calculated from hp.m_curRate, used by HPCC
+    uint64_t HpGetCurWin(); // window size calculated from Hp().m_curRate, used by HPCC
+
+  private:
+    void FreeCcState(void);
+
+    uint32_t m_ccMode; // CcMode of m_cc, 0 if none
+    void* m_cc;        // state of m_ccMode, from the pool of its type
 };
 
-class RdmaRxQueuePair : public Object
-{ // Rx side queue pair
+/**
+ * Rx side queue pair. Only RdmaHw uses it, so it is a plain reference counted
+ * object, without the TypeId and aggregation of an Object, and RdmaHw reuses
+ * it for the next flow once it is deleted (see RdmaHw::DeleteRxQp).
+ */
+class RdmaRxQueuePair : public SimpleRefCount<RdmaRxQueuePair>
+{
   public:
     struct ECNAccount
     {
@@ -157,8 +232,8 @@ class RdmaRxQueuePair : public Object
     uint32_t m_lastNACK;
     EventId QcnTimerEvent; // if destroy this rxQp, remember to cancel this timer
 
-    static TypeId GetTypeId(void);
     RdmaRxQueuePair();
+    void Reset(void); // back to the state of a new rx qp
     uint32_t GetHash(void);
 };
 
@@ -166,6 +241,7 @@ class RdmaQueuePairGroup : public Object
 {
   public:
     std::vector<Ptr<RdmaQueuePair>> m_qps;
+    uint32_t m_generation; // bumped by Clear() so that users of m_qps can resync
     // std::vector<Ptr<RdmaRxQueuePair> > m_rxQps;
 
     static TypeId GetTypeId(void);
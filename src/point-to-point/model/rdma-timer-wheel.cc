@@ -0,0 +1,124 @@
+#include "rdma-timer-wheel.h"
+
+#include <ns3/assert.h>
+#include <ns3/simulator.h>
+
+namespace ns3
+{
+
+RdmaTimerWheel::RdmaTimerWheel()
+    : m_tick(0),
+      m_nPending(0),
+      m_nEvents(0)
+{
+}
+
+void
+RdmaTimerWheel::SetTick(Time tick)
+{
+    NS_ASSERT(!tick.IsStrictlyNegative());
+    m_tick = tick;
+}
+
+Time
+RdmaTimerWheel::GetTick(void) const
+{
+    return m_tick;
+}
+
+RdmaTimerWheel::TimerId
+RdmaTimerWheel::Schedule(Time delay, Callback<void> cb)
+{
+    uint32_t slot;
+    if (!m_free.empty())
+    {
+        slot = m_free.back();
+        m_free.pop_back();
+    }
+    else
+    {
+        slot = m_timers.size();
+        m_timers.push_back(Timer{Callback<void>(), 1});
+    }
+    m_timers[slot].cb = cb;
+    TimerId id = (TimerId)m_timers[slot].gen << 32 | slot;
+    m_nPending++;
+
+    // the end of the tick of the expiry time
+    int64_t at = (Simulator::Now() + delay).GetTimeStep();
+    int64_t tick = m_tick.GetTimeStep();
+    if (tick > 0)
+    {
+        at = (at + tick - 1) / tick * tick;
+    }
+    auto it = m_buckets.find(at);
+    if (it == m_buckets.end())
+    {
+        it = m_buckets.emplace(at, std::vector<TimerId>()).first;
+        Simulator::Schedule(TimeStep(at) - Simulator::Now(), &RdmaTimerWheel::Expire, this, at);
+        m_nEvents++;
+    }
+    it->second.push_back(id);
+    return id;
+}
+
+void
+RdmaTimerWheel::Cancel(TimerId& id)
+{
+    if (IsPending(id))
+    {
+        Release(id & 0xffffffff);
+    }
+    id = 0;
+}
+
+bool
+RdmaTimerWheel::IsPending(TimerId id) const
+{
+    uint32_t slot = id & 0xffffffff;
+    return id != 0 && slot < m_timers.size() && m_timers[slot].gen == id >> 32;
+}
+
+uint32_t
+RdmaTimerWheel::GetNPending(void) const
+{
+    return m_nPending;
+}
+
+uint64_t
+RdmaTimerWheel::GetNEvents(void) const
+{
+    return m_nEvents;
+}
+
+void
+RdmaTimerWheel::Expire(int64_t at)
+{
+    auto it = m_buckets.find(at);
+    NS_ASSERT(it != m_buckets.end());
+    // a timer may schedule another one in this bucket, with a zero delay
+    std::vector<TimerId>& bucket = it->second;
+    for (std::size_t i = 0; i < bucket.size(); i++)
+    {
+        TimerId id = bucket[i];
+        if (IsPending(id))
+        {
+            uint32_t slot = id & 0xffffffff;
+            Callback<void> cb = m_timers[slot].cb;
+            Release(slot);
+            cb();
+        }
+    }
+    m_buckets.erase(it);
+}
+
+void
+RdmaTimerWheel::Release(uint32_t slot)
+{
+    m_timers[slot].cb = Callback<void>();
+    m_timers[slot].gen++;
+    m_free.push_back(slot);
+    m_nPending--;
+}
+
+} /* namespace ns3 */
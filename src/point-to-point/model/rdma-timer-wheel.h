@@ -0,0 +1,63 @@
+#ifndef RDMA_TIMER_WHEEL_H
+#define RDMA_TIMER_WHEEL_H
+
+#include <ns3/callback.h>
+#include <ns3/nstime.h>
+
+#include <map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Timers of the congestion control of an RdmaHw, batched per tick.
+ *
+ * Timers are put in the bucket of the tick in which they expire, and each
+ * bucket is one simulator event, at the end of its tick, which runs its
+ * timers in the order they were scheduled. With a tick of 0, the default,
+ * a bucket is an exact time and the timers expire when a per-timer event
+ * would have. A larger tick batches the timers of many QPs into one event,
+ * each of them expiring up to one tick late.
+ *
+ * A timer is a TimerId, which Cancel() drops in O(1) and which is 0 when no
+ * timer is pending.
+ */
+class RdmaTimerWheel
+{
+  public:
+    typedef uint64_t TimerId;
+
+    RdmaTimerWheel();
+
+    void SetTick(Time tick);
+    Time GetTick(void) const;
+
+    TimerId Schedule(Time delay, Callback<void> cb);
+    void Cancel(TimerId& id); // no-op for 0, and for timers which expired or were canceled
+    bool IsPending(TimerId id) const;
+
+    uint32_t GetNPending(void) const; // timers not expired nor canceled
+    uint64_t GetNEvents(void) const;  // simulator events scheduled so far
+
+  private:
+    struct Timer
+    {
+        Callback<void> cb;
+        uint32_t gen; // bumped each time the timer is released
+    };
+
+    void Expire(int64_t at);
+    void Release(uint32_t slot);
+
+    Time m_tick;
+    std::vector<Timer> m_timers; // slots of the timers, TimerId = gen << 32 | slot
+    std::vector<uint32_t> m_free;
+    std::map<int64_t, std::vector<TimerId>> m_buckets; // expiry time step -> timers
+    uint32_t m_nPending;
+    uint64_t m_nEvents;
+};
+
+} /* namespace ns3 */
+
+#endif /* RDMA_TIMER_WHEEL_H */
@@ -0,0 +1,69 @@
+#include "switch-byte-counter.h"
+
+#include "ns3/assert.h"
+
+namespace ns3
+{
+
+void
+SwitchByteCounter::Add(uint32_t inDev, uint32_t outDev, uint32_t qIndex, uint32_t bytes)
+{
+    NS_ASSERT(qIndex < qCnt);
+    auto it = m_bytes.find(Key(inDev, outDev));
+    if (it == m_bytes.end())
+    {
+        it = m_bytes.emplace(Key(inDev, outDev), QueueBytes{}).first;
+    }
+    it->second[qIndex] += bytes;
+}
+
+void
+SwitchByteCounter::Remove(uint32_t inDev, uint32_t outDev, uint32_t qIndex, uint32_t bytes)
+{
+    NS_ASSERT(qIndex < qCnt);
+    auto it = m_bytes.find(Key(inDev, outDev));
+    NS_ASSERT_MSG(it != m_bytes.end() && it->second[qIndex] >= bytes,
+                  "Removing more bytes than were enqueued");
+    it->second[qIndex] -= bytes;
+    for (uint32_t q = 0; q < qCnt; q++)
+    {
+        if (it->second[q] != 0)
+        {
+            return;
+        }
+    }
+    m_bytes.erase(it); // pair fully drained
+}
+
+uint32_t
+SwitchByteCounter::Get(uint32_t inDev, uint32_t outDev, uint32_t qIndex) const
+{
+    auto it = m_bytes.find(Key(inDev, outDev));
+    if (it == m_bytes.end())
+    {
+        return 0;
+    }
+    return it->second[qIndex];
+}
+
+void
+SwitchByteCounter::Clear(void)
+{
+    m_bytes.clear();
+}
+
+uint32_t
+SwitchByteCounter::GetNActivePairs(void) const
+{
+    return m_bytes.size();
+}
+
+uint64_t
+SwitchByteCounter::GetMemoryFootprint(void) const
+{
+    // each node holds the value plus the singly linked list pointer
+    uint64_t nodeSize = sizeof(void*) + sizeof(std::pair<const uint32_t, QueueBytes>);
+    return sizeof(*this) + m_bytes.bucket_count() * sizeof(void*) + m_bytes.size() * nodeSize;
+}
+
+} /* namespace ns3 */
@@ -0,0 +1,46 @@
+#ifndef SWITCH_BYTE_COUNTER_H
+#define SWITCH_BYTE_COUNTER_H
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+
+namespace ns3
+{
+
+/**
+ * Sparse per-(inDev, outDev, qIndex) byte accounting for switches.
+ *
+ * Only in/out port pairs that currently hold queued bytes own an entry; an
+ * entry is released as soon as all of its queues drain back to zero. This
+ * replaces the dense [pCnt][pCnt][qCnt] array that was embedded in every
+ * switch object.
+ */
+class SwitchByteCounter
+{
+  public:
+    static const uint32_t qCnt = 8; // Number of queues/priorities used
+
+    void Add(uint32_t inDev, uint32_t outDev, uint32_t qIndex, uint32_t bytes);
+    void Remove(uint32_t inDev, uint32_t outDev, uint32_t qIndex, uint32_t bytes);
+    uint32_t Get(uint32_t inDev, uint32_t outDev, uint32_t qIndex) const;
+    void Clear(void);
+
+    uint32_t GetNActivePairs(void) const;
+    uint64_t GetMemoryFootprint(void) const; // approximate heap + object bytes
+
+  private:
+    typedef std::array<uint32_t, qCnt> QueueBytes;
+
+    static uint32_t
+    Key(uint32_t inDev, uint32_t outDev)
+    {
+        return (inDev << 16) | (outDev & 0xffff);
+    }
+
+    std::unordered_map<uint32_t, QueueBytes> m_bytes; // (inDev << 16 | outDev) -> bytes per queue
+};
+
+} /* namespace ns3 */
+
+#endif /* SWITCH_BYTE_COUNTER_H */
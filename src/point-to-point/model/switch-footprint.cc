@@ -0,0 +1,40 @@
+#include "switch-footprint.h"
+
+#include "forwarding-table.h"
+#include "switch-byte-counter.h"
+#include "switch-mmu.h"
+
+namespace ns3
+{
+
+uint64_t
+GetSwitchFootprint(uint64_t objectBytes,
+                   Ptr<SwitchMmu> mmu,
+                   const ForwardingTable& rtTable,
+                   const SwitchByteCounter& bytes)
+{
+    return objectBytes + mmu->GetMemoryFootprint() + rtTable.GetMemoryFootprint() -
+           sizeof(rtTable) + bytes.GetMemoryFootprint() - sizeof(bytes);
+}
+
+void
+PrintSwitchFootprint(FILE* mem_output,
+                     uint32_t swId,
+                     uint32_t nodeType,
+                     uint64_t total,
+                     const ForwardingTable& rtTable,
+                     const SwitchByteCounter& bytes)
+{
+    fprintf(mem_output,
+            "%u, %u, %lu, %lu, %u, %u, %lu, %u\n",
+            swId,
+            nodeType,
+            total,
+            bytes.GetMemoryFootprint(),
+            bytes.GetNActivePairs(),
+            rtTable.GetNEntries(),
+            rtTable.GetMemoryFootprint(),
+            rtTable.GetNGroups());
+}
+
+} /* namespace ns3 */
@@ -0,0 +1,39 @@
+#ifndef SWITCH_FOOTPRINT_H
+#define SWITCH_FOOTPRINT_H
+
+#include <ns3/ptr.h>
+
+#include <cstdint>
+#include <cstdio>
+
+namespace ns3
+{
+
+class ForwardingTable;
+class SwitchByteCounter;
+class SwitchMmu;
+
+/**
+ * Approximate bytes held by a switch node (SwitchNode, NVSwitchNode) of
+ * objectBytes, with its mmu, and its routing table and byte accounting which
+ * are embedded in the object: only their out-of-line part is added.
+ */
+uint64_t GetSwitchFootprint(uint64_t objectBytes,
+                            Ptr<SwitchMmu> mmu,
+                            const ForwardingTable& rtTable,
+                            const SwitchByteCounter& bytes);
+
+/**
+ * output format:
+ * sw_id, node_type, total_bytes, counter_bytes, active_pairs, rt_entries, rt_bytes, rt_groups
+ */
+void PrintSwitchFootprint(FILE* mem_output,
+                          uint32_t swId,
+                          uint32_t nodeType,
+                          uint64_t total,
+                          const ForwardingTable& rtTable,
+                          const SwitchByteCounter& bytes);
+
+} /* namespace ns3 */
+
+#endif /* SWITCH_FOOTPRINT_H */
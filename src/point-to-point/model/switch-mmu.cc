@@ -6,7 +6,7 @@
 #include "ns3/log.h"
 #include "ns3/object-vector.h"
 #include "ns3/packet.h"
-#include "ns3/random-variable.h"
+#include "ns3/random-variable-stream.h"
 #include "ns3/simulator.h"
 #include "ns3/uinteger.h"
 
@@ -25,23 +25,31 @@ SwitchMmu::GetTypeId(void)
 }
 
 SwitchMmu::SwitchMmu(void)
+    : pfc_a_shift(this)
 {
     buffer_size = 12 * 1024 * 1024;
     reserve = 4 * 1024;
     resume_offset = 3 * 1024;
+    total_hdrm = 0;
+    total_rsrv = 0;
 
     // headroom
     shared_used_bytes = 0;
-    memset(hdrm_bytes, 0, sizeof(hdrm_bytes));
-    memset(ingress_bytes, 0, sizeof(ingress_bytes));
-    memset(paused, 0, sizeof(paused));
-    memset(egress_bytes, 0, sizeof(egress_bytes));
+    m_ecnRv = CreateObject<UniformRandomVariable>();
+}
+
+int64_t
+SwitchMmu::AssignStreams(int64_t stream)
+{
+    m_ecnRv->SetStream(stream);
+    return 1;
 }
 
 bool
 SwitchMmu::CheckIngressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize)
 {
-    if (psize + hdrm_bytes[port][qIndex] > headroom[port] &&
+    Port& p = GetPort(port);
+    if (psize + p.hdrm_bytes[qIndex] > p.headroom &&
         psize + GetSharedUsed(port, qIndex) > GetPfcThreshold(port))
     {
         printf("%lu %u Drop: queue:%u,%u: Headroom full\n",
@@ -49,8 +57,8 @@ SwitchMmu::CheckIngressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize)
                node_id,
                port,
                qIndex);
-        for (uint32_t i = 1; i < 64; i++)
-            printf("(%u,%u)", hdrm_bytes[i][3], ingress_bytes[i][3]);
+        for (uint32_t i = 1; i < 64 && i < m_ports.size(); i++)
+            printf("(%u,%u)", m_ports[i].hdrm_bytes[3], m_ports[i].ingress_bytes[3]);
         printf("\n");
         return false;
     }
@@ -66,21 +74,22 @@ SwitchMmu::CheckEgressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize)
 void
 SwitchMmu::UpdateIngressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize)
 {
-    uint32_t new_bytes = ingress_bytes[port][qIndex] + psize;
+    Port& p = GetPort(port);
+    uint32_t new_bytes = p.ingress_bytes[qIndex] + psize;
     if (new_bytes <= reserve)
     {
-        ingress_bytes[port][qIndex] += psize;
+        p.ingress_bytes[qIndex] += psize;
     }
     else
     {
         uint32_t thresh = GetPfcThreshold(port);
         if (new_bytes - reserve > thresh)
         {
-            hdrm_bytes[port][qIndex] += psize;
+            p.hdrm_bytes[qIndex] += psize;
         }
         else
         {
-            ingress_bytes[port][qIndex] += psize;
+            p.ingress_bytes[qIndex] += psize;
             shared_used_bytes += std::min(psize, new_bytes - reserve);
         }
     }
@@ -89,66 +98,70 @@ SwitchMmu::UpdateIngressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize
 void
 SwitchMmu::UpdateEgressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize)
 {
-    egress_bytes[port][qIndex] += psize;
+    GetPort(port).egress_bytes[qIndex] += psize;
 }
 
 void
 SwitchMmu::RemoveFromIngressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize)
 {
-    uint32_t from_hdrm = std::min(hdrm_bytes[port][qIndex], psize);
+    Port& p = GetPort(port);
+    uint32_t from_hdrm = std::min(p.hdrm_bytes[qIndex], psize);
     uint32_t from_shared =
         std::min(psize - from_hdrm,
-                 ingress_bytes[port][qIndex] > reserve ? ingress_bytes[port][qIndex] - reserve : 0);
-    hdrm_bytes[port][qIndex] -= from_hdrm;
-    ingress_bytes[port][qIndex] -= psize - from_hdrm;
+                 p.ingress_bytes[qIndex] > reserve ? p.ingress_bytes[qIndex] - reserve : 0);
+    p.hdrm_bytes[qIndex] -= from_hdrm;
+    p.ingress_bytes[qIndex] -= psize - from_hdrm;
     shared_used_bytes -= from_shared;
 }
 
 void
 SwitchMmu::RemoveFromEgressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize)
 {
-    egress_bytes[port][qIndex] -= psize;
+    GetPort(port).egress_bytes[qIndex] -= psize;
 }
 
 bool
 SwitchMmu::CheckShouldPause(uint32_t port, uint32_t qIndex)
 {
-    return !paused[port][qIndex] &&
-           (hdrm_bytes[port][qIndex] > 0 || GetSharedUsed(port, qIndex) >= GetPfcThreshold(port));
+    Port& p = GetPort(port);
+    return !p.paused[qIndex] &&
+           (p.hdrm_bytes[qIndex] > 0 || GetSharedUsed(port, qIndex) >= GetPfcThreshold(port));
 }
 
 bool
 SwitchMmu::CheckShouldResume(uint32_t port, uint32_t qIndex)
 {
-    if (!paused[port][qIndex])
+    Port& p = GetPort(port);
+    if (!p.paused[qIndex])
         return false;
     uint32_t shared_used = GetSharedUsed(port, qIndex);
-    return hdrm_bytes[port][qIndex] == 0 &&
+    return p.hdrm_bytes[qIndex] == 0 &&
            (shared_used == 0 || shared_used + resume_offset <= GetPfcThreshold(port));
 }
 
 void
 SwitchMmu::SetPause(uint32_t port, uint32_t qIndex)
 {
-    paused[port][qIndex] = true;
+    GetPort(port).paused[qIndex] = true;
 }
 
 void
 SwitchMmu::SetResume(uint32_t port, uint32_t qIndex)
 {
-    paused[port][qIndex] = false;
+    GetPort(port).paused[qIndex] = false;
 }
 
 uint32_t
 SwitchMmu::GetPfcThreshold(uint32_t port)
 {
-    return (buffer_size - total_hdrm - total_rsrv - shared_used_bytes) >> pfc_a_shift[port];
+    return (buffer_size - total_hdrm - total_rsrv - shared_used_bytes) >>
+           GetPort(port).pfc_a_shift;
 }
 
 uint32_t
 SwitchMmu::GetSharedUsed(uint32_t port, uint32_t qIndex)
 {
-    uint32_t used = ingress_bytes[port][qIndex];
+    uint32_t used = GetPort(port).ingress_bytes[qIndex];
     return used > reserve ? used - reserve : 0;
 }
 
@@ -157,13 +170,13 @@ SwitchMmu::ShouldSendCN(uint32_t ifindex, uint32_t qIndex)
 {
     if (qIndex == 0)
         return false;
-    if (egress_bytes[ifindex][qIndex] > kmax[ifindex])
+    Port& p = GetPort(ifindex);
+    if (p.egress_bytes[qIndex] > p.kmax)
         return true;
-    if (egress_bytes[ifindex][qIndex] > kmin[ifindex])
+    if (p.egress_bytes[qIndex] > p.kmin)
     {
-        double p = pmax[ifindex] * double(egress_bytes[ifindex][qIndex] - kmin[ifindex]) /
-                   (kmax[ifindex] - kmin[ifindex]);
-        if (UniformVariable(0, 1).GetValue() < p)
+        double pr = p.pmax * double(p.egress_bytes[qIndex] - p.kmin) / (p.kmax - p.kmin);
+        if (m_ecnRv->GetValue() < pr)
             return true;
     }
     return false;
@@ -172,15 +185,16 @@ SwitchMmu::ShouldSendCN(uint32_t ifindex, uint32_t qIndex)
 void
 SwitchMmu::ConfigEcn(uint32_t port, uint32_t _kmin, uint32_t _kmax, double _pmax)
 {
-    kmin[port] = _kmin * 1000;
-    kmax[port] = _kmax * 1000;
-    pmax[port] = _pmax;
+    Port& p = ConfigPort(port);
+    p.kmin = _kmin * 1000;
+    p.kmax = _kmax * 1000;
+    p.pmax = _pmax;
 }
 
 void
 SwitchMmu::ConfigHdrm(uint32_t port, uint32_t size)
 {
-    headroom[port] = size;
+    ConfigPort(port).headroom = size;
 }
 
 void
@@ -190,14 +204,38 @@ SwitchMmu::ConfigNPort(uint32_t n_port)
     total_rsrv = 0;
     for (uint32_t i = 1; i <= n_port; i++)
     {
-        total_hdrm += headroom[i];
+        total_hdrm += ConfigPort(i).headroom;
         total_rsrv += reserve;
     }
 }
 
+void
+SwitchMmu::AddPort(Ptr<NetDevice> dev)
+{
+    ConfigPort(dev->GetIfIndex());
+}
+
 void
 SwitchMmu::ConfigBufferSize(uint32_t size)
 {
     buffer_size = size;
 }
+
+uint64_t
+SwitchMmu::GetEgressBytes(uint32_t port, uint32_t qIndex)
+{
+    return GetPort(port).egress_bytes[qIndex];
+}
+
+uint32_t
+SwitchMmu::GetNPorts(void) const
+{
+    return m_ports.size();
+}
+
+uint64_t
+SwitchMmu::GetMemoryFootprint(void) const
+{
+    return sizeof(*this) + m_ports.capacity() * sizeof(Port);
+}
 } // namespace ns3
@@ -1,9 +1,12 @@
 #ifndef SWITCH_MMU_H
 #define SWITCH_MMU_H
 
+#include <ns3/assert.h>
 #include <ns3/node.h>
+#include <ns3/random-variable-stream.h>
 
 #include <unordered_map>
+#include <vector>
 
 namespace ns3
 {
@@ -13,7 +16,6 @@ class Packet;
 class SwitchMmu : public Object
 {
   public:
-    static const uint32_t pCnt = 1025; // Number of ports used
     static const uint32_t qCnt = 8;    // Number of queues/priorities used
 
     static TypeId GetTypeId(void);
@@ -42,26 +44,80 @@ class SwitchMmu : public Object
     void ConfigEcn(uint32_t port, uint32_t _kmin, uint32_t _kmax, double _pmax);
     void ConfigHdrm(uint32_t port, uint32_t size);
     void ConfigNPort(uint32_t n_port);
+    void AddPort(Ptr<NetDevice> dev); // holds the state of dev, see SwitchNode
     void ConfigBufferSize(uint32_t size);
 
+    uint64_t GetEgressBytes(uint32_t port, uint32_t qIndex);
+    uint32_t GetNPorts(void) const;
+    uint64_t GetMemoryFootprint(void) const; // approximate heap + object bytes
+    int64_t AssignStreams(int64_t stream);   // of the ECN marking, returns the streams used
+
+    // pfc_a_shift[port], kept for the drivers that set it directly
+    class PfcAlphaShift
+    {
+      public:
+        explicit PfcAlphaShift(SwitchMmu* mmu)
+            : m_mmu(mmu)
+        {
+        }
+
+        uint32_t& operator[](uint32_t port)
+        {
+            return m_mmu->ConfigPort(port).pfc_a_shift;
+        }
+
+      private:
+        SwitchMmu* m_mmu;
+    };
+
     // config
     uint32_t node_id;
     uint32_t buffer_size;
-    uint32_t pfc_a_shift[pCnt];
+    PfcAlphaShift pfc_a_shift;
     uint32_t reserve;
-    uint32_t headroom[pCnt];
     uint32_t resume_offset;
-    uint32_t kmin[pCnt], kmax[pCnt];
-    double pmax[pCnt];
     uint32_t total_hdrm;
     uint32_t total_rsrv;
 
     // runtime
     uint32_t shared_used_bytes;
-    uint32_t hdrm_bytes[pCnt][qCnt];
-    uint32_t ingress_bytes[pCnt][qCnt];
-    uint32_t paused[pCnt][qCnt];
-    uint64_t egress_bytes[pCnt][qCnt];
+
+  private:
+    // state of one port: each counter keeps the qCnt queues in one cache line,
+    // the ingress checks only touch the first one
+    struct alignas(64) Port
+    {
+        uint32_t hdrm_bytes[qCnt];
+        uint32_t ingress_bytes[qCnt];
+        uint64_t egress_bytes[qCnt];
+        uint32_t headroom;
+        uint32_t pfc_a_shift;
+        uint32_t kmin, kmax;
+        double pmax;
+        bool paused[qCnt];
+    };
+
+    // the ports are added, zeroed, by the switch devices and the configuration, so a
+    // switch only holds its radix
+    Port&
+    ConfigPort(uint32_t port)
+    {
+        if (port >= m_ports.size())
+        {
+            m_ports.resize(port + 1);
+        }
+        return m_ports[port];
+    }
+
+    Port&
+    GetPort(uint32_t port)
+    {
+        NS_ASSERT_MSG(port < m_ports.size(), "SwitchMmu: no port " << port);
+        return m_ports[port];
+    }
+
+    std::vector<Port> m_ports;
+    Ptr<UniformRandomVariable> m_ecnRv; // ECN marking, per switch for MTP
 };
 
 } /* namespace ns3 */
@@ -1,17 +1,20 @@
 #include "switch-node.h"
 
+#include "monitor-writer.h"
 #include "ppp-header.h"
 #include "qbb-net-device.h"
+#include "switch-footprint.h"
 
 #include "ns3/boolean.h"
 #include "ns3/double.h"
-#include "ns3/flow-id-tag.h"
 #include "ns3/int-header.h"
 #include "ns3/ipv4-header.h"
 #include "ns3/ipv4.h"
 #include "ns3/packet.h"
 #include "ns3/pause-header.h"
+#include "ns3/simple-seq-ts-header.h"
 #include "ns3/simulator.h"
+#include "ns3/udp-header.h"
 #include "ns3/uinteger.h"
 
 #include <cmath>
@@ -19,6 +22,37 @@
 namespace ns3
 {
 
+namespace
+{
+
+// offset of the ip header in the packets of QbbNetDevice
+uint32_t
+GetIpOffset(void)
+{
+    static const uint32_t offset = PppHeader().GetSerializedSize();
+    return offset;
+}
+
+// offset of the l4 header, after ppp and ip
+uint32_t
+GetL4Offset(void)
+{
+    static const uint32_t offset = GetIpOffset() + Ipv4Header().GetSerializedSize();
+    return offset;
+}
+
+// offset of the INT header in an RDMA data packet, within its SeqTs header
+uint32_t
+GetIntOffset(void)
+{
+    static const uint32_t offset = GetL4Offset() + UdpHeader().GetSerializedSize() +
+                                   SimpleSeqTsHeader().GetSerializedSize() -
+                                   IntHeader::GetStaticSize();
+    return offset;
+}
+
+} // namespace
+
 TypeId
 SwitchNode::GetTypeId(void)
 {
@@ -53,12 +87,9 @@ SwitchNode::SwitchNode()
     m_ecmpSeed = GetId();
     m_node_type = 1;
     m_mmu = CreateObject<SwitchMmu>();
+    RegisterDeviceAdditionListener(MakeCallback(&SwitchMmu::AddPort, m_mmu));
     for (uint32_t i = 0; i < pCnt; i++)
-        for (uint32_t j = 0; j < pCnt; j++)
-            for (uint32_t k = 0; k < qCnt; k++)
-                m_bytes[i][j][k] = 0;
-    for (uint32_t i = 0; i < pCnt; i++)
-        m_txBytes[i] = 0;
+        m_txBytes[i] = last_txBytes[i] = 0;
     for (uint32_t i = 0; i < pCnt; i++)
         m_lastPktSize[i] = m_lastPktTs[i] = 0;
     for (uint32_t i = 0; i < pCnt; i++)
@@ -69,14 +100,14 @@ int
 SwitchNode::GetOutDev(Ptr<const Packet> p, CustomHeader& ch)
 {
     // look up entries
-    auto entry = m_rtTable.find(ch.dip);
+    const std::vector<int>* entry = m_rtTable.Lookup(ch.dip);
 
     // no matching entry
-    if (entry == m_rtTable.end())
+    if (entry == nullptr)
         return -1;
 
     // entry found
-    auto& nexthops = entry->second;
+    auto& nexthops = *entry;
 
     // pick one next hop based on hash
     union {
@@ -142,9 +173,7 @@ SwitchNode::SendToDev(Ptr<Packet> p, CustomHeader& ch)
         // std::cout << "qIndex is: " << qIndex << std::endl;
 
         // admission control
-        FlowIdTag t;
-        p->PeekPacketTag(t);
-        uint32_t inDev = t.GetFlowId();
+        uint32_t inDev = p->GetIngressPort();
         if (qIndex != 0)
         { // not highest priority
             if (m_mmu->CheckIngressAdmission(inDev, qIndex, p->GetSize()) &&
@@ -152,6 +181,7 @@ SwitchNode::SendToDev(Ptr<Packet> p, CustomHeader& ch)
             { // Admission control
                 m_mmu->UpdateIngressAdmission(inDev, qIndex, p->GetSize());
                 m_mmu->UpdateEgressAdmission(idx, qIndex, p->GetSize());
+                m_bytes.Add(inDev, idx, qIndex, p->GetSize());
             }
             else
             {
@@ -159,7 +189,6 @@ SwitchNode::SendToDev(Ptr<Packet> p, CustomHeader& ch)
             }
             CheckAndSendPfc(inDev, qIndex);
         }
-        m_bytes[inDev][idx][qIndex] += p->GetSize();
         Ptr<QbbNetDevice> device = DynamicCast<QbbNetDevice>(GetDevice(idx));
         device->SwitchSend(qIndex, p, ch);
     }
@@ -223,13 +252,13 @@ void
 SwitchNode::AddTableEntry(Ipv4Address& dstAddr, uint32_t intf_idx)
 {
     uint32_t dip = dstAddr.Get();
-    m_rtTable[dip].push_back(intf_idx);
+    m_rtTable.AddEntry(dip, intf_idx);
 }
 
 void
 SwitchNode::ClearTable()
 {
-    m_rtTable.clear();
+    m_rtTable.Clear();
 }
 
 // This function can only be called in switch mode
@@ -243,39 +272,39 @@ SwitchNode::SwitchReceiveFromDevice(Ptr<NetDevice> device, Ptr<Packet> packet, C
 void
 SwitchNode::SwitchNotifyDequeue(uint32_t ifIndex, uint32_t qIndex, Ptr<Packet> p)
 {
-    FlowIdTag t;
-    p->PeekPacketTag(t);
     if (qIndex != 0)
     {
-        uint32_t inDev = t.GetFlowId();
+        uint32_t inDev = p->GetIngressPort();
         m_mmu->RemoveFromIngressAdmission(inDev, qIndex, p->GetSize());
         m_mmu->RemoveFromEgressAdmission(ifIndex, qIndex, p->GetSize());
-        m_bytes[inDev][ifIndex][qIndex] -= p->GetSize();
+        m_bytes.Remove(inDev, ifIndex, qIndex, p->GetSize());
         if (m_ecnEnabled)
         {
             bool egressCongested = m_mmu->ShouldSendCN(ifIndex, qIndex);
             if (egressCongested)
             {
-                PppHeader ppp;
-                Ipv4Header h;
-                p->RemoveHeader(ppp);
-                p->RemoveHeader(h);
-                h.SetEcn((Ipv4Header::EcnType)0x03);
-                p->AddHeader(h);
-                p->AddHeader(ppp);
+                Ipv4Header::SetEcn(p, PppHeader::GetStaticSize(), Ipv4Header::ECN_CE);
+                DynamicCast<QbbNetDevice>(GetDevice(ifIndex))->NotifyCongested();
             }
         }
         // CheckAndSendPfc(inDev, qIndex);
         CheckAndSendResume(inDev, qIndex);
     }
-    if (1)
+    if (m_ccMode == 3 || m_ccMode == 10)
     {
-        uint8_t* buf = new uint8_t[p->GetSize()];
-        p->CopyData(buf, p->GetSize());
-        if (buf[PppHeader::GetStaticSize() + 9] == 0x11)
-        { // udp packet
-            IntHeader* ih = (IntHeader*)&buf[PppHeader::GetStaticSize() + 20 + 8 +
-                                             6]; // ppp, ip, udp, SeqTs, INT
+        uint8_t buf[64]; // ppp, ip: enough to identify the packet
+        uint32_t l4Offset = GetL4Offset();
+        NS_ASSERT(l4Offset <= sizeof(buf));
+        IntHeader* ih = nullptr;
+        if (p->CopyData(buf, l4Offset) == l4Offset && buf[GetIpOffset() + 9] == 0x11)
+        { // udp packet, stamp the INT header in place
+            uint32_t intOffset = GetIntOffset();
+            NS_ASSERT_MSG(p->GetSize() >= intOffset + IntHeader::GetStaticSize(),
+                          "SwitchNode: udp packet too short for its INT header");
+            ih = p->PeekMutableHeader<IntHeader>(intOffset);
+        }
+        if (ih)
+        {
             Ptr<QbbNetDevice> dev = DynamicCast<QbbNetDevice>(GetDevice(ifIndex));
             if (m_ccMode == 3)
             { // HPCC
@@ -358,18 +387,29 @@ SwitchNode::SwitchNotifyDequeue(uint32_t ifIndex, uint32_t qIndex, Ptr<Packet> p
                 m_u[ifIndex] = newU;
             }
         }
-        delete[] buf;
     }
     m_txBytes[ifIndex] += p->GetSize();
     m_lastPktSize[ifIndex] = p->GetSize();
     m_lastPktTs[ifIndex] = Simulator::Now().GetTimeStep();
 }
 
+int
+SwitchNode::GetOutPort(CustomHeader& ch)
+{
+    return GetOutDev(nullptr, ch);
+}
+
+void
+SwitchNode::AddTxBytes(uint32_t ifIndex, uint64_t bytes)
+{
+    m_txBytes[ifIndex] += bytes;
+}
+
 int
 SwitchNode::logres_shift(int b, int l)
 {
-    static int data[] = {0, 0, 1, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4,
-                         5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5};
+    static const int data[] = {0, 0, 1, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4,
+                               5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5};
     return l - data[b];
 }
 
@@ -394,42 +434,46 @@ SwitchNode::log2apprx(int x, int b, int m, int l)
 
 // for monitor
 /**
- * outoput format:
+ * output format:
  * time, sw_id, port_id, q_id, qlen, port_len
  */
 void
 SwitchNode::PrintSwitchQlen(FILE* qlen_output)
 {
     uint32_t n_dev = this->GetNDevices();
+    if (last_qlen.size() < n_dev * qCnt)
+    {
+        last_qlen.resize(n_dev * qCnt, 0);
+    }
     for (uint32_t i = 1; i < n_dev; ++i)
     {
         uint64_t port_len = 0;
         for (uint32_t j = 0; j < qCnt; ++j)
         {
-            port_len += m_mmu->egress_bytes[i][j];
-        }
-        if (port_len == last_port_qlen[i])
-        {
-            continue;
+            port_len += m_mmu->GetEgressBytes(i, j);
         }
+        // only the queues that changed since the last sampling
         for (uint32_t j = 0; j < qCnt; ++j)
         {
-            fprintf(qlen_output,
-                    "%lu, %u, %u, %u, %lu, %lu\n",
-                    Simulator::Now().GetTimeStep(),
-                    GetId(),
-                    i,
-                    j,
-                    m_mmu->egress_bytes[i][j],
-                    port_len);
-            fflush(qlen_output);
+            uint64_t& last = last_qlen[i * qCnt + j];
+            if (m_mmu->GetEgressBytes(i, j) == last)
+            {
+                continue;
+            }
+            last = m_mmu->GetEgressBytes(i, j);
+            MonitorWriter::WriteQlen(qlen_output,
+                                     Simulator::Now().GetTimeStep(),
+                                     GetId(),
+                                     i,
+                                     j,
+                                     last,
+                                     port_len);
         }
-        last_port_qlen[i] = port_len;
     }
 }
 
 /**
- * outoput format:
+ * output format:
  * time, sw_id, port_id, bandwidth
  */
 void
@@ -444,10 +488,31 @@ SwitchNode::PrintSwitchBw(FILE* bw_output, uint32_t bw_mon_interval)
         }
         double bw = (m_txBytes[i] - last_txBytes[i]) * 8 * 1e6 / bw_mon_interval; // bit/s
         bw = bw * 1.0 / 1e9;                                                      // Gbps
-        fprintf(bw_output, "%lu, %u, %u, %f\n", Simulator::Now().GetTimeStep(), GetId(), i, bw);
-        fflush(bw_output);
+        MonitorWriter::WriteBw(bw_output,
+                               MonitorWriter::SWITCH_BW,
+                               Simulator::Now().GetTimeStep(),
+                               GetId(),
+                               i,
+                               bw);
         last_txBytes[i] = m_txBytes[i];
     }
 }
 
+uint64_t
+SwitchNode::GetMemoryFootprint(void)
+{
+    return GetSwitchFootprint(sizeof(*this), m_mmu, m_rtTable, m_bytes);
+}
+
+void
+SwitchNode::PrintMemoryFootprint(FILE* mem_output)
+{
+    PrintSwitchFootprint(mem_output,
+                         GetId(),
+                         GetNodeType(),
+                         GetMemoryFootprint(),
+                         m_rtTable,
+                         m_bytes);
+}
+
 } /* namespace ns3 */
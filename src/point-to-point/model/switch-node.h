@@ -1,13 +1,16 @@
 #ifndef SWITCH_NODE_H
 #define SWITCH_NODE_H
 
+#include "forwarding-table.h"
 #include "pint.h"
 #include "qbb-net-device.h"
+#include "switch-byte-counter.h"
 #include "switch-mmu.h"
 
 #include <ns3/node.h>
 
 #include <unordered_map>
+#include <vector>
 
 namespace ns3
 {
@@ -19,13 +22,11 @@ class SwitchNode : public Node
     static const uint32_t pCnt = 1025; // Number of ports used
     static const uint32_t qCnt = 8;    // Number of queues/priorities used
     uint32_t m_ecmpSeed;
-    std::unordered_map<uint32_t, std::vector<int>>
-        m_rtTable; // map from ip address (u32) to possible ECMP port (index of dev)
+    ForwardingTable m_rtTable; // map from ip address (u32) to possible ECMP port (index of dev)
     std::set<uint32_t> active_ports; // record active ports in switch
 
     // monitor of PFC
-    uint32_t m_bytes[pCnt][pCnt][qCnt]; // m_bytes[inDev][outDev][qidx] is the bytes from inDev
-                                        // enqueued for outDev at qidx
+    SwitchByteCounter m_bytes; // bytes from inDev enqueued for outDev at qidx
 
     uint64_t m_txBytes[pCnt]; // counter of tx bytes
 
@@ -57,6 +58,8 @@ class SwitchNode : public Node
     void ClearTable();
     bool SwitchReceiveFromDevice(Ptr<NetDevice> device, Ptr<Packet> packet, CustomHeader& ch);
     void SwitchNotifyDequeue(uint32_t ifIndex, uint32_t qIndex, Ptr<Packet> p);
+    int GetOutPort(CustomHeader& ch); // egress port of a packet with the headers ch, -1 if none
+    void AddTxBytes(uint32_t ifIndex, uint64_t bytes); // bytes sent without packets, e.g. fluid
 
     // for approximate calc in PINT
     int logres_shift(int b, int l);
@@ -65,18 +68,23 @@ class SwitchNode : public Node
 
     // for monitor
     uint64_t last_txBytes[pCnt];   // last sampling of the counter of tx bytes
-    uint64_t last_port_qlen[pCnt]; // last sampling of the port length
+    std::vector<uint64_t> last_qlen; // last sampling of each queue, [port * qCnt + queue]
 
     /**
-     * outoput format:
+     * output format:
      * time, sw_id, port_id, q_id, qlen, port_len
+     * one line per queue whose qlen changed since the last call, through MonitorWriter
      */
     void PrintSwitchQlen(FILE* qlen_output);
     /**
-     * outoput format:
+     * output format:
      * time, sw_id, port_id, txBytes
      */
     void PrintSwitchBw(FILE* bw_output, uint32_t bw_mon_interval);
+
+    // approximate bytes held by this switch (object, tables and byte accounting)
+    uint64_t GetMemoryFootprint(void);
+    void PrintMemoryFootprint(FILE* mem_output); // see PrintSwitchFootprint()
 };
 
 } /* namespace ns3 */
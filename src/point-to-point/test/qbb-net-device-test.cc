@@ -0,0 +1,499 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include "rdma-test-fixture.h"
+
+#include "ns3/broadcom-egress-queue.h"
+#include "ns3/custom-header.h"
+#include "ns3/data-rate.h"
+#include "ns3/enum.h"
+#include "ns3/node.h"
+#include "ns3/packet.h"
+#include "ns3/qbb-net-device.h"
+#include "ns3/rdma-hw.h"
+#include "ns3/rdma-queue-pair.h"
+#include "ns3/simulator.h"
+#include "ns3/test.h"
+#include "ns3/uinteger.h"
+
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * \brief Test the round-robin and bucket bookkeeping of RdmaEgressQueue
+ */
+class RdmaEgressQueueTest : public TestCase
+{
+  public:
+    RdmaEgressQueueTest();
+    void DoRun() override;
+
+  private:
+    /**
+     * \brief Pick and dequeue the next qp, as QbbNetDevice does
+     * \param eq the queue
+     * \param paused paused state per pg
+     * \return the index of the qp, or -1024 if none can send
+     */
+    int SendNext(Ptr<RdmaEgressQueue> eq, bool paused[]);
+    /**
+     * \brief Stand-in for RdmaHw::GetNxtPacket
+     * \param qp the qp to send from
+     * \return a 1000 byte packet
+     */
+    Ptr<Packet> GetNxtPacket(Ptr<RdmaQueuePair> qp);
+    /**
+     * \brief Check the send order after the test time is reached
+     */
+    void CheckRateBlocked(Ptr<RdmaEgressQueue> eq);
+};
+
+RdmaEgressQueueTest::RdmaEgressQueueTest()
+    : TestCase("RdmaEgressQueue")
+{
+}
+
+Ptr<Packet>
+RdmaEgressQueueTest::GetNxtPacket(Ptr<RdmaQueuePair> qp)
+{
+    qp->snd_nxt += 1000;
+    return Create<Packet>(1000);
+}
+
+int
+RdmaEgressQueueTest::SendNext(Ptr<RdmaEgressQueue> eq, bool paused[])
+{
+    int idx = eq->GetNextQindex(paused);
+    if (idx >= 0)
+    {
+        Ptr<RdmaQueuePair> qp = eq->GetQp(idx);
+        eq->DequeueQindex(idx);
+        qp->m_nextAvail = Simulator::Now(); // no rate limit by default
+    }
+    return idx;
+}
+
+void
+RdmaEgressQueueTest::CheckRateBlocked(Ptr<RdmaEgressQueue> eq)
+{
+    bool paused[RdmaEgressQueue::qCnt] = {false};
+    // qps 1 and 2 were rate-blocked until now, the other one is drained
+    NS_TEST_EXPECT_MSG_EQ(SendNext(eq, paused), 1, "rate-blocked qp released in time");
+    NS_TEST_EXPECT_MSG_EQ(SendNext(eq, paused), 2, "rate-blocked qp released in time");
+    NS_TEST_EXPECT_MSG_EQ(SendNext(eq, paused), -1024, "nothing else to send");
+    NS_TEST_EXPECT_MSG_EQ(eq->GetNextAvail(),
+                          Simulator::GetMaximumSimulationTime(),
+                          "no rate-blocked qp left");
+}
+
+void
+RdmaEgressQueueTest::DoRun()
+{
+    Ptr<RdmaEgressQueue> eq = CreateObject<RdmaEgressQueue>();
+    eq->m_qpGrp = CreateObject<RdmaQueuePairGroup>();
+    eq->m_rdmaGetNxtPkt = MakeCallback(&RdmaEgressQueueTest::GetNxtPacket, this);
+    bool paused[RdmaEgressQueue::qCnt] = {false};
+
+    std::vector<Ptr<RdmaQueuePair>> qps;
+    for (uint16_t i = 0; i < 3; i++)
+    {
+        Ptr<RdmaQueuePair> qp = CreateObject<RdmaQueuePair>(3,
+                                                            Ipv4Address("11.0.0.1"),
+                                                            Ipv4Address("11.0.1.1"),
+                                                            10000 + i,
+                                                            100);
+        qp->SetSize(2000);
+        eq->m_qpGrp->AddQp(qp);
+        qps.push_back(qp);
+    }
+
+    // round-robin starts behind m_rrlast
+    int expected[] = {1, 2, 0, 1, 2, 0};
+    for (int e : expected)
+    {
+        NS_TEST_EXPECT_MSG_EQ(SendNext(eq, paused), e, "round-robin order");
+    }
+    NS_TEST_EXPECT_MSG_EQ(SendNext(eq, paused), -1024, "all qps drained");
+
+    // a NACK makes qp 2 send again, unless its pg is paused
+    qps[2]->snd_nxt = 1000;
+    eq->UpdateQp(qps[2]);
+    paused[3] = true;
+    NS_TEST_EXPECT_MSG_EQ(SendNext(eq, paused), -1024, "pg paused");
+    paused[3] = false;
+    NS_TEST_EXPECT_MSG_EQ(SendNext(eq, paused), 2, "recovered qp");
+
+    // finished qps are removed from the group
+    qps[0]->Acknowledge(2000);
+    qps[2]->Acknowledge(2000);
+    eq->UpdateQp(qps[0]);
+    eq->UpdateQp(qps[2]);
+    NS_TEST_EXPECT_MSG_EQ(SendNext(eq, paused), -1024, "qp 1 drained");
+    NS_TEST_EXPECT_MSG_EQ(eq->GetFlowCount(), 1, "finished qps compacted");
+    NS_TEST_EXPECT_MSG_EQ(qps[1]->m_eqIdx, 0, "index of the remaining qp");
+
+    // qps waiting for m_nextAvail are picked once the time is reached
+    for (uint16_t i = 0; i < 2; i++)
+    {
+        Ptr<RdmaQueuePair> qp = CreateObject<RdmaQueuePair>(3,
+                                                            Ipv4Address("11.0.0.1"),
+                                                            Ipv4Address("11.0.1.1"),
+                                                            10003 + i,
+                                                            100);
+        qp->SetSize(1000);
+        qp->m_nextAvail = MicroSeconds(1 + 2 * i);
+        eq->m_qpGrp->AddQp(qp);
+        qps.push_back(qp);
+    }
+    NS_TEST_EXPECT_MSG_EQ(SendNext(eq, paused), -1024, "new qps are rate-blocked");
+    NS_TEST_EXPECT_MSG_EQ(eq->GetNextAvail(), MicroSeconds(1), "earliest release time");
+    // a rate change moves the release time of a rate-blocked qp
+    qps[4]->m_nextAvail = NanoSeconds(500);
+    eq->UpdateQp(qps[4]);
+    NS_TEST_EXPECT_MSG_EQ(eq->GetNextAvail(), NanoSeconds(500), "decreased release time");
+    qps[4]->m_nextAvail = NanoSeconds(1000);
+    eq->UpdateQp(qps[4]);
+    NS_TEST_EXPECT_MSG_EQ(eq->GetNextAvail(), MicroSeconds(1), "increased release time");
+    Simulator::Schedule(MicroSeconds(1), &RdmaEgressQueueTest::CheckRateBlocked, this, eq);
+    Simulator::Run();
+    Simulator::Destroy();
+}
+
+/**
+ * \brief Test CustomHeader::FastParse and the lazy INT decode against Deserialize
+ */
+class CustomHeaderFastParseTest : public TestCase
+{
+  public:
+    CustomHeaderFastParseTest();
+    void DoRun() override;
+
+  private:
+    /**
+     * \brief Parse a packet both ways and compare the forwarding fields and INT
+     * \param h the headers to send
+     */
+    void Compare(CustomHeader& h);
+};
+
+CustomHeaderFastParseTest::CustomHeaderFastParseTest()
+    : TestCase("CustomHeaderFastParse")
+{
+}
+
+void
+CustomHeaderFastParseTest::Compare(CustomHeader& h)
+{
+    Ptr<Packet> p = Create<Packet>(100);
+    p->AddHeader(h);
+
+    uint32_t type = CustomHeader::L2_Header | CustomHeader::L3_Header | CustomHeader::L4_Header;
+    CustomHeader full(type);
+    CustomHeader fast(type);
+    full.getInt = 1;
+    uint32_t size = p->PeekHeader(full);
+    NS_TEST_EXPECT_MSG_EQ(fast.FastParse(p), size, "parsed size");
+    NS_TEST_EXPECT_MSG_EQ(fast.intParsed, false, "INT is not decoded by FastParse");
+    NS_TEST_EXPECT_MSG_EQ(fast.sip, full.sip, "sip");
+    NS_TEST_EXPECT_MSG_EQ(fast.dip, full.dip, "dip");
+    NS_TEST_EXPECT_MSG_EQ(fast.l3Prot, full.l3Prot, "l3Prot");
+    NS_TEST_EXPECT_MSG_EQ(fast.m_tos, full.m_tos, "tos");
+    NS_TEST_EXPECT_MSG_EQ(fast.ipid, full.ipid, "ipid");
+    if (h.l3Prot == 0x11)
+    {
+        NS_TEST_EXPECT_MSG_EQ(fast.udp.sport, full.udp.sport, "udp sport");
+        NS_TEST_EXPECT_MSG_EQ(fast.udp.dport, full.udp.dport, "udp dport");
+        NS_TEST_EXPECT_MSG_EQ(fast.udp.seq, full.udp.seq, "udp seq");
+        NS_TEST_EXPECT_MSG_EQ(fast.udp.pg, full.udp.pg, "udp pg");
+        fast.ParseInt(p);
+        NS_TEST_EXPECT_MSG_EQ(fast.udp.ih.IntHeader_t.nhop,
+                              h.udp.ih.IntHeader_t.nhop,
+                              "udp INT nhop");
+        NS_TEST_EXPECT_MSG_EQ(fast.udp.ih.IntHeader_t.hop[0].GetQlen(),
+                              h.udp.ih.IntHeader_t.hop[0].GetQlen(),
+                              "udp INT");
+    }
+    else if (h.l3Prot == 0xFC)
+    {
+        NS_TEST_EXPECT_MSG_EQ(fast.ack.sport, full.ack.sport, "ack sport");
+        NS_TEST_EXPECT_MSG_EQ(fast.ack.dport, full.ack.dport, "ack dport");
+        NS_TEST_EXPECT_MSG_EQ(fast.ack.flags, full.ack.flags, "ack flags");
+        NS_TEST_EXPECT_MSG_EQ(fast.ack.pg, full.ack.pg, "ack pg");
+        NS_TEST_EXPECT_MSG_EQ(fast.ack.seq, full.ack.seq, "ack seq");
+        fast.ParseInt(p);
+        NS_TEST_EXPECT_MSG_EQ(fast.ack.ih.IntHeader_t.nhop,
+                              h.ack.ih.IntHeader_t.nhop,
+                              "ack INT nhop");
+        NS_TEST_EXPECT_MSG_EQ(fast.ack.ih.IntHeader_t.hop[0].GetQlen(),
+                              h.ack.ih.IntHeader_t.hop[0].GetQlen(),
+                              "ack INT");
+    }
+    else if (h.l3Prot == 0xFE)
+    {
+        NS_TEST_EXPECT_MSG_EQ(fast.pfc.time, full.pfc.time, "pfc time");
+        NS_TEST_EXPECT_MSG_EQ(fast.pfc.qlen, full.pfc.qlen, "pfc qlen");
+        NS_TEST_EXPECT_MSG_EQ((uint32_t)fast.pfc.qIndex, (uint32_t)full.pfc.qIndex, "pfc qIndex");
+    }
+    NS_TEST_EXPECT_MSG_EQ(fast.intParsed, (h.l3Prot == 0x11 || h.l3Prot == 0xFC), "INT decoded");
+}
+
+void
+CustomHeaderFastParseTest::DoRun()
+{
+    IntHeader::mode = IntHeader::NORMAL;
+    CustomHeader h(CustomHeader::L2_Header | CustomHeader::L3_Header | CustomHeader::L4_Header);
+    h.m_tos = 4;
+    h.ipid = 0x1234;
+    h.m_ttl = 64;
+    h.sip = Ipv4Address("11.0.0.1").Get();
+    h.dip = Ipv4Address("11.0.1.1").Get();
+
+    h.l3Prot = 0x11;
+    h.udp.sport = 10000;
+    h.udp.dport = 100;
+    h.udp.payload_size = 100;
+    h.udp.seq = 0x0102030405060708lu;
+    h.udp.pg = 3;
+    h.udp.ih = IntHeader();
+    h.udp.ih.PushHop(1, 2000, 300, 100000000000lu);
+    Compare(h);
+
+    h.l3Prot = 0xFC;
+    h.ack.sport = 100;
+    h.ack.dport = 10000;
+    h.ack.flags = 1;
+    h.ack.pg = 3;
+    h.ack.seq = 0x0102030405060708lu;
+    h.ack.ih = IntHeader();
+    h.ack.ih.PushHop(1, 2000, 300, 100000000000lu);
+    Compare(h);
+
+    h.l3Prot = 0xFE;
+    h.pfc.time = 5;
+    h.pfc.qlen = 0x10203;
+    h.pfc.qIndex = 3;
+    Compare(h);
+    IntHeader::mode = IntHeader::NONE;
+}
+
+/**
+ * \brief Test the priority queues of BEgressQueue, sized to NumPriorities
+ */
+class BEgressQueueTest : public TestCase
+{
+  public:
+    BEgressQueueTest();
+    void DoRun() override;
+};
+
+BEgressQueueTest::BEgressQueueTest()
+    : TestCase("BEgressQueue")
+{
+}
+
+void
+BEgressQueueTest::DoRun()
+{
+    Ptr<BEgressQueue> q =
+        CreateObjectWithAttributes<BEgressQueue>("NumPriorities", UintegerValue(3));
+    NS_TEST_EXPECT_MSG_EQ(q->GetNPriorities(), 3, "priorities");
+    // enough packets for the rings to grow
+    for (uint32_t i = 0; i < 40; i++)
+    {
+        q->Enqueue(Create<Packet>(100 + i), 1 + i % 2);
+    }
+    q->Enqueue(Create<Packet>(50), 0);
+    NS_TEST_EXPECT_MSG_EQ(q->GetNBytes(0), 50, "queue 0 bytes");
+    NS_TEST_EXPECT_MSG_EQ(q->GetNBytes(1), 20 * 100 + 380, "queue 1 bytes");
+    NS_TEST_EXPECT_MSG_EQ(q->GetNBytes(5), 0, "no such queue");
+    NS_TEST_EXPECT_MSG_EQ(q->GetNBytesTotal(), 40 * 100 + 780 + 50, "total bytes");
+
+    bool paused[BEgressQueue::qCnt] = {};
+    paused[0] = true;
+    // queue 0 goes first, even when paused
+    NS_TEST_EXPECT_MSG_EQ(q->DequeueRR(paused)->GetSize(), 50, "strict priority");
+    NS_TEST_EXPECT_MSG_EQ(q->GetLastQueue(), 0, "last queue");
+    // then round robin over 1 and 2, each in FIFO order
+    for (uint32_t i = 0; i < 40; i++)
+    {
+        Ptr<Packet> p = q->DequeueRR(paused);
+        NS_TEST_ASSERT_MSG_NE(p, nullptr, "packet " << i);
+        NS_TEST_EXPECT_MSG_EQ(p->GetSize(), 100 + i, "order");
+        NS_TEST_EXPECT_MSG_EQ(q->GetLastQueue(), 1 + i % 2, "last queue");
+        if (i == 5)
+        {
+            // queue 0 is used again once drained
+            q->Enqueue(Create<Packet>(100), 0);
+            NS_TEST_EXPECT_MSG_EQ(q->DequeueRR(paused)->GetSize(), 100, "strict priority");
+        }
+    }
+    NS_TEST_EXPECT_MSG_EQ(q->GetNBytesTotal(), 0, "drained");
+
+    q->Enqueue(Create<Packet>(100), 2);
+    paused[2] = true;
+    NS_TEST_EXPECT_MSG_EQ(q->DequeueRR(paused), nullptr, "queue 2 paused");
+    paused[2] = false;
+    NS_TEST_EXPECT_MSG_NE(q->DequeueRR(paused), nullptr, "queue 2 resumed");
+}
+
+/**
+ * \brief Test the DWRR and strict priority modes of BEgressQueue
+ */
+class BEgressQueueSchedulingTest : public TestCase
+{
+  public:
+    BEgressQueueSchedulingTest();
+    void DoRun() override;
+};
+
+BEgressQueueSchedulingTest::BEgressQueueSchedulingTest()
+    : TestCase("BEgressQueue scheduling modes")
+{
+}
+
+void
+BEgressQueueSchedulingTest::DoRun()
+{
+    Ptr<BEgressQueue> q = CreateObjectWithAttributes<BEgressQueue>("SchedulingMode",
+                                                                   EnumValue(BEgressQueue::DWRR),
+                                                                   "Quantum",
+                                                                   UintegerValue(1000));
+    q->SetQuantum(2, 3000);
+    for (uint32_t i = 0; i < 40; i++)
+    {
+        q->Enqueue(Create<Packet>(1000), 1);
+        q->Enqueue(Create<Packet>(1000), 2);
+    }
+    // queue 2 has three times the weight of queue 1
+    uint32_t sent[3] = {};
+    for (uint32_t i = 0; i < 40; i++)
+    {
+        q->DequeueRR(0u);
+        sent[q->GetLastQueue()]++;
+    }
+    NS_TEST_EXPECT_MSG_EQ(sent[1], 10, "queue 1 share");
+    NS_TEST_EXPECT_MSG_EQ(sent[2], 30, "queue 2 share");
+    // a paused queue gives its turn away
+    q->DequeueRR(1u << 2);
+    NS_TEST_EXPECT_MSG_EQ(q->GetLastQueue(), 1, "queue 2 paused");
+
+    q = CreateObjectWithAttributes<BEgressQueue>("SchedulingMode", EnumValue(BEgressQueue::SP));
+    q->Enqueue(Create<Packet>(100), 5);
+    q->Enqueue(Create<Packet>(100), 3);
+    q->Enqueue(Create<Packet>(100), 3);
+    q->DequeueRR(0u);
+    NS_TEST_EXPECT_MSG_EQ(q->GetLastQueue(), 3, "lowest index first");
+    q->DequeueRR(1u << 3);
+    NS_TEST_EXPECT_MSG_EQ(q->GetLastQueue(), 5, "queue 3 paused");
+    q->Enqueue(Create<Packet>(100), 0);
+    q->DequeueRR(1u);
+    NS_TEST_EXPECT_MSG_EQ(q->GetLastQueue(), 0, "queue 0 is never paused");
+}
+
+/**
+ * \brief Test that QbbNetDevice tells RdmaHw about its sent data packets when
+ * their transmission completes, and only about those
+ */
+class QbbSentCallbackTest : public TestCase
+{
+  public:
+    QbbSentCallbackTest();
+    void DoRun() override;
+
+  private:
+    Ptr<Packet> GetNxtPacket(Ptr<RdmaQueuePair> qp);
+    void PktSent(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, Time interframeGap);
+    void UpdateTxBytes(uint32_t port, uint64_t bytes);
+    void Sent(Ptr<RdmaQueuePair> qp);
+
+    std::vector<std::pair<Ptr<RdmaQueuePair>, Time>> m_sent;
+};
+
+QbbSentCallbackTest::QbbSentCallbackTest()
+    : TestCase("QbbSentCallback")
+{
+}
+
+Ptr<Packet>
+QbbSentCallbackTest::GetNxtPacket(Ptr<RdmaQueuePair> qp)
+{
+    qp->snd_nxt += 1000;
+    return Create<Packet>(1000);
+}
+
+void
+QbbSentCallbackTest::PktSent(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, Time interframeGap)
+{
+}
+
+void
+QbbSentCallbackTest::UpdateTxBytes(uint32_t port, uint64_t bytes)
+{
+}
+
+void
+QbbSentCallbackTest::Sent(Ptr<RdmaQueuePair> qp)
+{
+    m_sent.emplace_back(qp, Simulator::Now());
+}
+
+void
+QbbSentCallbackTest::DoRun()
+{
+    // 1ns per byte
+    Ptr<QbbNetDevice> devA = QbbLink(CreateObject<Node>(), CreateObject<Node>()).first;
+
+    devA->m_rdmaEQ->m_qpGrp = CreateObject<RdmaQueuePairGroup>();
+    devA->m_rdmaEQ->m_rdmaGetNxtPkt = MakeCallback(&QbbSentCallbackTest::GetNxtPacket, this);
+    devA->m_rdmaPktSent = MakeCallback(&QbbSentCallbackTest::PktSent, this);
+    devA->m_rdmaUpdateTxBytes = MakeCallback(&QbbSentCallbackTest::UpdateTxBytes, this);
+    devA->m_rdmaSentCb = MakeCallback(&QbbSentCallbackTest::Sent, this);
+
+    // an ACK goes first, from the high priority queue, then 3 data packets
+    Ptr<RdmaQueuePair> qp = CreateObject<RdmaQueuePair>(3,
+                                                        Ipv4Address("11.0.0.1"),
+                                                        Ipv4Address("11.0.1.1"),
+                                                        10000,
+                                                        100);
+    qp->SetSize(3000);
+    devA->m_rdmaEQ->m_qpGrp->AddQp(qp);
+    devA->RdmaEnqueueHighPrioQ(Create<Packet>(60));
+    devA->NewQp(qp);
+    Simulator::Run();
+
+    NS_TEST_ASSERT_MSG_EQ(m_sent.size(), 3, "one notification per data packet");
+    for (uint32_t i = 0; i < m_sent.size(); i++)
+    {
+        NS_TEST_EXPECT_MSG_EQ(m_sent[i].first, qp, "QP of the packet");
+        NS_TEST_EXPECT_MSG_EQ(m_sent[i].second,
+                              NanoSeconds(60 + 1000 * (i + 1)),
+                              "notified at the end of the transmission");
+    }
+    Simulator::Destroy();
+}
+
+/**
+ * \brief TestSuite for QbbNetDevice and its egress queues
+ */
+class QbbNetDeviceTestSuite : public TestSuite
+{
+  public:
+    /**
+     * \brief Constructor
+     */
+    QbbNetDeviceTestSuite();
+};
+
+QbbNetDeviceTestSuite::QbbNetDeviceTestSuite()
+    : TestSuite("devices-point-to-point-qbb", Type::UNIT)
+{
+    AddTestCase(new RdmaEgressQueueTest, TestCase::Duration::QUICK);
+    AddTestCase(new CustomHeaderFastParseTest, TestCase::Duration::QUICK);
+    AddTestCase(new BEgressQueueTest, TestCase::Duration::QUICK);
+    AddTestCase(new BEgressQueueSchedulingTest, TestCase::Duration::QUICK);
+    AddTestCase(new QbbSentCallbackTest, TestCase::Duration::QUICK);
+}
+
+static QbbNetDeviceTestSuite g_qbbNetDeviceTestSuite; //!< The testsuite
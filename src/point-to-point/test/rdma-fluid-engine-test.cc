@@ -0,0 +1,215 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include "rdma-test-fixture.h"
+
+#include "ns3/custom-header.h"
+#include "ns3/data-rate.h"
+#include "ns3/packet.h"
+#include "ns3/qbb-net-device.h"
+#include "ns3/rdma-driver.h"
+#include "ns3/rdma-fluid-engine.h"
+#include "ns3/rdma-hw.h"
+#include "ns3/rdma-queue-pair.h"
+#include "ns3/simulator.h"
+#include "ns3/test.h"
+#include "ns3/uinteger.h"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * \brief Test that RdmaFluidEngine fast forwards a qp on an idle path with the
+ * timing, the byte counts, the receiver state and the completion of packet
+ * mode, and drops it back to packet mode when another packet goes out on its
+ * path
+ */
+class RdmaFluidEngineTest : public TestCase
+{
+  public:
+    RdmaFluidEngineTest();
+    void DoRun() override;
+
+  private:
+    struct Result
+    {
+        std::vector<uint32_t> sent;  // send completions per qp
+        std::vector<int64_t> done;   // time step of the last one per qp
+        std::vector<int64_t> times;  // time steps of those of the first qp
+        std::vector<int64_t> acked;  // time step of the completion per qp, on its last ACK
+        uint64_t rxSeq;              // next seq the receiver of the first qp expects
+        uint64_t txBytes;            // of the NIC of h0
+        uint64_t events;
+        uint64_t started;            // flows fast forwarded
+        uint32_t fluid;              // flows still fluid at the end
+    };
+
+    /**
+     * \brief Send 200 packets from h0 to h1 through a switch. At 100us, cross
+     * 1 adds a qp of 20 packets on h0, cross 2 sends a packet from the switch
+     * port to h1. Without sink, nothing counts the send completions.
+     */
+    Result Run(bool fluid, uint32_t cross, bool sink = true);
+    void Sent(Ptr<RdmaQueuePair> qp);
+    void Completed(Ptr<RdmaQueuePair> qp);
+
+    Result m_result;
+};
+
+RdmaFluidEngineTest::RdmaFluidEngineTest()
+    : TestCase("RdmaFluidEngine")
+{
+}
+
+void
+RdmaFluidEngineTest::Sent(Ptr<RdmaQueuePair> qp)
+{
+    m_result.sent[qp->GetTag()]++;
+    m_result.done[qp->GetTag()] = Simulator::Now().GetTimeStep();
+    if (qp->GetTag() == 0)
+        m_result.times.push_back(Simulator::Now().GetTimeStep());
+}
+
+void
+RdmaFluidEngineTest::Completed(Ptr<RdmaQueuePair> qp)
+{
+    m_result.acked[qp->GetTag()] = Simulator::Now().GetTimeStep();
+}
+
+RdmaFluidEngineTest::Result
+RdmaFluidEngineTest::Run(bool fluid, uint32_t cross, bool sink)
+{
+    m_result = Result{{0, 0}, {0, 0}, {}, {0, 0}, 0, 0, 0, 0, 0};
+    RdmaStar star(2, DataRate("8Gb/s"), MicroSeconds(1));
+    Ptr<RdmaFluidEngine> engine = CreateObject<RdmaFluidEngine>();
+    Ptr<RdmaHw> hw[2];
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        hw[i] = CreateObject<RdmaHw>();
+        hw[i]->SetAttribute("Mtu", UintegerValue(1000));
+        hw[i]->SetAttribute("L2AckInterval", UintegerValue(1));
+        if (fluid)
+            hw[i]->SetFluidEngine(engine);
+        Ptr<RdmaDriver> driver = InstallRdma(star.hosts[i], hw[i]);
+        if (sink)
+            driver->TraceConnectWithoutContext("SendComplete",
+                                               MakeCallback(&RdmaFluidEngineTest::Sent, this));
+        driver->TraceConnectWithoutContext("QpComplete",
+                                           MakeCallback(&RdmaFluidEngineTest::Completed, this));
+    }
+    star.Route();
+
+    Ipv4Address sip = star.GetAddress(0);
+    Ipv4Address dip = star.GetAddress(1);
+    hw[0]->AddQueuePair(0, 1, 0, 200000, 3, sip, dip, 10000, 100, 0, 4000, {}, {});
+    if (cross == 1)
+    {
+        Simulator::Schedule(MicroSeconds(100),
+                            &RdmaHw::AddQueuePair,
+                            hw[0],
+                            0,
+                            1,
+                            1,
+                            20000,
+                            3,
+                            sip,
+                            dip,
+                            10001,
+                            100,
+                            0,
+                            4000,
+                            Callback<void>(),
+                            Callback<void>());
+    }
+    else if (cross == 2)
+    {
+        CustomHeader ch;
+        Simulator::Schedule(MicroSeconds(100),
+                            &QbbNetDevice::SwitchSend,
+                            star.switchDevs[1],
+                            0,
+                            Create<Packet>(60),
+                            ch);
+    }
+    Simulator::Run();
+    m_result.rxSeq = hw[1]->GetRxQp(dip.Get(), sip.Get(), 100, 10000, 3, false)
+                         ->ReceiverNextExpectedSeq;
+    m_result.txBytes = hw[0]->tx_bytes[0];
+    m_result.events = Simulator::GetEventCount();
+    m_result.started = engine->GetNStarted();
+    m_result.fluid = engine->GetNFluid();
+    Simulator::Destroy();
+    return m_result;
+}
+
+void
+RdmaFluidEngineTest::DoRun()
+{
+    Result packet = Run(false, 0);
+    Result fluid = Run(true, 0);
+    NS_TEST_EXPECT_MSG_EQ(packet.sent[0], 200, "packets sent");
+    NS_TEST_EXPECT_MSG_EQ(fluid.sent[0], 200, "one completion per packet");
+    NS_TEST_EXPECT_MSG_EQ(fluid.done[0], packet.done[0], "same completion time");
+    NS_TEST_EXPECT_MSG_EQ((fluid.times == packet.times), true, "same send completion times");
+    NS_TEST_EXPECT_MSG_EQ(fluid.txBytes, packet.txBytes, "same tx bytes");
+    NS_TEST_EXPECT_MSG_EQ(packet.rxSeq, 200000, "all received");
+    NS_TEST_EXPECT_MSG_EQ(fluid.rxSeq, 200000, "all received");
+    NS_TEST_EXPECT_MSG_GT(packet.acked[0], packet.done[0], "completed on the last ACK");
+    NS_TEST_EXPECT_MSG_EQ(fluid.acked[0], packet.acked[0], "same time of the last ACK");
+    NS_TEST_EXPECT_MSG_EQ(fluid.started, 1, "fast forwarded");
+    // one event per packet is left for the send completions, without a sink none
+    fluid = Run(true, 0, false);
+    NS_TEST_EXPECT_MSG_EQ(fluid.started, 1, "fast forwarded");
+    NS_TEST_EXPECT_MSG_EQ(fluid.txBytes, packet.txBytes, "same tx bytes");
+    NS_TEST_EXPECT_MSG_LT(fluid.events * 10, packet.events, "fewer events");
+
+    // a packet of the switch port stops the flow, which goes on where it was
+    fluid = Run(true, 2);
+    NS_TEST_EXPECT_MSG_EQ(fluid.sent[0], 200, "packets sent");
+    NS_TEST_EXPECT_MSG_EQ(fluid.done[0], packet.done[0], "same completion time");
+    NS_TEST_EXPECT_MSG_EQ((fluid.times == packet.times), true, "same send completion times");
+    NS_TEST_EXPECT_MSG_EQ(fluid.rxSeq, 200000, "all received");
+    NS_TEST_EXPECT_MSG_GT(fluid.acked[0], 0, "completed");
+    NS_TEST_EXPECT_MSG_EQ(fluid.started, 2, "fast forwarded again");
+
+    // the second qp stops the flow, which starts again once it is alone, and
+    // once more after the last packets of the second qp left the switch port
+    packet = Run(false, 1);
+    fluid = Run(true, 1);
+    NS_TEST_EXPECT_MSG_EQ(fluid.sent[0], 200, "packets sent");
+    NS_TEST_EXPECT_MSG_EQ(fluid.sent[1], 20, "packets of the second qp");
+    NS_TEST_EXPECT_MSG_EQ(fluid.txBytes, packet.txBytes, "same tx bytes");
+    NS_TEST_EXPECT_MSG_EQ(fluid.started, 3, "fast forwarded again");
+    NS_TEST_EXPECT_MSG_EQ(fluid.fluid, 0, "all flows completed");
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        // the second qp starts at once instead of after the packet on the wire
+        int64_t err = std::abs(fluid.done[i] - packet.done[i]);
+        NS_TEST_EXPECT_MSG_LT_OR_EQ(err, NanoSeconds(1100).GetTimeStep(), "completion time");
+        err = std::abs(fluid.acked[i] - packet.acked[i]);
+        NS_TEST_EXPECT_MSG_LT_OR_EQ(err, NanoSeconds(1100).GetTimeStep(), "time of the last ACK");
+    }
+}
+
+/**
+ * \brief TestSuite for RdmaFluidEngine
+ */
+class RdmaFluidEngineTestSuite : public TestSuite
+{
+  public:
+    /**
+     * \brief Constructor
+     */
+    RdmaFluidEngineTestSuite();
+};
+
+RdmaFluidEngineTestSuite::RdmaFluidEngineTestSuite()
+    : TestSuite("devices-point-to-point-fluid", Type::UNIT)
+{
+    AddTestCase(new RdmaFluidEngineTest, TestCase::Duration::QUICK);
+}
+
+static RdmaFluidEngineTestSuite g_rdmaFluidEngineTestSuite; //!< The testsuite
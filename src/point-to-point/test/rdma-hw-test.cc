@@ -0,0 +1,661 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include "rdma-test-fixture.h"
+
+#include "ns3/boolean.h"
+#include "ns3/custom-header.h"
+#include "ns3/data-rate.h"
+#include "ns3/global-value.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/monitor-writer.h"
+#include "ns3/packet.h"
+#include "ns3/ppp-header.h"
+#include "ns3/qbb-header.h"
+#include "ns3/qbb-helper.h"
+#include "ns3/qbb-net-device.h"
+#include "ns3/rdma-congestion-control.h"
+#include "ns3/rdma-driver.h"
+#include "ns3/rdma-hw.h"
+#include "ns3/rdma-queue-pair.h"
+#include "ns3/rdma-timer-wheel.h"
+#include "ns3/simulator.h"
+#include "ns3/switch-node.h"
+#include "ns3/test.h"
+#include "ns3/uinteger.h"
+#ifdef NS3_MTP
+#include "ns3/multithreaded-simulator-impl.h"
+#endif
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * \brief Test that the header template of RdmaHw::GetNxtPacket gives the same
+ * bytes as adding the headers one by one, ip checksum included
+ */
+class RdmaHeaderTemplateTest : public TestCase
+{
+  public:
+    RdmaHeaderTemplateTest();
+    void DoRun() override;
+
+  private:
+    /**
+     * \brief Send two packets of a qp through both paths and compare them
+     * \param mode the IntHeader mode
+     * \param checksum the value of the ChecksumEnabled global
+     */
+    void Compare(IntHeader::Mode mode, bool checksum);
+};
+
+RdmaHeaderTemplateTest::RdmaHeaderTemplateTest()
+    : TestCase("RdmaHeaderTemplate")
+{
+}
+
+void
+RdmaHeaderTemplateTest::Compare(IntHeader::Mode mode, bool checksum)
+{
+    IntHeader::mode = mode;
+    GlobalValue::Bind("ChecksumEnabled", BooleanValue(checksum));
+    Ptr<RdmaHw> hw[2] = {CreateObject<RdmaHw>(), CreateObject<RdmaHw>()};
+    hw[1]->SetAttribute("HeaderTemplate", BooleanValue(false));
+    Ptr<RdmaQueuePair> qp[2];
+    for (uint32_t k = 0; k < 2; k++)
+    {
+        qp[k] = CreateObject<RdmaQueuePair>(3,
+                                            Ipv4Address("11.0.0.1"),
+                                            Ipv4Address("11.0.1.1"),
+                                            10000,
+                                            100);
+        qp[k]->SetSize(hw[k]->m_mtu + 100); // one full and one short packet
+        qp[k]->m_ipid = 0xfffe;
+    }
+    for (uint32_t n = 0; n < 2; n++)
+    {
+        Ptr<Packet> p[2];
+        std::vector<uint8_t> bytes[2];
+        for (uint32_t k = 0; k < 2; k++)
+        {
+            p[k] = hw[k]->GetNxtPacket(qp[k]);
+            bytes[k].resize(p[k]->GetSize());
+            p[k]->CopyData(bytes[k].data(), bytes[k].size());
+        }
+        NS_TEST_EXPECT_MSG_EQ(p[0]->GetSize(), p[1]->GetSize(), "packet size");
+        NS_TEST_EXPECT_MSG_EQ((bytes[0] == bytes[1]), true, "packet bytes, mode " << mode);
+
+        RdmaHeaderTemplate hdr;
+        p[0]->PeekHeader(hdr);
+        NS_TEST_EXPECT_MSG_EQ(hdr.GetSeq(), n * hw[0]->m_mtu, "seq of the template");
+        NS_TEST_EXPECT_MSG_EQ(hdr.GetIpid(), (uint16_t)(0xfffe + n), "ipid of the template");
+        uint32_t ipLen = (bytes[0][2 + 2] << 8) | bytes[0][2 + 3];
+        NS_TEST_EXPECT_MSG_EQ(ipLen, p[0]->GetSize() - 2, "ip total length of the template");
+
+        Ptr<Packet> copy = p[0]->Copy();
+        PppHeader ppp;
+        copy->RemoveHeader(ppp);
+        Ipv4Header ip;
+        ip.EnableChecksum();
+        copy->RemoveHeader(ip);
+        uint32_t sum = (bytes[0][2 + 10] << 8) | bytes[0][2 + 11];
+        if (checksum)
+            NS_TEST_EXPECT_MSG_EQ(ip.IsChecksumOk(), true, "ip checksum of the template");
+        else
+            NS_TEST_EXPECT_MSG_EQ(sum, 0, "no ip checksum");
+    }
+    IntHeader::mode = IntHeader::NONE;
+    GlobalValue::Bind("ChecksumEnabled", BooleanValue(false));
+}
+
+void
+RdmaHeaderTemplateTest::DoRun()
+{
+    Compare(IntHeader::NORMAL, false);
+    Compare(IntHeader::TS, false);
+    Compare(IntHeader::NONE, false);
+    Compare(IntHeader::NORMAL, true);
+}
+
+/**
+ * \brief Test the NIC index and flow hash cached on RdmaQueuePair
+ */
+class RdmaNicIdxCacheTest : public TestCase
+{
+  public:
+    RdmaNicIdxCacheTest();
+    void DoRun() override;
+};
+
+RdmaNicIdxCacheTest::RdmaNicIdxCacheTest()
+    : TestCase("RdmaNicIdxCache")
+{
+}
+
+void
+RdmaNicIdxCacheTest::DoRun()
+{
+    Ptr<RdmaHw> hw = CreateObject<RdmaHw>();
+    hw->m_gpus_per_server = 8;
+    Ipv4Address dip("11.0.1.1");
+    Ptr<RdmaQueuePair> qp =
+        CreateObject<RdmaQueuePair>(3, Ipv4Address("11.0.0.1"), dip, 10000, 100);
+    qp->SetSrc(0);
+    qp->SetDest(8); // another server, routed through the switch
+    hw->m_qpMap[RdmaHw::GetQpKey(dip.Get(), qp->sport, qp->m_pg)] = qp;
+    NS_TEST_EXPECT_MSG_EQ(qp->GetHash(), qp->ComputeHash(), "cached flow hash");
+
+    hw->AddTableEntry(dip, 1, false);
+    NS_TEST_EXPECT_MSG_EQ(hw->GetNicIdxOfQp(qp), 1, "looked up nic index");
+    hw->ClearTable();
+    hw->AddTableEntry(dip, 2, false);
+    NS_TEST_EXPECT_MSG_EQ(hw->GetNicIdxOfQp(qp), 1, "nic index stays cached");
+    hw->InvalidateNicIdx();
+    NS_TEST_EXPECT_MSG_EQ(hw->GetNicIdxOfQp(qp), 2, "nic index looked up again");
+}
+
+/**
+ * \brief Test that a QP only carries the congestion control state of its CcMode
+ */
+class RdmaQpCcStateTest : public TestCase
+{
+  public:
+    RdmaQpCcStateTest();
+    void DoRun() override;
+};
+
+RdmaQpCcStateTest::RdmaQpCcStateTest()
+    : TestCase("RdmaQpCcState")
+{
+}
+
+void
+RdmaQpCcStateTest::DoRun()
+{
+    Ptr<RdmaQueuePair> qp = CreateObject<RdmaQueuePair>(3,
+                                                        Ipv4Address("11.0.0.1"),
+                                                        Ipv4Address("11.0.1.1"),
+                                                        10000,
+                                                        100);
+    uint64_t bare = qp->GetMemoryFootprint();
+    NS_TEST_EXPECT_MSG_EQ(qp->GetCcMode(), 0, "no state before SetCcMode");
+
+    qp->SetCcMode(1);
+    NS_TEST_EXPECT_MSG_EQ(qp->GetCcMode(), 1, "DCQCN");
+    NS_TEST_EXPECT_MSG_EQ(qp->Mlx().m_first_cnp, true, "initial DCQCN state");
+    NS_TEST_EXPECT_MSG_EQ(qp->GetMemoryFootprint(),
+                          bare + sizeof(RdmaQueuePair::DcqcnState),
+                          "only the DCQCN state");
+    qp->Mlx().m_first_cnp = false;
+
+    qp->SetCcMode(3);
+    NS_TEST_EXPECT_MSG_EQ(qp->Hp().u, 1, "initial HPCC state");
+    NS_TEST_EXPECT_MSG_EQ(qp->Hp().hopState[IntHeader::maxHop - 1].u, 1, "initial hop state");
+    NS_TEST_EXPECT_MSG_EQ(qp->GetMemoryFootprint(),
+                          bare + sizeof(RdmaQueuePair::HpccState),
+                          "only the HPCC state");
+
+    // a state given back to the pool is reset when it is reused
+    qp->SetCcMode(1);
+    NS_TEST_EXPECT_MSG_EQ(qp->Mlx().m_first_cnp, true, "reused DCQCN state reset");
+    qp->SetCcMode(8);
+    NS_TEST_EXPECT_MSG_EQ(qp->Dctcp().m_alpha, 1, "initial DCTCP state");
+    qp->SetCcMode(2);
+    NS_TEST_EXPECT_MSG_EQ(qp->GetCcMode(), 0, "no state for other modes");
+    NS_TEST_EXPECT_MSG_EQ(qp->GetMemoryFootprint(), bare, "state freed");
+}
+
+/**
+ * \brief Test the congestion control algorithms behind RdmaCongestionControl
+ */
+class RdmaCongestionControlTest : public TestCase
+{
+  public:
+    RdmaCongestionControlTest();
+    void DoRun() override;
+};
+
+RdmaCongestionControlTest::RdmaCongestionControlTest()
+    : TestCase("RdmaCongestionControl")
+{
+}
+
+void
+RdmaCongestionControlTest::DoRun()
+{
+    // each CcMode gets its algorithm, which binds the QP state of that mode
+    uint32_t modes[] = {0, 1, 3, 7, 8, 10};
+    for (uint32_t mode : modes)
+    {
+        Ptr<RdmaCongestionControl> cc = RdmaCongestionControl::CreateForMode(mode);
+        NS_TEST_EXPECT_MSG_EQ(cc->GetCcMode(), mode, "algorithm of the mode");
+    }
+    NS_TEST_EXPECT_MSG_EQ(RdmaCongestionControl::CreateForMode(2)->GetCcMode(),
+                          0,
+                          "no algorithm");
+
+    Ptr<RdmaHw> hw = CreateObject<RdmaHw>();
+    hw->SetCongestionControl(RdmaCongestionControl::CreateForMode(3));
+    Ptr<RdmaQueuePair> qp = CreateObject<RdmaQueuePair>(3,
+                                                        Ipv4Address("11.0.0.1"),
+                                                        Ipv4Address("11.0.1.1"),
+                                                        10000,
+                                                        100);
+    hw->GetCongestionControl()->InitQp(qp, DataRate("100Gb/s"));
+    NS_TEST_EXPECT_MSG_EQ(qp->GetCcMode(), 3, "HPCC state");
+    NS_TEST_EXPECT_MSG_EQ(qp->Hp().m_curRate, DataRate("100Gb/s"), "HPCC starts at line rate");
+
+    // DCTCP halves the rate on the first ECN echo, alpha being 1
+    hw->SetCongestionControl(RdmaCongestionControl::CreateForMode(8));
+    hw->GetCongestionControl()->InitQp(qp, DataRate("100Gb/s"));
+    qp->m_rate = qp->m_max_rate = DataRate("100Gb/s");
+    qp->snd_nxt = 5000;
+    CustomHeader ch;
+    ch.ack.seq = 1000;
+    ch.ack.flags = 1 << qbbHeader::FLAG_CNP;
+    hw->GetCongestionControl()->OnAck(qp, Create<Packet>(), ch);
+    NS_TEST_EXPECT_MSG_EQ(qp->m_rate, DataRate("50Gb/s"), "DCTCP rate cut");
+    NS_TEST_EXPECT_MSG_EQ(qp->Dctcp().m_caState, 1, "DCTCP in CWR");
+    hw->GetCongestionControl()->OnAck(qp, Create<Packet>(), ch);
+    NS_TEST_EXPECT_MSG_EQ(qp->m_rate, DataRate("50Gb/s"), "one cut per window");
+}
+
+/**
+ * \brief Test the expiry times, order and batching of RdmaTimerWheel
+ */
+class RdmaTimerWheelTest : public TestCase
+{
+  public:
+    RdmaTimerWheelTest();
+    void DoRun() override;
+
+  private:
+    void Fire(uint32_t timer);
+    void FireAndReschedule(uint32_t timer);
+
+    RdmaTimerWheel m_wheel;
+    std::vector<std::pair<uint32_t, int64_t>> m_fired; // timer, expiry time step
+};
+
+RdmaTimerWheelTest::RdmaTimerWheelTest()
+    : TestCase("RdmaTimerWheel")
+{
+}
+
+void
+RdmaTimerWheelTest::Fire(uint32_t timer)
+{
+    m_fired.emplace_back(timer, Simulator::Now().GetTimeStep());
+}
+
+void
+RdmaTimerWheelTest::FireAndReschedule(uint32_t timer)
+{
+    Fire(timer);
+    m_wheel.Schedule(Time(0), MakeCallback(&RdmaTimerWheelTest::Fire, this, timer + 1));
+}
+
+void
+RdmaTimerWheelTest::DoRun()
+{
+    // exact times: one event per distinct time, in the order of scheduling
+    m_wheel.Schedule(NanoSeconds(3), MakeCallback(&RdmaTimerWheelTest::Fire, this, 0u));
+    m_wheel.Schedule(NanoSeconds(1), MakeCallback(&RdmaTimerWheelTest::Fire, this, 1u));
+    RdmaTimerWheel::TimerId canceled =
+        m_wheel.Schedule(NanoSeconds(1), MakeCallback(&RdmaTimerWheelTest::Fire, this, 2u));
+    m_wheel.Schedule(NanoSeconds(1), MakeCallback(&RdmaTimerWheelTest::Fire, this, 3u));
+    NS_TEST_EXPECT_MSG_EQ(m_wheel.IsPending(canceled), true, "pending");
+    m_wheel.Cancel(canceled);
+    NS_TEST_EXPECT_MSG_EQ(canceled, 0, "canceled id cleared");
+    m_wheel.Cancel(canceled);
+    NS_TEST_EXPECT_MSG_EQ(m_wheel.GetNPending(), 3, "pending timers");
+    NS_TEST_EXPECT_MSG_EQ(m_wheel.GetNEvents(), 2, "one event per time");
+    Simulator::Run();
+    std::vector<std::pair<uint32_t, int64_t>> expected{{1, 1}, {3, 1}, {0, 3}};
+    NS_TEST_EXPECT_MSG_EQ((m_fired == expected), true, "exact expiry times");
+    NS_TEST_EXPECT_MSG_EQ(m_wheel.GetNPending(), 0, "all expired");
+
+    // with a tick, the timers of a tick expire together at its end
+    m_fired.clear();
+    m_wheel.SetTick(MicroSeconds(1));
+    Time start = Simulator::Now();
+    m_wheel.Schedule(NanoSeconds(700), MakeCallback(&RdmaTimerWheelTest::Fire, this, 0u));
+    m_wheel.Schedule(NanoSeconds(300),
+                     MakeCallback(&RdmaTimerWheelTest::FireAndReschedule, this, 1u));
+    m_wheel.Schedule(NanoSeconds(1500), MakeCallback(&RdmaTimerWheelTest::Fire, this, 5u));
+    NS_TEST_EXPECT_MSG_EQ(m_wheel.GetNEvents(), 4, "one event per tick");
+    Simulator::Run();
+    int64_t tick = MicroSeconds(1).GetTimeStep();
+    expected = {{0, tick}, {1, tick}, {2, tick}, {5, 2 * tick}};
+    NS_TEST_EXPECT_MSG_EQ(start.GetTimeStep(), 3, "start of the second run");
+    NS_TEST_EXPECT_MSG_EQ((m_fired == expected), true, "batched expiry times");
+    Simulator::Destroy();
+}
+
+/**
+ * \brief Test that RdmaHw reuses a qp once it is deleted, compacted out of the
+ * qpGrp of its nic and held by nothing else, and a deleted rx qp
+ */
+class RdmaQpPoolTest : public TestCase
+{
+  public:
+    RdmaQpPoolTest();
+    void DoRun() override;
+
+  private:
+    void Finished(void);
+
+    uint32_t m_finished;
+};
+
+RdmaQpPoolTest::RdmaQpPoolTest()
+    : TestCase("RdmaQpPool")
+{
+}
+
+void
+RdmaQpPoolTest::Finished(void)
+{
+    m_finished++;
+}
+
+void
+RdmaQpPoolTest::DoRun()
+{
+    m_finished = 0;
+    RdmaStar star(2, DataRate("8Gb/s"), Time(0));
+    Ptr<RdmaHw> hw = CreateObject<RdmaHw>();
+    hw->SetAttribute("Mtu", UintegerValue(1000));
+    InstallRdma(star.hosts[0], hw);
+    Ptr<RdmaHw> rxHw = CreateObject<RdmaHw>();
+    InstallRdma(star.hosts[1], rxHw);
+    star.Route();
+    Ptr<QbbNetDevice> dev = star.hostDevs[0];
+    Ptr<RdmaQueuePairGroup> qpGrp = dev->m_rdmaEQ->m_qpGrp;
+
+    Ipv4Address sip = star.GetAddress(0);
+    Ipv4Address dip = star.GetAddress(1);
+    Callback<void> finished = MakeCallback(&RdmaQpPoolTest::Finished, this);
+    hw->AddQueuePair(0, 1, 0, 1000, 3, sip, dip, 10000, 100, 0, 4000, finished, {});
+    Ptr<RdmaQueuePair> qp = hw->GetQp(dip.Get(), 10000, 3);
+    RdmaQueuePair* first = PeekPointer(qp);
+    qp->m_cnpCount = 3;
+    Simulator::Run(); // the packet is sent, which releases the qp from the device
+    NS_TEST_EXPECT_MSG_EQ(rxHw->GetRxQp(dip.Get(), sip.Get(), 100, 10000, 3, false),
+                          nullptr,
+                          "no rx qp kept without ACKs");
+
+    // acked as ReceiveAck does, and compacted out of the qpGrp on the next send
+    qp->Acknowledge(1000);
+    hw->QpComplete(qp);
+    dev->m_rdmaEQ->UpdateQp(qp);
+    dev->TriggerTransmit();
+    NS_TEST_EXPECT_MSG_EQ(m_finished, 1, "qp completed");
+    NS_TEST_EXPECT_MSG_EQ(qpGrp->GetN(), 0, "qp compacted");
+
+    // still held here
+    hw->AddQueuePair(0, 1, 1, 1000, 3, sip, dip, 10001, 100, 0, 4000, finished, {});
+    Ptr<RdmaQueuePair> second = hw->GetQp(dip.Get(), 10001, 3);
+    NS_TEST_EXPECT_MSG_NE(PeekPointer(second), first, "held qp not reused");
+
+    qp = nullptr;
+    hw->AddQueuePair(0, 1, 2, 3000, 3, sip, dip, 10002, 100, 0, 4000, finished, {});
+    qp = hw->GetQp(dip.Get(), 10002, 3);
+    NS_TEST_EXPECT_MSG_EQ(PeekPointer(qp), first, "deleted qp reused");
+    uint32_t inGrp = 0;
+    for (uint32_t i = 0; i < qpGrp->GetN(); i++)
+    {
+        inGrp += PeekPointer(qpGrp->Get(i)) == first;
+    }
+    NS_TEST_EXPECT_MSG_EQ(inGrp, 1, "reused qp once in the qpGrp");
+    NS_TEST_EXPECT_MSG_EQ(qp->snd_una, 0, "reset snd_una");
+    NS_TEST_EXPECT_MSG_EQ(qp->m_size, 3000, "size of the new flow");
+    NS_TEST_EXPECT_MSG_EQ(qp->GetTag(), 2, "tag of the new flow");
+    NS_TEST_EXPECT_MSG_EQ(qp->sport, 10002, "sport of the new flow");
+    NS_TEST_EXPECT_MSG_EQ(qp->GetHash(), qp->ComputeHash(), "flow hash of the new flow");
+    NS_TEST_EXPECT_MSG_EQ(qp->m_cnpCount, 0, "reset cnp counter");
+    NS_TEST_EXPECT_MSG_EQ(hw->m_qpList.size(), hw->m_qpMap.size(), "qp list of the live qps");
+    for (uint32_t i = 0; i < hw->m_qpList.size(); i++)
+    {
+        NS_TEST_EXPECT_MSG_EQ(hw->m_qpList[i]->m_hwIdx, i, "index in the qp list");
+    }
+
+    Ptr<RdmaRxQueuePair> rxQp = hw->GetRxQp(1, 2, 3, 4, 3, true);
+    RdmaRxQueuePair* firstRx = PeekPointer(rxQp);
+    rxQp->ReceiverNextExpectedSeq = 1000;
+    rxQp = nullptr;
+    hw->DeleteRxQp(2, 3, 4);
+    rxQp = hw->GetRxQp(5, 6, 7, 8, 3, true);
+    NS_TEST_EXPECT_MSG_EQ(PeekPointer(rxQp), firstRx, "deleted rx qp reused");
+    NS_TEST_EXPECT_MSG_EQ(rxQp->ReceiverNextExpectedSeq, 0, "reset expected seq");
+    NS_TEST_EXPECT_MSG_EQ(rxQp->sip, 5, "sip of the new flow");
+    NS_TEST_EXPECT_MSG_EQ(hw->GetRxQp(1, 2, 3, 4, 3, false), nullptr, "old rx qp deleted");
+    Simulator::Destroy();
+}
+
+/**
+ * \brief Test the buffering and the record formats of MonitorWriter
+ */
+class MonitorWriterTest : public TestCase
+{
+  public:
+    MonitorWriterTest();
+    void DoRun() override;
+};
+
+MonitorWriterTest::MonitorWriterTest()
+    : TestCase("MonitorWriter")
+{
+}
+
+void
+MonitorWriterTest::DoRun()
+{
+    FILE* f = tmpfile();
+    NS_TEST_ASSERT_MSG_NE(f, nullptr, "temporary file");
+    uint32_t bufferSize = MonitorWriter::GetBufferSize();
+
+    MonitorWriter::SetFormat(MonitorWriter::TEXT);
+    MonitorWriter::SetBufferSize(1024);
+    MonitorWriter::WriteQlen(f, 1000, 5, 2, 3, 4096, 8192);
+    MonitorWriter::WriteBw(f, MonitorWriter::SWITCH_BW, 1000, 5, 2, 12.5);
+    MonitorWriter::WriteQp(f, MonitorWriter::QP_RATE, 1000, 1, 2, 10000, 100, 65536, 100000000000);
+    NS_TEST_EXPECT_MSG_EQ(ftell(f), 0, "records are buffered");
+    MonitorWriter::Flush();
+    std::string expected = "1000, 5, 2, 3, 4096, 8192\n"
+                           "1000, 5, 2, 12.500000\n"
+                           "1000, 1, 2, 10000, 100, 65536, 100000000000\n";
+    std::string text(expected.size() + 1, '\0');
+    rewind(f);
+    text.resize(fread(&text[0], 1, text.size(), f));
+    NS_TEST_EXPECT_MSG_EQ(text, expected, "text records");
+
+    // packed records: type, time and fields
+    MonitorWriter::SetFormat(MonitorWriter::BINARY);
+    fseek(f, 0, SEEK_END);
+    long start = ftell(f);
+    MonitorWriter::WriteQlen(f, 1000, 5, 2, 3, 4096, 8192);
+    MonitorWriter::WriteBw(f, MonitorWriter::HOST_BW, 1000, 5, 2, 12.5);
+    MonitorWriter::WriteQp(f, MonitorWriter::QP_CNP, 1000, 1, 2, 10000, 100, 65536, 7);
+    MonitorWriter::Flush();
+    NS_TEST_EXPECT_MSG_EQ(ftell(f) - start, 37 + 25 + 37, "binary record sizes");
+    fseek(f, start, SEEK_SET);
+    uint8_t type = 0;
+    uint64_t time = 0;
+    NS_TEST_EXPECT_MSG_EQ(fread(&type, 1, 1, f), 1, "read type");
+    NS_TEST_EXPECT_MSG_EQ(fread(&time, 8, 1, f), 1, "read time"); // little-endian host
+    NS_TEST_EXPECT_MSG_EQ((uint32_t)type, MonitorWriter::QLEN, "record type");
+    NS_TEST_EXPECT_MSG_EQ(time, 1000, "record time");
+
+    // without a buffer every record goes out at once
+    MonitorWriter::SetBufferSize(0);
+    fseek(f, 0, SEEK_END);
+    start = ftell(f);
+    MonitorWriter::WriteBw(f, MonitorWriter::HOST_BW, 1000, 5, 2, 12.5);
+    NS_TEST_EXPECT_MSG_EQ(ftell(f) - start, 25, "unbuffered record");
+
+    // what is left in the buffers goes out at Simulator::Destroy()
+    MonitorWriter::SetBufferSize(1024);
+    MonitorWriter::WriteBw(f, MonitorWriter::HOST_BW, 1000, 5, 2, 12.5);
+    NS_TEST_EXPECT_MSG_EQ(ftell(f) - start, 25, "record is buffered");
+    Simulator::Destroy();
+    NS_TEST_EXPECT_MSG_EQ(ftell(f) - start, 50, "record flushed at destroy");
+
+    MonitorWriter::SetFormat(MonitorWriter::TEXT);
+    MonitorWriter::SetBufferSize(bufferSize);
+    fclose(f);
+}
+
+#ifdef NS3_MTP
+/**
+ * \brief Test that an incast through a switch with ECN marking completes at
+ * the same times with the multithreaded simulator, at any thread count, as
+ * with the default one: the RDMA and switch models keep no state shared
+ * between the nodes, and draw from their own random streams
+ */
+class RdmaMtpTest : public TestCase
+{
+  public:
+    RdmaMtpTest();
+    void DoRun() override;
+
+  private:
+    /**
+     * \brief h0 and h1 send 100 packets each to h2 through a switch, with the
+     * multithreaded simulator if threads > 0. Returns the completion time step
+     * of each qp, on its last ACK.
+     */
+    std::vector<int64_t> Run(uint32_t threads);
+    void Completed(Ptr<RdmaQueuePair> qp);
+
+    std::vector<int64_t> m_done; // one slot per qp, each written by the LP of its sender
+};
+
+RdmaMtpTest::RdmaMtpTest()
+    : TestCase("RdmaMtp")
+{
+}
+
+void
+RdmaMtpTest::Completed(Ptr<RdmaQueuePair> qp)
+{
+    m_done[qp->GetTag()] = Simulator::Now().GetTimeStep();
+}
+
+std::vector<int64_t>
+RdmaMtpTest::Run(uint32_t threads)
+{
+    Ptr<MultithreadedSimulatorImpl> impl;
+    if (threads > 0)
+    {
+        impl = CreateObject<MultithreadedSimulatorImpl>();
+        impl->SetAttribute("MaxThreads", UintegerValue(threads));
+        Simulator::SetImplementation(impl);
+    }
+    m_done.assign(2, 0);
+    RdmaStar star(3, DataRate("8Gb/s"), MicroSeconds(1));
+    Ptr<SwitchNode> sw = star.sw;
+    sw->SetAttribute("EcnEnabled", BooleanValue(true));
+    sw->SetAttribute("CcMode", UintegerValue(1));
+    NetDeviceContainer devs;
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        devs.Add(star.hostDevs[i]);
+        devs.Add(star.switchDevs[i]);
+        sw->m_mmu->ConfigEcn(star.switchDevs[i]->GetIfIndex(), 5, 40, 0.5);
+    }
+    QbbHelper qbb;
+    NS_TEST_EXPECT_MSG_EQ(qbb.AssignStreams(devs, 0), 7, "a stream per device and switch");
+    Ptr<RdmaHw> hw[3];
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        hw[i] = CreateObject<RdmaHw>();
+        hw[i]->SetAttribute("Mtu", UintegerValue(1000));
+        hw[i]->SetAttribute("L2AckInterval", UintegerValue(1));
+        hw[i]->SetAttribute("CcMode", UintegerValue(1));
+        Ptr<RdmaDriver> driver = InstallRdma(star.hosts[i], hw[i]);
+        driver->TraceConnectWithoutContext("QpComplete",
+                                           MakeCallback(&RdmaMtpTest::Completed, this));
+    }
+    star.Route();
+
+    Ipv4Address dip = star.GetAddress(2);
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        // in the LP of the sender
+        Ipv4Address sip = star.GetAddress(i);
+        Simulator::ScheduleWithContext(star.hosts[i]->GetId(),
+                                       Time(0),
+                                       &RdmaHw::AddQueuePair,
+                                       hw[i],
+                                       0,
+                                       2,
+                                       i,
+                                       100000,
+                                       3,
+                                       sip,
+                                       dip,
+                                       10000 + i,
+                                       100,
+                                       0,
+                                       4000,
+                                       Callback<void>(),
+                                       Callback<void>());
+    }
+    Simulator::Run();
+    if (threads > 0)
+    {
+        NS_TEST_EXPECT_MSG_EQ(impl->GetSystemCount(), 5, "an LP per node, and the public one");
+    }
+    Simulator::Destroy();
+    return m_done;
+}
+
+void
+RdmaMtpTest::DoRun()
+{
+    std::vector<int64_t> expected = Run(0);
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        NS_TEST_ASSERT_MSG_GT(expected[i], 0, "qp " << i << " completed");
+    }
+    for (uint32_t threads : {1, 2, 4})
+    {
+        std::vector<int64_t> done = Run(threads);
+        NS_TEST_EXPECT_MSG_EQ((done == expected), true, "same times with " << threads);
+    }
+}
+#endif
+
+/**
+ * \brief TestSuite for RdmaHw
+ */
+class RdmaHwTestSuite : public TestSuite
+{
+  public:
+    /**
+     * \brief Constructor
+     */
+    RdmaHwTestSuite();
+};
+
+RdmaHwTestSuite::RdmaHwTestSuite()
+    : TestSuite("devices-point-to-point-rdma-hw", Type::UNIT)
+{
+    AddTestCase(new RdmaHeaderTemplateTest, TestCase::Duration::QUICK);
+    AddTestCase(new RdmaNicIdxCacheTest, TestCase::Duration::QUICK);
+    AddTestCase(new RdmaQpCcStateTest, TestCase::Duration::QUICK);
+    AddTestCase(new RdmaCongestionControlTest, TestCase::Duration::QUICK);
+    AddTestCase(new RdmaTimerWheelTest, TestCase::Duration::QUICK);
+    AddTestCase(new RdmaQpPoolTest, TestCase::Duration::QUICK);
+    AddTestCase(new MonitorWriterTest, TestCase::Duration::QUICK);
+#ifdef NS3_MTP
+    AddTestCase(new RdmaMtpTest, TestCase::Duration::QUICK);
+#endif
+}
+
+static RdmaHwTestSuite g_rdmaHwTestSuite; //!< The testsuite
@@ -0,0 +1,74 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include "rdma-test-fixture.h"
+
+#include "ns3/broadcom-egress-queue.h"
+#include "ns3/qbb-channel.h"
+#include "ns3/rdma-route-helper.h"
+
+namespace ns3
+{
+
+std::pair<Ptr<QbbNetDevice>, Ptr<QbbNetDevice>>
+QbbLink(Ptr<Node> a, Ptr<Node> b, DataRate rate, Time delay)
+{
+    Ptr<QbbChannel> channel = CreateObject<QbbChannel>();
+    channel->SetAttribute("Delay", TimeValue(delay));
+    Ptr<QbbNetDevice> devA = CreateObject<QbbNetDevice>();
+    Ptr<QbbNetDevice> devB = CreateObject<QbbNetDevice>();
+    devA->SetQueue(CreateObject<BEgressQueue>());
+    devB->SetQueue(CreateObject<BEgressQueue>());
+    devA->SetDataRate(rate);
+    devB->SetDataRate(rate);
+    a->AddDevice(devA);
+    b->AddDevice(devB);
+    devA->Attach(channel);
+    devB->Attach(channel);
+    return {devA, devB};
+}
+
+Ptr<RdmaDriver>
+InstallRdma(Ptr<Node> host, Ptr<RdmaHw> hw)
+{
+    Ptr<RdmaDriver> driver = CreateObject<RdmaDriver>();
+    driver->SetNode(host);
+    driver->SetRdmaHw(hw);
+    host->AggregateObject(driver);
+    driver->Init();
+    return driver;
+}
+
+RdmaStar::RdmaStar(uint32_t nHosts, DataRate rate, Time delay)
+{
+    for (uint32_t i = 0; i < nHosts; i++)
+    {
+        hosts.push_back(CreateObject<Node>());
+        nodes.Add(hosts[i]);
+    }
+    sw = CreateObject<SwitchNode>();
+    nodes.Add(sw);
+    for (uint32_t i = 0; i < nHosts; i++)
+    {
+        std::pair<Ptr<QbbNetDevice>, Ptr<QbbNetDevice>> devs = QbbLink(hosts[i], sw, rate, delay);
+        hostDevs.push_back(devs.first);
+        switchDevs.push_back(devs.second);
+    }
+}
+
+void
+RdmaStar::Route(void)
+{
+    RdmaRouteHelper routes;
+    routes.Compute(nodes);
+    routes.Install();
+}
+
+Ipv4Address
+RdmaStar::GetAddress(uint32_t i) const
+{
+    return RdmaRouteHelper::GetNodeAddress(hosts[i]->GetId());
+}
+
+} // namespace ns3
@@ -0,0 +1,83 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#ifndef RDMA_TEST_FIXTURE_H
+#define RDMA_TEST_FIXTURE_H
+
+#include "ns3/data-rate.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/node-container.h"
+#include "ns3/nstime.h"
+#include "ns3/qbb-net-device.h"
+#include "ns3/rdma-driver.h"
+#include "ns3/rdma-hw.h"
+#include "ns3/switch-node.h"
+
+#include <utility>
+#include <vector>
+
+/**
+ * \file
+ * Topologies shared by the tests of the qbb devices, RdmaHw, the switches and
+ * the fluid mode.
+ */
+
+namespace ns3
+{
+
+/**
+ * \brief Link a and b with a QbbChannel, through a QbbNetDevice with a
+ * BEgressQueue on each side
+ * \param a the first node
+ * \param b the second node
+ * \param rate the rate of both devices, 8Gb/s is 1ns per byte
+ * \param delay the delay of the channel
+ * \return the devices of a and of b
+ */
+std::pair<Ptr<QbbNetDevice>, Ptr<QbbNetDevice>> QbbLink(Ptr<Node> a,
+                                                        Ptr<Node> b,
+                                                        DataRate rate = DataRate("8Gb/s"),
+                                                        Time delay = Time(0));
+
+/**
+ * \brief Install hw on host with an RdmaDriver, once the links of host are up
+ * \param host the host
+ * \param hw the RdmaHw, with its attributes set
+ * \return the driver
+ */
+Ptr<RdmaDriver> InstallRdma(Ptr<Node> host, Ptr<RdmaHw> hw);
+
+/**
+ * \brief Hosts linked to a single SwitchNode. The hosts get their RdmaHw with
+ * InstallRdma(), then Route() computes and installs the routes.
+ */
+class RdmaStar
+{
+  public:
+    /**
+     * \brief Create the hosts, then the switch, and link them
+     * \param nHosts the number of hosts
+     * \param rate the rate of every device
+     * \param delay the delay of every link
+     */
+    RdmaStar(uint32_t nHosts, DataRate rate, Time delay);
+
+    /// Compute and install the routes of all the nodes
+    void Route(void);
+    /**
+     * \param i the index of a host
+     * \return its address, see RdmaRouteHelper::GetNodeAddress()
+     */
+    Ipv4Address GetAddress(uint32_t i) const;
+
+    NodeContainer nodes;                       //!< the hosts, then the switch
+    std::vector<Ptr<Node>> hosts;              //!< the hosts
+    Ptr<SwitchNode> sw;                        //!< the switch
+    std::vector<Ptr<QbbNetDevice>> hostDevs;   //!< the device of each host
+    std::vector<Ptr<QbbNetDevice>> switchDevs; //!< the device of the switch to each host
+};
+
+} // namespace ns3
+
+#endif /* RDMA_TEST_FIXTURE_H */
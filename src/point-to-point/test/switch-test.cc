@@ -0,0 +1,317 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+#include "rdma-test-fixture.h"
+
+#include "ns3/forwarding-table.h"
+#include "ns3/node.h"
+#include "ns3/nvswitch-node.h"
+#include "ns3/rdma-driver.h"
+#include "ns3/rdma-hw.h"
+#include "ns3/rdma-route-helper.h"
+#include "ns3/simulator.h"
+#include "ns3/switch-byte-counter.h"
+#include "ns3/switch-mmu.h"
+#include "ns3/switch-node.h"
+#include "ns3/test.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * \brief Test the sparse per-(inDev, outDev, qIndex) switch byte accounting
+ */
+class SwitchByteCounterTest : public TestCase
+{
+  public:
+    SwitchByteCounterTest();
+    void DoRun() override;
+};
+
+SwitchByteCounterTest::SwitchByteCounterTest()
+    : TestCase("SwitchByteCounter")
+{
+}
+
+void
+SwitchByteCounterTest::DoRun()
+{
+    SwitchByteCounter counter;
+    counter.Add(1, 1024, 3, 1000);
+    counter.Add(1, 1024, 3, 500);
+    counter.Add(1, 1024, 5, 200);
+    counter.Add(7, 2, 3, 64);
+
+    NS_TEST_EXPECT_MSG_EQ(counter.Get(1, 1024, 3), 1500, "bytes accumulate per queue");
+    NS_TEST_EXPECT_MSG_EQ(counter.Get(1, 1024, 5), 200, "queues are independent");
+    NS_TEST_EXPECT_MSG_EQ(counter.Get(1024, 1, 3), 0, "direction matters");
+    NS_TEST_EXPECT_MSG_EQ(counter.GetNActivePairs(), 2, "only touched pairs are stored");
+
+    counter.Remove(1, 1024, 3, 1500);
+    NS_TEST_EXPECT_MSG_EQ(counter.GetNActivePairs(), 2, "pair kept while a queue is non-empty");
+    counter.Remove(1, 1024, 5, 200);
+    NS_TEST_EXPECT_MSG_EQ(counter.GetNActivePairs(), 1, "drained pair is released");
+    NS_TEST_EXPECT_MSG_EQ(counter.Get(1, 1024, 5), 0, "released pair reads as zero");
+}
+
+/**
+ * \brief Test the per-port state of SwitchMmu, sized to the ports in use
+ */
+class SwitchMmuTest : public TestCase
+{
+  public:
+    SwitchMmuTest();
+    void DoRun() override;
+};
+
+SwitchMmuTest::SwitchMmuTest()
+    : TestCase("SwitchMmu")
+{
+}
+
+void
+SwitchMmuTest::DoRun()
+{
+    Ptr<SwitchMmu> mmu = CreateObject<SwitchMmu>();
+    for (uint32_t i = 1; i <= 4; i++)
+    {
+        mmu->ConfigEcn(i, 10, 20, 0.2);
+        mmu->ConfigHdrm(i, 100 * 1024);
+        mmu->pfc_a_shift[i] = 2;
+    }
+    mmu->ConfigNPort(4);
+    mmu->ConfigBufferSize(4 * 1024 * 1024);
+    NS_TEST_EXPECT_MSG_EQ(mmu->GetNPorts(), 5, "ports sized to the radix");
+    NS_TEST_EXPECT_MSG_LT(mmu->GetMemoryFootprint(), 2048, "no room kept for 1025 ports");
+    NS_TEST_EXPECT_MSG_EQ(mmu->total_hdrm, 4 * 100 * 1024, "total headroom");
+
+    uint32_t thresh = (4 * 1024 * 1024 - 4 * 100 * 1024 - 4 * 4 * 1024) >> 2;
+    NS_TEST_EXPECT_MSG_EQ(mmu->GetPfcThreshold(2), thresh, "pfc threshold");
+    // the reserve first, then the shared buffer
+    mmu->UpdateIngressAdmission(2, 3, 6 * 1024);
+    NS_TEST_EXPECT_MSG_EQ(mmu->GetSharedUsed(2, 3), 2 * 1024, "shared bytes");
+    NS_TEST_EXPECT_MSG_EQ(mmu->shared_used_bytes, 2 * 1024, "switch shared bytes");
+    NS_TEST_EXPECT_MSG_EQ(mmu->GetSharedUsed(2, 4), 0, "other queue");
+    NS_TEST_EXPECT_MSG_EQ(mmu->GetSharedUsed(1, 3), 0, "other port");
+    NS_TEST_EXPECT_MSG_EQ(mmu->CheckShouldPause(2, 3), false, "below the threshold");
+    mmu->UpdateEgressAdmission(3, 3, 25 * 1000);
+    NS_TEST_EXPECT_MSG_EQ(mmu->GetEgressBytes(3, 3), 25 * 1000, "egress bytes");
+    NS_TEST_EXPECT_MSG_EQ(mmu->ShouldSendCN(3, 3), true, "above kmax");
+    mmu->RemoveFromEgressAdmission(3, 3, 25 * 1000);
+    mmu->RemoveFromIngressAdmission(2, 3, 6 * 1024);
+    NS_TEST_EXPECT_MSG_EQ(mmu->shared_used_bytes, 0, "drained");
+
+    // the devices of a switch add their ports, lookups do not
+    Ptr<SwitchNode> sw = CreateObject<SwitchNode>();
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        QbbLink(sw, CreateObject<Node>());
+    }
+    NS_TEST_EXPECT_MSG_EQ(sw->m_mmu->GetNPorts(), 3, "a port per device");
+    sw->m_mmu->UpdateEgressAdmission(2, 1, 100);
+    NS_TEST_EXPECT_MSG_EQ(sw->m_mmu->GetEgressBytes(2, 1), 100, "egress bytes");
+    NS_TEST_EXPECT_MSG_EQ(sw->m_mmu->GetNPorts(), 3, "no port added by a lookup");
+}
+
+/**
+ * \brief Test the lookups and the group sharing of ForwardingTable
+ */
+class ForwardingTableTest : public TestCase
+{
+  public:
+    ForwardingTableTest();
+    void DoRun() override;
+};
+
+ForwardingTableTest::ForwardingTableTest()
+    : TestCase("ForwardingTable")
+{
+}
+
+void
+ForwardingTableTest::DoRun()
+{
+    ForwardingTable table;
+    // 1000 hosts behind 4 uplinks, 24 of them on 2 local ports
+    for (uint32_t id = 0; id < 1000; id++)
+    {
+        uint32_t dip = 0x0b000001 + ((id / 256) << 16) + ((id % 256) << 8);
+        if (id < 24)
+        {
+            table.AddEntry(dip, 1 + id % 2);
+        }
+        else
+        {
+            for (int port = 3; port <= 6; port++)
+            {
+                table.AddEntry(dip, port);
+            }
+        }
+    }
+    NS_TEST_EXPECT_MSG_EQ(table.GetNEntries(), 1000, "entries");
+    NS_TEST_EXPECT_MSG_EQ(table.GetNGroups(), 3, "groups shared by the destinations");
+    NS_TEST_EXPECT_MSG_LT(table.GetMemoryFootprint(), 16 * 1024, "compact table");
+
+    const std::vector<int>* nexthops = table.Lookup(0x0b000001 + (3 << 16) + (5 << 8));
+    NS_TEST_ASSERT_MSG_NE(nexthops, nullptr, "node 773");
+    NS_TEST_EXPECT_MSG_EQ(nexthops->size(), 4, "ECMP ports");
+    NS_TEST_EXPECT_MSG_EQ((*nexthops)[3], 6, "ECMP ports in order");
+    nexthops = table.Lookup(0x0b000001 + (7 << 8));
+    NS_TEST_ASSERT_MSG_NE(nexthops, nullptr, "node 7");
+    NS_TEST_EXPECT_MSG_EQ((*nexthops)[0], 2, "local port");
+    NS_TEST_EXPECT_MSG_EQ(table.Lookup(0x0b000001 + (5 << 16)), nullptr, "no route");
+
+    // an ip outside of the node id scheme, colliding with node 7
+    uint32_t other = 0x0c000701;
+    table.AddEntry(other, 9);
+    NS_TEST_EXPECT_MSG_EQ(table.GetNEntries(), 1001, "entries");
+    nexthops = table.Lookup(other);
+    NS_TEST_ASSERT_MSG_NE(nexthops, nullptr, "other ip");
+    NS_TEST_EXPECT_MSG_EQ((*nexthops)[0], 9, "other ip port");
+    NS_TEST_EXPECT_MSG_EQ((*table.Lookup(0x0b000001 + (7 << 8)))[0], 2, "node 7 kept");
+
+    table.Clear();
+    NS_TEST_EXPECT_MSG_EQ(table.GetNEntries(), 0, "cleared");
+    NS_TEST_EXPECT_MSG_EQ(table.Lookup(other), nullptr, "cleared");
+}
+
+/**
+ * \brief Test the routes computed, cached and installed by RdmaRouteHelper
+ */
+class RdmaRouteHelperTest : public TestCase
+{
+  public:
+    RdmaRouteHelperTest();
+    void DoRun() override;
+};
+
+RdmaRouteHelperTest::RdmaRouteHelperTest()
+    : TestCase("RdmaRouteHelper")
+{
+}
+
+void
+RdmaRouteHelperTest::DoRun()
+{
+    // h0 and h1 share an NVSwitch and two switches, h2 is behind s0 only
+    NodeContainer nodes;
+    std::vector<Ptr<Node>> h;
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        h.push_back(CreateObject<Node>());
+        Ptr<RdmaDriver> driver = CreateObject<RdmaDriver>();
+        driver->m_rdma = CreateObject<RdmaHw>();
+        h[i]->AggregateObject(driver);
+        nodes.Add(h[i]);
+    }
+    Ptr<SwitchNode> s0 = CreateObject<SwitchNode>();
+    Ptr<SwitchNode> s1 = CreateObject<SwitchNode>();
+    Ptr<NVSwitchNode> nv = CreateObject<NVSwitchNode>();
+    nodes.Add(s0);
+    nodes.Add(s1);
+    nodes.Add(nv);
+    uint32_t h0s0 = QbbLink(h[0], s0).first->GetIfIndex();
+    uint32_t h0s1 = QbbLink(h[0], s1).first->GetIfIndex();
+    uint32_t h0nv = QbbLink(h[0], nv).first->GetIfIndex();
+    uint32_t h1s0 = QbbLink(h[1], s0).first->GetIfIndex();
+    QbbLink(h[1], s1);
+    QbbLink(h[1], nv);
+    QbbLink(h[2], s0);
+    uint32_t s0h0 = 0; // the first device of s0
+
+    RdmaRouteHelper routes;
+    routes.SetThreads(2);
+    routes.Compute(nodes);
+    std::vector<uint32_t> expected{h0s0, h0s1, h0nv};
+    NS_TEST_EXPECT_MSG_EQ((routes.GetNextHops(h[0]->GetId(), h[1]->GetId()) == expected),
+                          true,
+                          "ECMP over both switches and the NVSwitch");
+    expected = {h0s0};
+    NS_TEST_EXPECT_MSG_EQ((routes.GetNextHops(h[0]->GetId(), h[2]->GetId()) == expected),
+                          true,
+                          "hosts do not relay");
+    expected = {s0h0};
+    NS_TEST_EXPECT_MSG_EQ((routes.GetNextHops(s0->GetId(), h[0]->GetId()) == expected),
+                          true,
+                          "switch to host");
+    NS_TEST_EXPECT_MSG_EQ(routes.GetNextHops(s0->GetId(), s1->GetId()).size(),
+                          0,
+                          "switches are not destinations");
+
+    routes.Install();
+    Ptr<RdmaHw> rdma = h[0]->GetObject<RdmaDriver>()->m_rdma;
+    uint32_t dip = RdmaRouteHelper::GetNodeAddress(h[1]->GetId()).Get();
+    NS_TEST_ASSERT_MSG_NE(rdma->m_rtTable.Lookup(dip), nullptr, "switch table");
+    NS_TEST_EXPECT_MSG_EQ(rdma->m_rtTable.Lookup(dip)->size(), 2, "switch ports");
+    NS_TEST_ASSERT_MSG_NE(rdma->m_rtTable_nxthop_nvswitch.Lookup(dip), nullptr, "nvswitch table");
+    NS_TEST_EXPECT_MSG_EQ((*rdma->m_rtTable_nxthop_nvswitch.Lookup(dip))[0],
+                          (int)h0nv,
+                          "nvswitch port");
+    rdma = h[1]->GetObject<RdmaDriver>()->m_rdma;
+    dip = RdmaRouteHelper::GetNodeAddress(h[2]->GetId()).Get();
+    NS_TEST_ASSERT_MSG_NE(rdma->m_rtTable.Lookup(dip), nullptr, "switch table");
+    NS_TEST_EXPECT_MSG_EQ((*rdma->m_rtTable.Lookup(dip))[0], (int)h1s0, "switch port");
+
+    // the cache is only loaded on the same topology
+    std::string file = CreateTempDirFilename("routes.bin");
+    NS_TEST_ASSERT_MSG_EQ(routes.Save(file), true, "save");
+    RdmaRouteHelper cached;
+    NS_TEST_ASSERT_MSG_EQ(cached.Load(nodes, file), true, "load");
+    NS_TEST_EXPECT_MSG_EQ((cached.GetNextHops(h[0]->GetId(), h[1]->GetId()) ==
+                           routes.GetNextHops(h[0]->GetId(), h[1]->GetId())),
+                          true,
+                          "loaded routes");
+    // a cache of the same topology with a corrupted record: magic, hash, destinations,
+    // size of the first routes, then its first record [node, n, n interfaces]
+    auto corrupt = [&file](long offset, uint32_t value) {
+        FILE* f = fopen(file.c_str(), "r+b");
+        fseek(f, offset, SEEK_SET);
+        fwrite(&value, sizeof(value), 1, f);
+        fclose(f);
+    };
+    corrupt(24, 1000);
+    NS_TEST_EXPECT_MSG_EQ(cached.Load(nodes, file), false, "node out of range");
+    routes.Save(file);
+    corrupt(28, 1000);
+    NS_TEST_EXPECT_MSG_EQ(cached.Load(nodes, file), false, "record past the routes");
+    NS_TEST_EXPECT_MSG_EQ(cached.GetNextHops(h[0]->GetId(), h[1]->GetId()).size(),
+                          0,
+                          "nothing loaded");
+    routes.Save(file);
+    corrupt(20, 0x10000000);
+    NS_TEST_EXPECT_MSG_EQ(cached.Load(nodes, file), false, "routes larger than the graph");
+    routes.Save(file);
+    QbbLink(h[2], s1);
+    NS_TEST_EXPECT_MSG_EQ(cached.Load(nodes, file), false, "topology changed");
+    remove(file.c_str());
+
+    Simulator::Destroy();
+}
+
+/**
+ * \brief TestSuite for the switches
+ */
+class SwitchTestSuite : public TestSuite
+{
+  public:
+    /**
+     * \brief Constructor
+     */
+    SwitchTestSuite();
+};
+
+SwitchTestSuite::SwitchTestSuite()
+    : TestSuite("devices-point-to-point-switch", Type::UNIT)
+{
+    AddTestCase(new SwitchByteCounterTest, TestCase::Duration::QUICK);
+    AddTestCase(new SwitchMmuTest, TestCase::Duration::QUICK);
+    AddTestCase(new ForwardingTableTest, TestCase::Duration::QUICK);
+    AddTestCase(new RdmaRouteHelperTest, TestCase::Duration::QUICK);
+}
+
+static SwitchTestSuite g_switchTestSuite; //!< The testsuite
@@ -0,0 +1,221 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+// This program benchmarks the per-hop cost of stamping the INT header of a
+// data packet at switch dequeue: the old scratch-copy path (allocate and copy
+// the whole packet, then discard the copy) against the in-place path through
+// Packet::PeekMutableHeader.
+// Sample usage:  ./ns3 run 'bench-int-stamp --n=100000 --hops=5'
+
+#include "ns3/command-line.h"
+#include "ns3/int-header.h"
+#include "ns3/packet.h"
+#include "ns3/system-wall-clock-ms.h"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <stdlib.h> // for exit ()
+
+using namespace ns3;
+
+/// Offsets of the headers built by RdmaHw::GetNxtPacket, as seen by SwitchNode
+static const uint32_t l3Offset = 14;                       // ppp
+static const uint32_t intOffset = l3Offset + 20 + 8 + 10; // ip, udp, SeqTs
+
+static uint32_t g_payloadSize = 1000; //!< payload bytes after the INT header
+static uint32_t g_hops = 5;           //!< INT stamps per packet
+
+/// Raw ppp/ip/udp/SeqTs/INT bytes with the IP protocol set to UDP
+class BenchRdmaHeader : public Header
+{
+  public:
+    static TypeId
+    GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::BenchRdmaHeader").SetParent<Header>();
+        return tid;
+    }
+
+    TypeId
+    GetInstanceTypeId() const override
+    {
+        return GetTypeId();
+    }
+
+    void
+    Print(std::ostream& os) const override
+    {
+    }
+
+    uint32_t
+    GetSerializedSize() const override
+    {
+        return intOffset + IntHeader::GetStaticSize();
+    }
+
+    void
+    Serialize(Buffer::Iterator start) const override
+    {
+        start.WriteU8(0, l3Offset + 9);
+        start.WriteU8(0x11); // udp
+        start.WriteU8(0, GetSerializedSize() - l3Offset - 10);
+    }
+
+    uint32_t
+    Deserialize(Buffer::Iterator start) override
+    {
+        return GetSerializedSize();
+    }
+};
+
+static Ptr<Packet>
+MakePacket()
+{
+    Ptr<Packet> p = Create<Packet>(g_payloadSize);
+    p->AddHeader(BenchRdmaHeader());
+    return p;
+}
+
+static void
+StampCopy(Ptr<Packet> p, uint32_t hop)
+{
+    uint8_t* buf = new uint8_t[p->GetSize()];
+    p->CopyData(buf, p->GetSize());
+    if (buf[l3Offset + 9] == 0x11)
+    {
+        IntHeader* ih = (IntHeader*)&buf[intOffset];
+        ih->PushHop(hop, hop * 1000, hop * 80, 100000000000lu);
+    }
+    delete[] buf;
+}
+
+static void
+StampInPlace(Ptr<Packet> p, uint32_t hop)
+{
+    uint8_t buf[l3Offset + 20];
+    if (p->CopyData(buf, sizeof(buf)) == sizeof(buf) && buf[l3Offset + 9] == 0x11)
+    {
+        IntHeader* ih = p->PeekMutableHeader<IntHeader>(intOffset);
+        if (ih)
+        {
+            ih->PushHop(hop, hop * 1000, hop * 80, 100000000000lu);
+        }
+    }
+}
+
+static void
+benchCreate(uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+    {
+        Ptr<Packet> p = MakePacket();
+    }
+}
+
+static void
+benchCopy(uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+    {
+        Ptr<Packet> p = MakePacket();
+        for (uint32_t h = 0; h < g_hops; h++)
+        {
+            StampCopy(p, h);
+        }
+    }
+}
+
+static void
+benchInPlace(uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+    {
+        Ptr<Packet> p = MakePacket();
+        for (uint32_t h = 0; h < g_hops; h++)
+        {
+            StampInPlace(p, h);
+        }
+    }
+}
+
+static void
+benchInPlaceShared(uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+    {
+        Ptr<Packet> p = MakePacket();
+        for (uint32_t h = 0; h < g_hops; h++)
+        {
+            // each hop receives a copy which still shares its bytes
+            p = p->Copy();
+            StampInPlace(p, h);
+        }
+    }
+}
+
+static uint64_t
+runBenchOneIteration(void (*bench)(uint32_t), uint32_t n)
+{
+    SystemWallClockMs time;
+    time.Start();
+    (*bench)(n);
+    uint64_t deltaMs = time.End();
+    return deltaMs;
+}
+
+static uint64_t
+runBench(void (*bench)(uint32_t), uint32_t n, uint32_t minIterations, const char* name)
+{
+    uint64_t minDelay = std::numeric_limits<uint64_t>::max();
+    for (uint32_t i = 0; i < minIterations; i++)
+    {
+        uint64_t delay = runBenchOneIteration(bench, n);
+        minDelay = std::min(minDelay, delay);
+    }
+    double ns = minDelay * 1e6 / ((double)n * g_hops);
+    std::cout << ns << " ns/hop"
+              << " (" << minDelay << " ms elapsed)\t" << name << std::endl;
+    return minDelay;
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t n = 0;
+    uint32_t minIterations = 1;
+
+    CommandLine cmd(__FILE__);
+    cmd.Usage("Benchmark INT stamping at switch dequeue");
+    cmd.AddValue("n", "number of packets", n);
+    cmd.AddValue("hops", "number of INT stamps per packet", g_hops);
+    cmd.AddValue("size", "payload size of each packet", g_payloadSize);
+    cmd.AddValue("min-iterations",
+                 "number of subiterations to minimize iteration time over",
+                 minIterations);
+    cmd.Parse(argc, argv);
+
+    if (n == 0)
+    {
+        std::cerr << "Error-- number of packets must be specified "
+                  << "by command-line argument --n=(number of packets)" << std::endl;
+        exit(1);
+    }
+    IntHeader::mode = IntHeader::NORMAL;
+    std::cout << "Running bench-int-stamp with n=" << n << " hops=" << g_hops
+              << " size=" << g_payloadSize << std::endl;
+
+    uint64_t createMs = runBench(&benchCreate, n, minIterations, "Create packets only");
+    uint64_t copyMs = runBench(&benchCopy, n, minIterations, "Scratch copy per hop");
+    uint64_t inPlaceMs = runBench(&benchInPlace, n, minIterations, "In place");
+    runBench(&benchInPlaceShared, n, minIterations, "In place, shared bytes");
+    if (inPlaceMs > createMs)
+    {
+        // compare the stamping cost alone, without packet creation
+        std::cout << "per-hop speedup: " << (double)(copyMs - createMs) / (inPlaceMs - createMs)
+                  << "x" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,197 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+// This program benchmarks the hybrid fluid mode of RdmaFluidEngine on a ring
+// allreduce of hosts behind one switch: 2 * (hosts - 1) steps, in which each
+// host sends a chunk to the next one. A step ends when every qp of the step
+// completed on its last ACK. It runs the allreduce in packet mode and in
+// hybrid mode, and reports the error of the end of each step and the speedup
+// in wall clock time. With --cross, another qp shares the path of a ring qp in
+// the middle step, which drops them back to packet mode. In a ring, each NIC
+// sends the ACKs of the chunk it receives, so that few qps are fast
+// forwarded; with --halves, each host of the first half sends its chunk to
+// the host of the second half across, whose NIC sends nothing else.
+// Sample usage:  ./ns3 run 'bench-rdma-fluid --hosts=8 --size=16000000 --cross=1'
+
+#include "ns3/command-line.h"
+#include "ns3/node-container.h"
+#include "ns3/qbb-channel.h"
+#include "ns3/qbb-net-device.h"
+#include "ns3/rdma-driver.h"
+#include "ns3/rdma-fluid-engine.h"
+#include "ns3/rdma-hw.h"
+#include "ns3/rdma-route-helper.h"
+#include "ns3/simulator.h"
+#include "ns3/switch-node.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+using namespace ns3;
+
+static uint32_t g_hosts = 8;        //!< hosts of the ring
+static uint64_t g_size = 16000000;  //!< bytes of each host, a chunk is g_size / g_hosts
+static uint32_t g_mtu = 1000;       //!< payload of a packet
+static bool g_cross = false;        //!< another qp in the middle step
+static bool g_halves = false;       //!< the first half of the hosts sends to the second one
+static std::vector<Ptr<Node>> g_h;  //!< hosts
+static std::vector<Ptr<RdmaHw>> g_hw;
+static uint32_t g_step;             //!< current step
+static uint32_t g_left;             //!< qps of the step not completed yet
+static std::vector<int64_t> g_ends; //!< time step of the end of each step
+
+static void
+AddQp(uint32_t src, uint32_t dst, uint32_t idx, uint64_t size)
+{
+    Ipv4Address sip = RdmaRouteHelper::GetNodeAddress(g_h[src]->GetId());
+    Ipv4Address dip = RdmaRouteHelper::GetNodeAddress(g_h[dst]->GetId());
+    uint16_t sport = 10000 + g_step * (g_hosts + 1) + idx;
+    g_hw[src]->AddQueuePair(src, dst, idx, size, 3, sip, dip, sport, 100, 0, 4000, {}, {});
+}
+
+static void
+StartStep(void)
+{
+    uint64_t chunk = g_size / g_hosts;
+    bool cross = g_cross && g_step == g_hosts - 1;
+    uint32_t half = g_hosts / 2;
+    g_left = (g_halves ? half : g_hosts) + cross;
+    for (uint32_t i = 0; i < g_left - cross; i++)
+    {
+        AddQp(i, g_halves ? i + half : (i + 1) % g_hosts, i, chunk);
+    }
+    if (cross)
+    { // shares the NIC of host 0 and the switch port to the host after the next one
+        AddQp(0, g_halves ? half + 1 : 2, g_left - 1, chunk);
+    }
+}
+
+static void
+Completed(Ptr<RdmaQueuePair> qp)
+{
+    if (--g_left > 0)
+        return;
+    g_ends.push_back(Simulator::Now().GetTimeStep());
+    if (++g_step < 2 * (g_hosts - 1))
+        Simulator::ScheduleNow(&StartStep);
+}
+
+static uint64_t
+Run(bool fluid, uint64_t& events, uint64_t& started, uint64_t& fluidPackets)
+{
+    g_h.clear();
+    g_hw.clear();
+    g_ends.clear();
+    g_step = 0;
+
+    NodeContainer nodes;
+    for (uint32_t i = 0; i < g_hosts; i++)
+    {
+        g_h.push_back(CreateObject<Node>());
+        nodes.Add(g_h[i]);
+    }
+    Ptr<SwitchNode> sw = CreateObject<SwitchNode>();
+    nodes.Add(sw);
+    for (uint32_t i = 0; i < g_hosts; i++)
+    {
+        Ptr<QbbChannel> channel = CreateObject<QbbChannel>();
+        channel->SetAttribute("Delay", TimeValue(MicroSeconds(1)));
+        Ptr<QbbNetDevice> devH = CreateObject<QbbNetDevice>();
+        Ptr<QbbNetDevice> devS = CreateObject<QbbNetDevice>();
+        devH->SetQueue(CreateObject<BEgressQueue>());
+        devS->SetQueue(CreateObject<BEgressQueue>());
+        devH->SetDataRate(DataRate("100Gb/s"));
+        devS->SetDataRate(DataRate("100Gb/s"));
+        g_h[i]->AddDevice(devH);
+        sw->AddDevice(devS);
+        devH->Attach(channel);
+        devS->Attach(channel);
+    }
+    Ptr<RdmaFluidEngine> engine = CreateObject<RdmaFluidEngine>();
+    for (uint32_t i = 0; i < g_hosts; i++)
+    {
+        Ptr<RdmaDriver> driver = CreateObject<RdmaDriver>();
+        g_hw.push_back(CreateObject<RdmaHw>());
+        g_hw[i]->SetAttribute("Mtu", UintegerValue(g_mtu));
+        g_hw[i]->SetAttribute("L2AckInterval", UintegerValue(1));
+        if (fluid)
+            g_hw[i]->SetFluidEngine(engine);
+        driver->SetNode(g_h[i]);
+        driver->SetRdmaHw(g_hw[i]);
+        g_h[i]->AggregateObject(driver);
+        driver->Init();
+        driver->TraceConnectWithoutContext("QpComplete", MakeCallback(&Completed));
+    }
+    RdmaRouteHelper routes;
+    routes.Compute(nodes);
+    routes.Install();
+
+    SystemWallClockMs time;
+    time.Start();
+    StartStep();
+    Simulator::Run();
+    uint64_t ms = time.End();
+    events = Simulator::GetEventCount();
+    started = engine->GetNStarted();
+    fluidPackets = engine->GetFluidPackets();
+    Simulator::Destroy();
+    return ms;
+}
+
+int
+main(int argc, char* argv[])
+{
+    CommandLine cmd(__FILE__);
+    cmd.Usage("Benchmark the hybrid fluid mode of RdmaFluidEngine on a ring allreduce");
+    cmd.AddValue("hosts", "number of hosts of the ring", g_hosts);
+    cmd.AddValue("size", "bytes reduced by each host", g_size);
+    cmd.AddValue("mtu", "payload size of each packet", g_mtu);
+    cmd.AddValue("cross", "another qp on the path of a ring qp in the middle step", g_cross);
+    cmd.AddValue("halves", "the first half of the hosts sends to the second one", g_halves);
+    cmd.Parse(argc, argv);
+    g_hosts = std::max<uint32_t>(g_hosts, 3);
+    std::cout << "Running bench-rdma-fluid with hosts=" << g_hosts << " size=" << g_size
+              << " mtu=" << g_mtu << " cross=" << g_cross << " halves=" << g_halves
+              << std::endl;
+
+    uint64_t events;
+    uint64_t started;
+    uint64_t fluidPackets;
+    uint64_t packetMs = Run(false, events, started, fluidPackets);
+    std::vector<int64_t> packetEnds = g_ends;
+    std::cout << "packet mode: " << packetMs << " ms, " << events << " events" << std::endl;
+    uint64_t fluidMs = Run(true, events, started, fluidPackets);
+    std::cout << "hybrid mode: " << fluidMs << " ms, " << events << " events, " << started
+              << " flows fast forwarded, " << fluidPackets << " packets not sent" << std::endl;
+
+    if (g_ends.size() != packetEnds.size() || packetEnds.empty())
+    {
+        std::cerr << "Error-- the allreduce did not complete" << std::endl;
+        return 1;
+    }
+    double maxErr = 0;
+    int64_t prev = 0;
+    for (std::size_t i = 0; i < packetEnds.size(); i++)
+    {
+        // error of the duration of the step, relative to packet mode
+        int64_t dPacket = packetEnds[i] - prev;
+        int64_t dFluid = g_ends[i] - (i > 0 ? g_ends[i - 1] : 0);
+        maxErr = std::max(maxErr, std::abs((double)(dFluid - dPacket)) / dPacket);
+        prev = packetEnds[i];
+    }
+    double totalErr = std::abs((double)(g_ends.back() - packetEnds.back())) / packetEnds.back();
+    std::cout << "completion time: " << packetEnds.back() << " ns in packet mode, "
+              << g_ends.back() << " ns in hybrid mode" << std::endl;
+    std::cout << "error: " << totalErr * 100 << "% total, " << maxErr * 100
+              << "% max per step" << std::endl;
+    if (fluidMs > 0)
+    {
+        std::cout << "speedup: " << (double)packetMs / fluidMs << "x" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+// This program benchmarks the packets/sec of RdmaHw::GetNxtPacket on the NIC
+// send path: the per-packet path adding SimpleSeqTsHeader, UdpHeader,
+// Ipv4Header and PppHeader one by one, against the per-qp header template.
+// Sample usage:  ./ns3 run 'bench-rdma-packets --n=1000000 --mtu=1000'
+
+#include "ns3/boolean.h"
+#include "ns3/command-line.h"
+#include "ns3/int-header.h"
+#include "ns3/rdma-hw.h"
+#include "ns3/rdma-queue-pair.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <stdlib.h> // for exit ()
+
+using namespace ns3;
+
+static Ptr<RdmaHw> g_hw;
+
+static void
+bench(uint32_t n)
+{
+    Ptr<RdmaQueuePair> qp = CreateObject<RdmaQueuePair>(3,
+                                                        Ipv4Address("11.0.0.1"),
+                                                        Ipv4Address("11.0.1.1"),
+                                                        10000,
+                                                        100);
+    qp->SetSize((uint64_t)n * g_hw->m_mtu);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        Ptr<Packet> p = g_hw->GetNxtPacket(qp);
+    }
+}
+
+static uint64_t
+runBench(bool hdrTemplate, uint32_t n, uint32_t minIterations, const char* name)
+{
+    g_hw->SetAttribute("HeaderTemplate", BooleanValue(hdrTemplate));
+    uint64_t minDelay = std::numeric_limits<uint64_t>::max();
+    for (uint32_t i = 0; i < minIterations; i++)
+    {
+        SystemWallClockMs time;
+        time.Start();
+        bench(n);
+        minDelay = std::min(minDelay, (uint64_t)time.End());
+    }
+    double pps = minDelay == 0 ? 0 : n * 1e3 / minDelay;
+    std::cout << pps << " packets/s"
+              << " (" << minDelay << " ms elapsed)\t" << name << std::endl;
+    return minDelay;
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t n = 0;
+    uint32_t mtu = 1000;
+    uint32_t intMode = IntHeader::NORMAL;
+    uint32_t minIterations = 1;
+
+    CommandLine cmd(__FILE__);
+    cmd.Usage("Benchmark data packet creation in RdmaHw::GetNxtPacket");
+    cmd.AddValue("n", "number of packets", n);
+    cmd.AddValue("mtu", "payload size of each packet", mtu);
+    cmd.AddValue("int", "IntHeader mode (0: NORMAL, 1: TS, 2: PINT, 3: NONE)", intMode);
+    cmd.AddValue("min-iterations",
+                 "number of subiterations to minimize iteration time over",
+                 minIterations);
+    cmd.Parse(argc, argv);
+
+    if (n == 0)
+    {
+        std::cerr << "Error-- number of packets must be specified "
+                  << "by command-line argument --n=(number of packets)" << std::endl;
+        exit(1);
+    }
+    IntHeader::mode = (IntHeader::Mode)intMode;
+    g_hw = CreateObject<RdmaHw>();
+    g_hw->SetAttribute("Mtu", UintegerValue(mtu));
+    std::cout << "Running bench-rdma-packets with n=" << n << " mtu=" << mtu
+              << " int=" << intMode << std::endl;
+
+    uint64_t oldMs = runBench(false, n, minIterations, "Header by header");
+    uint64_t newMs = runBench(true, n, minIterations, "Header template");
+    if (newMs > 0)
+    {
+        std::cout << "speedup: " << (double)oldMs / newMs << "x" << std::endl;
+    }
+    g_hw = nullptr;
+
+    return 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+// This program benchmarks the per-hop cost of the switch dequeue path of
+// QbbNetDevice: the old path, which copied each packet and parsed its ppp and
+// ip headers into a copy it never used, and kept the ingress port in a
+// FlowIdTag, against the current one, which only looks at the ingress port
+// stored inline in the packet and at the first bytes of the packet.
+// Sample usage:  ./ns3 run 'bench-switch-dequeue --n=100000 --hops=5'
+
+#include "ns3/command-line.h"
+#include "ns3/flow-id-tag.h"
+#include "ns3/int-header.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ppp-header.h"
+#include "ns3/rdma-hw.h"
+#include "ns3/rdma-queue-pair.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <stdlib.h> // for exit ()
+#include <vector>
+
+using namespace ns3;
+
+static uint32_t g_hops = 5; //!< switches crossed by each packet
+static std::vector<Ptr<Packet>> g_packets;
+
+static void
+HopCopy(Ptr<Packet> p)
+{
+    p->AddPacketTag(FlowIdTag(1)); // ingress
+    Ptr<Packet> packet = p->Copy();
+    PppHeader ppp;
+    packet->RemoveHeader(ppp);
+    Ipv4Header h;
+    packet->RemoveHeader(h);
+    // what SwitchNode::SwitchNotifyDequeue reads
+    FlowIdTag t;
+    p->PeekPacketTag(t);
+    uint8_t buf[14 + 20];
+    p->CopyData(buf, sizeof(buf));
+    p->RemovePacketTag(t);
+}
+
+static void
+HopNoCopy(Ptr<Packet> p)
+{
+    p->SetIngressPort(1); // ingress
+    // what SwitchNode::SwitchNotifyDequeue reads
+    p->GetIngressPort();
+    uint8_t buf[14 + 20];
+    p->CopyData(buf, sizeof(buf));
+    p->ResetMeta();
+}
+
+static uint64_t
+runBench(void (*hop)(Ptr<Packet>), uint32_t minIterations, const char* name)
+{
+    uint64_t minDelay = std::numeric_limits<uint64_t>::max();
+    for (uint32_t i = 0; i < minIterations; i++)
+    {
+        SystemWallClockMs time;
+        time.Start();
+        for (auto& p : g_packets)
+        {
+            for (uint32_t h = 0; h < g_hops; h++)
+            {
+                (*hop)(p);
+            }
+        }
+        minDelay = std::min(minDelay, (uint64_t)time.End());
+    }
+    double ns = minDelay * 1e6 / ((double)g_packets.size() * g_hops);
+    std::cout << ns << " ns/hop"
+              << " (" << minDelay << " ms elapsed)\t" << name << std::endl;
+    return minDelay;
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t n = 0;
+    uint32_t mtu = 1000;
+    uint32_t minIterations = 1;
+
+    CommandLine cmd(__FILE__);
+    cmd.Usage("Benchmark the per-hop cost of the switch dequeue path");
+    cmd.AddValue("n", "number of packets", n);
+    cmd.AddValue("hops", "number of switches crossed by each packet", g_hops);
+    cmd.AddValue("mtu", "payload size of each packet", mtu);
+    cmd.AddValue("min-iterations",
+                 "number of subiterations to minimize iteration time over",
+                 minIterations);
+    cmd.Parse(argc, argv);
+
+    if (n == 0)
+    {
+        std::cerr << "Error-- number of packets must be specified "
+                  << "by command-line argument --n=(number of packets)" << std::endl;
+        exit(1);
+    }
+    IntHeader::mode = IntHeader::NORMAL;
+    std::cout << "Running bench-switch-dequeue with n=" << n << " hops=" << g_hops
+              << " mtu=" << mtu << std::endl;
+
+    // data packets as the NICs send them
+    Ptr<RdmaHw> hw = CreateObject<RdmaHw>();
+    hw->SetAttribute("Mtu", UintegerValue(mtu));
+    Ptr<RdmaQueuePair> qp = CreateObject<RdmaQueuePair>(3,
+                                                        Ipv4Address("11.0.0.1"),
+                                                        Ipv4Address("11.0.1.1"),
+                                                        10000,
+                                                        100);
+    qp->SetSize((uint64_t)n * mtu);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        g_packets.push_back(hw->GetNxtPacket(qp));
+    }
+
+    uint64_t copyMs = runBench(&HopCopy, minIterations, "Copy and parse per hop");
+    uint64_t noCopyMs = runBench(&HopNoCopy, minIterations, "No copy, inline ingress port");
+    if (noCopyMs > 0)
+    {
+        std::cout << "per-hop speedup: " << (double)copyMs / noCopyMs << "x" << std::endl;
+    }
+    g_packets.clear();
+
+    return 0;
+}
@@ -0,0 +1,49 @@
+#!/usr/bin/env python3
+"""
+Convert the binary records of ns3::MonitorWriter to the text lines the
+monitors print in TEXT mode.
+
+Usage: monitor-to-csv.py <binary file> [output file]
+"""
+
+import struct
+import sys
+
+# record type -> (struct layout after the type byte, text line)
+RECORDS = {
+    1: ("<QIIIQQ", "{}, {}, {}, {}, {}, {}\n"),  # QLEN
+    2: ("<QIId", "{}, {}, {}, {:f}\n"),  # SWITCH_BW
+    3: ("<QIId", "{}, {}, {}, {:f}\n"),  # HOST_BW
+    4: ("<QIIHHQQ", "{}, {}, {}, {}, {}, {}, {}\n"),  # QP_RATE
+    5: ("<QIIHHQQ", "{}, {}, {}, {}, {}, {}, {}\n"),  # QP_CNP
+}
+
+
+def convert(data, out):
+    offset = 0
+    while offset < len(data):
+        record_type = data[offset]
+        if record_type not in RECORDS:
+            raise ValueError("unknown record type %d at offset %d" % (record_type, offset))
+        layout, line = RECORDS[record_type]
+        fields = struct.unpack_from(layout, data, offset + 1)
+        out.write(line.format(*fields))
+        offset += 1 + struct.calcsize(layout)
+
+
+def main(argv):
+    if len(argv) not in (2, 3):
+        print(__doc__.strip(), file=sys.stderr)
+        return 1
+    with open(argv[1], "rb") as f:
+        data = f.read()
+    if len(argv) == 3:
+        with open(argv[2], "w") as out:
+            convert(data, out)
+    else:
+        convert(data, sys.stdout)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))